@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <xlnt/xlnt.hpp>
+
+int current_time()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return static_cast<int>(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+// Fill a worksheet with a lattice of formulas where each cell depends on the
+// three cells above it. Every row forms one level of the dependency graph and
+// the formulas within a row can be evaluated independently of each other.
+void build_lattice(xlnt::worksheet ws, int cols, int rows)
+{
+    for (int col = 1; col <= cols; col++)
+    {
+        ws.get_cell(xlnt::cell_reference(col, 1)).set_value(col);
+    }
+
+    for (int row = 2; row <= rows; row++)
+    {
+        for (int col = 1; col <= cols; col++)
+        {
+            auto left = xlnt::cell_reference(std::max(col - 1, 1), row - 1).to_string();
+            auto above = xlnt::cell_reference(col, row - 1).to_string();
+            auto right = xlnt::cell_reference(std::min(col + 1, cols), row - 1).to_string();
+
+            ws.get_cell(xlnt::cell_reference(col, row)).set_formula(
+                "(" + left + "+" + above + "+" + right + ")/3+IF(" + above + ">" + left + ",1,0)");
+        }
+    }
+}
+
+// Recalculate the whole lattice by changing every input in the first row.
+int recalculate(xlnt::workbook &wb, int cols, int seed)
+{
+    auto ws = wb.get_active_sheet();
+
+    for (int col = 1; col <= cols; col++)
+    {
+        ws.get_cell(xlnt::cell_reference(col, 1)).set_value(col + seed);
+    }
+
+    auto start = current_time();
+    wb.calculate();
+
+    return current_time() - start;
+}
+
+void benchmark(int cols, int rows)
+{
+    std::cout << cols << " cols " << rows << " rows (" << cols * (rows - 1) << " formulas)" << std::endl;
+
+    xlnt::workbook wb;
+    build_lattice(wb.get_active_sheet(), cols, rows);
+
+    // the first calculation also compiles the formulas and builds the dependency graph
+    auto start = current_time();
+    wb.calculate();
+    std::cout << "  initial calculation " << current_time() - start << "ms" << std::endl;
+
+    const int repeat = 3;
+    int single_threaded = 0;
+
+    for (std::size_t threads : { 1, 2, 4, 8 })
+    {
+        xlnt::calculation_properties properties;
+        properties.thread_count = threads;
+        wb.set_calculation_properties(properties);
+
+        int best = std::numeric_limits<int>::max();
+
+        for (int i = 0; i < repeat; i++)
+        {
+            best = std::min(best, recalculate(wb, cols, i + 1));
+        }
+
+        if (threads == 1)
+        {
+            single_threaded = best;
+        }
+
+        std::cout << "  " << threads << " threads " << best << "ms, speedup "
+            << single_threaded / static_cast<double>(std::max(best, 1)) << "x" << std::endl;
+    }
+}
+
+int main()
+{
+    benchmark(1000, 100);
+    benchmark(10000, 50);
+    benchmark(100, 1000);
+
+    return 0;
+}
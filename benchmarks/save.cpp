@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <xlnt/xlnt.hpp>
+
+int current_time()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return static_cast<int>(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+// Fill a worksheet with numbers, half of them integers and half of them
+// fractions, so that saving it is dominated by writing the cells of sheetData.
+void fill(xlnt::worksheet ws, int cols, int rows)
+{
+    for (int row = 1; row <= rows; row++)
+    {
+        for (int col = 1; col <= cols; col++)
+        {
+            auto cell = ws.get_cell(xlnt::cell_reference(col, row));
+
+            if (col % 2 == 0)
+            {
+                cell.set_value(row * col);
+            }
+            else
+            {
+                cell.set_value(row * 0.37 + col);
+            }
+        }
+    }
+}
+
+void benchmark(int cols, int rows)
+{
+    std::cout << cols << " cols " << rows << " rows (" << static_cast<long long>(cols) * rows << " cells)" << std::endl;
+
+    xlnt::workbook wb;
+    fill(wb.get_active_sheet(), cols, rows);
+
+    const int repeat = 3;
+    int best = std::numeric_limits<int>::max();
+    std::size_t size = 0;
+
+    for (int i = 0; i < repeat; i++)
+    {
+        std::vector<std::uint8_t> data;
+        auto start = current_time();
+        wb.save(data);
+        best = std::min(best, current_time() - start);
+        size = data.size();
+    }
+
+    std::cout << "  save " << best << "ms, " << size << " bytes" << std::endl;
+}
+
+// The number of rows can be given as the only argument since a million rows
+// of 100 columns needs more memory than many machines have.
+int main(int argc, char *argv[])
+{
+    const int rows = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    benchmark(100, rows);
+
+    return 0;
+}
@@ -66,8 +66,11 @@ SET(SOURCES ${CELL_SOURCES} ${CHARTS_SOURCES} ${CHARTSHEET_SOURCES} ${DRAWING_SO
 SET(MINIZ ../third-party/miniz/miniz.c ../third-party/miniz/miniz.h)
 SET(LIBSTUDXML ../third-party/libstudxml/xml/parser.cxx ../third-party/libstudxml/xml/qname.cxx ../third-party/libstudxml/xml/serializer.cxx ../third-party/libstudxml/xml/value-traits.cxx ../third-party/libstudxml/xml/details/expat/xmlparse.c ../third-party/libstudxml/xml/details/expat/xmlrole.c ../third-party/libstudxml/xml/details/expat/xmltok_impl.c ../third-party/libstudxml/xml/details/expat/xmltok_ns.c ../third-party/libstudxml/xml/details/expat/xmltok.c ../third-party/libstudxml/xml/details/genx/char-props.c ../third-party/libstudxml/xml/details/genx/genx.c)
 
+find_package(Threads REQUIRED)
+
 if(SHARED)
     add_library(xlnt.shared SHARED ${HEADERS} ${SOURCES} ${MINIZ} ${LIBSTUDXML})
+    target_link_libraries(xlnt.shared ${CMAKE_THREAD_LIBS_INIT})
     target_compile_definitions(xlnt.shared PRIVATE XLNT_SHARED=1 LIBSTUDXML_STATIC_LIB=1)
     if(MSVC)
         target_compile_definitions(xlnt.shared PRIVATE XLNT_EXPORT=1 _CRT_SECURE_NO_WARNINGS=1)
@@ -102,6 +105,7 @@ endif()
 
 if(STATIC)
     add_library(xlnt.static STATIC ${HEADERS} ${SOURCES} ${MINIZ} ${LIBSTUDXML})
+    target_link_libraries(xlnt.static ${CMAKE_THREAD_LIBS_INIT})
     target_compile_definitions(xlnt.static PUBLIC XLNT_STATIC=1)
     target_compile_definitions(xlnt.static PRIVATE LIBSTUDXML_STATIC_LIB=1)
     if(MSVC)
@@ -61,6 +61,7 @@ namespace detail {
 class xlsx_consumer;
 class xlsx_producer;
 struct cell_impl; 
+struct worksheet_impl;
 
 } // namespace detail
 
@@ -385,6 +386,8 @@ public:
     /// Make this a merged cell iff merged is true.
     /// Generally, this shouldn't be called directly. Instead,
     /// use worksheet::merge_cells on its parent worksheet.
+    /// A cell inside a larger merged range of the worksheet stays merged
+    /// when merged is false.
     /// </summary>
     void set_merged(bool merged);
 
@@ -487,14 +490,52 @@ private:
 	format &get_format_internal();
 
     /// <summary>
-    /// Private constructor to create a cell from its implementation.
+    /// Notify the workbook's formula engine that this cell's value or formula changed
+    /// so that dependent formulas are recalculated.
     /// </summary>
-    cell(detail::cell_impl *d);
+    void mark_dirty();
+
+    /// <summary>
+    /// Points to the implementation of a cell. A copied worksheet shares its cells
+    /// with the copy until a block of them is modified, at which point the block
+    /// is copied and its cells move. The implementation is looked up again after
+    /// that happened to the worksheet this cell belongs to. Non-const access
+    /// copies the block first if it's shared so that the copy doesn't change.
+    /// </summary>
+    class impl_pointer
+    {
+    public:
+        impl_pointer(detail::cell_impl *d, detail::worksheet_impl *parent);
+
+        detail::cell_impl *operator->();
+        detail::cell_impl *operator->() const;
+        detail::cell_impl &operator*();
+        detail::cell_impl &operator*() const;
+
+        /// <summary>
+        /// Returns the current implementation without copying anything.
+        /// </summary>
+        detail::cell_impl *get() const;
+
+        detail::worksheet_impl *parent() const;
+
+    private:
+        mutable detail::cell_impl *d_;
+        detail::worksheet_impl *parent_;
+        mutable std::size_t generation_;
+        row_t row_;
+        column_t::index_t column_;
+    };
+
+    /// <summary>
+    /// Private constructor to create a cell from its implementation and the worksheet it belongs to.
+    /// </summary>
+    cell(detail::cell_impl *d, detail::worksheet_impl *parent);
 
     /// <summary>
     /// A pointer to this cell's implementation.
     /// </summary>
-    detail::cell_impl *d_;
+    impl_pointer d_;
 };
 
 } // namespace xlnt
@@ -0,0 +1,92 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <xlnt/xlnt_config.hpp>
+
+namespace xlnt {
+
+struct compressed_file;
+
+namespace detail {
+struct deflate_cache_impl;
+} // namespace detail
+
+/// <summary>
+/// Remembers the deflated form of parts so that a part whose content was
+/// already compressed by an earlier save is copied instead of compressed again.
+/// Parts are looked up by the SHA-256 digest, size and CRC-32 of their content,
+/// and only their compressed bytes are kept. The least recently used parts are
+/// dropped once the compressed bytes kept exceed the capacity. A cache can be shared by saves on several threads. Pass one to
+/// workbook::save with save_options::compression_cache.
+/// </summary>
+class XLNT_CLASS deflate_cache
+{
+public:
+	/// <summary>
+	/// Construct an empty cache that keeps at most capacity compressed bytes of parts.
+	/// </summary>
+	deflate_cache(std::size_t capacity = 64 * 1024 * 1024);
+	~deflate_cache();
+
+	/// <summary>
+	/// Return content deflated by zip_file::precompress, compressing it first
+	/// and keeping the result if it isn't in the cache.
+	/// </summary>
+	std::shared_ptr<const compressed_file> get(const std::string &content);
+
+	/// <summary>
+	/// The number of calls to get that found their part in the cache.
+	/// </summary>
+	std::size_t hits() const;
+
+	/// <summary>
+	/// The number of calls to get that had to compress their part.
+	/// </summary>
+	std::size_t misses() const;
+
+	/// <summary>
+	/// The number of parts in the cache and the total size of their compressed bytes.
+	/// </summary>
+	std::size_t size() const;
+	std::size_t size_in_bytes() const;
+
+	std::size_t capacity() const;
+
+	/// <summary>
+	/// Drop every part. The hit and miss counts are kept.
+	/// </summary>
+	void clear();
+
+private:
+	deflate_cache(const deflate_cache &) = delete;
+	deflate_cache &operator=(const deflate_cache &) = delete;
+
+	std::unique_ptr<detail::deflate_cache_impl> d_;
+};
+
+} // namespace xlnt
@@ -0,0 +1,95 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+
+namespace xlnt {
+
+/// <summary>
+/// Random access to the bytes of an archive to be loaded without copying them
+/// into memory first. The source isn't owned by what reads from it and must
+/// outlive it.
+/// </summary>
+class XLNT_CLASS input_source
+{
+public:
+	virtual ~input_source();
+
+	/// <summary>
+	/// The total number of bytes in the source.
+	/// </summary>
+	virtual std::uint64_t size() const = 0;
+
+	/// <summary>
+	/// Copy up to size bytes starting at offset into data and return how many were
+	/// copied, which is less than size only at the end of the source or on failure.
+	/// </summary>
+	virtual std::size_t read_at(std::uint64_t offset, std::uint8_t *data, std::size_t size) = 0;
+
+	/// <summary>
+	/// The bytes of the source if they're all in memory so they can be read in
+	/// place, otherwise nullptr. Returns nullptr by default.
+	/// </summary>
+	virtual const std::uint8_t *data() const;
+};
+
+/// <summary>
+/// A span of bytes the caller owns, such as a memory mapped file or shared memory.
+/// </summary>
+class XLNT_CLASS memory_source : public input_source
+{
+public:
+	memory_source(const std::uint8_t *data, std::size_t size);
+	memory_source(const std::vector<std::uint8_t> &bytes);
+
+	std::uint64_t size() const override;
+	std::size_t read_at(std::uint64_t offset, std::uint8_t *data, std::size_t size) override;
+	const std::uint8_t *data() const override;
+
+private:
+	const std::uint8_t *data_;
+	std::size_t size_;
+};
+
+/// <summary>
+/// A seekable std::istream, read at the positions needed instead of all at once.
+/// </summary>
+class XLNT_CLASS istream_source : public input_source
+{
+public:
+	istream_source(std::istream &stream);
+
+	std::uint64_t size() const override;
+	std::size_t read_at(std::uint64_t offset, std::uint8_t *data, std::size_t size) override;
+
+private:
+	std::istream &stream_;
+	std::uint64_t size_;
+};
+
+} // namespace xlnt
@@ -94,6 +94,11 @@ public:
 	/// </summary>
 	std::string register_relationship(const uri &source, relationship::type type, const uri &target, target_mode mode, const std::string &rel_id);
 
+	/// <summary>
+	/// Removes the relationship with the given id from the relationships of source.
+	/// </summary>
+	void unregister_relationship(const uri &source, const std::string &rel_id);
+
     // Content Types
 
 	/// <summary>
@@ -0,0 +1,122 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+
+namespace xlnt {
+
+/// <summary>
+/// Somewhere the bytes of a saved archive are written to, in order and a part
+/// at a time. Implement this to save straight into memory or a connection the
+/// caller already owns instead of into an intermediate buffer.
+/// </summary>
+class XLNT_CLASS output_sink
+{
+public:
+	virtual ~output_sink();
+
+	/// <summary>
+	/// Called before each write with the number of bytes that follow so space
+	/// can be made for them at once. Does nothing by default.
+	/// </summary>
+	virtual void reserve(std::size_t size);
+
+	/// <summary>
+	/// Append size bytes starting at data. Throws if they can't be written.
+	/// </summary>
+	virtual void write(const std::uint8_t *data, std::size_t size) = 0;
+
+	/// <summary>
+	/// Called once after the last write. Does nothing by default.
+	/// </summary>
+	virtual void flush();
+};
+
+/// <summary>
+/// Writes to a std::ostream.
+/// </summary>
+class XLNT_CLASS ostream_sink : public output_sink
+{
+public:
+	ostream_sink(std::ostream &stream);
+
+	void write(const std::uint8_t *data, std::size_t size) override;
+	void flush() override;
+
+private:
+	std::ostream &stream_;
+};
+
+/// <summary>
+/// Appends to a byte vector.
+/// </summary>
+class XLNT_CLASS vector_sink : public output_sink
+{
+public:
+	vector_sink(std::vector<std::uint8_t> &bytes);
+
+	void reserve(std::size_t size) override;
+	void write(const std::uint8_t *data, std::size_t size) override;
+
+private:
+	std::vector<std::uint8_t> &bytes_;
+};
+
+/// <summary>
+/// Writes to an open file descriptor, such as a socket or pipe, which stays
+/// open afterwards.
+/// </summary>
+class XLNT_CLASS file_descriptor_sink : public output_sink
+{
+public:
+	file_descriptor_sink(int descriptor);
+
+	void write(const std::uint8_t *data, std::size_t size) override;
+
+private:
+	int descriptor_;
+};
+
+/// <summary>
+/// Passes each chunk to a function.
+/// </summary>
+class XLNT_CLASS callback_sink : public output_sink
+{
+public:
+	using callback = std::function<void(const std::uint8_t *data, std::size_t size)>;
+
+	callback_sink(const callback &write);
+
+	void write(const std::uint8_t *data, std::size_t size) override;
+
+private:
+	callback write_;
+};
+
+} // namespace xlnt
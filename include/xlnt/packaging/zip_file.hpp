@@ -23,8 +23,10 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -38,6 +40,9 @@ struct mz_zip_archive_tag;
 
 namespace xlnt {
 
+class input_source;
+class output_sink;
+
 /// <summary>
 /// Information about a specific file in zip_file.
 /// </summary>
@@ -78,6 +83,17 @@ struct XLNT_CLASS zip_info
     std::size_t file_size;
 };
 
+/// <summary>
+/// The deflated content of a file along with what's needed to add it to an
+/// archive without compressing it again. See zip_file::precompress.
+/// </summary>
+struct XLNT_CLASS compressed_file
+{
+    std::string bytes;
+    uint32_t crc;
+    std::size_t uncompressed_size;
+};
+
 /// <summary>
 /// A compressed archive file that exists in memory which can read
 /// or write to and from the filesystem, std::iostreams, and byte vectors.
@@ -89,6 +105,7 @@ public:
     zip_file(const path &filename);
     zip_file(const std::vector<uint8_t> &bytes);
     zip_file(std::istream &stream);
+    zip_file(input_source &source);
     ~zip_file();
 
     // to/from file
@@ -103,8 +120,39 @@ public:
     void load(std::istream &stream);
     void save(std::ostream &stream);
 
+    /// <summary>
+    /// Read the archive in place from source, which must outlive this object or the
+    /// next load or reset, instead of copying it into memory. Only the central
+    /// directory is read up front and files are read from source as they're needed.
+    /// The archive is copied into memory if it's saved or written to.
+    /// </summary>
+    void load(input_source &source);
+
     void reset();
 
+    /// <summary>
+    /// Start a new, empty archive that is written straight to the file at filename.
+    /// Each file added afterwards is compressed into the file as it's added so only
+    /// the central directory is kept in memory. The archive is complete once end_write
+    /// is called and can't be read back through this object. Until then it is written
+    /// to filename with ".tmp" appended, which replaces filename in end_write and is
+    /// removed if the archive is abandoned, so filename is never left half written.
+    /// </summary>
+    void begin_write(const path &filename);
+
+    /// <summary>
+    /// Start a new, empty archive like begin_write(const path &) but pass its bytes
+    /// to sink, which must outlive the archive, in order and a file at a time.
+    /// </summary>
+    void begin_write(output_sink &sink);
+
+    /// <summary>
+    /// Write the central directory and comment of an archive started with begin_write,
+    /// flush its sink and close its file if it has one. Throws xlnt::exception if the
+    /// archive couldn't be written.
+    /// </summary>
+    void end_write();
+
     bool has_file(const path &name);
     bool has_file(const zip_info &name);
 
@@ -119,6 +167,13 @@ public:
     std::string read(const path &name);
     std::string read(const zip_info &name);
 
+    /// <summary>
+    /// Decompress the file called name a chunk at a time, passing each chunk to
+    /// callback until it returns false. Only as much of the file as needed is
+    /// decompressed. Returns false if callback stopped the read early.
+    /// </summary>
+    bool read(const path &name, const std::function<bool(const char *data, std::size_t size)> &callback);
+
     bool check_crc();
 
     void write_file(const path &source_file);
@@ -127,6 +182,24 @@ public:
     void write_string(const std::string &string, const path &archive_path);
     void write_string(const std::string &string, const zip_info &archive_path);
 
+    /// <summary>
+    /// Deflate bytes the same way write_string does so the result can be added
+    /// to any number of archives with write_compressed.
+    /// </summary>
+    static compressed_file precompress(const std::string &bytes);
+
+    /// <summary>
+    /// Add a file that was already compressed with precompress as archive_path
+    /// by copying its bytes.
+    /// </summary>
+    void write_compressed(const compressed_file &file, const path &archive_path);
+
+    /// <summary>
+    /// Add the file called name in source to this archive without
+    /// decompressing and recompressing it.
+    /// </summary>
+    void copy_file(zip_file &source, const path &name);
+
     path get_filename() const;
 
     std::string comment;
@@ -140,7 +213,19 @@ private:
 
     zip_info getinfo(int index);
 
+    void flush_destination();
+    void read_source_into_buffer();
+
+    struct destination;
+
     std::unique_ptr<mz_zip_archive_tag> archive_;
+    std::unique_ptr<destination> destination_;
+
+    // held while files are located in or read from the archive so that one shared by
+    // copies of a lazily loaded workbook can be read by a save on another thread
+    std::mutex read_mutex_;
+
+    input_source *source_;
     std::vector<char> buffer_;
     std::stringstream open_stream_;
     path filename_;
@@ -0,0 +1,56 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+
+#include <xlnt/xlnt_config.hpp>
+
+namespace xlnt {
+
+/// <summary>
+/// Controls how the formulas of a workbook are calculated.
+/// The iteration settings correspond to the attributes of the same name of
+/// calcPr in workbook.xml.
+/// </summary>
+class XLNT_CLASS calculation_properties
+{
+public:
+	/// <summary>
+	/// The number of threads used to evaluate independent formulas in parallel.
+	/// 0 uses one thread per hardware core. The threads are kept by the workbook
+	/// until it's destroyed or this is set back to 1, so the default is 1.
+	/// </summary>
+	std::size_t thread_count = 1;
+
+	/// <summary>
+	/// If true, circular references are resolved by repeated evaluation until
+	/// the values change by less than iterate_delta or iterate_count
+	/// iterations have been done. Otherwise they evaluate to 0.
+	/// </summary>
+	bool iterate = false;
+	std::size_t iterate_count = 100;
+	double iterate_delta = 0.001;
+};
+
+} // namespace xlnt
@@ -0,0 +1,119 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+#include <xlnt/cell/index_types.hpp>
+
+namespace xlnt {
+
+/// <summary>
+/// Controls which parts of a file workbook::load reads. Every part that is
+/// skipped is also left unparsed so that loading only what is needed is
+/// faster and uses less memory.
+/// </summary>
+class XLNT_CLASS load_options
+{
+public:
+	/// <summary>
+	/// Returns options which only load the values of cells. Formulas are replaced
+	/// by their cached values and styles, row and column properties, merged cells,
+	/// views and page setup are skipped.
+	/// </summary>
+	static load_options values_only();
+
+	/// <summary>
+	/// The titles of the worksheets to load. If both this and sheet_indices are
+	/// empty, every worksheet is loaded. Worksheets that aren't loaded are
+	/// removed from the workbook.
+	/// </summary>
+	std::vector<std::string> sheet_titles;
+
+	/// <summary>
+	/// The zero-based positions in the file of the worksheets to load.
+	/// </summary>
+	std::vector<std::size_t> sheet_indices;
+
+	/// <summary>
+	/// The columns of the cells to load. If empty, cells in every column are loaded.
+	/// </summary>
+	std::vector<column_t> columns;
+
+	/// <summary>
+	/// The first and last row of the cells to load. Parsing of a worksheet stops
+	/// at the first row after last_row, so the elements that follow the cells
+	/// in the file, such as merged cells and page setup, aren't read in that case.
+	/// </summary>
+	row_t first_row = 1;
+	row_t last_row = std::numeric_limits<row_t>::max();
+
+	/// <summary>
+	/// If true, each worksheet is parsed the first time it is accessed.
+	/// See workbook::set_lazy_loading.
+	/// </summary>
+	bool lazy = false;
+
+	/// <summary>
+	/// If true, the shared string table is kept as the XML it was read from with
+	/// the position of each string, and a string is only decoded the first time
+	/// it's used. This is much faster for large tables of which most strings
+	/// aren't used and avoids allocating for every string.
+	/// </summary>
+	bool lazy_shared_strings = false;
+
+	/// <summary>
+	/// If true, the stylesheet isn't read and cells are left unformatted.
+	/// The stylesheet of the file is written back unchanged by save as long
+	/// as no formats are created.
+	/// </summary>
+	bool skip_styles = false;
+
+	/// <summary>
+	/// If true, cells with a formula only get its cached value and the
+	/// calculation chain isn't read.
+	/// </summary>
+	bool skip_formulas = false;
+
+	/// <summary>
+	/// If true, row heights, column properties and default sizes aren't read.
+	/// </summary>
+	bool skip_row_column_properties = false;
+
+	/// <summary>
+	/// If true, merged cells aren't read.
+	/// </summary>
+	bool skip_merged_cells = false;
+
+	/// <summary>
+	/// If true, sheet views, sheet properties, page margins, page setup,
+	/// print options and headers and footers aren't read.
+	/// </summary>
+	bool skip_views_and_page_setup = false;
+};
+
+} // namespace xlnt
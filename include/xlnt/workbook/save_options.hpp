@@ -0,0 +1,81 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <xlnt/xlnt_config.hpp>
+
+namespace xlnt {
+
+class deflate_cache;
+
+/// <summary>
+/// Controls how workbook::save writes a workbook.
+/// </summary>
+class XLNT_CLASS save_options
+{
+public:
+	/// <summary>
+	/// Where the text of string cells is written.
+	/// </summary>
+	enum class string_storage
+	{
+		/// <summary>
+		/// Every string cell refers to an entry of the shared string table.
+		/// </summary>
+		shared,
+
+		/// <summary>
+		/// Strings without formatting are written in their cells. Formatted
+		/// strings stay in the shared string table.
+		/// </summary>
+		inline_,
+
+		/// <summary>
+		/// Each column of each worksheet is written inline unless its string cells
+		/// hold at most half as many distinct strings as there are cells. Columns
+		/// of mostly unique strings, like identifiers and free text, then skip the
+		/// table while columns of repeated values still benefit from it.
+		/// </summary>
+		automatic
+	};
+
+	string_storage strings = string_storage::shared;
+
+	/// <summary>
+	/// If true, the shared string table is rebuilt from the string cells that refer
+	/// to it so that strings no cell uses anymore aren't written. This is ignored
+	/// while a lazily loaded worksheet hasn't been accessed since its cells still
+	/// refer to the table as it was loaded.
+	/// </summary>
+	bool rebuild_shared_strings = false;
+
+	/// <summary>
+	/// If not null, every part is looked up in this cache by its content and only
+	/// compressed if an earlier save didn't already compress the same content.
+	/// Saving similar workbooks repeatedly then only compresses the parts that
+	/// changed. The cache isn't owned and must outlive the save.
+	/// </summary>
+	deflate_cache *compression_cache = nullptr;
+};
+
+} // namespace xlnt
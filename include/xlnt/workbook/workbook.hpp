@@ -24,6 +24,7 @@
 #pragma once
 
 #include <functional>
+#include <future>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -37,6 +38,7 @@ namespace xlnt {
 
 class alignment;
 class border;
+class calculation_properties;
 class cell;
 class cell_style;
 class color;
@@ -45,15 +47,19 @@ class drawing;
 class fill;
 class font;
 class format;
+class input_source;
+class load_options;
 class manifest;
 class named_range;
 class number_format;
+class output_sink;
 class path;
 class pattern_fill;
 class protection;
 class range;
 class range_reference;
 class relationship;
+class save_options;
 class style;
 class style_serializer;
 class text;
@@ -61,6 +67,7 @@ class theme;
 class workbook_view;
 class worksheet;
 class worksheet_iterator;
+class worksheet_summary;
 class zip_file;
 
 struct datetime;
@@ -71,6 +78,7 @@ enum class relationship_type;
 namespace detail {
 struct stylesheet;
 struct workbook_impl;
+struct worksheet_impl;
 class xlsx_consumer;
 class xlsx_producer;
 } // namespace detail
@@ -146,6 +154,19 @@ public:
 	/// </summary>
     void set_data_only(bool data_only);
 
+	/// <summary>
+	/// Returns true if worksheets are parsed on first access rather than by load.
+	/// </summary>
+    bool get_lazy_loading() const;
+
+	/// <summary>
+	/// Set to true to make load only read the workbook part, styles and shared
+	/// strings. Each worksheet is then parsed the first time it is accessed and
+	/// worksheets that are never accessed are copied unchanged by save.
+	/// Like data_only, this setting is kept when a file is loaded.
+	/// </summary>
+    void set_lazy_loading(bool lazy);
+
     // add worksheets
 
 	/// <summary>
@@ -348,6 +369,17 @@ public:
     range get_named_range(const std::string &name);
     void remove_named_range(const std::string &name);
 
+    // formulas
+
+    /// <summary>
+    /// Evaluate every formula whose inputs have changed since the last calculation
+    /// and store the results as the cached values of their cells.
+    /// Only the affected formulas are re-evaluated, in dependency order.
+    /// Saving doesn't calculate, so call this first for the saved file to hold
+    /// the results of formulas that have changed.
+    /// </summary>
+    void calculate();
+
     // serialization
 
 	void save(std::vector<std::uint8_t> &data) const;
@@ -355,11 +387,70 @@ public:
 	void save(const xlnt::path &filename) const;
 	void save(std::ostream &stream) const;
 
+	/// <summary>
+	/// Save the workbook, writing it as described by options.
+	/// </summary>
+	void save(std::vector<std::uint8_t> &data, const save_options &options) const;
+	void save(const std::string &filename, const save_options &options) const;
+	void save(const xlnt::path &filename, const save_options &options) const;
+	void save(std::ostream &stream, const save_options &options) const;
+
+	/// <summary>
+	/// Save the workbook by passing the bytes of the archive to sink a part at
+	/// a time as each one is compressed, without building the whole archive first.
+	/// </summary>
+	void save(output_sink &sink) const;
+	void save(output_sink &sink, const save_options &options) const;
+
+	/// <summary>
+	/// Save a snapshot of the workbook on a background thread and return a future
+	/// that is ready, or holds the exception that was thrown, once it has been
+	/// written. The workbook is copied before this returns, so it can be changed
+	/// or destroyed while the save runs. A vector
+	/// or sink that is written to must stay alive until the future is ready.
+	/// </summary>
+	std::future<void> save_async(const std::string &filename) const;
+	std::future<void> save_async(const xlnt::path &filename) const;
+	std::future<void> save_async(std::vector<std::uint8_t> &data) const;
+	std::future<void> save_async(output_sink &sink) const;
+	std::future<void> save_async(const std::string &filename, const save_options &options) const;
+	std::future<void> save_async(const xlnt::path &filename, const save_options &options) const;
+	std::future<void> save_async(std::vector<std::uint8_t> &data, const save_options &options) const;
+	std::future<void> save_async(output_sink &sink, const save_options &options) const;
+
 	void load(const std::vector<std::uint8_t> &data);
 	void load(const std::string &filename);
 	void load(const xlnt::path &filename);
 	void load(std::istream &stream);
 
+	/// <summary>
+	/// Load the file, only reading the parts selected by options.
+	/// </summary>
+	void load(const std::vector<std::uint8_t> &data, const load_options &options);
+	void load(const std::string &filename, const load_options &options);
+	void load(const xlnt::path &filename, const load_options &options);
+	void load(std::istream &stream, const load_options &options);
+
+	/// <summary>
+	/// Load the file by reading it in place from source instead of copying it into
+	/// memory first. The source must outlive the load and, with lazy loading or
+	/// lazy_shared_strings, every later access to a part that was left unread.
+	/// </summary>
+	void load(input_source &source);
+	void load(input_source &source, const load_options &options);
+
+	/// <summary>
+	/// Returns the title, dimension and emptiness of each sheet of the file in tab
+	/// order. Only the package, workbook part and the start of each sheet part up
+	/// to its cells are read, so the cost doesn't depend on the size of the sheets
+	/// as long as they have a dimension element.
+	/// </summary>
+	static std::vector<worksheet_summary> probe(const std::vector<std::uint8_t> &data);
+	static std::vector<worksheet_summary> probe(const std::string &filename);
+	static std::vector<worksheet_summary> probe(const xlnt::path &filename);
+	static std::vector<worksheet_summary> probe(std::istream &stream);
+	static std::vector<worksheet_summary> probe(input_source &source);
+
 	bool has_view() const;
 	workbook_view get_view() const;
 	void set_view(const workbook_view &view);
@@ -390,6 +481,8 @@ public:
 	// calculation
 
 	bool has_calculation_properties() const;
+	calculation_properties get_calculation_properties() const;
+	void set_calculation_properties(const calculation_properties &properties);
 
     // theme
 
@@ -420,8 +513,20 @@ public:
     // shared strings
 
     void add_shared_string(const text &shared, bool allow_duplicates=false);
-    std::vector<text> &get_shared_strings();
-    const std::vector<text> &get_shared_strings() const;
+
+    /// <summary>
+    /// Return a copy of every shared string. Strings of a table that was loaded
+    /// with load_options::lazy_shared_strings are decoded first.
+    /// </summary>
+    std::vector<text> get_shared_strings() const;
+
+    std::size_t get_shared_string_count() const;
+
+    /// <summary>
+    /// Return the shared string at index, decoding only that string if the table
+    /// was loaded with load_options::lazy_shared_strings.
+    /// </summary>
+    text get_shared_string(std::size_t index) const;
     
     // thumbnail
 
@@ -460,7 +565,9 @@ public:
     bool operator!=(const workbook &rhs) const;
 
 private:
+	friend class cell;
 	friend class worksheet;
+	friend struct detail::worksheet_impl;
 	friend class detail::xlsx_consumer;
 	friend class detail::xlsx_producer;
 
@@ -0,0 +1,62 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <string>
+
+#include <xlnt/xlnt_config.hpp>
+#include <xlnt/cell/index_types.hpp>
+#include <xlnt/worksheet/range_reference.hpp>
+
+namespace xlnt {
+
+/// <summary>
+/// What workbook::probe finds out about a sheet without loading its cells.
+/// </summary>
+class XLNT_CLASS worksheet_summary
+{
+public:
+	/// <summary>
+	/// The title of the sheet.
+	/// </summary>
+	std::string title;
+
+	/// <summary>
+	/// The range of the sheet's cells. This comes from the dimension element at
+	/// the start of the sheet part if it has one and is otherwise found by
+	/// scanning the references of the cells.
+	/// </summary>
+	range_reference dimension;
+
+	/// <summary>
+	/// True if the sheet doesn't have any cells.
+	/// </summary>
+	bool empty = true;
+
+	/// <summary>
+	/// The number of rows spanned by dimension, or 0 if the sheet is empty.
+	/// </summary>
+	row_t row_count = 0;
+};
+
+} // namespace xlnt
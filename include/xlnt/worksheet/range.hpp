@@ -29,6 +29,7 @@
 
 #include <xlnt/xlnt_config.hpp>
 #include <xlnt/worksheet/cell_vector.hpp>
+#include <xlnt/worksheet/comparison_operator.hpp>
 #include <xlnt/worksheet/major_order.hpp>
 #include <xlnt/worksheet/const_range_iterator.hpp>
 #include <xlnt/worksheet/range_iterator.hpp>
@@ -76,6 +77,39 @@ public:
     std::size_t length() const;
 
     bool contains(const cell_reference &ref);
+
+    /// <summary>
+    /// Return the sum of the numeric cells in this range.
+    /// Cells holding text, booleans, or errors are ignored.
+    /// </summary>
+    double sum() const;
+
+    /// <summary>
+    /// Return the smallest numeric value in this range or 0 if there is none.
+    /// </summary>
+    double minimum() const;
+
+    /// <summary>
+    /// Return the largest numeric value in this range or 0 if there is none.
+    /// </summary>
+    double maximum() const;
+
+    /// <summary>
+    /// Return the number of numeric cells in this range.
+    /// </summary>
+    std::size_t count() const;
+
+    /// <summary>
+    /// Return the arithmetic mean of the numeric cells in this range.
+    /// Throws invalid_data_type if there are no numeric cells.
+    /// </summary>
+    double mean() const;
+
+    /// <summary>
+    /// Return the number of numeric cells in this range whose value compares
+    /// to operand according to op, e.g. count_if(comparison_operator::greater, 0).
+    /// </summary>
+    std::size_t count_if(comparison_operator op, double operand) const;
     
     iterator begin();
     iterator end();
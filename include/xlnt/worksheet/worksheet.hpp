@@ -56,6 +56,7 @@ struct date;
 
 namespace detail {
 struct worksheet_impl;
+class worksheet_inspector;
 class xlsx_consumer;
 class xlsx_producer;
 }
@@ -150,6 +151,18 @@ public:
     void unmerge_cells(column_t start_column, row_t start_row, column_t end_column, row_t end_row);
     std::vector<range_reference> get_merged_ranges() const;
 
+    /// <summary>
+    /// Return true if the cell at reference is part of a merged range, whether or not
+    /// the cell itself has been created.
+    /// </summary>
+    bool has_merged_range(const cell_reference &reference) const;
+
+    /// <summary>
+    /// Return the merged range containing the cell at reference.
+    /// Throws key_not_found if it isn't merged.
+    /// </summary>
+    range_reference get_merged_range(const cell_reference &reference) const;
+
     // append
     void append();
     void append(const std::vector<std::string> &cells);
@@ -242,8 +255,10 @@ public:
 private:
     friend class workbook;
     friend class cell;
+    friend class range;
     friend class range_iterator;
     friend class const_range_iterator;
+	friend class detail::worksheet_inspector;
 	friend class detail::xlsx_consumer;
 	friend class detail::xlsx_producer;
     
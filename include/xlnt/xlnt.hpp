@@ -35,7 +35,10 @@
 #include <xlnt/cell/text_run.hpp>
 
 // packaging
+#include <xlnt/packaging/deflate_cache.hpp>
+#include <xlnt/packaging/input_source.hpp>
 #include <xlnt/packaging/manifest.hpp>
+#include <xlnt/packaging/output_sink.hpp>
 #include <xlnt/packaging/relationship.hpp>
 #include <xlnt/packaging/zip_file.hpp>
 
@@ -66,18 +69,23 @@
 #include <xlnt/utils/timedelta.hpp>
 
 // workbook
+#include <xlnt/workbook/calculation_properties.hpp>
 #include <xlnt/workbook/const_worksheet_iterator.hpp>
 #include <xlnt/workbook/document_security.hpp>
 #include <xlnt/workbook/external_book.hpp>
+#include <xlnt/workbook/load_options.hpp>
 #include <xlnt/workbook/named_range.hpp>
+#include <xlnt/workbook/save_options.hpp>
 #include <xlnt/workbook/theme.hpp>
 #include <xlnt/workbook/workbook.hpp>
 #include <xlnt/workbook/worksheet_iterator.hpp>
+#include <xlnt/workbook/worksheet_summary.hpp>
 
 // worksheet
 #include <xlnt/worksheet/cell_iterator.hpp>
 #include <xlnt/worksheet/cell_vector.hpp>
 #include <xlnt/worksheet/column_properties.hpp>
+#include <xlnt/worksheet/comparison_operator.hpp>
 #include <xlnt/worksheet/const_cell_iterator.hpp>
 #include <xlnt/worksheet/const_range_iterator.hpp>
 #include <xlnt/worksheet/footer.hpp>
@@ -23,6 +23,8 @@
 // @author: see AUTHORS file
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <limits>
 #include <sstream>
 
 #include <xlnt/cell/cell.hpp>
@@ -40,25 +42,27 @@
 #include <xlnt/utils/exceptions.hpp>
 #include <xlnt/workbook/workbook.hpp>
 #include <xlnt/worksheet/column_properties.hpp>
+#include <xlnt/worksheet/range_reference.hpp>
 #include <xlnt/worksheet/row_properties.hpp>
 #include <xlnt/worksheet/worksheet.hpp>
 
 #include <detail/cell_impl.hpp>
 #include <detail/comment_impl.hpp>
+#include <detail/workbook_impl.hpp>
 
 
 namespace {
 
-std::pair<bool, long double> cast_numeric(const std::string &s)
+std::pair<bool, double> cast_numeric(const std::string &s)
 {
 	const char *str = s.c_str();
 	char *str_end = nullptr;
-	auto result = std::strtold(str, &str_end);
+	auto result = std::strtod(str, &str_end);
 	if (str_end != str + s.size()) return{ false, 0 };
 	return{ true, result };
 }
 
-std::pair<bool, long double> cast_percentage(const std::string &s)
+std::pair<bool, double> cast_percentage(const std::string &s)
 {
 	if (s.back() == '%')
 	{
@@ -73,6 +77,62 @@ std::pair<bool, long double> cast_percentage(const std::string &s)
 	return{ false, 0 };
 }
 
+const double two_to_the_63 = 9223372036854775808.0;
+const double two_to_the_64 = 18446744073709551616.0;
+
+// The integer that value_numeric_ truncates to, saturated to the range of std::int64_t.
+std::int64_t truncate_signed(double d)
+{
+    if (d >= two_to_the_63) return std::numeric_limits<std::int64_t>::max();
+    if (d < -two_to_the_63) return std::numeric_limits<std::int64_t>::min();
+
+    return static_cast<std::int64_t>(d);
+}
+
+// The integer that value_numeric_ truncates to, saturated to the range of std::uint64_t.
+std::uint64_t truncate_unsigned(double d)
+{
+    if (d >= two_to_the_64) return std::numeric_limits<std::uint64_t>::max();
+    if (d < 0) return static_cast<std::uint64_t>(truncate_signed(d));
+
+    return static_cast<std::uint64_t>(d);
+}
+
+// Each of these replaces a string value, whose index would otherwise keep the string
+// in the shared string table of a saved file.
+void store_integer(xlnt::detail::cell_impl &impl, std::int64_t i)
+{
+    impl.value_string_index_ = xlnt::detail::cell_impl::no_string_index;
+    impl.value_numeric_ = static_cast<double>(i);
+    impl.value_integer_offset_ = static_cast<std::int16_t>(i - truncate_signed(impl.value_numeric_));
+}
+
+void store_integer(xlnt::detail::cell_impl &impl, std::uint64_t i)
+{
+    impl.value_string_index_ = xlnt::detail::cell_impl::no_string_index;
+    impl.value_numeric_ = static_cast<double>(i);
+    impl.value_integer_offset_ = static_cast<std::int16_t>(
+        static_cast<std::int64_t>(i - truncate_unsigned(impl.value_numeric_)));
+}
+
+void store_number(xlnt::detail::cell_impl &impl, double d)
+{
+    impl.value_string_index_ = xlnt::detail::cell_impl::no_string_index;
+    impl.value_numeric_ = d;
+    impl.value_integer_offset_ = 0;
+}
+
+std::int64_t load_signed(const xlnt::detail::cell_impl &impl)
+{
+    return truncate_signed(impl.value_numeric_) + impl.value_integer_offset_;
+}
+
+std::uint64_t load_unsigned(const xlnt::detail::cell_impl &impl)
+{
+    return truncate_unsigned(impl.value_numeric_) + static_cast<std::uint64_t>(
+        static_cast<std::int64_t>(impl.value_integer_offset_));
+}
+
 std::pair<bool, xlnt::time> cast_time(const std::string &s)
 {
 	xlnt::time result;
@@ -176,7 +236,57 @@ std::string cell::check_string(const std::string &to_check)
     return s;
 }
 
-cell::cell(detail::cell_impl *d) : d_(d)
+cell::impl_pointer::impl_pointer(detail::cell_impl *d, detail::worksheet_impl *parent)
+    : d_(d),
+      parent_(parent),
+      generation_(parent->cell_map_.generation()),
+      row_(d->row_),
+      column_(d->column_.index)
+{
+}
+
+detail::cell_impl *cell::impl_pointer::operator->()
+{
+    // copy the block of cells first if it's shared so that copies of the worksheet keep their value
+    parent_->cell_map_.unshare(row_);
+
+    return get();
+}
+
+detail::cell_impl *cell::impl_pointer::operator->() const
+{
+    return get();
+}
+
+detail::cell_impl &cell::impl_pointer::operator*()
+{
+    return *operator->();
+}
+
+detail::cell_impl &cell::impl_pointer::operator*() const
+{
+    return *get();
+}
+
+detail::cell_impl *cell::impl_pointer::get() const
+{
+    const auto &cells = parent_->cell_map_;
+
+    if (generation_ != cells.generation())
+    {
+        d_ = const_cast<detail::cell_impl *>(cells.find_cell(row_, column_));
+        generation_ = cells.generation();
+    }
+
+    return d_;
+}
+
+detail::worksheet_impl *cell::impl_pointer::parent() const
+{
+    return parent_;
+}
+
+cell::cell(detail::cell_impl *d, detail::worksheet_impl *parent) : d_(d, parent)
 {
 }
 
@@ -189,77 +299,100 @@ template <>
 XLNT_FUNCTION void cell::set_value(std::nullptr_t)
 {
 	d_->type_ = type::null;
+    d_->value_string_index_ = detail::cell_impl::no_string_index;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(bool b)
 {
-    d_->value_numeric_ = b ? 1 : 0;
+    store_number(*d_, b ? 1 : 0);
     d_->type_ = type::boolean;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(std::int8_t i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::int64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(std::int16_t i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::int64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(std::int32_t i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::int64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(std::int64_t i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::int64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(std::uint8_t i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::uint64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(std::uint16_t i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::uint64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(std::uint32_t i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::uint64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(std::uint64_t i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::uint64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 #ifdef _MSC_VER
 template <>
 XLNT_FUNCTION void cell::set_value(unsigned long i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::uint64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 #endif
 
@@ -267,37 +400,49 @@ XLNT_FUNCTION void cell::set_value(unsigned long i)
 template <>
 XLNT_FUNCTION void cell::set_value(long long i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::int64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(unsigned long long i)
 {
-    d_->value_numeric_ = static_cast<long double>(i);
+    store_integer(*d_, static_cast<std::uint64_t>(i));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 #endif
 
 template <>
 XLNT_FUNCTION void cell::set_value(float f)
 {
-    d_->value_numeric_ = static_cast<long double>(f);
+    store_number(*d_, static_cast<double>(f));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(double d)
 {
-    d_->value_numeric_ = static_cast<long double>(d);
+    store_number(*d_, d);
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(long double d)
 {
-    d_->value_numeric_ = static_cast<long double>(d);
+    // values are stored as doubles, like in the file, so clamp anything beyond their range
+    const auto max = static_cast<long double>(std::numeric_limits<double>::max());
+    store_number(*d_, static_cast<double>(d > max ? max : d < -max ? -max : d));
     d_->type_ = type::numeric;
+
+    mark_dirty();
 }
 
 template <>
@@ -317,11 +462,13 @@ XLNT_FUNCTION void cell::set_value(std::string s)
 	else
 	{
 		d_->type_ = type::string;
-        d_->value_text_.set_plain_string(s);
+        d_->clear_value_text();
+        d_->value_string_index_ = detail::cell_impl::no_string_index;
         
         if (s.size() > 0)
         {
-            get_workbook().add_shared_string(d_->value_text_);
+            get_workbook().register_shared_string_table_in_manifest();
+            d_->value_string_index_ = static_cast<std::uint32_t>(get_workbook().impl().mutable_shared_strings().add(s));
         }
 	}
 
@@ -329,6 +476,8 @@ XLNT_FUNCTION void cell::set_value(std::string s)
 	{
 		guess_type_and_set_value(s);
 	}
+
+    mark_dirty();
 }
 
 template <>
@@ -341,9 +490,12 @@ XLNT_FUNCTION void cell::set_value(text t)
     else
     {
         d_->type_ = type::string;
-        d_->value_text_ = t;
-        get_workbook().add_shared_string(t);
+        d_->clear_value_text();
+        get_workbook().register_shared_string_table_in_manifest();
+        d_->value_string_index_ = static_cast<std::uint32_t>(get_workbook().impl().mutable_shared_strings().add(t, false));
     }
+
+    mark_dirty();
 }
 
 template <>
@@ -355,44 +507,70 @@ XLNT_FUNCTION void cell::set_value(char const *c)
 template <>
 XLNT_FUNCTION void cell::set_value(cell c)
 {
-    d_->type_ = c.d_->type_;
-    d_->value_numeric_ = c.d_->value_numeric_;
-    d_->value_text_ = c.d_->value_text_;
-    d_->hyperlink_ = c.d_->hyperlink_;
-    d_->formula_ = c.d_->formula_;
-    d_->format_id_ = c.d_->format_id_;
+    d_->type_ = c.d_.get()->type_;
+    d_->value_numeric_ = c.d_.get()->value_numeric_;
+    d_->value_integer_offset_ = c.d_.get()->value_integer_offset_;
+    d_->value_string_index_ = c.d_.get()->value_string_index_;
+    d_->format_id_ = c.d_.get()->format_id_;
+
+    if (c.d_.get()->extras_ || d_->extras_)
+    {
+        auto &extras = d_.parent()->cell_map_.extras(*d_);
+        extras.value_text_ = c.d_.get()->value_text();
+        extras.hyperlink_ = c.d_.get()->hyperlink();
+        extras.formula_ = c.d_.get()->formula();
+    }
+
+    // the index refers to the shared strings of the workbook of c
+    if (d_->type_ == type::string && d_->value_string_index_ != detail::cell_impl::no_string_index
+        && &c.get_workbook().impl() != &get_workbook().impl())
+    {
+        get_workbook().register_shared_string_table_in_manifest();
+        d_->value_string_index_ = static_cast<std::uint32_t>(get_workbook().impl().mutable_shared_strings().add(
+            c.get_workbook().impl().shared_strings_->get(c.d_.get()->value_string_index_), false));
+    }
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(date d)
 {
     d_->type_ = type::numeric;
-    d_->value_numeric_ = d.to_number(get_base_date());
+    store_number(*d_, static_cast<double>(d.to_number(get_base_date())));
     set_number_format(number_format::date_yyyymmdd2());
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(datetime d)
 {
     d_->type_ = type::numeric;
-    d_->value_numeric_ = d.to_number(get_base_date());
+    store_number(*d_, static_cast<double>(d.to_number(get_base_date())));
     set_number_format(number_format::date_datetime());
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(time t)
 {
     d_->type_ = type::numeric;
-    d_->value_numeric_ = t.to_number();
+    store_number(*d_, static_cast<double>(t.to_number()));
     set_number_format(number_format::date_time6());
+
+    mark_dirty();
 }
 
 template <>
 XLNT_FUNCTION void cell::set_value(timedelta t)
 {
     d_->type_ = type::numeric;
-    d_->value_numeric_ = t.to_number();
+    store_number(*d_, static_cast<double>(t.to_number()));
     set_number_format(number_format("[hh]:mm:ss"));
+
+    mark_dirty();
 }
 
 row_t cell::get_row() const
@@ -407,12 +585,24 @@ column_t cell::get_column() const
 
 void cell::set_merged(bool merged)
 {
-    d_->is_merged_ = merged;
+    // a cell merged on its own is kept as a range of one cell
+    const auto reference = get_reference();
+    const range_reference own(reference, reference);
+    auto ws = get_worksheet();
+
+    if (merged && !ws.has_merged_range(reference))
+    {
+        ws.merge_cells(own);
+    }
+    else if (!merged && ws.has_merged_range(reference) && ws.get_merged_range(reference) == own)
+    {
+        ws.unmerge_cells(own);
+    }
 }
 
 bool cell::is_merged() const
 {
-    return d_->is_merged_;
+    return get_worksheet().has_merged_range(get_reference());
 }
 
 bool cell::is_date() const
@@ -429,39 +619,31 @@ cell_reference cell::get_reference() const
 
 bool cell::operator==(std::nullptr_t) const
 {
-    return d_ == nullptr;
+    return d_.get() == nullptr;
 }
 
 bool cell::operator==(const cell &comparand) const
 {
-    return d_ == comparand.d_;
+    return d_.get() == comparand.d_.get();
 }
 
 cell &cell::operator=(const cell &rhs)
 {
-	d_->column_ = rhs.d_->column_;
-	d_->format_id_ = rhs.d_->format_id_;
-	d_->formula_ = rhs.d_->formula_;
-	d_->hyperlink_ = rhs.d_->hyperlink_;
-	d_->is_merged_ = rhs.d_->is_merged_;
-	d_->parent_ = rhs.d_->parent_;
-	d_->row_ = rhs.d_->row_;
-	d_->style_name_ = rhs.d_->style_name_;
-	d_->type_ = rhs.d_->type_;
-	d_->value_numeric_ = rhs.d_->value_numeric_;
-	d_->value_text_ = rhs.d_->value_text_;
+    d_.parent()->cell_map_.assign(*d_, *rhs.d_);
+
+    mark_dirty();
 
     return *this;
 }
 
 std::string cell::to_repr() const
 {
-    return "<Cell " + worksheet(d_->parent_).get_title() + "." + get_reference().to_string() + ">";
+    return "<Cell " + worksheet(d_.parent()).get_title() + "." + get_reference().to_string() + ">";
 }
 
 std::string cell::get_hyperlink() const
 {
-	return d_->hyperlink_.get();
+	return d_->hyperlink().get();
 }
 
 void cell::set_hyperlink(const std::string &hyperlink)
@@ -471,7 +653,7 @@ void cell::set_hyperlink(const std::string &hyperlink)
         throw invalid_parameter();
     }
 
-	d_->hyperlink_ = hyperlink;
+	d_.parent()->cell_map_.extras(*d_).hyperlink_ = hyperlink;
 
     if (get_data_type() == type::null)
     {
@@ -488,27 +670,34 @@ void cell::set_formula(const std::string &formula)
 
     if (formula[0] == '=')
     {
-        d_->formula_ = formula.substr(1);
+        d_.parent()->cell_map_.extras(*d_).formula_ = formula.substr(1);
     }
     else
     {
-        d_->formula_ = formula;
+        d_.parent()->cell_map_.extras(*d_).formula_ = formula;
     }
+
+    // the cached value is stale until the workbook is calculated
+    d_->type_ = type::formula;
+
+    mark_dirty();
 }
 
 bool cell::has_formula() const
 {
-	return d_->formula_;
+	return d_->formula();
 }
 
 std::string cell::get_formula() const
 {
-    return d_->formula_.get();
+    return d_->formula().get();
 }
 
 void cell::clear_formula()
 {
-    d_->formula_.clear();
+    d_->clear_formula();
+
+    mark_dirty();
 }
 
 void cell::set_error(const std::string &error)
@@ -518,23 +707,32 @@ void cell::set_error(const std::string &error)
         throw invalid_data_type();
     }
 
-    d_->value_text_.set_plain_string(error);
+    d_.parent()->cell_map_.extras(*d_).value_text_.set_plain_string(error);
+    d_->value_string_index_ = detail::cell_impl::no_string_index;
     d_->type_ = type::error;
+
+    mark_dirty();
 }
 
 cell cell::offset(int column, int row)
 {
-    return get_worksheet().get_cell(cell_reference(d_->column_ + column, d_->row_ + row));
+    const auto &impl = *d_.get();
+    return get_worksheet().get_cell(cell_reference(impl.column_ + column, impl.row_ + row));
+}
+
+void cell::mark_dirty()
+{
+    get_workbook().impl().formulas_.cell_changed(*d_.parent(), *d_);
 }
 
 worksheet cell::get_worksheet()
 {
-    return worksheet(d_->parent_);
+    return worksheet(d_.parent());
 }
 
 const worksheet cell::get_worksheet() const
 {
-    return worksheet(d_->parent_);
+    return worksheet(d_.parent());
 }
 
 workbook &cell::get_workbook()
@@ -643,10 +841,13 @@ protection cell::get_computed_protection() const
 
 void cell::clear_value()
 {
-    d_->value_numeric_ = 0;
-    d_->value_text_.clear();
-    d_->formula_.clear();
+    store_number(*d_, 0);
+    d_->clear_value_text();
+    d_->value_string_index_ = detail::cell_impl::no_string_index;
+    d_->clear_formula();
     d_->type_ = cell::type::null;
+
+    mark_dirty();
 }
 
 template <>
@@ -676,7 +877,7 @@ XLNT_FUNCTION std::int32_t cell::get_value() const
 template <>
 XLNT_FUNCTION std::int64_t cell::get_value() const
 {
-    return static_cast<std::int64_t>(d_->value_numeric_);
+    return load_signed(*d_);
 }
 
 template <>
@@ -700,20 +901,20 @@ XLNT_FUNCTION std::uint32_t cell::get_value() const
 template <>
 XLNT_FUNCTION std::uint64_t cell::get_value() const
 {
-    return static_cast<std::uint64_t>(d_->value_numeric_);
+    return load_unsigned(*d_);
 }
 
 #ifdef __linux
 template <>
 XLNT_FUNCTION long long cell::get_value() const
 {
-    return static_cast<long long>(d_->value_numeric_);
+    return static_cast<long long>(load_signed(*d_));
 }
 
 template <>
 XLNT_FUNCTION unsigned long long cell::get_value() const
 {
-    return static_cast<unsigned long long>(d_->value_numeric_);
+    return static_cast<unsigned long long>(load_unsigned(*d_));
 }
 #endif
 
@@ -726,13 +927,13 @@ XLNT_FUNCTION float cell::get_value() const
 template <>
 XLNT_FUNCTION double cell::get_value() const
 {
-    return static_cast<double>(d_->value_numeric_);
+    return d_->value_numeric_;
 }
 
 template <>
 XLNT_FUNCTION long double cell::get_value() const
 {
-    return d_->value_numeric_;
+    return static_cast<long double>(d_->value_numeric_);
 }
 
 template <>
@@ -804,13 +1005,23 @@ void cell::set_protection(const xlnt::protection &protection_)
 template <>
 XLNT_FUNCTION std::string cell::get_value() const
 {
-    return d_->value_text_.get_plain_string();
+    if (d_->type_ == type::string && d_->value_string_index_ != detail::cell_impl::no_string_index)
+    {
+        return get_workbook().impl().shared_strings_->get_plain_string(d_->value_string_index_);
+    }
+
+    return d_->value_text().get_plain_string();
 }
 
 template <>
 XLNT_FUNCTION text cell::get_value() const
 {
-    return d_->value_text_;
+    if (d_->type_ == type::string && d_->value_string_index_ != detail::cell_impl::no_string_index)
+    {
+        return get_workbook().impl().shared_strings_->get(d_->value_string_index_);
+    }
+
+    return d_->value_text();
 }
 
 bool cell::has_value() const
@@ -865,7 +1076,7 @@ void cell::guess_type_and_set_value(const std::string &value)
 
 	if (percentage.first)
 	{
-		d_->value_numeric_ = percentage.second;
+		store_number(*d_, percentage.second);
 		d_->type_ = cell::type::numeric;
 		set_number_format(xlnt::number_format::percentage());
 	}
@@ -877,7 +1088,7 @@ void cell::guess_type_and_set_value(const std::string &value)
 		{
 			d_->type_ = cell::type::numeric;
 			set_number_format(number_format::date_time6());
-			d_->value_numeric_ = time.second.to_number();
+			store_number(*d_, static_cast<double>(time.second.to_number()));
 		}
 		else
 		{
@@ -885,7 +1096,7 @@ void cell::guess_type_and_set_value(const std::string &value)
 
 			if (numeric.first)
 			{
-				d_->value_numeric_ = numeric.second;
+				store_number(*d_, numeric.second);
 				d_->type_ = cell::type::numeric;
 			}
 		}
@@ -899,32 +1110,32 @@ void cell::clear_format()
 
 void cell::clear_style()
 {
-	d_->style_name_.clear();
+	d_->clear_style_name();
 }
 
 void cell::set_style(const style &new_style)
 {
-	d_->style_name_ = new_style.name();
+	d_.parent()->cell_map_.extras(*d_).style_name_ = new_style.name();
 }
 
 void cell::set_style(const std::string &style_name)
 {
-	d_->style_name_ = get_workbook().get_style(style_name).name();
+	d_.parent()->cell_map_.extras(*d_).style_name_ = get_workbook().get_style(style_name).name();
 }
 
 style cell::get_style() const
 {
-    if (!d_->style_name_)
+    if (!d_->style_name())
     {
 		throw invalid_attribute();
     }
 
-    return get_workbook().get_style(*d_->style_name_);
+    return get_workbook().get_style(d_->style_name().get());
 }
 
 bool cell::has_style() const
 {
-    return d_->style_name_;
+    return d_->style_name();
 }
 
 base_format cell::get_computed_format() const
@@ -1023,7 +1234,7 @@ protection cell::get_protection() const
 
 bool cell::has_hyperlink() const
 {
-	return d_->hyperlink_;
+	return d_->hyperlink();
 }
 
 } // namespace xlnt
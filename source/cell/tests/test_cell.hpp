@@ -2,6 +2,7 @@
 
 #include <ctime>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <cxxtest/TestSuite.h>
 
@@ -24,7 +25,7 @@ public:
         auto cell = ws.get_cell("A1");
 
 		cell.set_value("4.2");
-		TS_ASSERT(cell.get_value<long double>() == 4.2L);
+		TS_ASSERT(cell.get_value<double>() == 4.2);
 
 		cell.set_value("-42.000");
 		TS_ASSERT(cell.get_value<int>() == -42);
@@ -33,10 +34,10 @@ public:
 		TS_ASSERT(cell.get_value<int>() == 0);
 
 		cell.set_value("0.9999");
-		TS_ASSERT(cell.get_value<long double>() == 0.9999L);
+		TS_ASSERT(cell.get_value<double>() == 0.9999);
 
 		cell.set_value("99E-02");
-		TS_ASSERT(cell.get_value<long double>() == 0.99L);
+		TS_ASSERT(cell.get_value<double>() == 0.99);
 
 		cell.set_value("4");
 		TS_ASSERT(cell.get_value<int>() == 4);
@@ -48,7 +49,7 @@ public:
 		TS_ASSERT(cell.get_value<int>() == 200);
 
 		cell.set_value("3.1%");
-		TS_ASSERT(cell.get_value<long double>() == 0.031L);
+		TS_ASSERT(cell.get_value<double>() == 0.031);
 
 		cell.set_value("03:40:16");
         TS_ASSERT(cell.get_value<xlnt::time>() == xlnt::time(3, 40, 16));
@@ -114,6 +115,42 @@ public:
         TS_ASSERT(cell.get_data_type() == xlnt::cell::type::string);
     }
     
+    void test_shared_string_value()
+    {
+        xlnt::workbook shared_wb;
+        auto ws = shared_wb.get_active_sheet();
+        const auto initial_count = shared_wb.get_shared_string_count();
+
+        for (xlnt::row_t row = 1; row <= 100; ++row)
+        {
+            ws.get_cell(xlnt::cell_reference(1, row)).set_value(row % 2 == 0 ? "even" : "odd");
+        }
+
+        TS_ASSERT_EQUALS(shared_wb.get_shared_string_count(), initial_count + 2);
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_value<std::string>(), "odd");
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_value<xlnt::text>().get_plain_string(), "even");
+
+        ws.get_cell("A2").set_value(3);
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_value<int>(), 3);
+        ws.get_cell("A2").clear_value();
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_value<std::string>(), "");
+
+        // the value of a cell of another workbook is added to this workbook's strings
+        auto other_ws = wb.create_sheet();
+        other_ws.get_cell("A1").set_value(ws.get_cell("A1"));
+        TS_ASSERT_EQUALS(other_ws.get_cell("A1").get_value<std::string>(), "odd");
+        ws.get_cell("A1").set_value("changed");
+        TS_ASSERT_EQUALS(other_ws.get_cell("A1").get_value<std::string>(), "odd");
+
+        std::vector<std::uint8_t> bytes;
+        shared_wb.save(bytes);
+        xlnt::workbook loaded;
+        loaded.load(bytes);
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("A1").get_value<std::string>(), "changed");
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("A4").get_value<std::string>(), "even");
+        TS_ASSERT_EQUALS(loaded.get_shared_string_count(), shared_wb.get_shared_string_count());
+    }
+    
     void test_formula1()
     {
         auto ws = wb_guess_types.create_sheet();
@@ -190,7 +227,7 @@ public:
         
         cell.set_value(xlnt::datetime(2010, 7, 13, 6, 37, 41));
         TS_ASSERT(cell.get_data_type() == xlnt::cell::type::numeric);
-        TS_ASSERT(cell.get_value<long double>() == 40372.27616898148L);
+        TS_ASSERT(cell.get_value<double>() == 40372.27616898148);
         TS_ASSERT(cell.is_date());
         TS_ASSERT(cell.get_number_format().get_format_string() == "yyyy-mm-dd h:mm:ss");
     }
@@ -202,7 +239,7 @@ public:
         
         cell.set_value(xlnt::date(2010, 7, 13));
         TS_ASSERT(cell.get_data_type() == xlnt::cell::type::numeric);
-        TS_ASSERT(cell.get_value<long double>() == 40372.L);
+        TS_ASSERT(cell.get_value<double>() == 40372.);
         TS_ASSERT(cell.is_date());
         TS_ASSERT(cell.get_number_format().get_format_string() == "yyyy-mm-dd");
     }
@@ -214,7 +251,7 @@ public:
         
         cell.set_value(xlnt::time(1, 3));
         TS_ASSERT(cell.get_data_type() == xlnt::cell::type::numeric);
-        TS_ASSERT(cell.get_value<long double>() == 0.04375L);
+        TS_ASSERT(cell.get_value<double>() == 0.04375);
         TS_ASSERT(cell.is_date());
         TS_ASSERT(cell.get_number_format().get_format_string() == "h:mm:ss");
     }
@@ -572,6 +609,47 @@ public:
         TS_ASSERT_EQUALS(cell.get_value<std::string>(), std::string(32'767, 'a'));
     }
 
+    void test_integer_fidelity()
+    {
+        auto ws = wb.create_sheet();
+        auto cell = ws.get_cell("A1");
+
+        const auto beyond_double = (std::int64_t(1) << 53) + 1;
+        cell.set_value(beyond_double);
+        TS_ASSERT_EQUALS(cell.get_value<std::int64_t>(), beyond_double);
+        TS_ASSERT_EQUALS(cell.get_value<double>(), static_cast<double>(beyond_double));
+
+        cell.set_value(-beyond_double);
+        TS_ASSERT_EQUALS(cell.get_value<std::int64_t>(), -beyond_double);
+
+        cell.set_value(std::numeric_limits<std::int64_t>::max());
+        TS_ASSERT_EQUALS(cell.get_value<std::int64_t>(), std::numeric_limits<std::int64_t>::max());
+
+        cell.set_value(std::numeric_limits<std::int64_t>::min());
+        TS_ASSERT_EQUALS(cell.get_value<std::int64_t>(), std::numeric_limits<std::int64_t>::min());
+
+        cell.set_value(std::numeric_limits<std::uint64_t>::max() - 1);
+        TS_ASSERT_EQUALS(cell.get_value<std::uint64_t>(), std::numeric_limits<std::uint64_t>::max() - 1);
+
+        // assigning a non-integer discards the correction
+        cell.set_value(beyond_double);
+        cell.set_value(2.5);
+        TS_ASSERT_EQUALS(cell.get_value<std::int64_t>(), 2);
+
+        xlnt::workbook saved;
+        saved.get_active_sheet().get_cell("A1").set_value(beyond_double);
+        saved.get_active_sheet().get_cell("A2").set_value(0.1 + 0.2);
+
+        std::vector<std::uint8_t> data;
+        saved.save(data);
+
+        xlnt::workbook loaded;
+        loaded.load(data);
+
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("A1").get_value<std::int64_t>(), beyond_double);
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("A2").get_value<double>(), 0.1 + 0.2);
+    }
+
     void test_reference()
     {
         xlnt::cell_reference_hash hash;
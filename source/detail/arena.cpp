@@ -0,0 +1,153 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#include <detail/arena.hpp>
+
+namespace {
+
+// chunks start small so that worksheets with few cells stay small
+const std::size_t first_chunk_size = 1024;
+const std::size_t max_chunk_size = 64 * 1024;
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+const std::size_t arena::max_small_size;
+const std::size_t arena::large_header_size;
+
+arena::arena()
+    : next_(nullptr),
+      end_(nullptr),
+      capacity_(0),
+      used_(0)
+{
+    owned_.previous = owned_.next = &owned_;
+    large_.previous = large_.next = &large_;
+}
+
+arena::~arena()
+{
+    for (auto item = owned_.next; item != &owned_; )
+    {
+        auto header = reinterpret_cast<owned *>(item);
+        item = item->next;
+        header->destroy(header);
+    }
+
+    for (auto item = large_.next; item != &large_; )
+    {
+        auto allocation = item;
+        item = item->next;
+        ::operator delete(allocation);
+    }
+}
+
+void *arena::allocate(std::size_t size, std::size_t alignment)
+{
+    if (size > max_small_size)
+    {
+        // the links to the other large allocations come first
+        auto allocation = static_cast<char *>(::operator new(large_header_size + size));
+        link(*new (allocation) node, large_);
+
+        return allocation + large_header_size;
+    }
+
+    auto address = reinterpret_cast<std::uintptr_t>(next_);
+    auto padding = (alignment - address % alignment) % alignment;
+
+    if (next_ == nullptr || static_cast<std::size_t>(end_ - next_) < padding + size)
+    {
+        auto chunk_size = std::min(max_chunk_size, std::max(first_chunk_size, capacity_));
+        chunks_.emplace_back(new char[chunk_size]);
+        next_ = chunks_.back().get();
+        end_ = next_ + chunk_size;
+        capacity_ += chunk_size;
+        // new[] returns memory aligned for any fundamental type
+        padding = 0;
+    }
+
+    auto result = next_ + padding;
+    next_ = result + size;
+    used_ += size;
+
+    return result;
+}
+
+void arena::deallocate(void *pointer, std::size_t size)
+{
+    if (size > max_small_size)
+    {
+        auto allocation = static_cast<char *>(pointer) - large_header_size;
+        unlink(*reinterpret_cast<node *>(allocation));
+        ::operator delete(allocation);
+
+        return;
+    }
+
+    used_ -= size;
+
+    // erasing what was just added reuses the memory right away
+    if (static_cast<char *>(pointer) + size == next_)
+    {
+        next_ = static_cast<char *>(pointer);
+    }
+}
+
+void arena::link(node &item, node &list)
+{
+    item.previous = &list;
+    item.next = list.next;
+    list.next->previous = &item;
+    list.next = &item;
+}
+
+void arena::unlink(owned &header)
+{
+    unlink(header.links);
+}
+
+void arena::unlink(node &item)
+{
+    item.previous->next = item.next;
+    item.next->previous = item.previous;
+}
+
+std::size_t arena::capacity() const
+{
+    return capacity_;
+}
+
+std::size_t arena::unused() const
+{
+    return capacity_ - used_;
+}
+
+} // namespace detail
+} // namespace xlnt
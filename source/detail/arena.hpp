@@ -0,0 +1,216 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Memory for many small objects which are released together. Allocations are
+/// carved out of chunks by bumping a pointer and deallocating only records how
+/// many bytes are no longer used, except that the most recent allocation can be
+/// given back. Everything is freed at once when the arena is destroyed so that
+/// its owner can decide when it's worth compacting. Requests larger than
+/// max_small_size bytes go to operator new and delete directly but are still
+/// freed with the arena, so objects allocated here don't have to be destroyed
+/// unless they were made with create().
+/// </summary>
+class arena
+{
+public:
+    static const std::size_t max_small_size = 512;
+
+    arena();
+    arena(const arena &other) = delete;
+    arena &operator=(const arena &other) = delete;
+    ~arena();
+
+    void *allocate(std::size_t size, std::size_t alignment);
+    void deallocate(void *pointer, std::size_t size);
+
+    /// <summary>
+    /// Construct a T in the arena which is destroyed by destroy() or else with the
+    /// arena, so unlike other objects here it may own memory elsewhere.
+    /// </summary>
+    template <typename T, typename... Args>
+    T *create(Args &&... args)
+    {
+        const auto size = object_offset<T>() + sizeof(T);
+        auto memory = static_cast<char *>(allocate(size, alignment<T>()));
+        T *object = nullptr;
+
+        try
+        {
+            object = new (memory + object_offset<T>()) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            deallocate(memory, size);
+            throw;
+        }
+
+        auto header = new (memory) owned{ {}, &destroy_object<T>, size };
+        link(header->links, owned_);
+
+        return object;
+    }
+
+    /// <summary>
+    /// Destroy an object made by create() and give back its memory.
+    /// </summary>
+    template <typename T>
+    void destroy(T *object)
+    {
+        auto header = reinterpret_cast<owned *>(reinterpret_cast<char *>(object) - object_offset<T>());
+
+        unlink(*header);
+        object->~T();
+        deallocate(header, header->size);
+    }
+
+    /// <summary>
+    /// The number of bytes in chunks, used or not.
+    /// </summary>
+    std::size_t capacity() const;
+
+    /// <summary>
+    /// The number of bytes of chunks that were deallocated or never allocated.
+    /// </summary>
+    std::size_t unused() const;
+
+private:
+    /// <summary>
+    /// Links the allocations which have to be visited when the arena is destroyed.
+    /// </summary>
+    struct node
+    {
+        node *previous;
+        node *next;
+    };
+
+    /// <summary>
+    /// Precedes each object made by create().
+    /// </summary>
+    struct owned
+    {
+        node links;
+        void (*destroy)(owned *header);
+        std::size_t size;
+    };
+
+    template <typename T>
+    static std::size_t alignment()
+    {
+        return alignof(T) > alignof(owned) ? alignof(T) : alignof(owned);
+    }
+
+    template <typename T>
+    static std::size_t object_offset()
+    {
+        return (sizeof(owned) + alignof(T) - 1) / alignof(T) * alignof(T);
+    }
+
+    template <typename T>
+    static void destroy_object(owned *header)
+    {
+        reinterpret_cast<T *>(reinterpret_cast<char *>(header) + object_offset<T>())->~T();
+    }
+
+    static void link(node &item, node &list);
+    static void unlink(owned &header);
+    static void unlink(node &item);
+
+    // the size of the links before large allocations, which keeps them aligned for any type
+    static const std::size_t large_header_size = (sizeof(node) + alignof(std::max_align_t) - 1)
+        / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char *next_;
+    char *end_;
+    std::size_t capacity_;
+    std::size_t used_;
+
+    // circular lists of the objects made by create() and of the large allocations
+    node owned_;
+    node large_;
+};
+
+/// <summary>
+/// An allocator which allocates from an arena so that it can be used by standard
+/// containers. Copies of a container share the arena of the original, so owners
+/// that need a separate arena for a copy have to copy with an allocator argument.
+/// </summary>
+template <typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    explicit arena_allocator(arena *memory) : memory_(memory)
+    {
+    }
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U> &other) : memory_(other.memory())
+    {
+    }
+
+    T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(memory_->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *pointer, std::size_t count)
+    {
+        memory_->deallocate(pointer, count * sizeof(T));
+    }
+
+    arena *memory() const
+    {
+        return memory_;
+    }
+
+    template <typename U>
+    bool operator==(const arena_allocator<U> &other) const
+    {
+        return memory_ == other.memory();
+    }
+
+    template <typename U>
+    bool operator!=(const arena_allocator<U> &other) const
+    {
+        return memory_ != other.memory();
+    }
+
+private:
+    arena *memory_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,132 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <detail/calculation_chain.hpp>
+#include <detail/cell_impl.hpp>
+#include <detail/worksheet_impl.hpp>
+#include <detail/worksheet_registry.hpp>
+
+namespace {
+
+std::uint64_t cell_key(xlnt::row_t row, xlnt::column_t::index_t column)
+{
+    return (static_cast<std::uint64_t>(row) << 32) | column;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+void calculation_chain::clear()
+{
+    entries_.clear();
+}
+
+bool calculation_chain::empty() const
+{
+    return entries_.empty();
+}
+
+void calculation_chain::append(std::size_t sheet_id, row_t row, column_t::index_t column, std::uint8_t flags)
+{
+    entry new_entry;
+    new_entry.sheet_id = static_cast<std::uint32_t>(sheet_id);
+    new_entry.row = row;
+    new_entry.column = column;
+    new_entry.flags = flags;
+
+    entries_.push_back(new_entry);
+}
+
+const std::vector<calculation_chain::entry> &calculation_chain::entries() const
+{
+    return entries_;
+}
+
+void calculation_chain::reconcile(const worksheet_registry &worksheets)
+{
+    // cells of each sheet that are already in the chain
+    std::unordered_map<std::size_t, std::unordered_set<std::uint64_t>> chained;
+
+    auto has_formula = [](const worksheet_impl &ws, row_t row, column_t::index_t column)
+    {
+        auto row_match = ws.cell_map_.find(row);
+        if (row_match == ws.cell_map_.end()) return false;
+
+        auto cell_match = row_match->second.find(column);
+        return cell_match != row_match->second.end() && cell_match->second.formula();
+    };
+
+    auto kept = std::remove_if(entries_.begin(), entries_.end(), [&](const entry &e)
+    {
+        auto sheet = worksheets.find_by_id(e.sheet_id);
+
+        if (sheet == nullptr || (!sheet->is_deferred() && !has_formula(*sheet, e.row, e.column)))
+        {
+            return true;
+        }
+
+        return !chained[e.sheet_id].insert(cell_key(e.row, e.column)).second;
+    });
+
+    entries_.erase(kept, entries_.end());
+
+    for (const auto &ws : worksheets)
+    {
+        // the cells of a worksheet that hasn't been parsed are unknown so its entries are kept as they were
+        if (ws.is_deferred()) continue;
+
+        std::vector<std::uint64_t> missing;
+        const auto &sheet_chained = chained[ws.id_];
+
+        for (const auto &row : ws.cell_map_)
+        {
+            for (const auto &cell : row.second)
+            {
+                if (!cell.second.formula()) continue;
+
+                auto key = cell_key(row.first, cell.first.index);
+
+                if (sheet_chained.find(key) == sheet_chained.end())
+                {
+                    missing.push_back(key);
+                }
+            }
+        }
+
+        std::sort(missing.begin(), missing.end());
+
+        for (auto key : missing)
+        {
+            append(ws.id_, static_cast<row_t>(key >> 32), static_cast<column_t::index_t>(key & 0xffffffff));
+        }
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
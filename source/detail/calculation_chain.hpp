@@ -0,0 +1,99 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <xlnt/cell/index_types.hpp>
+
+namespace xlnt {
+namespace detail {
+
+class worksheet_registry;
+
+/// <summary>
+/// The order in which the formulas of a workbook were last calculated, as stored
+/// in xl/calcChain.xml. Writing it back lets Excel open a workbook without
+/// rebuilding its dependency tree. Entries are kept in a flat array of
+/// (sheet id, row, column) so that chains with millions of formulas stay small.
+/// </summary>
+class calculation_chain
+{
+public:
+    /// <summary>
+    /// The optional attributes of a chain entry.
+    /// </summary>
+    enum flag : std::uint8_t
+    {
+        new_level = 1, // l: the cell starts a new dependency level
+        child_chain = 2, // s: the cell is part of a child chain
+        array = 4, // a: the cell holds an array formula
+        new_thread = 8 // t: the cell starts a new calculation thread
+    };
+
+    struct entry
+    {
+        std::uint32_t sheet_id;
+        row_t row;
+        std::uint32_t column : 24;
+        std::uint32_t flags : 8;
+    };
+
+    /// <summary>
+    /// Remove every entry.
+    /// </summary>
+    void clear();
+
+    /// <summary>
+    /// Return true if the chain has no entries.
+    /// </summary>
+    bool empty() const;
+
+    /// <summary>
+    /// Add the formula in the given cell of the worksheet with the given id to the end of the chain.
+    /// </summary>
+    void append(std::size_t sheet_id, row_t row, column_t::index_t column, std::uint8_t flags = 0);
+
+    /// <summary>
+    /// Return the entries in calculation order.
+    /// </summary>
+    const std::vector<entry> &entries() const;
+
+    /// <summary>
+    /// Make the chain match the formulas currently in worksheets. Entries for removed
+    /// sheets, cells that no longer hold a formula, and duplicates are dropped, keeping
+    /// the order of the rest. Formulas that aren't in the chain yet are appended
+    /// in sheet, row, column order. Entries of lazily loaded sheets that haven't been
+    /// parsed yet are left alone.
+    /// </summary>
+    void reconcile(const worksheet_registry &worksheets);
+
+private:
+    std::vector<entry> entries_;
+};
+
+} // namespace detail
+} // namespace xlnt
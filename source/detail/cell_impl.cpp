@@ -21,13 +21,89 @@
 //
 // @license: http://www.opensource.org/licenses/mit-license.php
 // @author: see AUTHORS file
+#include <xlnt/cell/cell.hpp>
 #include <xlnt/worksheet/worksheet.hpp>
 
+#include "arena.hpp"
 #include "cell_impl.hpp"
 #include "comment_impl.hpp"
 
 namespace xlnt {
 namespace detail {
 
+const std::uint32_t cell_impl::no_string_index;
+
+void cell_impl::assign(const cell_impl &other, arena &memory)
+{
+    type_ = other.type_;
+    value_integer_offset_ = other.value_integer_offset_;
+    value_string_index_ = other.value_string_index_;
+    value_numeric_ = other.value_numeric_;
+    format_id_ = other.format_id_;
+
+    if (other.extras_ != nullptr)
+    {
+        extras(memory) = *other.extras_;
+    }
+    else
+    {
+        release(memory);
+    }
+}
+
+cell_impl::extra_values &cell_impl::extras(arena &memory)
+{
+    if (extras_ == nullptr)
+    {
+        extras_ = memory.create<extra_values>();
+    }
+
+    return *extras_;
+}
+
+void cell_impl::release(arena &memory)
+{
+    if (extras_ != nullptr)
+    {
+        memory.destroy(extras_);
+        extras_ = nullptr;
+    }
+}
+
+void cell_impl::clear_value_text()
+{
+    if (extras_)
+    {
+        extras_->value_text_.clear();
+    }
+}
+
+void cell_impl::clear_formula()
+{
+    if (extras_)
+    {
+        extras_->formula_.clear();
+    }
+}
+
+void cell_impl::clear_style_name()
+{
+    if (extras_)
+    {
+        extras_->style_name_.clear();
+    }
+}
+
+const cell_impl::extra_values &cell_impl::no_extras()
+{
+    static const extra_values none;
+    return none;
+}
+
+std::string cell_impl::get_string(const worksheet_impl &parent) const
+{
+    return cell(const_cast<cell_impl *>(this), const_cast<worksheet_impl *>(&parent)).get_value<std::string>();
+}
+
 } // namespace detail
 } // namespace xlnt
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include <xlnt/cell/cell_type.hpp>
@@ -34,30 +35,106 @@ namespace xlnt {
 
 namespace detail {
 
+class arena;
 struct comment_impl;
 struct worksheet_impl;
 
+/// <summary>
+/// A cell is trivially destructible so that its block can be freed without
+/// visiting it. Its extra values are allocated from the arena of the block which
+/// destroys them, so they have to be copied and released with that arena.
+/// </summary>
 struct cell_impl
 {
-    cell_type type_;
+    static const std::uint32_t no_string_index = 0xFFFFFFFF;
 
-    worksheet_impl *parent_;
+    /// <summary>
+    /// The values most cells don't have. They are only allocated once one of them
+    /// is set so that cells holding a number or a shared string stay small.
+    /// </summary>
+    struct extra_values
+    {
+        // formula results and errors, which aren't shared strings
+        text value_text_;
 
-    column_t column_;
-    row_t row_;
+        optional<std::string> formula_;
+
+        optional<std::string> hyperlink_;
+
+        optional<std::string> style_name_;
+    };
+
+    cell_impl() = default;
+    cell_impl(const cell_impl &other) = delete;
+    cell_impl &operator=(const cell_impl &other) = delete;
+
+    /// <summary>
+    /// Copy everything but the position of other, allocating extra values from memory.
+    /// </summary>
+    void assign(const cell_impl &other, arena &memory);
+
+    const text &value_text() const
+    {
+        return extras_ ? extras_->value_text_ : no_extras().value_text_;
+    }
+
+    const optional<std::string> &formula() const
+    {
+        return extras_ ? extras_->formula_ : no_extras().formula_;
+    }
+
+    const optional<std::string> &hyperlink() const
+    {
+        return extras_ ? extras_->hyperlink_ : no_extras().hyperlink_;
+    }
 
-	bool is_merged_;
+    const optional<std::string> &style_name() const
+    {
+        return extras_ ? extras_->style_name_ : no_extras().style_name_;
+    }
 
-    text value_text_;
-    long double value_numeric_;
+    /// <summary>
+    /// Return the extra values for modification, allocating them from memory first if needed.
+    /// </summary>
+    extra_values &extras(arena &memory);
 
-    optional<std::string> formula_;
+    /// <summary>
+    /// Destroy the extra values, e.g. before the cell is erased.
+    /// </summary>
+    void release(arena &memory);
 
-    optional<std::string> hyperlink_;
+    /// <summary>
+    /// Clear one of the extra values without allocating them.
+    /// </summary>
+    void clear_value_text();
+    void clear_formula();
+    void clear_style_name();
+
+    /// <summary>
+    /// Return the characters of the string or error value of this cell, which belongs to parent.
+    /// </summary>
+    std::string get_string(const worksheet_impl &parent) const;
+
+    cell_type type_;
+
+    column_t column_;
+    row_t row_;
+
+    // Integers beyond 2^53 are rounded when stored in value_numeric_. The rounding
+    // error is at most 2^11 so it fits here and is added back by the integer getters.
+    std::int16_t value_integer_offset_;
+
+    // The value of a string cell is the shared string at value_string_index_. Formula
+    // results and errors, which aren't shared strings, are kept in the extra values.
+    std::uint32_t value_string_index_ = no_string_index;
+    double value_numeric_;
 
     optional<std::size_t> format_id_;
 
-    optional<std::string> style_name_;
+    extra_values *extras_ = nullptr;
+
+private:
+    static const extra_values &no_extras();
 };
 
 } // namespace detail
@@ -0,0 +1,390 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <atomic>
+#include <new>
+#include <tuple>
+
+#include <detail/cell_store.hpp>
+#include <detail/copy_on_write.hpp>
+
+namespace {
+
+// compacting a block that wastes less than this isn't worth moving its cells
+const std::size_t min_compacted_waste = 64 * 1024;
+
+std::size_t next_generation()
+{
+    static std::atomic<std::size_t> generation(0);
+    return ++generation;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+const row_t cell_store::block_rows;
+
+cell_store::block::block()
+    : rows(*new (memory.allocate(sizeof(row_table), alignof(row_table)))
+          row_table(row_table::allocator_type(&memory)))
+{
+}
+
+cell_store::block::block(const block &other)
+    : block()
+{
+    rows.reserve(other.rows.size());
+
+    for (const auto &row : other.rows)
+    {
+        auto &cells = rows.emplace(std::piecewise_construct, std::forward_as_tuple(row.first),
+            std::forward_as_tuple(row_map::allocator_type(&memory))).first->second;
+        cells.reserve(row.second.size());
+
+        for (const auto &cell : row.second)
+        {
+            auto &copy = cells[cell.first];
+            copy.row_ = cell.second.row_;
+            copy.column_ = cell.second.column_;
+            copy.assign(cell.second, memory);
+        }
+    }
+}
+
+cell_store::cell_store()
+    : table_(std::make_shared<block_table>()),
+      rows_(0),
+      generation_(next_generation()),
+      shared_(false)
+{
+}
+
+cell_store::cell_store(const cell_store &other)
+    : table_(other.table_),
+      rows_(other.rows_),
+      generation_(next_generation()),
+      shared_(true)
+{
+    other.shared_ = true;
+}
+
+cell_store &cell_store::operator=(const cell_store &other)
+{
+    if (this != &other)
+    {
+        table_ = other.table_;
+        rows_ = other.rows_;
+        generation_ = next_generation();
+        shared_ = true;
+        other.shared_ = true;
+    }
+
+    return *this;
+}
+
+std::size_t cell_store::size() const
+{
+    return rows_;
+}
+
+bool cell_store::empty() const
+{
+    return rows_ == 0;
+}
+
+cell_store::const_iterator cell_store::begin() const
+{
+    const auto &table = *table_;
+    return const_iterator(table.begin(), table.end());
+}
+
+cell_store::const_iterator cell_store::end() const
+{
+    const auto &table = *table_;
+    return const_iterator(table.end(), table.end());
+}
+
+cell_store::const_iterator cell_store::cbegin() const
+{
+    return begin();
+}
+
+cell_store::const_iterator cell_store::cend() const
+{
+    return end();
+}
+
+cell_store::const_iterator cell_store::find(row_t row) const
+{
+    const auto &table = *table_;
+    auto match = table.find(row / block_rows);
+
+    if (match == table.end())
+    {
+        return end();
+    }
+
+    const auto &rows = match->second->rows;
+    auto row_match = rows.find(row);
+
+    return row_match == rows.end() ? end() : const_iterator(match, table.end(), row_match);
+}
+
+const cell_store::row_map &cell_store::at(row_t row) const
+{
+    return table_->at(row / block_rows)->rows.at(row);
+}
+
+const cell_impl *cell_store::find_cell(row_t row, column_t column) const
+{
+    auto match = find(row);
+
+    if (match == end())
+    {
+        return nullptr;
+    }
+
+    auto cell_match = match->second.find(column);
+
+    return cell_match == match->second.end() ? nullptr : &cell_match->second;
+}
+
+cell_store::row_map &cell_store::operator[](row_t row)
+{
+    auto &stored = mutable_block(row);
+    auto match = stored.rows.find(row);
+
+    if (match != stored.rows.end())
+    {
+        return match->second;
+    }
+
+    ++rows_;
+
+    return stored.rows.emplace(std::piecewise_construct, std::forward_as_tuple(row),
+        std::forward_as_tuple(row_map::allocator_type(&stored.memory))).first->second;
+}
+
+cell_impl &cell_store::get_cell(row_t row, column_t column)
+{
+    auto &cells = (*this)[row];
+    auto match = cells.find(column);
+
+    if (match != cells.end())
+    {
+        return match->second;
+    }
+
+    auto &impl = cells[column];
+    impl.row_ = row;
+    impl.column_ = column;
+
+    return impl;
+}
+
+cell_impl::extra_values &cell_store::extras(cell_impl &cell)
+{
+    // the block isn't shared since cell is being modified so it doesn't have to be copied
+    return cell.extras(table_->at(cell.row_ / block_rows)->memory);
+}
+
+void cell_store::assign(cell_impl &cell, const cell_impl &other)
+{
+    cell.assign(other, table_->at(cell.row_ / block_rows)->memory);
+}
+
+cell_store::row_map::iterator cell_store::erase(row_map &cells, row_map::iterator position)
+{
+    position->second.release(*cells.get_allocator().memory());
+    return cells.erase(position);
+}
+
+cell_impl *cell_store::find_mutable_cell(row_t row, column_t column)
+{
+    if (find_cell(row, column) == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto &cells = mutable_block(row).rows.at(row);
+
+    return &cells.at(column);
+}
+
+bool cell_store::erase(row_t row)
+{
+    if (find(row) == end())
+    {
+        return false;
+    }
+
+    auto &stored = mutable_block(row);
+    auto &rows = stored.rows;
+    auto match = rows.find(row);
+
+    for (auto &cell : match->second)
+    {
+        cell.second.release(stored.memory);
+    }
+
+    rows.erase(match);
+    --rows_;
+
+    if (rows.empty())
+    {
+        table_->erase(row / block_rows);
+    }
+
+    return true;
+}
+
+cell_store::mutable_range cell_store::mutable_rows()
+{
+    unshare();
+
+    auto &table = *table_;
+
+    return mutable_range(iterator(table.begin(), table.end()), iterator(table.end(), table.end()));
+}
+
+bool cell_store::block_shared(row_t row) const
+{
+    auto match = table_->find(row / block_rows);
+
+    // every block of a shared table is shared, whatever its own reference count
+    return match != table_->end() && (!is_unique(table_) || !is_unique(match->second));
+}
+
+bool cell_store::unshare()
+{
+    if (!shared_)
+    {
+        return false;
+    }
+
+    auto moved = false;
+
+    for (auto &entry : mutable_table())
+    {
+        if (!is_unique(entry.second))
+        {
+            entry.second = std::make_shared<block>(*entry.second);
+            moved = true;
+        }
+    }
+
+    if (moved)
+    {
+        generation_ = next_generation();
+    }
+
+    // nothing is shared anymore and only copying this store can change that
+    shared_ = false;
+
+    return moved;
+}
+
+std::size_t cell_store::shared_cells() const
+{
+    if (!shared_)
+    {
+        return 0;
+    }
+
+    std::size_t count = 0;
+    const auto table_shared = !is_unique(table_);
+
+    for (const auto &entry : *table_)
+    {
+        if (table_shared || !is_unique(entry.second))
+        {
+            for (const auto &row : entry.second->rows)
+            {
+                count += row.second.size();
+            }
+        }
+    }
+
+    return count;
+}
+
+bool cell_store::compact()
+{
+    auto moved = false;
+
+    for (auto &entry : mutable_table())
+    {
+        const auto &memory = entry.second->memory;
+
+        if (memory.unused() >= min_compacted_waste && memory.unused() > memory.capacity() / 2)
+        {
+            entry.second = std::make_shared<block>(*entry.second);
+            moved = true;
+        }
+    }
+
+    if (moved)
+    {
+        generation_ = next_generation();
+    }
+
+    return moved;
+}
+
+void cell_store::reserve(std::size_t rows)
+{
+    mutable_table().reserve(rows / block_rows + 1);
+}
+
+cell_store::block_table &cell_store::mutable_table()
+{
+    // the copy of the table still shares every block, so the blocks are copied separately as needed
+    if (shared_ && !is_unique(table_))
+    {
+        table_ = std::make_shared<block_table>(*table_);
+    }
+
+    return *table_;
+}
+
+cell_store::block &cell_store::mutable_block(row_t row)
+{
+    auto &stored = mutable_table()[row / block_rows];
+
+    if (!stored)
+    {
+        stored = std::make_shared<block>();
+    }
+    else if (shared_ && !is_unique(stored))
+    {
+        stored = std::make_shared<block>(*stored);
+        generation_ = next_generation();
+    }
+
+    return *stored;
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,336 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <xlnt/cell/index_types.hpp>
+#include <detail/arena.hpp>
+#include <detail/cell_impl.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// The cells of a worksheet by row and column. Rows are grouped into blocks of
+/// block_rows consecutive rows which are reference counted, as is the table of
+/// blocks, so copying a store only copies a pointer. Reading never copies
+/// anything. The block holding a row is copied the first time the row is modified
+/// while another store still refers to it. That moves the cells of the block so
+/// generation() changes whenever it happens and handles to cells compare it to
+/// know when to look their cell up again.
+/// Each block allocates its rows and cells from its own arena, which is freed
+/// at once with the block without visiting any cell. Copying a block compacts
+/// it into a new arena.
+/// </summary>
+class cell_store
+{
+public:
+    using row_map = std::unordered_map<column_t, cell_impl, std::hash<column_t>,
+        std::equal_to<column_t>, arena_allocator<std::pair<const column_t, cell_impl>>>;
+
+    static const row_t block_rows = 256;
+
+private:
+    using row_table = std::unordered_map<row_t, row_map, std::hash<row_t>,
+        std::equal_to<row_t>, arena_allocator<std::pair<const row_t, row_map>>>;
+
+    static_assert(std::is_trivially_destructible<cell_impl>::value,
+        "blocks are freed without destroying their cells");
+
+    struct block
+    {
+        block();
+        block(const block &other);
+        block &operator=(const block &other) = delete;
+
+        arena memory;
+
+        // Allocated from memory and never destroyed since everything it holds is
+        // in memory too, which also destroys the extra values of the cells.
+        row_table &rows;
+    };
+
+    using block_table = std::unordered_map<row_t, std::shared_ptr<block>>;
+
+    /// <summary>
+    /// Iterates over the rows of every block. Blocks are never left empty so
+    /// only the end of each one has to be skipped.
+    /// </summary>
+    template <bool is_const>
+    class basic_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = row_table::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename std::conditional<is_const, const value_type *, value_type *>::type;
+        using reference = typename std::conditional<is_const, const value_type &, value_type &>::type;
+
+        basic_iterator() = default;
+
+        reference operator*() const
+        {
+            return *row_;
+        }
+
+        pointer operator->() const
+        {
+            return &*row_;
+        }
+
+        basic_iterator &operator++()
+        {
+            if (++row_ == rows().end() && ++block_ != end_)
+            {
+                row_ = rows().begin();
+            }
+
+            return *this;
+        }
+
+        basic_iterator operator++(int)
+        {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const basic_iterator &other) const
+        {
+            return block_ == other.block_ && (block_ == end_ || row_ == other.row_);
+        }
+
+        bool operator!=(const basic_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        friend class cell_store;
+
+        using table_iterator = typename std::conditional<is_const,
+            block_table::const_iterator, block_table::iterator>::type;
+        using row_iterator = typename std::conditional<is_const,
+            row_table::const_iterator, row_table::iterator>::type;
+        using rows_reference = typename std::conditional<is_const, const row_table &, row_table &>::type;
+
+        basic_iterator(table_iterator position, table_iterator end)
+            : block_(position), end_(end)
+        {
+            if (block_ != end_)
+            {
+                row_ = rows().begin();
+            }
+        }
+
+        basic_iterator(table_iterator position, table_iterator end, row_iterator row)
+            : block_(position), end_(end), row_(row)
+        {
+        }
+
+        rows_reference rows() const
+        {
+            return block_->second->rows;
+        }
+
+        table_iterator block_;
+        table_iterator end_;
+        row_iterator row_;
+    };
+
+public:
+    using const_iterator = basic_iterator<true>;
+    using iterator = basic_iterator<false>;
+
+    /// <summary>
+    /// The rows returned by mutable_rows().
+    /// </summary>
+    class mutable_range
+    {
+    public:
+        iterator begin() const
+        {
+            return begin_;
+        }
+
+        iterator end() const
+        {
+            return end_;
+        }
+
+    private:
+        friend class cell_store;
+
+        mutable_range(iterator begin, iterator end) : begin_(begin), end_(end)
+        {
+        }
+
+        iterator begin_;
+        iterator end_;
+    };
+
+    cell_store();
+
+    /// <summary>
+    /// Share the blocks of other. Neither store copies a block until it's modified.
+    /// </summary>
+    cell_store(const cell_store &other);
+    cell_store &operator=(const cell_store &other);
+
+    /// <summary>
+    /// The number of rows with at least one cell.
+    /// </summary>
+    std::size_t size() const;
+    bool empty() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator cbegin() const;
+    const_iterator cend() const;
+    const_iterator find(row_t row) const;
+
+    /// <summary>
+    /// Throws std::out_of_range like std::unordered_map::at if there is no such row.
+    /// </summary>
+    const row_map &at(row_t row) const;
+
+    /// <summary>
+    /// Return the cell at row and column or nullptr if there is none.
+    /// </summary>
+    const cell_impl *find_cell(row_t row, column_t column) const;
+
+    /// <summary>
+    /// Return the row, adding it if it doesn't exist. The block holding it is copied first if it's shared.
+    /// </summary>
+    row_map &operator[](row_t row);
+
+    /// <summary>
+    /// Return the cell at row and column, adding it if it doesn't exist.
+    /// The block holding it is copied first if it's shared.
+    /// </summary>
+    cell_impl &get_cell(row_t row, column_t column);
+
+    /// <summary>
+    /// Return the extra values of cell, which has to be in this store and modifiable,
+    /// allocating them from the arena of its block first if needed.
+    /// </summary>
+    cell_impl::extra_values &extras(cell_impl &cell);
+
+    /// <summary>
+    /// Copy everything but the position of other to cell, which has to be in this store and modifiable.
+    /// </summary>
+    void assign(cell_impl &cell, const cell_impl &other);
+
+    /// <summary>
+    /// Remove the cell at position from cells, a row of this store, and return the next one.
+    /// </summary>
+    static row_map::iterator erase(row_map &cells, row_map::iterator position);
+
+    /// <summary>
+    /// Return the cell at row and column for modification or nullptr if there is none.
+    /// The block holding it is copied first if it's shared.
+    /// </summary>
+    cell_impl *find_mutable_cell(row_t row, column_t column);
+
+    /// <summary>
+    /// Remove row and its cells. Returns false if there is no such row.
+    /// </summary>
+    bool erase(row_t row);
+
+    /// <summary>
+    /// Copy every shared block and return the rows for modification.
+    /// </summary>
+    mutable_range mutable_rows();
+
+    /// <summary>
+    /// Return true if the block holding row is still shared with another store.
+    /// This is cheap for stores that were never copied.
+    /// </summary>
+    bool is_shared(row_t row) const
+    {
+        return shared_ && block_shared(row);
+    }
+
+    /// <summary>
+    /// Copy the block holding row if it's shared.
+    /// </summary>
+    void unshare(row_t row)
+    {
+        if (is_shared(row))
+        {
+            mutable_block(row);
+        }
+    }
+
+    /// <summary>
+    /// Copy every shared block. Returns true if any cells were moved.
+    /// </summary>
+    bool unshare();
+
+    /// <summary>
+    /// The number of cells in blocks which are still shared with another store.
+    /// </summary>
+    std::size_t shared_cells() const;
+
+    /// <summary>
+    /// Copy the blocks whose arena is mostly unused into new arenas, e.g. after
+    /// many cells were erased. Returns true if any cells were moved.
+    /// </summary>
+    bool compact();
+
+    /// <summary>
+    /// Prepare the table for holding rows rows without rehashing.
+    /// </summary>
+    void reserve(std::size_t rows);
+
+    /// <summary>
+    /// Changes whenever cells are moved by copying a shared block. Generations
+    /// are unique among all stores so a new store never repeats an old one.
+    /// </summary>
+    std::size_t generation() const
+    {
+        return generation_;
+    }
+
+private:
+    bool block_shared(row_t row) const;
+    block_table &mutable_table();
+    block &mutable_block(row_t row);
+
+    std::shared_ptr<block_table> table_;
+    std::size_t rows_;
+    std::size_t generation_;
+
+    // set once table_ has been shared with another store and cleared by unshare()
+    // so that stores which were never copied skip the reference count checks
+    mutable bool shared_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,66 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Return true if pointer holds the only reference to its object, so that the
+/// object can be modified without affecting the copies it was shared with.
+/// Another thread may have just released its reference, e.g. a copy being saved in
+/// the background, so its reads of the object have to happen before it's modified.
+/// </summary>
+template <typename T>
+bool is_unique(const std::shared_ptr<T> &pointer)
+{
+    if (pointer.use_count() != 1)
+    {
+        return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return true;
+}
+
+/// <summary>
+/// Return the object of pointer for modification, first replacing it with a copy
+/// of its own if it's shared.
+/// </summary>
+template <typename T>
+T &copy_if_shared(std::shared_ptr<T> &pointer)
+{
+    if (!is_unique(pointer))
+    {
+        pointer = std::make_shared<T>(*pointer);
+    }
+
+    return *pointer;
+}
+
+} // namespace detail
+} // namespace xlnt
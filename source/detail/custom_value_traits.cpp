@@ -32,7 +32,7 @@ std::string to_string(relationship::type t)
 	case relationship::type::thumbnail:
 		return "http://schemas.openxmlformats.org/package/2006/relationships/metadata/thumbnail";
 	case relationship::type::calculation_chain:
-		return "http://purl.oclc.org/ooxml/officeDocument/relationships/calcChain";
+		return "http://schemas.openxmlformats.org/officeDocument/2006/relationships/calcChain";
 	case relationship::type::extended_properties:
 		return "http://schemas.openxmlformats.org/officeDocument/2006/relationships/extended-properties";
 	case relationship::type::core_properties:
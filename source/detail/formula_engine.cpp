@@ -0,0 +1,1739 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <thread>
+#include <unordered_set>
+
+#include <detail/cell_impl.hpp>
+#include <detail/formula_engine.hpp>
+#include <detail/numeric_kernels.hpp>
+#include <detail/workbook_impl.hpp>
+#include <detail/worksheet_impl.hpp>
+#include <xlnt/utils/exceptions.hpp>
+#include <xlnt/workbook/calculation_properties.hpp>
+#include <xlnt/workbook/named_range.hpp>
+#include <xlnt/worksheet/range_reference.hpp>
+#include <xlnt/worksheet/worksheet.hpp>
+
+namespace {
+
+using xlnt::detail::cell_impl;
+using xlnt::detail::formula_function;
+using xlnt::detail::formula_node;
+using xlnt::detail::formula_operator;
+using xlnt::detail::formula_reference;
+using xlnt::detail::formula_value;
+using xlnt::detail::worksheet_impl;
+
+using value_type = formula_value::value_type;
+
+// Ranges spanning more columns than this are tested against every changed cell
+// of their sheet instead of being added to each column's bucket.
+const xlnt::column_t::index_t wide_range_columns = 16;
+
+// Levels with fewer formulas than this are evaluated on the calling thread.
+const std::size_t parallel_level_size = 256;
+
+// The smallest number of formulas handed to a worker thread at once.
+const std::size_t parallel_grain_size = 64;
+
+formula_value make_number(double number)
+{
+    formula_value result;
+
+    if (std::isfinite(number))
+    {
+        result.type = value_type::number;
+        result.number = number;
+    }
+    else
+    {
+        result.type = value_type::error;
+        result.text = "#NUM!";
+    }
+
+    return result;
+}
+
+formula_value make_string(const std::string &string)
+{
+    formula_value result;
+    result.type = value_type::string;
+    result.text = string;
+
+    return result;
+}
+
+formula_value make_boolean(bool boolean)
+{
+    formula_value result;
+    result.type = value_type::boolean;
+    result.number = boolean ? 1 : 0;
+
+    return result;
+}
+
+formula_value make_error(const std::string &error)
+{
+    formula_value result;
+    result.type = value_type::error;
+    result.text = error;
+
+    return result;
+}
+
+formula_value make_reference(const formula_reference &reference)
+{
+    formula_value result;
+    result.type = value_type::reference;
+    result.reference = reference;
+
+    return result;
+}
+
+std::string to_upper(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](char c) {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    });
+
+    return s;
+}
+
+/// <summary>
+/// Format number the way Excel's General format does when a number is used as text,
+/// i.e. with up to 15 significant digits.
+/// </summary>
+std::string number_to_string(double number)
+{
+    if (number == std::floor(number) && std::fabs(number) < 1e15)
+    {
+        return std::to_string(static_cast<long long>(number));
+    }
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15G", number);
+
+    return buffer;
+}
+
+const cell_impl *find_cell(const worksheet_impl *sheet, xlnt::row_t row, xlnt::column_t::index_t column)
+{
+    auto row_match = sheet->cell_map_.find(row);
+
+    if (row_match == sheet->cell_map_.end())
+    {
+        return nullptr;
+    }
+
+    auto cell_match = row_match->second.find(xlnt::column_t(column));
+
+    return cell_match == row_match->second.end() ? nullptr : &cell_match->second;
+}
+
+formula_value cell_value(const worksheet_impl *sheet, const cell_impl *cell)
+{
+    if (cell == nullptr)
+    {
+        return formula_value();
+    }
+
+    switch (cell->type_)
+    {
+    case xlnt::cell_type::numeric:
+        return make_number(cell->value_numeric_);
+    case xlnt::cell_type::boolean:
+        return make_boolean(cell->value_numeric_ != 0);
+    case xlnt::cell_type::string:
+        return make_string(cell->get_string(*sheet));
+    case xlnt::cell_type::error:
+        return make_error(cell->value_text().get_plain_string());
+    case xlnt::cell_type::formula:
+    case xlnt::cell_type::null:
+    default:
+        return formula_value();
+    }
+}
+
+formula_value cell_value(const formula_reference &reference, xlnt::row_t row, xlnt::column_t::index_t column)
+{
+    return cell_value(reference.sheet, find_cell(reference.sheet, row, column));
+}
+
+/// <summary>
+/// Dereference a single-cell reference. Multi-cell references can't be used
+/// where a single value is expected.
+/// </summary>
+formula_value to_scalar(const formula_value &value)
+{
+    if (value.type != value_type::reference)
+    {
+        return value;
+    }
+
+    if (value.reference.sheet == nullptr)
+    {
+        return make_error("#REF!");
+    }
+
+    if (!value.reference.is_cell())
+    {
+        return make_error("#VALUE!");
+    }
+
+    return cell_value(value.reference, value.reference.first_row, value.reference.first_column);
+}
+
+/// <summary>
+/// Coerce a scalar to a number. Returns an error value if that isn't possible.
+/// </summary>
+formula_value to_number(const formula_value &value)
+{
+    switch (value.type)
+    {
+    case value_type::number:
+        return value;
+    case value_type::boolean:
+    case value_type::empty:
+        return make_number(value.number);
+    case value_type::string:
+    {
+        const char *begin = value.text.c_str();
+        char *end = nullptr;
+        auto number = std::strtod(begin, &end);
+
+        while (end != nullptr && *end != '\0' && std::isspace(static_cast<unsigned char>(*end)))
+        {
+            ++end;
+        }
+
+        if (value.text.empty() || end == begin || *end != '\0')
+        {
+            return make_error("#VALUE!");
+        }
+
+        return make_number(number);
+    }
+    case value_type::error:
+        return value;
+    case value_type::reference:
+    default:
+        return to_number(to_scalar(value));
+    }
+}
+
+formula_value to_boolean(const formula_value &value)
+{
+    switch (value.type)
+    {
+    case value_type::boolean:
+        return value;
+    case value_type::number:
+    case value_type::empty:
+        return make_boolean(value.number != 0);
+    case value_type::string:
+    {
+        auto upper = to_upper(value.text);
+
+        if (upper == "TRUE") return make_boolean(true);
+        if (upper == "FALSE") return make_boolean(false);
+
+        return make_error("#VALUE!");
+    }
+    case value_type::error:
+        return value;
+    case value_type::reference:
+    default:
+        return to_boolean(to_scalar(value));
+    }
+}
+
+std::string to_text(const formula_value &value)
+{
+    switch (value.type)
+    {
+    case value_type::number:
+        return number_to_string(value.number);
+    case value_type::boolean:
+        return value.number != 0 ? "TRUE" : "FALSE";
+    case value_type::string:
+    case value_type::error:
+        return value.text;
+    case value_type::empty:
+    case value_type::reference:
+    default:
+        return "";
+    }
+}
+
+/// <summary>
+/// Compare two scalars using Excel's ordering: numbers < text < logical values,
+/// text compared case-insensitively. Blank cells compare equal to 0, "", and FALSE.
+/// </summary>
+int compare(const formula_value &left, const formula_value &right)
+{
+    auto rank = [](const formula_value &v) {
+        switch (v.type)
+        {
+        case value_type::number: return 0;
+        case value_type::string: return 1;
+        case value_type::boolean: return 2;
+        default: return 0;
+        }
+    };
+
+    auto l = left;
+    auto r = right;
+
+    if (l.type == value_type::empty)
+    {
+        l = r.type == value_type::string ? make_string("") : r.type == value_type::boolean ? make_boolean(false) : make_number(0);
+    }
+
+    if (r.type == value_type::empty)
+    {
+        r = l.type == value_type::string ? make_string("") : l.type == value_type::boolean ? make_boolean(false) : make_number(0);
+    }
+
+    if (rank(l) != rank(r))
+    {
+        return rank(l) < rank(r) ? -1 : 1;
+    }
+
+    if (l.type == value_type::string)
+    {
+        auto lu = to_upper(l.text);
+        auto ru = to_upper(r.text);
+
+        return lu < ru ? -1 : (lu == ru ? 0 : 1);
+    }
+
+    return l.number < r.number ? -1 : (l.number == r.number ? 0 : 1);
+}
+
+/// <summary>
+/// True if a lookup function should consider candidate a match for lookup.
+/// Unlike compare, values of different types never match and blanks never match.
+/// </summary>
+bool same_kind(const formula_value &candidate, const formula_value &lookup)
+{
+    if (candidate.type == value_type::empty) return false;
+    if (candidate.type == lookup.type) return true;
+
+    return false;
+}
+
+/// <summary>
+/// Running state of SUM, AVERAGE, MIN, MAX, and COUNT.
+/// </summary>
+struct aggregate
+{
+    xlnt::detail::numeric_summary values;
+    bool has_error = false;
+    std::string error;
+
+    void add(double number)
+    {
+        values.sum += number;
+        values.min = std::min(values.min, number);
+        values.max = std::max(values.max, number);
+        ++values.count;
+    }
+
+    void fail(const std::string &code)
+    {
+        if (!has_error)
+        {
+            has_error = true;
+            error = code;
+        }
+    }
+};
+
+class evaluator
+{
+public:
+    formula_value evaluate(const formula_node &node, const worksheet_impl &sheet)
+    {
+        switch (node.type)
+        {
+        case formula_node::node_type::number:
+            return make_number(node.number);
+        case formula_node::node_type::string:
+            return make_string(node.text);
+        case formula_node::node_type::boolean:
+            return make_boolean(node.number != 0);
+        case formula_node::node_type::error:
+            return make_error(node.text);
+        case formula_node::node_type::reference:
+            if (node.reference.sheet == nullptr)
+            {
+                return make_error("#REF!");
+            }
+            return make_reference(node.reference);
+        case formula_node::node_type::name:
+            return make_error("#NAME?");
+        case formula_node::node_type::unary:
+            return evaluate_unary(node, sheet);
+        case formula_node::node_type::binary:
+            return evaluate_binary(node, sheet);
+        case formula_node::node_type::function:
+            return evaluate_function(node, sheet);
+        case formula_node::node_type::empty:
+        default:
+            return formula_value();
+        }
+    }
+
+private:
+    formula_value evaluate_unary(const formula_node &node, const worksheet_impl &sheet)
+    {
+        auto operand = to_scalar(evaluate(node.children.front(), sheet));
+
+        if (node.op == formula_operator::plus)
+        {
+            return operand;
+        }
+
+        auto number = to_number(operand);
+
+        if (number.type == value_type::error)
+        {
+            return number;
+        }
+
+        return make_number(node.op == formula_operator::negate ? -number.number : number.number / 100);
+    }
+
+    formula_value evaluate_binary(const formula_node &node, const worksheet_impl &sheet)
+    {
+        auto left = to_scalar(evaluate(node.children[0], sheet));
+        auto right = to_scalar(evaluate(node.children[1], sheet));
+
+        if (left.type == value_type::error) return left;
+        if (right.type == value_type::error) return right;
+
+        switch (node.op)
+        {
+        case formula_operator::concatenate:
+            return make_string(to_text(left) + to_text(right));
+        case formula_operator::equal:
+            return make_boolean(compare(left, right) == 0);
+        case formula_operator::not_equal:
+            return make_boolean(compare(left, right) != 0);
+        case formula_operator::less:
+            return make_boolean(compare(left, right) < 0);
+        case formula_operator::less_or_equal:
+            return make_boolean(compare(left, right) <= 0);
+        case formula_operator::greater:
+            return make_boolean(compare(left, right) > 0);
+        case formula_operator::greater_or_equal:
+            return make_boolean(compare(left, right) >= 0);
+        default:
+            break;
+        }
+
+        left = to_number(left);
+        right = to_number(right);
+
+        if (left.type == value_type::error) return left;
+        if (right.type == value_type::error) return right;
+
+        switch (node.op)
+        {
+        case formula_operator::add:
+            return make_number(left.number + right.number);
+        case formula_operator::subtract:
+            return make_number(left.number - right.number);
+        case formula_operator::multiply:
+            return make_number(left.number * right.number);
+        case formula_operator::divide:
+            if (right.number == 0) return make_error("#DIV/0!");
+            return make_number(left.number / right.number);
+        case formula_operator::power:
+            if (left.number == 0 && right.number == 0) return make_error("#NUM!");
+            return make_number(std::pow(left.number, right.number));
+        default:
+            return make_error("#VALUE!");
+        }
+    }
+
+    formula_value evaluate_function(const formula_node &node, const worksheet_impl &sheet)
+    {
+        switch (node.function)
+        {
+        case formula_function::sum:
+        case formula_function::average:
+        case formula_function::min:
+        case formula_function::max:
+        case formula_function::count:
+            return evaluate_aggregate(node, sheet);
+        case formula_function::if_:
+            return evaluate_if(node, sheet);
+        case formula_function::vlookup:
+            return evaluate_vlookup(node, sheet);
+        case formula_function::index:
+            return evaluate_index(node, sheet);
+        case formula_function::match:
+            return evaluate_match(node, sheet);
+        case formula_function::unknown:
+        default:
+            return make_error("#NAME?");
+        }
+    }
+
+    formula_value evaluate_aggregate(const formula_node &node, const worksheet_impl &sheet)
+    {
+        if (node.children.empty())
+        {
+            return make_error("#VALUE!");
+        }
+
+        const auto counting = node.function == formula_function::count;
+        aggregate result;
+
+        for (const auto &argument : node.children)
+        {
+            auto value = evaluate(argument, sheet);
+
+            if (value.type == value_type::reference)
+            {
+                // Cells referenced by a range only contribute numbers. Text and
+                // logical values in the range are ignored.
+                if (value.reference.sheet == nullptr)
+                {
+                    if (!counting) result.fail("#REF!");
+                    continue;
+                }
+
+                const auto &reference = value.reference;
+                xlnt::detail::numeric_bounds bounds = { reference.first_row, reference.last_row,
+                    reference.first_column, reference.last_column };
+
+                auto error = xlnt::detail::gather_numeric_blocks(*reference.sheet, bounds,
+                    [&result](const xlnt::detail::numeric_block &block) {
+                        result.values.merge(xlnt::detail::summarize(block));
+                    });
+
+                if (error != nullptr && !counting)
+                {
+                    result.fail(error->value_text().get_plain_string());
+                }
+
+                continue;
+            }
+
+            auto number = to_number(value);
+
+            if (number.type == value_type::error)
+            {
+                if (!counting) result.fail(number.text);
+                continue;
+            }
+
+            result.add(number.number);
+        }
+
+        if (result.has_error)
+        {
+            return make_error(result.error);
+        }
+
+        switch (node.function)
+        {
+        case formula_function::sum:
+            return make_number(result.values.sum);
+        case formula_function::average:
+            if (result.values.count == 0) return make_error("#DIV/0!");
+            return make_number(result.values.sum / static_cast<double>(result.values.count));
+        case formula_function::min:
+            return make_number(result.values.count == 0 ? 0 : result.values.min);
+        case formula_function::max:
+            return make_number(result.values.count == 0 ? 0 : result.values.max);
+        case formula_function::count:
+        default:
+            return make_number(static_cast<double>(result.values.count));
+        }
+    }
+
+    formula_value evaluate_if(const formula_node &node, const worksheet_impl &sheet)
+    {
+        if (node.children.empty() || node.children.size() > 3)
+        {
+            return make_error("#VALUE!");
+        }
+
+        auto condition = to_boolean(to_scalar(evaluate(node.children[0], sheet)));
+
+        if (condition.type == value_type::error)
+        {
+            return condition;
+        }
+
+        if (condition.number != 0)
+        {
+            return node.children.size() > 1 ? evaluate(node.children[1], sheet) : make_boolean(true);
+        }
+
+        return node.children.size() > 2 ? evaluate(node.children[2], sheet) : make_boolean(false);
+    }
+
+    /// <summary>
+    /// Evaluate an argument that must be a reference, e.g. the table of VLOOKUP.
+    /// </summary>
+    bool evaluate_reference(const formula_node &node, const worksheet_impl &sheet, formula_reference &reference, formula_value &error)
+    {
+        auto value = evaluate(node, sheet);
+
+        if (value.type == value_type::error)
+        {
+            error = value;
+            return false;
+        }
+
+        if (value.type != value_type::reference)
+        {
+            error = make_error("#VALUE!");
+            return false;
+        }
+
+        if (value.reference.sheet == nullptr)
+        {
+            error = make_error("#REF!");
+            return false;
+        }
+
+        reference = value.reference;
+
+        return true;
+    }
+
+    bool evaluate_integer(const formula_node &node, const worksheet_impl &sheet, long long &integer, formula_value &error)
+    {
+        auto value = to_number(to_scalar(evaluate(node, sheet)));
+
+        if (value.type == value_type::error)
+        {
+            error = value;
+            return false;
+        }
+
+        integer = static_cast<long long>(value.number);
+
+        return true;
+    }
+
+    formula_value evaluate_vlookup(const formula_node &node, const worksheet_impl &sheet)
+    {
+        if (node.children.size() < 3 || node.children.size() > 4)
+        {
+            return make_error("#VALUE!");
+        }
+
+        auto lookup = to_scalar(evaluate(node.children[0], sheet));
+
+        if (lookup.type == value_type::error) return lookup;
+
+        formula_reference table;
+        formula_value error;
+        long long column_index = 0;
+
+        if (!evaluate_reference(node.children[1], sheet, table, error)) return error;
+        if (!evaluate_integer(node.children[2], sheet, column_index, error)) return error;
+
+        auto approximate = true;
+
+        if (node.children.size() == 4)
+        {
+            auto flag = to_boolean(to_scalar(evaluate(node.children[3], sheet)));
+            if (flag.type == value_type::error) return flag;
+            approximate = flag.number != 0;
+        }
+
+        if (column_index < 1) return make_error("#VALUE!");
+        if (column_index > static_cast<long long>(table.last_column - table.first_column) + 1) return make_error("#REF!");
+
+        auto result_column = table.first_column + static_cast<xlnt::column_t::index_t>(column_index - 1);
+
+        if (lookup.type == value_type::empty) lookup = make_number(0);
+
+        auto found = false;
+        auto found_row = table.first_row;
+
+        for (auto row = table.first_row; row <= table.last_row; ++row)
+        {
+            auto candidate = cell_value(table, row, table.first_column);
+
+            if (!same_kind(candidate, lookup)) continue;
+
+            auto order = compare(candidate, lookup);
+
+            if (order == 0)
+            {
+                found = true;
+                found_row = row;
+
+                if (!approximate) break;
+            }
+            else if (approximate)
+            {
+                // the first column is assumed to be sorted ascending
+                if (order > 0) break;
+
+                found = true;
+                found_row = row;
+            }
+        }
+
+        if (!found) return make_error("#N/A");
+
+        return cell_value(table, found_row, result_column);
+    }
+
+    formula_value evaluate_index(const formula_node &node, const worksheet_impl &sheet)
+    {
+        if (node.children.size() < 2 || node.children.size() > 3)
+        {
+            return make_error("#VALUE!");
+        }
+
+        formula_reference table;
+        formula_value error;
+        long long row_index = 0;
+        long long column_index = 0;
+
+        if (!evaluate_reference(node.children[0], sheet, table, error)) return error;
+        if (!evaluate_integer(node.children[1], sheet, row_index, error)) return error;
+
+        if (node.children.size() == 3 && node.children[2].type != formula_node::node_type::empty)
+        {
+            if (!evaluate_integer(node.children[2], sheet, column_index, error)) return error;
+        }
+        else if (table.first_row == table.last_row)
+        {
+            // INDEX(A1:E1, 3) indexes along the only row
+            column_index = row_index;
+            row_index = 0;
+        }
+
+        auto height = static_cast<long long>(table.last_row - table.first_row) + 1;
+        auto width = static_cast<long long>(table.last_column - table.first_column) + 1;
+
+        if (row_index < 0 || column_index < 0) return make_error("#VALUE!");
+        if (row_index > height || column_index > width) return make_error("#REF!");
+
+        formula_reference result = table;
+
+        if (row_index > 0)
+        {
+            result.first_row = result.last_row = table.first_row + static_cast<xlnt::row_t>(row_index - 1);
+        }
+        else if (width > 1 && column_index == 0 && height > 1)
+        {
+            return make_reference(table);
+        }
+
+        if (column_index > 0)
+        {
+            result.first_column = result.last_column = table.first_column + static_cast<xlnt::column_t::index_t>(column_index - 1);
+        }
+        else if (width == 1)
+        {
+            result.last_column = result.first_column;
+        }
+
+        return make_reference(result);
+    }
+
+    formula_value evaluate_match(const formula_node &node, const worksheet_impl &sheet)
+    {
+        if (node.children.size() < 2 || node.children.size() > 3)
+        {
+            return make_error("#VALUE!");
+        }
+
+        auto lookup = to_scalar(evaluate(node.children[0], sheet));
+
+        if (lookup.type == value_type::error) return lookup;
+
+        formula_reference table;
+        formula_value error;
+        long long match_type = 1;
+
+        if (!evaluate_reference(node.children[1], sheet, table, error)) return error;
+
+        if (node.children.size() == 3 && node.children[2].type != formula_node::node_type::empty)
+        {
+            if (!evaluate_integer(node.children[2], sheet, match_type, error)) return error;
+        }
+
+        auto vertical = table.first_column == table.last_column;
+
+        if (!vertical && table.first_row != table.last_row)
+        {
+            return make_error("#N/A");
+        }
+
+        if (lookup.type == value_type::empty) lookup = make_number(0);
+
+        auto length = vertical
+            ? static_cast<std::size_t>(table.last_row - table.first_row) + 1
+            : static_cast<std::size_t>(table.last_column - table.first_column) + 1;
+
+        std::size_t found = 0;
+
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            auto candidate = vertical
+                ? cell_value(table, table.first_row + static_cast<xlnt::row_t>(i), table.first_column)
+                : cell_value(table, table.first_row, table.first_column + static_cast<xlnt::column_t::index_t>(i));
+
+            if (!same_kind(candidate, lookup)) continue;
+
+            auto order = compare(candidate, lookup);
+
+            if (match_type == 0)
+            {
+                if (order == 0)
+                {
+                    found = i + 1;
+                    break;
+                }
+            }
+            else if (match_type > 0)
+            {
+                // largest value <= lookup in an ascending list
+                if (order > 0) break;
+                found = i + 1;
+            }
+            else
+            {
+                // smallest value >= lookup in a descending list
+                if (order < 0) break;
+                found = i + 1;
+            }
+        }
+
+        if (found == 0) return make_error("#N/A");
+
+        return make_number(static_cast<double>(found));
+    }
+};
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+std::size_t formula_engine::cell_key_hash::operator()(const cell_key &key) const
+{
+    auto hash = std::hash<const void *>()(key.sheet);
+    hash ^= std::hash<std::uint64_t>()((static_cast<std::uint64_t>(key.row) << 32) | key.column)
+        + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+
+    return hash;
+}
+
+formula_engine::formula_engine()
+    : built_(false),
+      untracked_changes_(false),
+      edited_(false),
+      parsing_(false),
+      workbook_(nullptr)
+{
+}
+
+formula_engine::formula_engine(const formula_engine &other)
+    : formula_engine()
+{
+    *this = other;
+}
+
+formula_engine &formula_engine::operator=(const formula_engine &other)
+{
+    auto pending = other.untracked_changes_ || (other.built_ && !other.dirty_.empty());
+    auto edited = other.edited_;
+
+    reset();
+    untracked_changes_ = pending;
+    edited_ = edited;
+
+    return *this;
+}
+
+void formula_engine::reset()
+{
+    built_ = false;
+    untracked_changes_ = false;
+    edited_ = false;
+    workbook_ = nullptr;
+    formulas_.clear();
+    cell_dependents_.clear();
+    range_dependents_.clear();
+    dirty_.clear();
+    deferred_precedents_.clear();
+}
+
+void formula_engine::invalidate()
+{
+    auto pending = has_pending_changes();
+    auto edited = edited_;
+
+    reset();
+    untracked_changes_ = pending;
+    edited_ = edited;
+}
+
+bool formula_engine::has_pending_changes() const
+{
+    return untracked_changes_ || (built_ && !dirty_.empty());
+}
+
+void formula_engine::cell_changed(const worksheet_impl &sheet, cell_impl &cell)
+{
+    if (parsing_)
+    {
+        return;
+    }
+
+    edited_ = true;
+
+    if (!built_)
+    {
+        untracked_changes_ = true;
+        return;
+    }
+
+    cell_key key{ &sheet, cell.row_, cell.column_.index };
+    auto existing = formulas_.find(key);
+
+    if (cell.formula())
+    {
+        if (existing == formulas_.end() || existing->second.formula != cell.formula().get())
+        {
+            if (existing != formulas_.end())
+            {
+                remove_formula(key);
+            }
+
+            add_formula(sheet, cell, true);
+        }
+        else if (cell.type_ == cell_type::formula && !existing->second.dirty)
+        {
+            mark_dirty(existing->second);
+        }
+    }
+    else if (existing != formulas_.end())
+    {
+        remove_formula(key);
+    }
+
+    mark_dependents_dirty(key);
+}
+
+void formula_engine::build(workbook_impl &workbook)
+{
+    auto full = untracked_changes_;
+    auto edited = edited_;
+
+    reset();
+
+    built_ = true;
+    edited_ = edited;
+    workbook_ = &workbook;
+
+    // the cells are only read, so blocks shared with a copy of the workbook stay shared
+    for (const auto &sheet : workbook.worksheets_)
+    {
+        if (sheet.is_deferred()) continue;
+
+        for (const auto &row : sheet.cell_map_)
+        {
+            for (const auto &cell : row.second)
+            {
+                if (cell.second.formula())
+                {
+                    add_formula(sheet, cell.second, full || cell.second.type_ == cell_type::formula);
+                }
+            }
+        }
+    }
+
+    parse_deferred_precedents(workbook);
+}
+
+void formula_engine::parse_deferred(workbook_impl &workbook, worksheet_impl &sheet)
+{
+    if (!sheet.is_deferred()) return;
+
+    parsing_ = true;
+
+    try
+    {
+        workbook.read_deferred_worksheet_(sheet);
+    }
+    catch (...)
+    {
+        parsing_ = false;
+        throw;
+    }
+
+    parsing_ = false;
+
+    // the formulas may refer to cells changed since the workbook was loaded
+    if (!built_ || workbook_ != &workbook)
+    {
+        untracked_changes_ = untracked_changes_ || edited_;
+        return;
+    }
+
+    for (const auto &row : sheet.cell_map_)
+    {
+        for (const auto &cell : row.second)
+        {
+            if (cell.second.formula())
+            {
+                add_formula(sheet, cell.second, edited_ || cell.second.type_ == cell_type::formula);
+            }
+        }
+    }
+}
+
+void formula_engine::parse_deferred_precedents(workbook_impl &workbook)
+{
+    // lazily loaded worksheets are only parsed once a formula refers to one and
+    // their formulas may refer to more of them
+    while (!deferred_precedents_.empty())
+    {
+        auto sheet = deferred_precedents_.back();
+        deferred_precedents_.pop_back();
+
+        parse_deferred(workbook, *sheet);
+    }
+}
+
+void formula_engine::resolve_cells(const std::vector<formula_entry *> &entries)
+{
+    for (auto entry : entries)
+    {
+        // keys refer to worksheets as const but they belong to the workbook being calculated
+        auto &cells = const_cast<worksheet_impl *>(entry->key.sheet)->cell_map_;
+        entry->cell = cells.find_mutable_cell(entry->key.row, entry->key.column);
+
+        // results are stored by several threads at once but arenas aren't thread safe
+        if (entry->cell != nullptr)
+        {
+            cells.extras(*entry->cell);
+        }
+    }
+}
+
+void formula_engine::add_formula(const worksheet_impl &sheet, const cell_impl &cell, bool dirty)
+{
+    cell_key key{ &sheet, cell.row_, cell.column_.index };
+    auto &entry = formulas_[key];
+
+    entry.key = key;
+    entry.formula = cell.formula().get();
+
+    try
+    {
+        entry.root = formula_parser(entry.formula).parse();
+        bind(entry.root, sheet, entry);
+    }
+    catch (xlnt::exception &)
+    {
+        entry.root = formula_node();
+        entry.supported = false;
+    }
+
+    for (const auto &precedent : entry.cell_precedents)
+    {
+        cell_dependents_[precedent].push_back(&entry);
+    }
+
+    for (const auto &precedent : entry.range_precedents)
+    {
+        if (precedent.last_column - precedent.first_column >= wide_range_columns)
+        {
+            range_bucket(precedent.sheet, 0).push_back({ precedent, &entry });
+            continue;
+        }
+
+        for (auto column = precedent.first_column; column <= precedent.last_column; ++column)
+        {
+            range_bucket(precedent.sheet, column).push_back({ precedent, &entry });
+        }
+    }
+
+    if (dirty)
+    {
+        mark_dirty(entry);
+    }
+}
+
+void formula_engine::remove_formula(const cell_key &key)
+{
+    auto match = formulas_.find(key);
+
+    if (match == formulas_.end())
+    {
+        return;
+    }
+
+    auto &entry = match->second;
+
+    for (const auto &precedent : entry.cell_precedents)
+    {
+        auto &dependents = cell_dependents_[precedent];
+        dependents.erase(std::remove(dependents.begin(), dependents.end(), &entry), dependents.end());
+    }
+
+    for (const auto &precedent : entry.range_precedents)
+    {
+        auto remove_from = [&](column_t::index_t column) {
+            auto &bucket = range_bucket(precedent.sheet, column);
+            bucket.erase(std::remove_if(bucket.begin(), bucket.end(),
+                [&](const range_dependent &d) { return d.entry == &entry; }), bucket.end());
+        };
+
+        if (precedent.last_column - precedent.first_column >= wide_range_columns)
+        {
+            remove_from(0);
+            continue;
+        }
+
+        for (auto column = precedent.first_column; column <= precedent.last_column; ++column)
+        {
+            remove_from(column);
+        }
+    }
+
+    formulas_.erase(match);
+}
+
+void formula_engine::bind(formula_node &node, const worksheet_impl &sheet, formula_entry &entry)
+{
+    auto find_sheet = [this](const std::string &title) -> const worksheet_impl * {
+        auto match = workbook_->worksheets_.find_by_title(title);
+
+        if (match == nullptr)
+        {
+            // sheet names are case-insensitive in formulas
+            auto upper = to_upper(title);
+
+            for (auto &candidate : workbook_->worksheets_)
+            {
+                if (to_upper(candidate.title_) == upper)
+                {
+                    match = &candidate;
+                    break;
+                }
+            }
+        }
+
+        if (match != nullptr && match->is_deferred())
+        {
+            deferred_precedents_.push_back(match);
+        }
+
+        return match;
+    };
+
+    if (node.type == formula_node::node_type::name)
+    {
+        const named_range *match = nullptr;
+
+        auto local = sheet.named_ranges_.find(node.text);
+
+        if (local != sheet.named_ranges_.end())
+        {
+            match = &local->second;
+        }
+        else
+        {
+            for (const auto &candidate : workbook_->worksheets_)
+            {
+                auto global = candidate.named_ranges_.find(node.text);
+
+                if (global != candidate.named_ranges_.end())
+                {
+                    match = &global->second;
+                    break;
+                }
+            }
+        }
+
+        // names spanning several areas aren't supported and evaluate to #NAME?
+        if (match == nullptr || match->get_targets().size() != 1)
+        {
+            return;
+        }
+
+        const auto &target = match->get_targets().front();
+        const auto &target_range = target.second;
+
+        node.type = formula_node::node_type::reference;
+        node.reference.has_sheet = true;
+        node.reference.sheet_title = target.first.get_title();
+        node.reference.first_row = target_range.get_top_left().get_row();
+        node.reference.last_row = target_range.get_bottom_right().get_row();
+        node.reference.first_column = target_range.get_top_left().get_column_index().index;
+        node.reference.last_column = target_range.get_bottom_right().get_column_index().index;
+    }
+
+    if (node.type == formula_node::node_type::reference)
+    {
+        node.reference.sheet = node.reference.has_sheet ? find_sheet(node.reference.sheet_title) : &sheet;
+
+        if (node.reference.sheet == nullptr)
+        {
+            return;
+        }
+
+        if (node.reference.is_cell())
+        {
+            entry.cell_precedents.push_back({ node.reference.sheet, node.reference.first_row, node.reference.first_column });
+        }
+        else
+        {
+            entry.range_precedents.push_back(node.reference);
+        }
+
+        return;
+    }
+
+    if (node.type == formula_node::node_type::function && node.function == formula_function::unknown)
+    {
+        entry.supported = false;
+    }
+
+    for (auto &child : node.children)
+    {
+        bind(child, sheet, entry);
+    }
+}
+
+std::vector<formula_engine::range_dependent> &formula_engine::range_bucket(const worksheet_impl *sheet, column_t::index_t column)
+{
+    return range_dependents_[cell_key{ sheet, 0, column }];
+}
+
+void formula_engine::mark_dirty(formula_entry &entry)
+{
+    entry.dirty = true;
+    dirty_.push_back(entry.key);
+}
+
+void formula_engine::mark_dependents_dirty(const cell_key &key)
+{
+    std::vector<cell_key> stack = { key };
+
+    auto visit = [&](formula_entry *dependent) {
+        if (!dependent->dirty)
+        {
+            mark_dirty(*dependent);
+            stack.push_back(dependent->key);
+        }
+    };
+
+    while (!stack.empty())
+    {
+        auto current = stack.back();
+        stack.pop_back();
+
+        auto direct = cell_dependents_.find(current);
+
+        if (direct != cell_dependents_.end())
+        {
+            for (auto dependent : direct->second)
+            {
+                visit(dependent);
+            }
+        }
+
+        for (auto column : { current.column, column_t::index_t(0) })
+        {
+            auto bucket = range_dependents_.find(cell_key{ current.sheet, 0, column });
+
+            if (bucket == range_dependents_.end()) continue;
+
+            for (const auto &dependent : bucket->second)
+            {
+                if (dependent.range.contains(current.row, current.column))
+                {
+                    visit(dependent.entry);
+                }
+            }
+        }
+    }
+}
+
+std::vector<std::vector<formula_engine::formula_entry *>> formula_engine::level_dirty(std::vector<formula_entry *> &circular)
+{
+    std::vector<formula_entry *> work;
+
+    for (const auto &key : dirty_)
+    {
+        auto match = formulas_.find(key);
+
+        if (match == formulas_.end() || !match->second.dirty || match->second.queued) continue;
+
+        auto &entry = match->second;
+        entry.queued = true;
+        entry.pending = 0;
+        entry.successors.clear();
+        work.push_back(&entry);
+    }
+
+    dirty_.clear();
+
+    std::unordered_map<const worksheet_impl *, std::vector<formula_entry *>> dirty_by_sheet;
+
+    for (auto entry : work)
+    {
+        dirty_by_sheet[entry->key.sheet].push_back(entry);
+    }
+
+    auto link = [](formula_entry *precedent, formula_entry *dependent) {
+        precedent->successors.push_back(dependent);
+        ++dependent->pending;
+    };
+
+    for (auto entry : work)
+    {
+        for (const auto &precedent : entry->cell_precedents)
+        {
+            auto match = formulas_.find(precedent);
+
+            if (match != formulas_.end() && match->second.queued)
+            {
+                link(&match->second, entry);
+            }
+        }
+
+        for (const auto &precedent : entry->range_precedents)
+        {
+            const auto &candidates = dirty_by_sheet[precedent.sheet];
+            auto area = (static_cast<std::uint64_t>(precedent.last_row - precedent.first_row) + 1)
+                * (static_cast<std::uint64_t>(precedent.last_column - precedent.first_column) + 1);
+
+            if (candidates.size() <= area)
+            {
+                for (auto candidate : candidates)
+                {
+                    if (precedent.contains(candidate->key.row, candidate->key.column))
+                    {
+                        link(candidate, entry);
+                    }
+                }
+
+                continue;
+            }
+
+            for (auto row = precedent.first_row; row <= precedent.last_row; ++row)
+            {
+                for (auto column = precedent.first_column; column <= precedent.last_column; ++column)
+                {
+                    auto match = formulas_.find(cell_key{ precedent.sheet, row, column });
+
+                    if (match != formulas_.end() && match->second.queued)
+                    {
+                        link(&match->second, entry);
+                    }
+                }
+            }
+        }
+    }
+
+    // Kahn's algorithm one frontier at a time. Formulas in the same level only
+    // depend on earlier levels so they can be evaluated in any order, or concurrently.
+    std::vector<std::vector<formula_entry *>> levels(1);
+
+    for (auto entry : work)
+    {
+        if (entry->pending == 0)
+        {
+            levels.back().push_back(entry);
+        }
+    }
+
+    while (!levels.back().empty())
+    {
+        std::vector<formula_entry *> next;
+
+        for (auto entry : levels.back())
+        {
+            for (auto successor : entry->successors)
+            {
+                if (--successor->pending == 0)
+                {
+                    next.push_back(successor);
+                }
+            }
+        }
+
+        levels.push_back(std::move(next));
+    }
+
+    levels.pop_back();
+
+    // whatever is still waiting on a precedent is part of, or downstream of, a cycle
+    for (auto entry : work)
+    {
+        if (entry->pending != 0)
+        {
+            circular.push_back(entry);
+        }
+    }
+
+    return levels;
+}
+
+void formula_engine::store_result(formula_entry &entry, const formula_value &result)
+{
+    // the cell was removed without the engine being told
+    if (entry.cell == nullptr)
+    {
+        return;
+    }
+
+    auto &cell = *entry.cell;
+    auto value = to_scalar(result);
+
+    cell.value_integer_offset_ = 0;
+    cell.value_string_index_ = cell_impl::no_string_index;
+
+    switch (value.type)
+    {
+    case formula_value::value_type::number:
+        cell.type_ = cell_type::numeric;
+        cell.value_numeric_ = value.number;
+        cell.clear_value_text();
+        break;
+    case formula_value::value_type::boolean:
+        cell.type_ = cell_type::boolean;
+        cell.value_numeric_ = value.number;
+        cell.clear_value_text();
+        break;
+    case formula_value::value_type::string:
+        cell.type_ = cell_type::string;
+        cell.value_numeric_ = 0;
+        cell.extras_->value_text_.set_plain_string(value.text);
+        break;
+    case formula_value::value_type::error:
+        cell.type_ = cell_type::error;
+        cell.value_numeric_ = 0;
+        cell.extras_->value_text_.set_plain_string(value.text);
+        break;
+    case formula_value::value_type::empty:
+    case formula_value::value_type::reference:
+    default:
+        // a formula referring to a blank cell displays 0
+        cell.type_ = cell_type::numeric;
+        cell.value_numeric_ = 0;
+        cell.clear_value_text();
+        break;
+    }
+}
+
+void formula_engine::calculate(workbook_impl &workbook)
+{
+    if (!built_ || workbook_ != &workbook)
+    {
+        auto uncalculated = untracked_changes_;
+
+        for (auto sheet = workbook.worksheets_.begin(); !uncalculated && sheet != workbook.worksheets_.end(); ++sheet)
+        {
+            for (auto row = sheet->cell_map_.begin(); !uncalculated && row != sheet->cell_map_.end(); ++row)
+            {
+                for (const auto &cell : row->second)
+                {
+                    if (cell.second.formula() && cell.second.type_ == cell_type::formula)
+                    {
+                        uncalculated = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // nothing has changed since the cached values were loaded
+        if (!uncalculated)
+        {
+            return;
+        }
+
+        build(workbook);
+    }
+
+    parse_deferred_precedents(workbook);
+
+    if (dirty_.empty())
+    {
+        return;
+    }
+
+    const auto &properties = workbook.calculation_properties_;
+    auto thread_count = properties.thread_count;
+
+    if (thread_count == 0)
+    {
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    if (thread_count <= 1)
+    {
+        pool_.reset();
+    }
+    else if (!pool_ || pool_->size() != thread_count)
+    {
+        pool_.reset(new thread_pool(thread_count));
+    }
+
+    std::vector<formula_entry *> circular;
+    auto levels = level_dirty(circular);
+
+    for (const auto &level : levels)
+    {
+        resolve_cells(level);
+    }
+
+    resolve_cells(circular);
+
+    for (const auto &level : levels)
+    {
+        auto evaluate_range = [&level](std::size_t begin, std::size_t end) {
+            evaluator evaluate;
+
+            for (auto i = begin; i < end; ++i)
+            {
+                auto entry = level[i];
+
+                if (entry->supported)
+                {
+                    store_result(*entry, evaluate.evaluate(entry->root, *entry->key.sheet));
+                }
+            }
+        };
+
+        // Small levels aren't worth waking the other threads for.
+        if (thread_count > 1 && level.size() >= parallel_level_size)
+        {
+            pool_->parallel_for(level.size(), std::max(level.size() / (thread_count * 8), parallel_grain_size), evaluate_range);
+        }
+        else
+        {
+            evaluate_range(0, level.size());
+        }
+
+        for (auto entry : level)
+        {
+            entry->dirty = false;
+            entry->queued = false;
+        }
+    }
+
+    if (!circular.empty())
+    {
+        calculate_circular(circular, properties);
+    }
+}
+
+std::vector<std::vector<formula_engine::formula_entry *>> formula_engine::strongly_connected(
+    const std::vector<formula_entry *> &entries)
+{
+    // Tarjan's algorithm with an explicit stack since chains of formulas can be
+    // far longer than the call stack allows.
+    struct frame
+    {
+        formula_entry *entry;
+        std::size_t next;
+    };
+
+    std::unordered_map<const formula_entry *, std::size_t> index;
+    std::unordered_map<const formula_entry *, std::size_t> low;
+    std::unordered_set<const formula_entry *> members(entries.begin(), entries.end());
+    std::unordered_set<const formula_entry *> on_stack;
+    std::vector<formula_entry *> stack;
+    std::vector<std::vector<formula_entry *>> components;
+    std::size_t visited = 0;
+
+    auto visit = [&](formula_entry *entry, std::vector<frame> &calls) {
+        index[entry] = low[entry] = visited++;
+        stack.push_back(entry);
+        on_stack.insert(entry);
+        calls.push_back(frame{ entry, 0 });
+    };
+
+    for (auto root : entries)
+    {
+        if (index.find(root) != index.end()) continue;
+
+        std::vector<frame> calls;
+        visit(root, calls);
+
+        while (!calls.empty())
+        {
+            auto entry = calls.back().entry;
+
+            if (calls.back().next < entry->successors.size())
+            {
+                auto successor = entry->successors[calls.back().next++];
+
+                if (members.find(successor) == members.end()) continue;
+
+                if (index.find(successor) == index.end())
+                {
+                    visit(successor, calls);
+                }
+                else if (on_stack.find(successor) != on_stack.end())
+                {
+                    low[entry] = std::min(low[entry], index[successor]);
+                }
+
+                continue;
+            }
+
+            if (low[entry] == index[entry])
+            {
+                components.emplace_back();
+                formula_entry *member = nullptr;
+
+                do
+                {
+                    member = stack.back();
+                    stack.pop_back();
+                    on_stack.erase(member);
+                    components.back().push_back(member);
+                } while (member != entry);
+            }
+
+            calls.pop_back();
+
+            if (!calls.empty())
+            {
+                auto parent = calls.back().entry;
+                low[parent] = std::min(low[parent], low[entry]);
+            }
+        }
+    }
+
+    // a component is completed after every component that depends on it
+    std::reverse(components.begin(), components.end());
+
+    return components;
+}
+
+void formula_engine::calculate_circular(std::vector<formula_entry *> &circular, const calculation_properties &properties)
+{
+    evaluator evaluate;
+
+    // Cells that only depend on a cycle aren't part of it. They are evaluated
+    // once, after the cycles they depend on have their final values.
+    for (auto &component : strongly_connected(circular))
+    {
+        auto front = component.front();
+        auto is_cycle = component.size() > 1
+            || std::find(front->successors.begin(), front->successors.end(), front) != front->successors.end();
+
+        if (!is_cycle)
+        {
+            if (front->supported)
+            {
+                store_result(*front, evaluate.evaluate(front->root, *front->key.sheet));
+            }
+        }
+        else if (!properties.iterate)
+        {
+            // Without iterative calculation enabled, Excel shows 0 for circular references.
+            for (auto entry : component)
+            {
+                if (entry->supported)
+                {
+                    store_result(*entry, make_number(0));
+                }
+            }
+        }
+        else
+        {
+            iterate_cycle(component, properties);
+        }
+    }
+
+    for (auto entry : circular)
+    {
+        entry->dirty = false;
+        entry->queued = false;
+    }
+}
+
+void formula_engine::iterate_cycle(std::vector<formula_entry *> &cycle, const calculation_properties &properties)
+{
+    // Evaluate the cycle in a fixed order, each pass starting from the values of
+    // the previous one, until the results settle or the iteration limit is reached.
+    std::sort(cycle.begin(), cycle.end(), [](const formula_entry *a, const formula_entry *b) {
+        if (a->key.sheet->id_ != b->key.sheet->id_) return a->key.sheet->id_ < b->key.sheet->id_;
+        if (a->key.row != b->key.row) return a->key.row < b->key.row;
+        return a->key.column < b->key.column;
+    });
+
+    evaluator evaluate;
+
+    for (std::size_t iteration = 0; iteration < properties.iterate_count; ++iteration)
+    {
+        auto max_change = 0.0;
+
+        for (auto entry : cycle)
+        {
+            if (!entry->supported) continue;
+
+            auto previous = cell_value(entry->key.sheet, entry->cell);
+            auto result = to_scalar(evaluate.evaluate(entry->root, *entry->key.sheet));
+            store_result(*entry, result);
+
+            if (previous.type == value_type::number && result.type == value_type::number)
+            {
+                max_change = std::max(max_change, std::fabs(result.number - previous.number));
+            }
+            else if (previous.type != result.type || previous.text != result.text)
+            {
+                max_change = std::numeric_limits<double>::infinity();
+            }
+        }
+
+        if (max_change < properties.iterate_delta)
+        {
+            break;
+        }
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
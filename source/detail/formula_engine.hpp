@@ -0,0 +1,231 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <detail/formula_parser.hpp>
+#include <detail/thread_pool.hpp>
+
+namespace xlnt {
+
+class calculation_properties;
+
+namespace detail {
+
+struct cell_impl;
+struct workbook_impl;
+struct worksheet_impl;
+
+/// <summary>
+/// The result of evaluating a formula or one of its sub-expressions.
+/// References are only dereferenced where a scalar is required so that
+/// functions like SUM and INDEX can operate on the referenced block.
+/// </summary>
+struct formula_value
+{
+    enum class value_type
+    {
+        empty,
+        number,
+        string,
+        boolean,
+        error,
+        reference
+    } type = value_type::empty;
+
+    double number = 0;
+    std::string text;
+    formula_reference reference;
+};
+
+/// <summary>
+/// Evaluates the formulas of a workbook. Formulas are compiled once and linked into
+/// a dependency graph (cell -> formulas reading it). Changing a cell marks every
+/// formula downstream of it dirty and calculate() re-evaluates only those, in
+/// dependency order.
+/// The graph is built lazily on the first calculation so that loading and bulk
+/// editing a workbook don't pay for it. Until then, change notifications are no-ops.
+/// </summary>
+class formula_engine
+{
+public:
+    formula_engine();
+
+    /// <summary>
+    /// The graph holds pointers into the workbook it was built for, so copies
+    /// start out empty and rebuild themselves when first used.
+    /// </summary>
+    formula_engine(const formula_engine &other);
+    formula_engine &operator=(const formula_engine &other);
+
+    /// <summary>
+    /// Discard the dependency graph and treat every cached formula value as current.
+    /// Called after a workbook has been loaded.
+    /// </summary>
+    void reset();
+
+    /// <summary>
+    /// Discard the dependency graph. Must be called whenever worksheets are
+    /// added, removed, moved, or renamed since formulas are bound to worksheet addresses.
+    /// Any pending changes cause a full recalculation the next time.
+    /// </summary>
+    void invalidate();
+
+    /// <summary>
+    /// Returns true if cells were changed since the last calculation.
+    /// </summary>
+    bool has_pending_changes() const;
+
+    /// <summary>
+    /// Notify the engine that the value or formula of cell was changed.
+    /// </summary>
+    void cell_changed(const worksheet_impl &sheet, cell_impl &cell);
+
+    /// <summary>
+    /// Parse the lazily loaded worksheet sheet of workbook. If the graph was already
+    /// built, the formulas of the worksheet are added to it. They keep their cached
+    /// values unless cells were changed since the workbook was loaded.
+    /// </summary>
+    void parse_deferred(workbook_impl &workbook, worksheet_impl &sheet);
+
+    /// <summary>
+    /// Evaluate every dirty formula in workbook and store the results in their cells.
+    /// Formulas loaded with a cached value are only re-evaluated when one of their
+    /// inputs changes. Formulas are grouped into levels that only depend on previous
+    /// levels and large levels are evaluated in parallel according to the workbook's
+    /// calculation_properties.
+    /// </summary>
+    void calculate(workbook_impl &workbook);
+
+private:
+    struct cell_key
+    {
+        const worksheet_impl *sheet;
+        row_t row;
+        column_t::index_t column;
+
+        bool operator==(const cell_key &other) const
+        {
+            return sheet == other.sheet && row == other.row && column == other.column;
+        }
+    };
+
+    struct cell_key_hash
+    {
+        std::size_t operator()(const cell_key &key) const;
+    };
+
+    struct formula_entry
+    {
+        cell_key key;
+        std::string formula;
+        formula_node root;
+
+        // false if the formula couldn't be parsed or uses functions that aren't
+        // implemented yet. Such cells keep whatever value they were given.
+        bool supported = true;
+
+        std::vector<cell_key> cell_precedents;
+        std::vector<formula_reference> range_precedents;
+
+        bool dirty = false;
+
+        // scratch space for ordering a calculation
+        cell_impl *cell = nullptr;
+        bool queued = false;
+        std::size_t pending = 0;
+        std::vector<formula_entry *> successors;
+    };
+
+    struct range_dependent
+    {
+        formula_reference range;
+        formula_entry *entry;
+    };
+
+    void build(workbook_impl &workbook);
+    void parse_deferred_precedents(workbook_impl &workbook);
+
+    /// <summary>
+    /// Find the cell each entry's result is stored in. A block of cells still shared
+    /// with a copy of the workbook is copied first, so only the blocks holding
+    /// formulas which are calculated are copied. Cells don't move while the formulas
+    /// are evaluated so this is done before evaluating any of them.
+    /// </summary>
+    static void resolve_cells(const std::vector<formula_entry *> &entries);
+    void add_formula(const worksheet_impl &sheet, const cell_impl &cell, bool dirty);
+    void remove_formula(const cell_key &key);
+    void bind(formula_node &node, const worksheet_impl &sheet, formula_entry &entry);
+    void mark_dependents_dirty(const cell_key &key);
+    void mark_dirty(formula_entry &entry);
+    std::vector<std::vector<formula_entry *>> level_dirty(std::vector<formula_entry *> &circular);
+    void calculate_circular(std::vector<formula_entry *> &circular, const calculation_properties &properties);
+    void iterate_cycle(std::vector<formula_entry *> &cycle, const calculation_properties &properties);
+
+    /// <summary>
+    /// Split entries into the groups of formulas that depend on each other through
+    /// successors, ordered so that every group comes after the groups it depends on.
+    /// </summary>
+    static std::vector<std::vector<formula_entry *>> strongly_connected(const std::vector<formula_entry *> &entries);
+    static void store_result(formula_entry &entry, const formula_value &result);
+
+    std::vector<range_dependent> &range_bucket(const worksheet_impl *sheet, column_t::index_t column);
+
+    bool built_;
+
+    // set when cells changed while there was no graph to track them
+    bool untracked_changes_;
+
+    // set when cells changed since the workbook was loaded, which the formulas of
+    // lazily loaded worksheets parsed afterwards may depend on
+    bool edited_;
+
+    // set while a lazily loaded worksheet is parsed, whose cells aren't changes
+    bool parsing_;
+
+    workbook_impl *workbook_;
+    std::unordered_map<cell_key, formula_entry, cell_key_hash> formulas_;
+    std::unordered_map<cell_key, std::vector<formula_entry *>, cell_key_hash> cell_dependents_;
+
+    // Range precedents are bucketed by (sheet, column) so that a changed cell only
+    // has to be tested against the ranges overlapping its column. Ranges wider
+    // than wide_range_columns go in a per-sheet bucket with column 0.
+    std::unordered_map<cell_key, std::vector<range_dependent>, cell_key_hash> range_dependents_;
+
+    std::vector<cell_key> dirty_;
+
+    // lazily loaded worksheets referred to by formulas, which are parsed before calculating
+    std::vector<worksheet_impl *> deferred_precedents_;
+
+    // created on demand when calculation_properties::thread_count allows more than one thread
+    std::unique_ptr<thread_pool> pool_;
+};
+
+} // namespace detail
+} // namespace xlnt
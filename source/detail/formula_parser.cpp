@@ -0,0 +1,679 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <unordered_map>
+
+#include <detail/formula_parser.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+namespace {
+
+bool is_identifier_character(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$' || c == '\\';
+}
+
+std::string to_upper(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](char c) {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    });
+
+    return s;
+}
+
+/// <summary>
+/// Parse a string like "$B$12" into a one-cell formula_reference.
+/// Returns false if the string isn't a valid A1-style reference.
+/// </summary>
+bool parse_cell_reference(const std::string &s, xlnt::detail::formula_reference &reference)
+{
+    std::size_t i = 0;
+
+    if (i < s.size() && s[i] == '$') ++i;
+
+    auto column_start = i;
+
+    while (i < s.size() && std::isalpha(static_cast<unsigned char>(s[i]))) ++i;
+
+    auto column_length = i - column_start;
+
+    if (column_length < 1 || column_length > 3) return false;
+
+    auto column_string = to_upper(s.substr(column_start, column_length));
+
+    if (i < s.size() && s[i] == '$') ++i;
+
+    auto row_start = i;
+
+    while (i < s.size() && std::isdigit(static_cast<unsigned char>(s[i]))) ++i;
+
+    if (i != s.size() || row_start == i || row_start + 7 < i) return false;
+
+    auto row = static_cast<xlnt::row_t>(std::strtoul(s.c_str() + row_start, nullptr, 10));
+    auto column = xlnt::column_t::column_index_from_string(column_string);
+
+    if (row == 0 || column > 16384) return false;
+
+    reference.first_row = reference.last_row = row;
+    reference.first_column = reference.last_column = column;
+
+    return true;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+formula_function function_from_string(const std::string &name)
+{
+    static const auto *functions = new std::unordered_map<std::string, formula_function>
+    {
+        { "AVERAGE", formula_function::average },
+        { "COUNT", formula_function::count },
+        { "IF", formula_function::if_ },
+        { "INDEX", formula_function::index },
+        { "MATCH", formula_function::match },
+        { "MAX", formula_function::max },
+        { "MIN", formula_function::min },
+        { "SUM", formula_function::sum },
+        { "VLOOKUP", formula_function::vlookup }
+    };
+
+    auto upper = to_upper(name);
+
+    // functions added after Excel 2007 are stored with a prefix
+    if (upper.compare(0, 6, "_XLFN.") == 0)
+    {
+        upper = upper.substr(6);
+    }
+
+    auto match = functions->find(upper);
+
+    return match == functions->end() ? formula_function::unknown : match->second;
+}
+
+formula_parser::formula_parser(const std::string &formula_string)
+    : formula_(formula_string)
+{
+}
+
+formula_node formula_parser::parse()
+{
+    position_ = 0;
+    has_peeked_ = false;
+
+    auto root = parse_comparison();
+
+    if (peek().type != token::token_type::end)
+    {
+        throw xlnt::exception("unexpected \"" + peek().string + "\" in formula: " + formula_);
+    }
+
+    return root;
+}
+
+const formula_parser::token &formula_parser::peek()
+{
+    if (!has_peeked_)
+    {
+        peeked_ = next_token();
+        has_peeked_ = true;
+    }
+
+    return peeked_;
+}
+
+void formula_parser::advance()
+{
+    peek();
+    has_peeked_ = false;
+}
+
+formula_parser::token formula_parser::next_token()
+{
+    while (position_ < formula_.size() && std::isspace(static_cast<unsigned char>(formula_[position_])))
+    {
+        ++position_;
+    }
+
+    token result;
+
+    if (position_ >= formula_.size())
+    {
+        return result;
+    }
+
+    auto start = position_;
+    auto c = formula_[position_];
+
+    if (std::isdigit(static_cast<unsigned char>(c))
+        || (c == '.' && position_ + 1 < formula_.size() && std::isdigit(static_cast<unsigned char>(formula_[position_ + 1]))))
+    {
+        char *end = nullptr;
+        result.number = std::strtod(formula_.c_str() + position_, &end);
+        position_ = static_cast<std::size_t>(end - formula_.c_str());
+        result.type = token::token_type::number;
+        result.string = formula_.substr(start, position_ - start);
+
+        // a row range like 1:3 is not supported, but numbers followed by letters aren't valid either
+        if (position_ < formula_.size() && is_identifier_character(formula_[position_]))
+        {
+            throw xlnt::exception("invalid number in formula: " + formula_);
+        }
+
+        return result;
+    }
+
+    if (c == '"')
+    {
+        ++position_;
+
+        while (true)
+        {
+            if (position_ >= formula_.size())
+            {
+                throw xlnt::exception("unterminated string in formula: " + formula_);
+            }
+
+            if (formula_[position_] == '"')
+            {
+                if (position_ + 1 < formula_.size() && formula_[position_ + 1] == '"')
+                {
+                    result.string.push_back('"');
+                    position_ += 2;
+                    continue;
+                }
+
+                ++position_;
+                break;
+            }
+
+            result.string.push_back(formula_[position_++]);
+        }
+
+        result.type = token::token_type::string;
+        return result;
+    }
+
+    if (c == '#')
+    {
+        static const std::vector<std::string> errors = { "#NULL!", "#DIV/0!", "#VALUE!", "#REF!", "#NAME?", "#NUM!", "#N/A" };
+
+        for (const auto &error : errors)
+        {
+            if (to_upper(formula_.substr(position_, error.size())) == error)
+            {
+                position_ += error.size();
+                result.type = token::token_type::error;
+                result.string = error;
+
+                return result;
+            }
+        }
+
+        throw xlnt::exception("invalid error literal in formula: " + formula_);
+    }
+
+    std::string sheet_title;
+    bool has_sheet = false;
+
+    if (c == '\'')
+    {
+        ++position_;
+
+        while (true)
+        {
+            if (position_ >= formula_.size())
+            {
+                throw xlnt::exception("unterminated sheet name in formula: " + formula_);
+            }
+
+            if (formula_[position_] == '\'')
+            {
+                if (position_ + 1 < formula_.size() && formula_[position_ + 1] == '\'')
+                {
+                    sheet_title.push_back('\'');
+                    position_ += 2;
+                    continue;
+                }
+
+                ++position_;
+                break;
+            }
+
+            sheet_title.push_back(formula_[position_++]);
+        }
+
+        if (position_ >= formula_.size() || formula_[position_] != '!')
+        {
+            throw xlnt::exception("expected ! after sheet name in formula: " + formula_);
+        }
+
+        ++position_;
+        has_sheet = true;
+    }
+
+    if (is_identifier_character(formula_[position_]))
+    {
+        auto identifier_start = position_;
+
+        while (position_ < formula_.size() && is_identifier_character(formula_[position_]))
+        {
+            ++position_;
+        }
+
+        auto identifier = formula_.substr(identifier_start, position_ - identifier_start);
+
+        if (!has_sheet && position_ < formula_.size() && formula_[position_] == '!')
+        {
+            ++position_;
+            sheet_title = identifier;
+            has_sheet = true;
+
+            identifier_start = position_;
+
+            while (position_ < formula_.size() && is_identifier_character(formula_[position_]))
+            {
+                ++position_;
+            }
+
+            identifier = formula_.substr(identifier_start, position_ - identifier_start);
+        }
+
+        if (!has_sheet)
+        {
+            auto lookahead = position_;
+
+            while (lookahead < formula_.size() && std::isspace(static_cast<unsigned char>(formula_[lookahead])))
+            {
+                ++lookahead;
+            }
+
+            if (lookahead < formula_.size() && formula_[lookahead] == '(')
+            {
+                position_ = lookahead + 1;
+                result.type = token::token_type::function;
+                result.string = identifier;
+
+                return result;
+            }
+
+            auto upper = to_upper(identifier);
+
+            if (upper == "TRUE" || upper == "FALSE")
+            {
+                result.type = token::token_type::boolean;
+                result.number = upper == "TRUE" ? 1 : 0;
+                result.string = upper;
+
+                return result;
+            }
+        }
+
+        if (parse_cell_reference(identifier, result.reference))
+        {
+            result.type = token::token_type::reference;
+            result.reference.has_sheet = has_sheet;
+            result.reference.sheet_title = sheet_title;
+
+            if (position_ < formula_.size() && formula_[position_] == ':')
+            {
+                auto end_start = position_ + 1;
+                auto end_position = end_start;
+
+                while (end_position < formula_.size() && is_identifier_character(formula_[end_position]))
+                {
+                    ++end_position;
+                }
+
+                formula_reference end;
+
+                if (!parse_cell_reference(formula_.substr(end_start, end_position - end_start), end))
+                {
+                    throw xlnt::exception("invalid range in formula: " + formula_);
+                }
+
+                position_ = end_position;
+
+                result.reference.first_row = std::min(result.reference.first_row, end.first_row);
+                result.reference.last_row = std::max(result.reference.last_row, end.last_row);
+                result.reference.first_column = std::min(result.reference.first_column, end.first_column);
+                result.reference.last_column = std::max(result.reference.last_column, end.last_column);
+            }
+
+            result.string = formula_.substr(start, position_ - start);
+
+            return result;
+        }
+
+        if (has_sheet)
+        {
+            throw xlnt::exception("invalid reference in formula: " + formula_);
+        }
+
+        result.type = token::token_type::name;
+        result.string = identifier;
+
+        return result;
+    }
+
+    if (has_sheet)
+    {
+        throw xlnt::exception("invalid reference in formula: " + formula_);
+    }
+
+    ++position_;
+    result.string = std::string(1, c);
+
+    switch (c)
+    {
+    case '(':
+        result.type = token::token_type::open_paren;
+        break;
+    case ')':
+        result.type = token::token_type::close_paren;
+        break;
+    case ',':
+    case ';':
+        result.type = token::token_type::separator;
+        break;
+    case '<':
+        if (position_ < formula_.size() && (formula_[position_] == '=' || formula_[position_] == '>'))
+        {
+            result.string.push_back(formula_[position_++]);
+        }
+        result.type = token::token_type::op;
+        break;
+    case '>':
+        if (position_ < formula_.size() && formula_[position_] == '=')
+        {
+            result.string.push_back(formula_[position_++]);
+        }
+        result.type = token::token_type::op;
+        break;
+    case '+':
+    case '-':
+    case '*':
+    case '/':
+    case '^':
+    case '&':
+    case '=':
+    case '%':
+        result.type = token::token_type::op;
+        break;
+    default:
+        throw xlnt::exception("unexpected character in formula: " + formula_);
+    }
+
+    return result;
+}
+
+formula_node formula_parser::parse_comparison()
+{
+    auto left = parse_concatenation();
+
+    while (peek().type == token::token_type::op)
+    {
+        const auto &op = peek().string;
+        formula_operator type;
+
+        if (op == "=") type = formula_operator::equal;
+        else if (op == "<>") type = formula_operator::not_equal;
+        else if (op == "<") type = formula_operator::less;
+        else if (op == "<=") type = formula_operator::less_or_equal;
+        else if (op == ">") type = formula_operator::greater;
+        else if (op == ">=") type = formula_operator::greater_or_equal;
+        else break;
+
+        advance();
+
+        formula_node node;
+        node.type = formula_node::node_type::binary;
+        node.op = type;
+        node.children.push_back(std::move(left));
+        node.children.push_back(parse_concatenation());
+        left = std::move(node);
+    }
+
+    return left;
+}
+
+formula_node formula_parser::parse_concatenation()
+{
+    auto left = parse_additive();
+
+    while (peek().type == token::token_type::op && peek().string == "&")
+    {
+        advance();
+
+        formula_node node;
+        node.type = formula_node::node_type::binary;
+        node.op = formula_operator::concatenate;
+        node.children.push_back(std::move(left));
+        node.children.push_back(parse_additive());
+        left = std::move(node);
+    }
+
+    return left;
+}
+
+formula_node formula_parser::parse_additive()
+{
+    auto left = parse_multiplicative();
+
+    while (peek().type == token::token_type::op && (peek().string == "+" || peek().string == "-"))
+    {
+        auto type = peek().string == "+" ? formula_operator::add : formula_operator::subtract;
+        advance();
+
+        formula_node node;
+        node.type = formula_node::node_type::binary;
+        node.op = type;
+        node.children.push_back(std::move(left));
+        node.children.push_back(parse_multiplicative());
+        left = std::move(node);
+    }
+
+    return left;
+}
+
+formula_node formula_parser::parse_multiplicative()
+{
+    auto left = parse_power();
+
+    while (peek().type == token::token_type::op && (peek().string == "*" || peek().string == "/"))
+    {
+        auto type = peek().string == "*" ? formula_operator::multiply : formula_operator::divide;
+        advance();
+
+        formula_node node;
+        node.type = formula_node::node_type::binary;
+        node.op = type;
+        node.children.push_back(std::move(left));
+        node.children.push_back(parse_power());
+        left = std::move(node);
+    }
+
+    return left;
+}
+
+formula_node formula_parser::parse_power()
+{
+    // Excel evaluates ^ left to right, so 2^3^2 is 64
+    auto left = parse_percent();
+
+    while (peek().type == token::token_type::op && peek().string == "^")
+    {
+        advance();
+
+        formula_node node;
+        node.type = formula_node::node_type::binary;
+        node.op = formula_operator::power;
+        node.children.push_back(std::move(left));
+        node.children.push_back(parse_percent());
+        left = std::move(node);
+    }
+
+    return left;
+}
+
+formula_node formula_parser::parse_percent()
+{
+    auto operand = parse_unary();
+
+    while (peek().type == token::token_type::op && peek().string == "%")
+    {
+        advance();
+
+        formula_node node;
+        node.type = formula_node::node_type::unary;
+        node.op = formula_operator::percent;
+        node.children.push_back(std::move(operand));
+        operand = std::move(node);
+    }
+
+    return operand;
+}
+
+formula_node formula_parser::parse_unary()
+{
+    // negation binds tighter than ^ in Excel, so -2^2 is 4
+    if (peek().type == token::token_type::op && (peek().string == "-" || peek().string == "+"))
+    {
+        auto type = peek().string == "-" ? formula_operator::negate : formula_operator::plus;
+        advance();
+
+        formula_node node;
+        node.type = formula_node::node_type::unary;
+        node.op = type;
+        node.children.push_back(parse_unary());
+
+        return node;
+    }
+
+    return parse_primary();
+}
+
+formula_node formula_parser::parse_primary()
+{
+    auto current = peek();
+    advance();
+
+    formula_node node;
+
+    switch (current.type)
+    {
+    case token::token_type::number:
+        node.type = formula_node::node_type::number;
+        node.number = current.number;
+        break;
+    case token::token_type::string:
+        node.type = formula_node::node_type::string;
+        node.text = current.string;
+        break;
+    case token::token_type::boolean:
+        node.type = formula_node::node_type::boolean;
+        node.number = current.number;
+        break;
+    case token::token_type::error:
+        node.type = formula_node::node_type::error;
+        node.text = current.string;
+        break;
+    case token::token_type::reference:
+        node.type = formula_node::node_type::reference;
+        node.reference = current.reference;
+        node.text = current.string;
+        break;
+    case token::token_type::name:
+        node.type = formula_node::node_type::name;
+        node.text = current.string;
+        break;
+    case token::token_type::function:
+        return parse_function(current.string);
+    case token::token_type::open_paren:
+        node = parse_comparison();
+
+        if (peek().type != token::token_type::close_paren)
+        {
+            throw xlnt::exception("expected ) in formula: " + formula_);
+        }
+
+        advance();
+        break;
+    default:
+        throw xlnt::exception("unexpected \"" + current.string + "\" in formula: " + formula_);
+    }
+
+    return node;
+}
+
+formula_node formula_parser::parse_function(const std::string &name)
+{
+    formula_node node;
+    node.type = formula_node::node_type::function;
+    node.function = function_from_string(name);
+    node.text = name;
+
+    if (peek().type == token::token_type::close_paren)
+    {
+        advance();
+        return node;
+    }
+
+    while (true)
+    {
+        if (peek().type == token::token_type::separator || peek().type == token::token_type::close_paren)
+        {
+            // omitted argument, e.g. IF(A1,,1)
+            node.children.push_back(formula_node());
+        }
+        else
+        {
+            node.children.push_back(parse_comparison());
+        }
+
+        if (peek().type == token::token_type::separator)
+        {
+            advance();
+            continue;
+        }
+
+        if (peek().type != token::token_type::close_paren)
+        {
+            throw xlnt::exception("expected ) in formula: " + formula_);
+        }
+
+        advance();
+        break;
+    }
+
+    return node;
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,183 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <xlnt/cell/index_types.hpp>
+
+namespace xlnt {
+namespace detail {
+
+struct worksheet_impl;
+
+enum class formula_function
+{
+    average,
+    count,
+    if_,
+    index,
+    match,
+    max,
+    min,
+    sum,
+    vlookup,
+    unknown
+};
+
+enum class formula_operator
+{
+    add,
+    subtract,
+    multiply,
+    divide,
+    power,
+    concatenate,
+    equal,
+    not_equal,
+    less,
+    less_or_equal,
+    greater,
+    greater_or_equal,
+    negate,
+    plus,
+    percent
+};
+
+/// <summary>
+/// A rectangular block of cells referenced by a formula. Single cell references
+/// have first == last in both dimensions. The sheet pointer is filled in when the
+/// formula is bound to a workbook; a null sheet after binding means #REF!.
+/// </summary>
+struct formula_reference
+{
+    bool has_sheet = false;
+    std::string sheet_title;
+    const worksheet_impl *sheet = nullptr;
+
+    row_t first_row = 0;
+    row_t last_row = 0;
+    column_t::index_t first_column = 0;
+    column_t::index_t last_column = 0;
+
+    bool is_cell() const
+    {
+        return first_row == last_row && first_column == last_column;
+    }
+
+    bool contains(row_t row, column_t::index_t column) const
+    {
+        return row >= first_row && row <= last_row
+            && column >= first_column && column <= last_column;
+    }
+};
+
+/// <summary>
+/// A node of a compiled formula. Formulas are parsed once into a tree of these
+/// which is then evaluated directly on every recalculation.
+/// </summary>
+struct formula_node
+{
+    enum class node_type
+    {
+        empty,
+        number,
+        string,
+        boolean,
+        error,
+        reference,
+        name,
+        unary,
+        binary,
+        function
+    } type = node_type::empty;
+
+    double number = 0;
+    std::string text;
+    formula_operator op = formula_operator::add;
+    formula_function function = formula_function::unknown;
+    formula_reference reference;
+    std::vector<formula_node> children;
+};
+
+/// <summary>
+/// Recursive descent parser for A1-style formula strings (without the leading '=')
+/// following Excel's operator precedence. Throws xlnt::exception on malformed input.
+/// </summary>
+class formula_parser
+{
+public:
+    formula_parser(const std::string &formula_string);
+    formula_node parse();
+
+private:
+    struct token
+    {
+        enum class token_type
+        {
+            number,
+            string,
+            boolean,
+            error,
+            reference,
+            name,
+            function,
+            op,
+            open_paren,
+            close_paren,
+            separator,
+            end
+        } type = token_type::end;
+
+        std::string string;
+        double number = 0;
+        formula_reference reference;
+    };
+
+    token next_token();
+    const token &peek();
+    void advance();
+
+    formula_node parse_comparison();
+    formula_node parse_concatenation();
+    formula_node parse_additive();
+    formula_node parse_multiplicative();
+    formula_node parse_power();
+    formula_node parse_unary();
+    formula_node parse_percent();
+    formula_node parse_primary();
+    formula_node parse_function(const std::string &name);
+
+    std::string formula_;
+    std::size_t position_ = 0;
+    bool has_peeked_ = false;
+    token peeked_;
+};
+
+formula_function function_from_string(const std::string &name);
+
+} // namespace detail
+} // namespace xlnt
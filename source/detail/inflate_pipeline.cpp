@@ -0,0 +1,161 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cstring>
+
+#include <detail/inflate_pipeline.hpp>
+#include <xlnt/packaging/zip_file.hpp>
+
+namespace xlnt {
+namespace detail {
+
+bool inflate_pipeline::forced = false;
+
+inflate_pipeline::inflate_pipeline(zip_file &archive, const path &name,
+    std::size_t buffer_size, std::size_t buffer_count)
+    : buffers_(std::max(buffer_count, std::size_t(2)), std::vector<char>(std::max(buffer_size, std::size_t(1)))),
+      sizes_(buffers_.size(), 0),
+      filled_(0),
+      consumed_(0),
+      write_size_(0),
+      holding_(false),
+      finished_(false),
+      cancelled_(false)
+{
+    thread_ = std::thread(&inflate_pipeline::inflate, this, std::ref(archive), name);
+}
+
+inflate_pipeline::~inflate_pipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+    }
+
+    changed_.notify_all();
+    thread_.join();
+}
+
+bool inflate_pipeline::next(const char *&data, std::size_t &size)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (holding_)
+    {
+        // the buffer returned last time can be filled again
+        ++consumed_;
+        holding_ = false;
+        changed_.notify_all();
+    }
+
+    changed_.wait(lock, [this] { return filled_ > consumed_ || finished_; });
+
+    if (filled_ == consumed_)
+    {
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+
+        return false;
+    }
+
+    const auto index = consumed_ % buffers_.size();
+    data = buffers_[index].data();
+    size = sizes_[index];
+    holding_ = true;
+
+    return true;
+}
+
+void inflate_pipeline::inflate(zip_file &archive, const path &name)
+{
+    try
+    {
+        archive.read(name, [this](const char *data, std::size_t size) { return write(data, size); });
+
+        if (write_size_ > 0)
+        {
+            publish();
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+    }
+
+    changed_.notify_all();
+}
+
+bool inflate_pipeline::write(const char *data, std::size_t size)
+{
+    while (size > 0)
+    {
+        if (write_size_ == 0)
+        {
+            // wait for the next buffer in the ring to be free
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [this] { return filled_ - consumed_ < buffers_.size() || cancelled_; });
+
+            if (cancelled_) return false;
+        }
+
+        // only this thread touches the buffer until it's published
+        auto &buffer = buffers_[filled_ % buffers_.size()];
+        const auto count = std::min(size, buffer.size() - write_size_);
+        std::memcpy(buffer.data() + write_size_, data, count);
+
+        write_size_ += count;
+        data += count;
+        size -= count;
+
+        if (write_size_ == buffer.size())
+        {
+            publish();
+        }
+    }
+
+    return true;
+}
+
+void inflate_pipeline::publish()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sizes_[filled_ % buffers_.size()] = write_size_;
+        ++filled_;
+    }
+
+    write_size_ = 0;
+    changed_.notify_all();
+}
+
+} // namespace detail
+} // namespace xlnt
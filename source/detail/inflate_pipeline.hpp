@@ -0,0 +1,98 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+#include <xlnt/utils/path.hpp>
+
+namespace xlnt {
+
+class zip_file;
+
+namespace detail {
+
+/// <summary>
+/// Inflates a file of a zip archive on its own thread into a ring of fixed-size
+/// buffers so that the beginning of the file can be parsed while the rest of it
+/// is still being inflated. The archive mustn't be used by anything else until
+/// the pipeline is destroyed.
+/// </summary>
+class XLNT_CLASS inflate_pipeline
+{
+public:
+    /// <summary>
+    /// Use the pipeline for large parts even with a single core, where it's
+    /// otherwise skipped. Only tests set this, so that they cover it on any machine.
+    /// </summary>
+    static bool forced;
+
+    inflate_pipeline(zip_file &archive, const path &name,
+        std::size_t buffer_size = 1 << 20, std::size_t buffer_count = 4);
+
+    /// <summary>
+    /// Stops inflating if the file hasn't been read to the end and waits for the thread.
+    /// </summary>
+    ~inflate_pipeline();
+
+    inflate_pipeline(const inflate_pipeline &) = delete;
+    inflate_pipeline &operator=(const inflate_pipeline &) = delete;
+
+    /// <summary>
+    /// Wait for the next filled buffer and point data and size at its contents,
+    /// which stay valid until the next call. Returns false once the whole file
+    /// has been returned. Rethrows anything thrown while inflating.
+    /// </summary>
+    bool next(const char *&data, std::size_t &size);
+
+private:
+    void inflate(zip_file &archive, const path &name);
+    bool write(const char *data, std::size_t size);
+    void publish();
+
+    std::vector<std::vector<char>> buffers_;
+    std::vector<std::size_t> sizes_;
+
+    // buffers are filled and consumed in order, so buffer i % buffers_.size() is
+    // the ith one; filled_ - consumed_ are waiting to be read
+    std::size_t filled_;
+    std::size_t consumed_;
+    std::size_t write_size_;
+    bool holding_;
+    bool finished_;
+    bool cancelled_;
+    std::exception_ptr error_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::thread thread_;
+};
+
+} // namespace detail
+} // namespace xlnt
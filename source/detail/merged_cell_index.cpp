@@ -0,0 +1,331 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cmath>
+
+#include <xlnt/utils/hash_combine.hpp>
+#include <detail/merged_cell_index.hpp>
+
+namespace {
+
+const std::size_t node_size = 16;
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+std::size_t merged_cell_index::range_hash::operator()(const range_reference &reference) const
+{
+    cell_reference_hash hasher;
+    auto seed = hasher(reference.get_top_left());
+    hash_combine(seed, hasher(reference.get_bottom_right()));
+
+    return seed;
+}
+
+merged_cell_index::merged_cell_index() : removed_count_(0), indexed_(0)
+{
+}
+
+merged_cell_index::merged_cell_index(const merged_cell_index &other)
+    : ranges_(other.ranges()), removed_(ranges_.size(), false), removed_count_(0), indexed_(0)
+{
+    index_slots();
+}
+
+merged_cell_index &merged_cell_index::operator=(const merged_cell_index &other)
+{
+    ranges_ = other.ranges();
+    removed_.assign(ranges_.size(), false);
+    removed_count_ = 0;
+    index_slots();
+    levels_.clear();
+    indexed_ = 0;
+
+    return *this;
+}
+
+std::vector<range_reference> merged_cell_index::ranges() const
+{
+    if (removed_count_ == 0)
+    {
+        return ranges_;
+    }
+
+    std::vector<range_reference> result;
+    result.reserve(size());
+
+    for (std::size_t i = 0; i < ranges_.size(); ++i)
+    {
+        if (!removed_[i])
+        {
+            result.push_back(ranges_[i]);
+        }
+    }
+
+    return result;
+}
+
+std::size_t merged_cell_index::size() const
+{
+    return ranges_.size() - removed_count_;
+}
+
+bool merged_cell_index::empty() const
+{
+    return size() == 0;
+}
+
+void merged_cell_index::clear()
+{
+    ranges_.clear();
+    removed_.clear();
+    removed_count_ = 0;
+    slots_.clear();
+    levels_.clear();
+    indexed_ = 0;
+}
+
+void merged_cell_index::add(const range_reference &reference)
+{
+    slots_.emplace(reference, ranges_.size());
+    ranges_.push_back(reference);
+    removed_.push_back(false);
+}
+
+bool merged_cell_index::remove(const range_reference &reference)
+{
+    auto matches = slots_.equal_range(reference);
+
+    if (matches.first == matches.second)
+    {
+        return false;
+    }
+
+    // of equal ranges, the one added first is removed
+    auto match = matches.first;
+
+    for (auto other = matches.first; other != matches.second; ++other)
+    {
+        if (other->second < match->second)
+        {
+            match = other;
+        }
+    }
+
+    // the tree still holds the range but find skips it
+    removed_[match->second] = true;
+    ++removed_count_;
+    slots_.erase(match);
+
+    if (removed_count_ > 8 && removed_count_ * 2 > ranges_.size())
+    {
+        compact();
+    }
+
+    return true;
+}
+
+const range_reference *merged_cell_index::find(const cell_reference &reference) const
+{
+    const auto row = reference.get_row();
+    const auto column = reference.get_column().index;
+
+    // rebuilding after every addition would make adding n ranges between lookups quadratic
+    const auto pending = ranges_.size() - indexed_;
+
+    if (pending > 8 + static_cast<std::size_t>(std::sqrt(static_cast<double>(indexed_))))
+    {
+        build();
+    }
+
+    for (auto i = indexed_; i < ranges_.size(); ++i)
+    {
+        if (!removed_[i] && make_box(ranges_[i], i).contains(row, column))
+        {
+            return &ranges_[i];
+        }
+    }
+
+    if (levels_.empty())
+    {
+        return nullptr;
+    }
+
+    const auto &root = levels_.back();
+
+    for (std::size_t node = 0; node < root.size(); ++node)
+    {
+        if (auto found = search(levels_.size() - 1, node, row, column))
+        {
+            return found;
+        }
+    }
+
+    return nullptr;
+}
+
+bool merged_cell_index::operator==(const merged_cell_index &other) const
+{
+    return size() == other.size() && ranges() == other.ranges();
+}
+
+merged_cell_index::box merged_cell_index::make_box(const range_reference &reference, std::size_t index)
+{
+    const auto top_left = reference.get_top_left();
+    const auto bottom_right = reference.get_bottom_right();
+
+    box result;
+    result.top = std::min(top_left.get_row(), bottom_right.get_row());
+    result.bottom = std::max(top_left.get_row(), bottom_right.get_row());
+    result.left = std::min(top_left.get_column().index, bottom_right.get_column().index);
+    result.right = std::max(top_left.get_column().index, bottom_right.get_column().index);
+    result.first = index;
+
+    return result;
+}
+
+void merged_cell_index::index_slots()
+{
+    slots_.clear();
+
+    for (std::size_t i = 0; i < ranges_.size(); ++i)
+    {
+        slots_.emplace(ranges_[i], i);
+    }
+}
+
+void merged_cell_index::compact()
+{
+    std::size_t kept = 0;
+
+    for (std::size_t i = 0; i < ranges_.size(); ++i)
+    {
+        if (!removed_[i])
+        {
+            ranges_[kept++] = ranges_[i];
+        }
+    }
+
+    ranges_.resize(kept);
+    removed_.assign(kept, false);
+    removed_count_ = 0;
+    index_slots();
+
+    // the positions in the tree have shifted
+    levels_.clear();
+    indexed_ = 0;
+}
+
+void merged_cell_index::build() const
+{
+    levels_.clear();
+    indexed_ = ranges_.size();
+
+    if (size() == 0) return;
+
+    std::vector<box> leaves;
+    leaves.reserve(ranges_.size());
+
+    for (std::size_t i = 0; i < ranges_.size(); ++i)
+    {
+        if (!removed_[i])
+        {
+            leaves.push_back(make_box(ranges_[i], i));
+        }
+    }
+
+    // sort-tile-recursive packing: vertical slices by column, then rows within each slice
+    const auto leaf_count = (leaves.size() + node_size - 1) / node_size;
+    const auto slice_count = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(leaf_count))));
+    const auto slice_size = slice_count * node_size;
+
+    std::sort(leaves.begin(), leaves.end(), [](const box &a, const box &b) { return a.left + a.right < b.left + b.right; });
+
+    for (std::size_t first = 0; first < leaves.size(); first += slice_size)
+    {
+        const auto last = std::min(first + slice_size, leaves.size());
+        std::sort(leaves.begin() + first, leaves.begin() + last,
+            [](const box &a, const box &b) { return a.top + a.bottom < b.top + b.bottom; });
+    }
+
+    levels_.push_back(std::move(leaves));
+
+    while (levels_.back().size() > node_size)
+    {
+        const auto &below = levels_.back();
+        std::vector<box> level;
+        level.reserve((below.size() + node_size - 1) / node_size);
+
+        for (std::size_t first = 0; first < below.size(); first += node_size)
+        {
+            const auto last = std::min(first + node_size, below.size());
+            auto parent = below[first];
+            parent.first = first;
+
+            for (auto i = first + 1; i < last; ++i)
+            {
+                parent.top = std::min(parent.top, below[i].top);
+                parent.bottom = std::max(parent.bottom, below[i].bottom);
+                parent.left = std::min(parent.left, below[i].left);
+                parent.right = std::max(parent.right, below[i].right);
+            }
+
+            level.push_back(parent);
+        }
+
+        levels_.push_back(std::move(level));
+    }
+}
+
+const range_reference *merged_cell_index::search(std::size_t level, std::size_t node, row_t row, column_t::index_t column) const
+{
+    const auto &current = levels_[level][node];
+
+    if (!current.contains(row, column))
+    {
+        return nullptr;
+    }
+
+    if (level == 0)
+    {
+        return removed_[current.first] ? nullptr : &ranges_[current.first];
+    }
+
+    const auto last = std::min(current.first + node_size, levels_[level - 1].size());
+
+    for (auto child = current.first; child < last; ++child)
+    {
+        if (auto found = search(level - 1, child, row, column))
+        {
+            return found;
+        }
+    }
+
+    return nullptr;
+}
+
+} // namespace detail
+} // namespace xlnt
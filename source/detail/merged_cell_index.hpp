@@ -0,0 +1,122 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <xlnt/cell/cell_reference.hpp>
+#include <xlnt/worksheet/range_reference.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// The merged ranges of a worksheet, kept as rectangles instead of as flags on
+/// every cell they cover. Lookups go through a packed R-tree that is rebuilt
+/// lazily. Ranges added since the last rebuild stay in a short unindexed tail
+/// that is searched linearly. The tree is rebuilt once that tail outgrows
+/// roughly the square root of the indexed count. Removed ranges are found through
+/// a hash map and only marked as such until they make up half of the ranges,
+/// when they are dropped all at once.
+/// </summary>
+class merged_cell_index
+{
+public:
+    merged_cell_index();
+
+    merged_cell_index(const merged_cell_index &other);
+    merged_cell_index &operator=(const merged_cell_index &other);
+
+    /// <summary>
+    /// The ranges in the order they were added.
+    /// </summary>
+    std::vector<range_reference> ranges() const;
+
+    std::size_t size() const;
+    bool empty() const;
+    void clear();
+
+    void add(const range_reference &reference);
+
+    /// <summary>
+    /// Remove the range equal to reference. Returns false if there isn't one.
+    /// </summary>
+    bool remove(const range_reference &reference);
+
+    /// <summary>
+    /// Return a range that contains the given cell or nullptr if there is none.
+    /// The pointer is valid until the index is next modified.
+    /// </summary>
+    const range_reference *find(const cell_reference &reference) const;
+
+    bool operator==(const merged_cell_index &other) const;
+
+private:
+    struct box
+    {
+        row_t top;
+        row_t bottom;
+        column_t::index_t left;
+        column_t::index_t right;
+
+        // index into ranges_ for leaves or of the first child in the level below
+        std::size_t first;
+
+        bool contains(row_t row, column_t::index_t column) const
+        {
+            return row >= top && row <= bottom && column >= left && column <= right;
+        }
+    };
+
+    struct range_hash
+    {
+        std::size_t operator()(const range_reference &reference) const;
+    };
+
+    static box make_box(const range_reference &reference, std::size_t index);
+
+    void index_slots();
+    void compact();
+    void build() const;
+    const range_reference *search(std::size_t level, std::size_t node, row_t row, column_t::index_t column) const;
+
+    // ranges_[i] was removed if removed_[i] is set
+    std::vector<range_reference> ranges_;
+    std::vector<bool> removed_;
+    std::size_t removed_count_;
+
+    // the position in ranges_ of each range that hasn't been removed
+    std::unordered_multimap<range_reference, std::size_t, range_hash> slots_;
+
+    // levels_[0] holds one box per indexed range and each level above holds
+    // one box per node_size boxes of the level below
+    mutable std::vector<std::vector<box>> levels_;
+
+    // ranges_[indexed_, size()) aren't in the tree yet
+    mutable std::size_t indexed_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,283 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+
+#include <detail/cell_impl.hpp>
+#include <detail/numeric_kernels.hpp>
+#include <detail/worksheet_impl.hpp>
+
+namespace {
+
+using xlnt::detail::numeric_block;
+
+const std::uint64_t all_valid = ~std::uint64_t(0);
+
+std::size_t popcount(std::uint64_t word)
+{
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+
+    return static_cast<std::size_t>((word * 0x0101010101010101ULL) >> 56);
+}
+
+// The loops below work on one 64-slot word of the validity bitmap at a time
+// with several independent accumulators and no data-dependent branches so
+// that the compiler can keep them in vector registers.
+
+template <typename Compare>
+std::size_t count_word(const double *values, std::uint64_t word, double operand, Compare compare)
+{
+    std::size_t count = 0;
+
+    for (std::size_t i = 0; i < 64; ++i)
+    {
+        count += static_cast<std::size_t>((word >> i) & compare(values[i], operand));
+    }
+
+    return count;
+}
+
+template <typename Compare>
+std::size_t count_block(const numeric_block &block, double operand, Compare compare)
+{
+    std::size_t count = 0;
+    const auto words = (block.size + 63) / 64;
+
+    for (std::size_t w = 0; w < words; ++w)
+    {
+        if (block.validity[w] != 0)
+        {
+            count += count_word(block.values + w * 64, block.validity[w], operand, compare);
+        }
+    }
+
+    return count;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+void numeric_summary::merge(const numeric_summary &other)
+{
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    count += other.count;
+}
+
+numeric_summary summarize(const numeric_block &block)
+{
+    numeric_summary result;
+    const auto words = (block.size + 63) / 64;
+
+    for (std::size_t w = 0; w < words; ++w)
+    {
+        const auto word = block.validity[w];
+
+        // skip runs of empty or non-numeric cells entirely
+        if (word == 0) continue;
+
+        const double *values = block.values + w * 64;
+
+        // invalid slots hold 0 so they don't change the sum
+        double sum[4] = { 0, 0, 0, 0 };
+
+        for (std::size_t i = 0; i < 64; i += 4)
+        {
+            sum[0] += values[i];
+            sum[1] += values[i + 1];
+            sum[2] += values[i + 2];
+            sum[3] += values[i + 3];
+        }
+
+        result.sum += (sum[0] + sum[1]) + (sum[2] + sum[3]);
+        result.count += popcount(word);
+
+        if (word == all_valid)
+        {
+            double min[4] = { values[0], values[1], values[2], values[3] };
+            double max[4] = { values[0], values[1], values[2], values[3] };
+
+            for (std::size_t i = 4; i < 64; i += 4)
+            {
+                for (std::size_t lane = 0; lane < 4; ++lane)
+                {
+                    min[lane] = values[i + lane] < min[lane] ? values[i + lane] : min[lane];
+                    max[lane] = values[i + lane] > max[lane] ? values[i + lane] : max[lane];
+                }
+            }
+
+            result.min = std::min({ result.min, min[0], min[1], min[2], min[3] });
+            result.max = std::max({ result.max, max[0], max[1], max[2], max[3] });
+        }
+        else
+        {
+            // Replace invalid slots by the identity of min and max.
+            const auto inf = std::numeric_limits<double>::infinity();
+            auto min = inf;
+            auto max = -inf;
+
+            for (std::size_t i = 0; i < 64; ++i)
+            {
+                const bool valid = ((word >> i) & 1) != 0;
+                const auto low = valid ? values[i] : inf;
+                const auto high = valid ? values[i] : -inf;
+                min = low < min ? low : min;
+                max = high > max ? high : max;
+            }
+
+            result.min = std::min(result.min, min);
+            result.max = std::max(result.max, max);
+        }
+    }
+
+    return result;
+}
+
+std::size_t count_matching(const numeric_block &block, comparison_operator op, double operand)
+{
+    switch (op)
+    {
+    case comparison_operator::equal:
+        return count_block(block, operand, [](double a, double b) { return std::uint64_t(a == b); });
+    case comparison_operator::not_equal:
+        return count_block(block, operand, [](double a, double b) { return std::uint64_t(a != b); });
+    case comparison_operator::less:
+        return count_block(block, operand, [](double a, double b) { return std::uint64_t(a < b); });
+    case comparison_operator::less_or_equal:
+        return count_block(block, operand, [](double a, double b) { return std::uint64_t(a <= b); });
+    case comparison_operator::greater:
+        return count_block(block, operand, [](double a, double b) { return std::uint64_t(a > b); });
+    case comparison_operator::greater_or_equal:
+        return count_block(block, operand, [](double a, double b) { return std::uint64_t(a >= b); });
+    }
+
+    return 0;
+}
+
+const cell_impl *gather_numeric_blocks(const worksheet_impl &sheet, const numeric_bounds &bounds,
+    const std::function<void(const numeric_block &)> &f)
+{
+    numeric_block block;
+    std::fill(block.validity, block.validity + numeric_block_size / 64, 0);
+    const cell_impl *first_error = nullptr;
+
+    auto flush = [&]() {
+        // pad the last word so that the kernels can always process whole words
+        std::fill(block.values + block.size, block.values + ((block.size + 63) / 64) * 64, 0.0);
+        f(block);
+        block.size = 0;
+        std::fill(block.validity, block.validity + numeric_block_size / 64, 0);
+    };
+
+    auto add = [&](const cell_impl &cell) {
+        const auto slot = block.size++;
+
+        if (cell.type_ == cell_type::numeric)
+        {
+            block.values[slot] = cell.value_numeric_;
+            block.validity[slot / 64] |= std::uint64_t(1) << (slot % 64);
+        }
+        else
+        {
+            block.values[slot] = 0;
+
+            if (cell.type_ == cell_type::error && first_error == nullptr)
+            {
+                first_error = &cell;
+            }
+        }
+
+        if (block.size == numeric_block_size)
+        {
+            flush();
+        }
+    };
+
+    const auto &cell_map = sheet.cell_map_;
+    const auto rows = static_cast<std::size_t>(bounds.last_row - bounds.first_row) + 1;
+    const auto columns = static_cast<std::size_t>(bounds.last_column - bounds.first_column) + 1;
+
+    // Walk whichever is smaller: the coordinates of the range or the stored cells.
+    auto visit_row = [&](const cell_store::row_map &row) {
+        if (columns > row.size())
+        {
+            for (const auto &cell : row)
+            {
+                if (cell.first.index >= bounds.first_column && cell.first.index <= bounds.last_column)
+                {
+                    add(cell.second);
+                }
+            }
+        }
+        else
+        {
+            for (auto column = bounds.first_column; column <= bounds.last_column; ++column)
+            {
+                auto match = row.find(column_t(column));
+
+                if (match != row.end())
+                {
+                    add(match->second);
+                }
+            }
+        }
+    };
+
+    if (rows > cell_map.size())
+    {
+        for (const auto &row : cell_map)
+        {
+            if (row.first >= bounds.first_row && row.first <= bounds.last_row)
+            {
+                visit_row(row.second);
+            }
+        }
+    }
+    else
+    {
+        for (auto row = bounds.first_row; row <= bounds.last_row; ++row)
+        {
+            auto match = cell_map.find(row);
+
+            if (match != cell_map.end())
+            {
+                visit_row(match->second);
+            }
+        }
+    }
+
+    if (block.size > 0)
+    {
+        flush();
+    }
+
+    return first_error;
+}
+
+} // namespace detail
+} // namespace xlnt
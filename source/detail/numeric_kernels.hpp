@@ -0,0 +1,101 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+#include <xlnt/cell/index_types.hpp>
+#include <xlnt/worksheet/comparison_operator.hpp>
+
+namespace xlnt {
+namespace detail {
+
+struct cell_impl;
+struct worksheet_impl;
+
+/// <summary>
+/// The number of slots in a numeric_block. A multiple of 64 so that the
+/// validity bitmap has no partially used words.
+/// </summary>
+const std::size_t numeric_block_size = 1024;
+
+/// <summary>
+/// A contiguous batch of cell values prepared for the aggregate kernels.
+/// Bit i of the validity bitmap is set if slot i holds a number. Slots of empty
+/// or non-numeric cells hold 0 so that sums can ignore the bitmap.
+/// </summary>
+struct numeric_block
+{
+    std::size_t size = 0;
+    double values[numeric_block_size];
+    std::uint64_t validity[numeric_block_size / 64];
+};
+
+/// <summary>
+/// The result of reducing one or more numeric blocks.
+/// </summary>
+struct numeric_summary
+{
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    std::size_t count = 0;
+
+    void merge(const numeric_summary &other);
+};
+
+/// <summary>
+/// Compute the sum, minimum, maximum, and count of the valid slots of block.
+/// </summary>
+numeric_summary summarize(const numeric_block &block);
+
+/// <summary>
+/// Count the valid slots of block whose value compares to operand according to op.
+/// </summary>
+std::size_t count_matching(const numeric_block &block, comparison_operator op, double operand);
+
+/// <summary>
+/// The cells of sheet within [first_row, last_row] x [first_column, last_column].
+/// </summary>
+struct numeric_bounds
+{
+    row_t first_row;
+    row_t last_row;
+    column_t::index_t first_column;
+    column_t::index_t last_column;
+};
+
+/// <summary>
+/// Copy the values of the existing cells of sheet within bounds into numeric
+/// blocks and call f with each filled block. Only cells that exist are visited so
+/// the cost depends on the number of stored cells rather than the area of the range.
+/// Returns the first error cell encountered, or nullptr.
+/// </summary>
+const cell_impl *gather_numeric_blocks(const worksheet_impl &sheet, const numeric_bounds &bounds,
+    const std::function<void(const numeric_block &)> &f);
+
+} // namespace detail
+} // namespace xlnt
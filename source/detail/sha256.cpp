@@ -0,0 +1,148 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <cstring>
+
+#include <detail/sha256.hpp>
+
+namespace {
+
+const std::uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+std::uint32_t rotate_right(std::uint32_t value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+void compress(std::uint32_t state[8], const unsigned char *block)
+{
+    std::uint32_t schedule[64];
+
+    for (int i = 0; i < 16; ++i)
+    {
+        schedule[i] = (std::uint32_t(block[i * 4]) << 24) | (std::uint32_t(block[i * 4 + 1]) << 16)
+            | (std::uint32_t(block[i * 4 + 2]) << 8) | std::uint32_t(block[i * 4 + 3]);
+    }
+
+    for (int i = 16; i < 64; ++i)
+    {
+        const auto s0 = rotate_right(schedule[i - 15], 7) ^ rotate_right(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+        const auto s1 = rotate_right(schedule[i - 2], 17) ^ rotate_right(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+        schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+    }
+
+    auto a = state[0], b = state[1], c = state[2], d = state[3];
+    auto e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; ++i)
+    {
+        const auto s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+        const auto choice = (e & f) ^ (~e & g);
+        const auto t1 = h + s1 + choice + round_constants[i] + schedule[i];
+        const auto s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+        const auto majority = (a & b) ^ (a & c) ^ (b & c);
+        const auto t2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+std::array<std::uint8_t, 32> sha256(const char *data, std::size_t size)
+{
+    std::uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+    const auto bytes = reinterpret_cast<const unsigned char *>(data);
+    const auto whole_blocks = size / 64;
+
+    for (std::size_t i = 0; i < whole_blocks; ++i)
+    {
+        compress(state, bytes + i * 64);
+    }
+
+    // the rest of the content, a one bit, zeros and the length in bits fill one or two blocks
+    unsigned char tail[128] = {};
+    const auto rest = size % 64;
+    std::memcpy(tail, bytes + whole_blocks * 64, rest);
+    tail[rest] = 0x80;
+
+    const auto tail_size = rest < 56 ? 64 : 128;
+    const auto bit_count = static_cast<std::uint64_t>(size) * 8;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        tail[tail_size - 1 - i] = static_cast<unsigned char>(bit_count >> (i * 8));
+    }
+
+    compress(state, tail);
+
+    if (tail_size == 128)
+    {
+        compress(state, tail + 64);
+    }
+
+    std::array<std::uint8_t, 32> digest;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        digest[i * 4] = static_cast<std::uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<std::uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<std::uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<std::uint8_t>(state[i]);
+    }
+
+    return digest;
+}
+
+} // namespace detail
+} // namespace xlnt
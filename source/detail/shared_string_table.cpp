@@ -0,0 +1,410 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+
+#include <detail/constants.hpp>
+#include <detail/shared_string_table.hpp>
+#include <detail/sheet_data_scanner.hpp>
+#include <detail/xlsx_consumer.hpp>
+#include <xlnt/cell/text_run.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+namespace {
+
+bool is_plain_text(const xlnt::text &string)
+{
+    const auto runs = string.get_runs();
+    return runs.empty() || (runs.size() == 1 && !runs.front().has_formatting());
+}
+
+bool is_name_end(char c)
+{
+    return c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+shared_string_table::shared_string_table(const shared_string_table &other)
+{
+    *this = other;
+}
+
+shared_string_table &shared_string_table::operator=(const shared_string_table &other)
+{
+    if (this == &other) return *this;
+
+    auto lock = other.lock_decoding();
+
+    entries_ = other.entries_;
+    arena_ = other.arena_;
+    formatted_ = other.formatted_;
+    index_ = other.index_;
+    xml_ = other.xml_;
+    prefix_ = other.prefix_;
+
+    return *this;
+}
+
+std::size_t shared_string_table::size() const
+{
+    return entries_.size();
+}
+
+bool shared_string_table::empty() const
+{
+    return entries_.empty();
+}
+
+void shared_string_table::clear()
+{
+    entries_.clear();
+    arena_.clear();
+    formatted_.clear();
+    xml_.reset();
+    prefix_.clear();
+    index_.clear();
+}
+
+std::size_t shared_string_table::add(const std::string &string)
+{
+    const auto existing = find(string);
+    return existing != npos ? existing : append_plain(string);
+}
+
+std::size_t shared_string_table::add(const text &string, bool allow_duplicates)
+{
+    if (!allow_duplicates)
+    {
+        const auto existing = find(string);
+        if (existing != npos) return existing;
+    }
+
+    if (is_plain_text(string))
+    {
+        return append_plain(string.get_plain_string());
+    }
+
+    check_capacity();
+    entries_.push_back({ formatted_.size(), 0, entry_kind::formatted, true });
+    formatted_.push_back(string);
+    index_.emplace(hash(string.get_plain_string()), static_cast<std::uint32_t>(entries_.size() - 1));
+
+    return entries_.size() - 1;
+}
+
+std::size_t shared_string_table::find(const std::string &string) const
+{
+    const auto candidates = index_.equal_range(hash(string));
+
+    for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+    {
+        const auto &current = entries_[candidate->second];
+
+        if (current.kind == entry_kind::formatted) continue;
+
+        const auto equal = current.kind == entry_kind::plain
+            ? arena_.compare(current.offset, current.length, string) == 0
+            : current.kind == entry_kind::xml_plain
+                ? xml_->compare(current.offset, current.length, string) == 0
+                : plain_string(current) == string;
+
+        if (equal) return candidate->second;
+    }
+
+    return npos;
+}
+
+std::size_t shared_string_table::find(const text &string) const
+{
+    if (is_plain_text(string))
+    {
+        return find(string.get_plain_string());
+    }
+
+    const auto candidates = index_.equal_range(hash(string.get_plain_string()));
+
+    for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+    {
+        const auto &current = entries_[candidate->second];
+
+        if (current.kind == entry_kind::formatted && formatted_[current.offset] == string)
+        {
+            return candidate->second;
+        }
+    }
+
+    return npos;
+}
+
+text shared_string_table::get(std::size_t index) const
+{
+    auto lock = lock_decoding();
+    const auto &current = decode(index);
+
+    if (current.kind == entry_kind::formatted)
+    {
+        return formatted_[current.offset];
+    }
+
+    text result;
+    result.set_plain_string(plain_string(current));
+
+    return result;
+}
+
+std::string shared_string_table::get_plain_string(std::size_t index) const
+{
+    auto lock = lock_decoding();
+    return plain_string(decode(index));
+}
+
+std::string shared_string_table::plain_string(const entry &current) const
+{
+    switch (current.kind)
+    {
+    case entry_kind::plain:
+        return arena_.substr(current.offset, current.length);
+    case entry_kind::xml_plain:
+        return xml_->substr(current.offset, current.length);
+    case entry_kind::xml_escaped:
+        return decode_character_data(xml_->data() + current.offset, xml_->data() + current.offset + current.length);
+    default:
+        return formatted_[current.offset].get_plain_string();
+    }
+}
+
+bool shared_string_table::is_plain(std::size_t index) const
+{
+    auto lock = lock_decoding();
+    return decode(index).kind != entry_kind::formatted;
+}
+
+bool shared_string_table::is_decoded(std::size_t index) const
+{
+    if (index >= entries_.size())
+    {
+        throw invalid_parameter();
+    }
+
+    auto lock = lock_decoding();
+    return entries_[index].kind != entry_kind::xml_element;
+}
+
+std::size_t shared_string_table::append_plain(const std::string &string)
+{
+    check_capacity();
+    entries_.push_back({ arena_.size(), static_cast<std::uint32_t>(string.size()), entry_kind::plain, true });
+    arena_.append(string);
+    index_.emplace(hash(string), static_cast<std::uint32_t>(entries_.size() - 1));
+
+    return entries_.size() - 1;
+}
+
+void shared_string_table::check_capacity() const
+{
+    // cells refer to strings by a 32-bit index
+    if (entries_.size() >= std::numeric_limits<std::uint32_t>::max())
+    {
+        throw exception("too many shared strings");
+    }
+}
+
+std::size_t shared_string_table::hash(const std::string &string)
+{
+    return std::hash<std::string>()(string);
+}
+
+std::unique_lock<std::mutex> shared_string_table::lock_decoding() const
+{
+    return xml_ ? std::unique_lock<std::mutex>(decode_mutex_.mutex) : std::unique_lock<std::mutex>();
+}
+
+const shared_string_table::entry &shared_string_table::decode(std::size_t index) const
+{
+    if (index >= entries_.size())
+    {
+        throw invalid_parameter();
+    }
+
+    auto &current = entries_[index];
+
+    if (current.kind == entry_kind::xml_element)
+    {
+        decode_element(current);
+    }
+
+    // find only looks at strings that were read since hashing them all would decode them all
+    if (!current.indexed)
+    {
+        index_.emplace(hash(plain_string(current)), static_cast<std::uint32_t>(index));
+        current.indexed = true;
+    }
+
+    return current;
+}
+
+void shared_string_table::decode_element(entry &current) const
+{
+    // the si element is parsed on its own so the namespace of the part is declared again
+    const auto namespace_declaration = std::string(" xmlns")
+        + (prefix_.empty() ? "" : ":" + prefix_.substr(0, prefix_.size() - 1))
+        + "=\"" + constants::get_namespace("worksheet") + "\"";
+    const auto element = "<" + prefix_ + "si" + namespace_declaration + ">"
+        + xml_->substr(current.offset, current.length) + "</" + prefix_ + "si>";
+    const auto string = xlsx_consumer::read_shared_string(element);
+
+    if (is_plain_text(string))
+    {
+        const auto plain = string.get_plain_string();
+        current = { arena_.size(), static_cast<std::uint32_t>(plain.size()), entry_kind::plain, false };
+        arena_.append(plain);
+    }
+    else
+    {
+        current = { formatted_.size(), 0, entry_kind::formatted, false };
+        formatted_.push_back(string);
+    }
+}
+
+void shared_string_table::assign_xml(std::string &&xml)
+{
+    clear();
+
+    auto part = std::make_shared<std::string>(std::move(xml));
+    const auto &source = *part;
+
+    // skip the declaration, processing instructions and comments before the root element
+    auto position = source.find('<');
+
+    while (position != std::string::npos && position + 1 < source.size()
+        && (source[position + 1] == '?' || source[position + 1] == '!'))
+    {
+        position = source.find('<', source.find('>', position));
+    }
+
+    if (position == std::string::npos)
+    {
+        throw invalid_file("shared strings");
+    }
+
+    auto root_name_end = position + 1;
+    while (root_name_end < source.size() && !is_name_end(source[root_name_end])) ++root_name_end;
+    const auto root_name = source.substr(position + 1, root_name_end - position - 1);
+
+    if (root_name.size() < 3 || root_name.compare(root_name.size() - 3, 3, "sst") != 0)
+    {
+        throw invalid_file("shared strings");
+    }
+
+    prefix_ = root_name.substr(0, root_name.size() - 3);
+    const auto root_end = source.find('>', position);
+    const auto root_tag = source.substr(position, root_end - position);
+
+    const auto open_si = "<" + prefix_ + "si";
+    const auto close_si = "</" + prefix_ + "si>";
+    const auto open_t = "<" + prefix_ + "t";
+    const auto close_t = "</" + prefix_ + "t>";
+
+    position = root_end;
+
+    while ((position = source.find(open_si, position)) != std::string::npos)
+    {
+        if (!is_name_end(source[position + open_si.size()]))
+        {
+            position += open_si.size();
+            continue;
+        }
+
+        const auto start_tag_end = source.find('>', position);
+
+        if (start_tag_end == std::string::npos)
+        {
+            throw invalid_file("shared strings");
+        }
+
+        if (source[start_tag_end - 1] == '/')
+        {
+            entries_.push_back({ 0, 0, entry_kind::xml_plain, false });
+            position = start_tag_end;
+            continue;
+        }
+
+        const auto content_start = start_tag_end + 1;
+        const auto content_end = source.find(close_si, content_start);
+
+        if (content_end == std::string::npos)
+        {
+            throw invalid_file("shared strings");
+        }
+
+        if (content_end - content_start > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw invalid_file("shared string too long");
+        }
+
+        entry current = { content_start, static_cast<std::uint32_t>(content_end - content_start), entry_kind::xml_element, false };
+
+        // a single unformatted t element can be read directly from the part
+        if (source.compare(content_start, open_t.size(), open_t) == 0
+            && is_name_end(source[content_start + open_t.size()]))
+        {
+            const auto characters_start = source.find('>', content_start) + 1;
+            const auto characters_end = source.find('<', characters_start);
+
+            if (characters_end + close_t.size() == content_end
+                && source.compare(characters_end, close_t.size(), close_t) == 0
+                && source[characters_start - 2] != '/')
+            {
+                const auto escaped = std::find_first_of(source.begin() + static_cast<std::ptrdiff_t>(characters_start),
+                    source.begin() + static_cast<std::ptrdiff_t>(characters_end), "&\r", "&\r" + 2)
+                    != source.begin() + static_cast<std::ptrdiff_t>(characters_end);
+
+                current = { characters_start, static_cast<std::uint32_t>(characters_end - characters_start),
+                    escaped ? entry_kind::xml_escaped : entry_kind::xml_plain, false };
+            }
+        }
+
+        entries_.push_back(current);
+        position = content_end + close_si.size();
+    }
+
+    xml_ = part;
+
+    const auto unique_count_position = root_tag.find("uniqueCount=\"");
+
+    if (unique_count_position != std::string::npos
+        && std::strtoull(root_tag.c_str() + unique_count_position + 13, nullptr, 10) != entries_.size())
+    {
+        throw invalid_file("sizes don't match");
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,178 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <xlnt/cell/text.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// The shared strings of a workbook. Strings without formatting are stored back to
+/// back in a single arena rather than as a text object each. A table can also be
+/// built from the undecoded XML of a shared strings part, in which case only the
+/// position of each entry is recorded and the entry is decoded the first time it's read.
+/// The const readers get, get_plain_string, is_plain and is_decoded can be called from
+/// several threads at once, as formulas are evaluated in parallel, since decoding is
+/// serialized. Adding or finding strings must not overlap with anything else.
+/// </summary>
+class shared_string_table
+{
+public:
+    shared_string_table() = default;
+
+    /// <summary>
+    /// Copying locks out decoding of other, which another thread may be reading,
+    /// e.g. while saving a copy of the workbook the table is shared with.
+    /// </summary>
+    shared_string_table(const shared_string_table &other);
+    shared_string_table &operator=(const shared_string_table &other);
+
+    std::size_t size() const;
+    bool empty() const;
+    void clear();
+
+    /// <summary>
+    /// Append string to the table and return its index. Unless allow_duplicates
+    /// is true, the index of an equal string is returned instead if there is one.
+    /// </summary>
+    std::size_t add(const text &string, bool allow_duplicates);
+
+    /// <summary>
+    /// Return the index of the unformatted string equal to string, appending it first if there is none.
+    /// </summary>
+    std::size_t add(const std::string &string);
+
+    /// <summary>
+    /// Return the index of a string equal to string or npos if there is none. Only
+    /// strings that were added or have been read are hashed, so a string of a table
+    /// built from XML isn't found before it's read and an equal one may be added again.
+    /// </summary>
+    std::size_t find(const text &string) const;
+    std::size_t find(const std::string &string) const;
+
+    /// <summary>
+    /// Return the string at index, decoding it first if needed.
+    /// Throws invalid_parameter if index is out of range.
+    /// </summary>
+    text get(std::size_t index) const;
+
+    /// <summary>
+    /// Return the characters of the string at index without its formatting.
+    /// </summary>
+    std::string get_plain_string(std::size_t index) const;
+
+    /// <summary>
+    /// Return true if the string at index has no formatting.
+    /// </summary>
+    bool is_plain(std::size_t index) const;
+
+    /// <summary>
+    /// Return false if the string at index is still undecoded XML.
+    /// </summary>
+    bool is_decoded(std::size_t index) const;
+
+    /// <summary>
+    /// Replace the contents of the table with the entries of a shared strings part.
+    /// The part is kept and each entry is only located, not decoded. Throws
+    /// invalid_file if the part isn't a string table or its uniqueCount is wrong.
+    /// </summary>
+    void assign_xml(std::string &&xml);
+
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+private:
+    enum class entry_kind : std::uint8_t
+    {
+        // characters in arena_
+        plain,
+        // characters in xml_ without entity references or carriage returns
+        xml_plain,
+        // characters in xml_ which must be unescaped
+        xml_escaped,
+        // content of an si element in xml_ which hasn't been parsed yet
+        xml_element,
+        // formatted_[offset]
+        formatted
+    };
+
+    struct entry
+    {
+        std::size_t offset;
+        std::uint32_t length;
+        entry_kind kind;
+
+        // true once the string is in index_
+        bool indexed;
+    };
+
+    /// <summary>
+    /// A mutex which is left behind when its table is copied.
+    /// </summary>
+    struct decode_mutex
+    {
+        decode_mutex() {}
+        decode_mutex(const decode_mutex &) {}
+        decode_mutex &operator=(const decode_mutex &) { return *this; }
+
+        std::mutex mutex;
+    };
+
+    /// <summary>
+    /// Lock out decoding on other threads while entries are read. Only tables built
+    /// from XML are decoded by readers so other tables return an unlocked lock.
+    /// </summary>
+    std::unique_lock<std::mutex> lock_decoding() const;
+
+    const entry &decode(std::size_t index) const;
+    void decode_element(entry &current) const;
+    std::string plain_string(const entry &current) const;
+    std::size_t append_plain(const std::string &string);
+    void check_capacity() const;
+    static std::size_t hash(const std::string &string);
+
+    // entries are decoded by const accessors so these are updated in place
+    mutable std::vector<entry> entries_;
+    mutable std::string arena_;
+    mutable std::vector<text> formatted_;
+
+    // hashes of the plain strings, filled as they are added or decoded
+    mutable std::unordered_multimap<std::size_t, std::uint32_t> index_;
+
+    mutable decode_mutex decode_mutex_;
+
+    // shared so that copying a workbook doesn't copy the part
+    std::shared_ptr<const std::string> xml_;
+    std::string prefix_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,513 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <cstdlib>
+#include <cstring>
+
+#include <detail/sheet_data_scanner.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+namespace {
+
+bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool starts_with(const char *first, const char *last, const char *prefix)
+{
+    const auto length = std::strlen(prefix);
+    return static_cast<std::size_t>(last - first) >= length && std::memcmp(first, prefix, length) == 0;
+}
+
+/// <summary>
+/// Return the first occurrence of string in [first, last) or last if there is none.
+/// </summary>
+const char *search(const char *first, const char *last, const char *string)
+{
+    const auto length = std::strlen(string);
+
+    while (static_cast<std::size_t>(last - first) >= length)
+    {
+        auto candidate = static_cast<const char *>(std::memchr(first, string[0],
+            static_cast<std::size_t>(last - first) - length + 1));
+
+        if (candidate == nullptr) break;
+        if (std::memcmp(candidate, string, length) == 0) return candidate;
+
+        first = candidate + 1;
+    }
+
+    return last;
+}
+
+void append_utf8(std::uint32_t code_point, std::string &destination)
+{
+    if (code_point < 0x80)
+    {
+        destination.push_back(static_cast<char>(code_point));
+    }
+    else if (code_point < 0x800)
+    {
+        destination.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        destination.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+    else if (code_point < 0x10000)
+    {
+        destination.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        destination.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        destination.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+    else
+    {
+        destination.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        destination.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        destination.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        destination.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+std::string decode_character_data(const char *first, const char *last)
+{
+    std::string result;
+    result.reserve(static_cast<std::size_t>(last - first));
+
+    while (first < last)
+    {
+        const auto c = *first;
+
+        if (c == '\r')
+        {
+            result.push_back('\n');
+            first += first + 1 < last && first[1] == '\n' ? 2 : 1;
+        }
+        else if (c == '<' && starts_with(first, last, "<![CDATA["))
+        {
+            const auto content_end = search(first + 9, last, "]]>");
+            result.append(first + 9, content_end);
+            first = content_end == last ? last : content_end + 3;
+        }
+        else if (c == '<' && starts_with(first, last, "<!--"))
+        {
+            const auto comment_end = search(first + 4, last, "-->");
+            first = comment_end == last ? last : comment_end + 3;
+        }
+        else if (c == '&')
+        {
+            const auto reference_end = static_cast<const char *>(std::memchr(first, ';', static_cast<std::size_t>(last - first)));
+
+            if (reference_end == nullptr)
+            {
+                throw invalid_file("unterminated reference");
+            }
+
+            const std::string reference(first + 1, reference_end);
+            first = reference_end + 1;
+
+            if (reference == "amp") result.push_back('&');
+            else if (reference == "lt") result.push_back('<');
+            else if (reference == "gt") result.push_back('>');
+            else if (reference == "quot") result.push_back('"');
+            else if (reference == "apos") result.push_back('\'');
+            else if (reference.size() > 1 && reference[0] == '#')
+            {
+                const auto hex = reference[1] == 'x';
+                append_utf8(static_cast<std::uint32_t>(std::strtoul(reference.c_str() + (hex ? 2 : 1), nullptr, hex ? 16 : 10)), result);
+            }
+            else
+            {
+                throw invalid_file("unknown entity: " + reference);
+            }
+        }
+        else
+        {
+            result.push_back(c);
+            ++first;
+        }
+    }
+
+    return result;
+}
+
+bool sheet_data_scanner::characters::empty() const
+{
+    return first == last;
+}
+
+bool sheet_data_scanner::characters::equals(const char *string) const
+{
+    const auto length = std::strlen(string);
+    return static_cast<std::size_t>(last - first) == length && std::memcmp(first, string, length) == 0;
+}
+
+std::string sheet_data_scanner::characters::to_string() const
+{
+    return escaped ? decode_character_data(first, last) : std::string(first, last);
+}
+
+sheet_data_scanner::sheet_data_scanner(const char *first, const char *last)
+    : position_(first),
+      last_(last),
+      in_row_(false)
+{
+}
+
+template <typename Visitor>
+void sheet_data_scanner::visit_attributes(const tag &element, Visitor visit)
+{
+    auto position = element.attributes.first;
+    const auto last = element.attributes.last;
+
+    while (true)
+    {
+        while (position < last && is_space(*position)) ++position;
+        if (position >= last) return;
+
+        characters name;
+        name.first = position;
+
+        while (position < last && *position != '=' && !is_space(*position)) ++position;
+
+        name.last = position;
+
+        while (position < last && *position != '"' && *position != '\'') ++position;
+        if (position >= last) return;
+
+        characters value;
+        value.first = position + 1;
+        value.last = static_cast<const char *>(std::memchr(value.first, *position, static_cast<std::size_t>(last - value.first)));
+
+        if (value.last == nullptr)
+        {
+            throw invalid_file("unterminated attribute in sheetData");
+        }
+
+        value.escaped = std::memchr(value.first, '&', static_cast<std::size_t>(value.last - value.first)) != nullptr;
+        visit(name, value);
+        position = value.last + 1;
+    }
+}
+
+bool sheet_data_scanner::next_row(row_record &row)
+{
+    tag current;
+
+    if (in_row_)
+    {
+        current.kind = tag_kind::start;
+        skip_element(current);
+        in_row_ = false;
+    }
+
+    while (next_tag(current))
+    {
+        if (current.kind == tag_kind::end) continue;
+
+        if (!current.name.equals("row"))
+        {
+            skip_element(current);
+            continue;
+        }
+
+        row.index = 0;
+        row.height = characters();
+
+        visit_attributes(current, [&row](const characters &name, const characters &value) {
+            if (name.equals("r"))
+            {
+                row.index = static_cast<row_t>(std::strtoul(value.first, nullptr, 10));
+            }
+            else if (name.equals("ht"))
+            {
+                row.height = value;
+            }
+        });
+
+        in_row_ = current.kind == tag_kind::start;
+
+        return true;
+    }
+
+    return false;
+}
+
+bool sheet_data_scanner::next_cell(cell_record &cell)
+{
+    if (!in_row_) return false;
+
+    tag current;
+
+    while (next_tag(current))
+    {
+        if (current.kind == tag_kind::end)
+        {
+            // end of the row
+            in_row_ = false;
+            return false;
+        }
+
+        if (!current.name.equals("c"))
+        {
+            skip_element(current);
+            continue;
+        }
+
+        cell.reference = characters();
+        cell.type = characters();
+        cell.style = characters();
+        cell.has_value = false;
+        cell.value = characters();
+        cell.has_formula = false;
+        cell.formula = characters();
+        cell.formula_type = characters();
+        cell.has_inline_string = false;
+
+        visit_attributes(current, [&cell](const characters &name, const characters &value) {
+            if (name.equals("r")) cell.reference = value;
+            else if (name.equals("t")) cell.type = value;
+            else if (name.equals("s")) cell.style = value;
+        });
+
+        if (current.kind == tag_kind::empty) return true;
+
+        tag child;
+
+        while (next_tag(child) && child.kind != tag_kind::end)
+        {
+            if (child.name.equals("v"))
+            {
+                cell.has_value = true;
+                cell.value = child.kind == tag_kind::start ? read_characters() : characters();
+            }
+            else if (child.name.equals("f"))
+            {
+                cell.has_formula = true;
+
+                visit_attributes(child, [&cell](const characters &name, const characters &value) {
+                    if (name.equals("t")) cell.formula_type = value;
+                });
+
+                cell.formula = child.kind == tag_kind::start ? read_characters() : characters();
+            }
+            else if (child.name.equals("is"))
+            {
+                cell.has_inline_string = true;
+                cell.inline_string.clear();
+
+                if (child.kind == tag_kind::start)
+                {
+                    read_inline_string(cell.inline_string);
+                }
+            }
+            else
+            {
+                skip_element(child);
+            }
+        }
+
+        return true;
+    }
+
+    in_row_ = false;
+
+    return false;
+}
+
+bool sheet_data_scanner::next_tag(tag &result)
+{
+    while (position_ < last_)
+    {
+        auto open = static_cast<const char *>(std::memchr(position_, '<', static_cast<std::size_t>(last_ - position_)));
+
+        if (open == nullptr || open + 1 == last_)
+        {
+            break;
+        }
+
+        if (open[1] == '!' || open[1] == '?')
+        {
+            // comments, CDATA sections and processing instructions
+            const auto terminator = starts_with(open, last_, "<!--") ? "-->"
+                : starts_with(open, last_, "<![CDATA[") ? "]]>" : open[1] == '?' ? "?>" : ">";
+            const auto found = search(open + 2, last_, terminator);
+            position_ = found == last_ ? last_ : found + std::strlen(terminator);
+
+            continue;
+        }
+
+        auto name_first = open + (open[1] == '/' ? 2 : 1);
+        auto name_last = name_first;
+
+        while (name_last < last_ && !is_space(*name_last) && *name_last != '>' && *name_last != '/')
+        {
+            if (*name_last == ':') name_first = name_last + 1;
+            ++name_last;
+        }
+
+        // find the end of the tag, skipping over quoted attribute values which may contain '>'
+        auto close = name_last;
+
+        while (close < last_ && *close != '>')
+        {
+            if (*close == '"' || *close == '\'')
+            {
+                auto quote_end = static_cast<const char *>(std::memchr(close + 1, *close, static_cast<std::size_t>(last_ - close - 1)));
+                close = quote_end == nullptr ? last_ : quote_end;
+            }
+
+            ++close;
+        }
+
+        if (close == last_)
+        {
+            throw invalid_file("unterminated tag in sheetData");
+        }
+
+        result.name.first = name_first;
+        result.name.last = name_last;
+        result.attributes.first = name_last;
+        result.attributes.last = close;
+
+        if (open[1] == '/')
+        {
+            result.kind = tag_kind::end;
+        }
+        else if (close[-1] == '/')
+        {
+            result.kind = tag_kind::empty;
+            --result.attributes.last;
+        }
+        else
+        {
+            result.kind = tag_kind::start;
+        }
+
+        position_ = close + 1;
+
+        return true;
+    }
+
+    position_ = last_;
+
+    return false;
+}
+
+void sheet_data_scanner::skip_element(const tag &start)
+{
+    if (start.kind != tag_kind::start) return;
+
+    std::size_t depth = 1;
+    tag current;
+
+    while (depth > 0 && next_tag(current))
+    {
+        if (current.kind == tag_kind::start) ++depth;
+        else if (current.kind == tag_kind::end) --depth;
+    }
+}
+
+sheet_data_scanner::characters sheet_data_scanner::read_characters()
+{
+    characters result;
+    result.first = position_;
+
+    auto open = position_;
+
+    while (true)
+    {
+        open = static_cast<const char *>(std::memchr(open, '<', static_cast<std::size_t>(last_ - open)));
+
+        if (open == nullptr)
+        {
+            throw invalid_file("unterminated element in sheetData");
+        }
+
+        if (starts_with(open, last_, "<![CDATA["))
+        {
+            result.escaped = true;
+            open = search(open + 9, last_, "]]>");
+        }
+        else if (starts_with(open, last_, "<!--"))
+        {
+            result.escaped = true;
+            open = search(open + 4, last_, "-->");
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    result.last = open;
+
+    if (!result.escaped)
+    {
+        const auto length = static_cast<std::size_t>(result.last - result.first);
+        result.escaped = std::memchr(result.first, '&', length) != nullptr
+            || std::memchr(result.first, '\r', length) != nullptr;
+    }
+
+    // consume the end tag
+    position_ = open;
+    tag end;
+    next_tag(end);
+
+    return result;
+}
+
+void sheet_data_scanner::read_inline_string(std::string &destination)
+{
+    // the text of every t element in the is element, which may be split into formatted runs
+    tag current;
+
+    while (next_tag(current) && current.kind != tag_kind::end)
+    {
+        if (current.name.equals("t"))
+        {
+            if (current.kind == tag_kind::start)
+            {
+                const auto text = read_characters();
+                destination.append(text.to_string());
+            }
+        }
+        else if (current.name.equals("r"))
+        {
+            if (current.kind == tag_kind::start)
+            {
+                read_inline_string(destination);
+            }
+        }
+        else
+        {
+            skip_element(current);
+        }
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
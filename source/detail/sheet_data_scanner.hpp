@@ -0,0 +1,132 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <xlnt/cell/index_types.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Return the text of the character data between first and last with entity and
+/// character references replaced, line endings normalized and CDATA sections unwrapped.
+/// </summary>
+std::string decode_character_data(const char *first, const char *last);
+
+/// <summary>
+/// Reads the rows and cells in the content of a sheetData element directly from
+/// the text of a worksheet part. This is much faster than going through the events
+/// of a general XML parser because the text is only searched for the few elements
+/// that can appear there and values are returned as ranges of the text instead of
+/// strings. Any other element is skipped along with its content.
+/// </summary>
+class sheet_data_scanner
+{
+public:
+    /// <summary>
+    /// A range of the text. escaped is true if it contains references,
+    /// carriage returns or CDATA sections and so has to be decoded before use.
+    /// </summary>
+    struct characters
+    {
+        const char *first = nullptr;
+        const char *last = nullptr;
+        bool escaped = false;
+
+        bool empty() const;
+        bool equals(const char *string) const;
+        std::string to_string() const;
+    };
+
+    struct row_record
+    {
+        // 0 if the row has no r attribute
+        row_t index;
+        characters height;
+    };
+
+    struct cell_record
+    {
+        characters reference;
+        characters type;
+        characters style;
+
+        bool has_value;
+        characters value;
+
+        bool has_formula;
+        characters formula;
+        characters formula_type;
+
+        bool has_inline_string;
+        std::string inline_string;
+    };
+
+    sheet_data_scanner(const char *first, const char *last);
+
+    /// <summary>
+    /// Advance to the next row, skipping the cells of the current one that weren't read.
+    /// Returns false if there are no more rows.
+    /// </summary>
+    bool next_row(row_record &row);
+
+    /// <summary>
+    /// Read the next cell of the current row. Returns false after its last cell.
+    /// </summary>
+    bool next_cell(cell_record &cell);
+
+private:
+    enum class tag_kind
+    {
+        start,
+        end,
+        empty
+    };
+
+    struct tag
+    {
+        tag_kind kind;
+        // the name without its namespace prefix
+        characters name;
+        characters attributes;
+    };
+
+    bool next_tag(tag &result);
+    void skip_element(const tag &start);
+    characters read_characters();
+    void read_inline_string(std::string &destination);
+
+    template <typename Visitor>
+    void visit_attributes(const tag &element, Visitor visit);
+
+    const char *position_;
+    const char *last_;
+    bool in_row_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,189 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <clocale>
+#include <cstdio>
+#include <cstring>
+
+#include <detail/sheet_data_writer.hpp>
+
+namespace {
+
+bool needs_escape(char c, bool in_attribute)
+{
+    switch (c)
+    {
+    case '&':
+    case '<':
+    case '>':
+    case '\r':
+        return true;
+    case '"':
+    case '\n':
+    case '\t':
+        return in_attribute;
+    default:
+        return false;
+    }
+}
+
+const char *escape(char c)
+{
+    switch (c)
+    {
+    case '&': return "&amp;";
+    case '<': return "&lt;";
+    case '>': return "&gt;";
+    case '"': return "&quot;";
+    case '\r': return "&#xD;";
+    case '\n': return "&#xA;";
+    case '\t': return "&#x9;";
+    default: return "";
+    }
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+sheet_data_writer::sheet_data_writer(std::ostream &destination, std::size_t buffer_size)
+    : destination_(destination),
+      buffer_size_(buffer_size)
+{
+    buffer_.reserve(buffer_size_ + 64);
+}
+
+void sheet_data_writer::append(const char *fragment)
+{
+    append(fragment, std::strlen(fragment));
+}
+
+void sheet_data_writer::append(const char *data, std::size_t size)
+{
+    reserve(size);
+    buffer_.append(data, size);
+}
+
+void sheet_data_writer::append_integer(long long value)
+{
+    if (value < 0)
+    {
+        append("-", 1);
+        // negate in unsigned arithmetic so that the smallest long long works too
+        append_unsigned(0ULL - static_cast<unsigned long long>(value));
+    }
+    else
+    {
+        append_unsigned(static_cast<unsigned long long>(value));
+    }
+}
+
+void sheet_data_writer::append_unsigned(unsigned long long value)
+{
+    char digits[20];
+    auto position = sizeof(digits);
+
+    do
+    {
+        digits[--position] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    append(digits + position, sizeof(digits) - position);
+}
+
+void sheet_data_writer::append_double(double value)
+{
+    // the same text as a stream with precision max_digits10 would produce
+    char text[32];
+    auto size = static_cast<std::size_t>(std::snprintf(text, sizeof(text), "%.17g", value));
+
+    // snprintf uses the decimal point of LC_NUMERIC but files always use '.'
+    const auto point = std::localeconv()->decimal_point;
+
+    if (point[0] != '.' || point[1] != '\0')
+    {
+        const auto point_size = std::strlen(point);
+        auto position = std::strstr(text, point);
+
+        if (point_size > 0 && position != nullptr)
+        {
+            *position = '.';
+            std::memmove(position + 1, position + point_size, text + size - (position + point_size));
+            size -= point_size - 1;
+        }
+    }
+
+    append(text, size);
+}
+
+void sheet_data_writer::append_reference(column_t::index_t column, row_t row)
+{
+    char letters[8];
+    auto position = sizeof(letters);
+
+    while (column > 0)
+    {
+        const auto remainder = (column - 1) % 26;
+        letters[--position] = static_cast<char>('A' + remainder);
+        column = (column - 1) / 26;
+    }
+
+    append(letters + position, sizeof(letters) - position);
+    append_unsigned(row);
+}
+
+void sheet_data_writer::append_escaped(const std::string &text, bool in_attribute)
+{
+    auto first = text.data();
+    const auto last = first + text.size();
+
+    for (auto current = first; current != last; ++current)
+    {
+        if (!needs_escape(*current, in_attribute)) continue;
+
+        append(first, static_cast<std::size_t>(current - first));
+        append(escape(*current));
+        first = current + 1;
+    }
+
+    append(first, static_cast<std::size_t>(last - first));
+}
+
+void sheet_data_writer::flush()
+{
+    destination_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+}
+
+void sheet_data_writer::reserve(std::size_t size)
+{
+    if (buffer_.size() + size > buffer_size_ && !buffer_.empty())
+    {
+        flush();
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
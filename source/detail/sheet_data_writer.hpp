@@ -0,0 +1,88 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include <xlnt/cell/index_types.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Writes the content of a sheetData element straight into the stream of a
+/// worksheet part. Tags are appended as pre-encoded fragments and numbers are
+/// formatted in place into a buffer that is written out whenever it fills up,
+/// so no per-cell strings are built and nothing goes through the namespace
+/// handling of a general XML serializer. Text is only escaped when it contains
+/// a character that needs it.
+/// </summary>
+class sheet_data_writer
+{
+public:
+    explicit sheet_data_writer(std::ostream &destination, std::size_t buffer_size = 1 << 16);
+
+    /// <summary>
+    /// Append a fragment that is already valid XML.
+    /// </summary>
+    void append(const char *fragment);
+    void append(const char *data, std::size_t size);
+
+    void append_integer(long long value);
+    void append_unsigned(unsigned long long value);
+
+    /// <summary>
+    /// Append value with enough digits to be read back exactly.
+    /// </summary>
+    void append_double(double value);
+
+    /// <summary>
+    /// Append a cell reference like "AB12".
+    /// </summary>
+    void append_reference(column_t::index_t column, row_t row);
+
+    /// <summary>
+    /// Append text as character data or, if in_attribute is true, as the value
+    /// of an attribute delimited by double quotes.
+    /// </summary>
+    void append_escaped(const std::string &text, bool in_attribute = false);
+
+    /// <summary>
+    /// Write everything appended so far to the destination. Must be called before
+    /// anything else is written to it.
+    /// </summary>
+    void flush();
+
+private:
+    void reserve(std::size_t size);
+
+    std::ostream &destination_;
+    std::string buffer_;
+    std::size_t buffer_size_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,103 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#include <iterator>
+
+#include <detail/static_part_cache.hpp>
+
+namespace xlnt {
+namespace detail {
+
+const std::size_t static_part_cache::max_entries;
+
+static_part_cache &static_part_cache::instance()
+{
+    static static_part_cache cache;
+    return cache;
+}
+
+std::shared_ptr<const compressed_file> static_part_cache::get(const std::string &content)
+{
+    const auto hash = std::hash<std::string>()(content);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto match = find(hash, content);
+
+        if (match != entries_.end())
+        {
+            return match->compressed;
+        }
+    }
+
+    // compress without holding the lock so other saves aren't held up
+    auto compressed = std::make_shared<const compressed_file>(zip_file::precompress(content));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // another thread may have cached the same part in the meantime
+    if (find(hash, content) != entries_.end())
+    {
+        return compressed;
+    }
+
+    if (entries_.size() >= max_entries)
+    {
+        auto oldest = std::prev(entries_.end());
+        auto range = index_.equal_range(oldest->hash);
+
+        for (auto i = range.first; i != range.second; ++i)
+        {
+            if (i->second == oldest)
+            {
+                index_.erase(i);
+                break;
+            }
+        }
+
+        entries_.erase(oldest);
+    }
+
+    entries_.push_front(entry{ hash, content, compressed });
+    index_.emplace(hash, entries_.begin());
+
+    return compressed;
+}
+
+std::list<static_part_cache::entry>::iterator static_part_cache::find(std::size_t hash, const std::string &content)
+{
+    auto range = index_.equal_range(hash);
+
+    for (auto i = range.first; i != range.second; ++i)
+    {
+        if (i->second->content == content)
+        {
+            entries_.splice(entries_.begin(), entries_, i->second);
+            return i->second;
+        }
+    }
+
+    return entries_.end();
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,87 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <xlnt/xlnt_config.hpp>
+#include <xlnt/packaging/zip_file.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Deflated copies of parts that come out the same in most saved workbooks,
+/// such as the default theme and thumbnail. Each is compressed once per process
+/// and then copied into every archive. Parts are found by the hash of their
+/// content and compared in full, so a custom thumbnail is never mistaken for a
+/// cached one. Once max_entries parts are cached, the least recently used one
+/// is dropped for a new part, so custom parts seen early don't keep the
+/// default ones out.
+/// </summary>
+class XLNT_CLASS static_part_cache
+{
+public:
+    /// <summary>
+    /// The cache shared by every save in the process.
+    /// </summary>
+    static static_part_cache &instance();
+
+    /// <summary>
+    /// Return content deflated by zip_file::precompress, compressing it first if
+    /// it isn't cached yet.
+    /// </summary>
+    std::shared_ptr<const compressed_file> get(const std::string &content);
+
+    /// <summary>
+    /// The most parts that are kept.
+    /// </summary>
+    static const std::size_t max_entries = 8;
+
+private:
+    struct entry
+    {
+        std::size_t hash;
+        std::string content;
+        std::shared_ptr<const compressed_file> compressed;
+    };
+
+    /// <summary>
+    /// Return the cached entry with content or entries_.end(), moving it to the front.
+    /// </summary>
+    std::list<entry>::iterator find(std::size_t hash, const std::string &content);
+
+    std::mutex mutex_;
+
+    // most recently used first
+    std::list<entry> entries_;
+    std::unordered_multimap<std::size_t, std::list<entry>::iterator> index_;
+};
+
+} // namespace detail
+} // namespace xlnt
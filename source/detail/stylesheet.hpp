@@ -38,10 +38,58 @@ namespace detail {
 
 struct stylesheet
 {
+    stylesheet()
+    {
+    }
+
+    stylesheet(const stylesheet &other)
+    {
+        *this = other;
+    }
+
     ~stylesheet() 
 	{
 	}
 
+    /// <summary>
+    /// Copy every record of other. The formats and styles are pointed at the
+    /// copied records instead of those of other.
+    /// </summary>
+    stylesheet &operator=(const stylesheet &other)
+    {
+        if (this == &other) return *this;
+
+        format_impls = other.format_impls;
+        formats = other.formats;
+        auto format_iter = formats.begin();
+
+        for (auto &impl : format_impls)
+        {
+            impl.parent = this;
+            (format_iter++)->d_ = &impl;
+        }
+
+        style_impls = other.style_impls;
+        styles = other.styles;
+        auto style_iter = styles.begin();
+
+        for (auto &impl : style_impls)
+        {
+            impl.parent = this;
+            (style_iter++)->d_ = &impl;
+        }
+
+        alignments = other.alignments;
+        borders = other.borders;
+        fills = other.fills;
+        fonts = other.fonts;
+        number_formats = other.number_formats;
+        protections = other.protections;
+        colors = other.colors;
+
+        return *this;
+    }
+
     format &create_format()
     {
 		format_impls.push_back(format_impl());
@@ -0,0 +1,221 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+
+#include <detail/thread_pool.hpp>
+
+namespace xlnt {
+namespace detail {
+
+thread_pool::thread_pool(std::size_t thread_count)
+    : generation_(0),
+      active_(0),
+      stopping_(false),
+      body_(nullptr),
+      remaining_(0)
+{
+    thread_count = std::max(thread_count, std::size_t(1));
+
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        queues_.emplace_back(new work_queue());
+    }
+
+    for (std::size_t i = 1; i < thread_count; ++i)
+    {
+        threads_.emplace_back(&thread_pool::run, this, i);
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    wake_.notify_all();
+
+    for (auto &thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+std::size_t thread_pool::size() const
+{
+    return queues_.size();
+}
+
+void thread_pool::parallel_for(std::size_t count, std::size_t grain,
+    const std::function<void(std::size_t, std::size_t)> &body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grain = std::max(grain, std::size_t(1));
+    auto chunk_count = (count + grain - 1) / grain;
+
+    if (threads_.empty() || chunk_count == 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    // Give each worker a contiguous block of chunks so that neighbouring
+    // indices, which tend to touch neighbouring data, stay on one thread.
+    auto workers = queues_.size();
+
+    for (std::size_t worker = 0; worker < workers; ++worker)
+    {
+        auto first = chunk_count * worker / workers;
+        auto last = chunk_count * (worker + 1) / workers;
+
+        std::lock_guard<std::mutex> lock(queues_[worker]->mutex);
+
+        for (auto i = first; i < last; ++i)
+        {
+            queues_[worker]->chunks.emplace_back(i * grain, std::min(count, (i + 1) * grain));
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        body_ = &body;
+        remaining_ = chunk_count;
+        error_ = nullptr;
+        active_ = threads_.size();
+        ++generation_;
+    }
+
+    wake_.notify_all();
+    work(0);
+
+    std::exception_ptr error;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return active_ == 0; });
+        body_ = nullptr;
+        std::swap(error, error_);
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void thread_pool::run(std::size_t index)
+{
+    std::size_t seen = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return stopping_ || generation_ != seen; });
+
+            if (stopping_)
+            {
+                return;
+            }
+
+            seen = generation_;
+        }
+
+        work(index);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (--active_ == 0)
+        {
+            done_.notify_all();
+        }
+    }
+}
+
+void thread_pool::work(std::size_t index)
+{
+    chunk next;
+
+    while (remaining_ > 0 && (pop(index, next) || steal(index, next)))
+    {
+        try
+        {
+            (*body_)(next.first, next.second);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (!error_)
+            {
+                error_ = std::current_exception();
+            }
+        }
+
+        --remaining_;
+    }
+}
+
+bool thread_pool::pop(std::size_t index, chunk &result)
+{
+    auto &queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.chunks.empty())
+    {
+        return false;
+    }
+
+    result = queue.chunks.front();
+    queue.chunks.pop_front();
+
+    return true;
+}
+
+bool thread_pool::steal(std::size_t thief, chunk &result)
+{
+    for (std::size_t offset = 1; offset < queues_.size(); ++offset)
+    {
+        auto &victim = *queues_[(thief + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.chunks.empty())
+        {
+            result = victim.chunks.back();
+            victim.chunks.pop_back();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace detail
+} // namespace xlnt
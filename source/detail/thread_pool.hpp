@@ -0,0 +1,102 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// A fixed set of worker threads that run loops in parallel. Each parallel_for
+/// splits its index space into chunks which are dealt out to per-worker queues.
+/// A worker drains its own queue from the front and, once that is empty, steals
+/// from the back of the other queues so that uneven chunks don't leave threads idle.
+/// The calling thread takes part as worker 0.
+/// </summary>
+class thread_pool
+{
+public:
+    /// <summary>
+    /// Create a pool that runs loops on thread_count threads including the caller.
+    /// </summary>
+    explicit thread_pool(std::size_t thread_count);
+    ~thread_pool();
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    /// <summary>
+    /// The number of threads, including the calling thread, used by parallel_for.
+    /// </summary>
+    std::size_t size() const;
+
+    /// <summary>
+    /// Call body(begin, end) for consecutive subranges of [0, count) of at most
+    /// grain indices each and wait for all of them to finish. The first exception
+    /// thrown by body is rethrown once every chunk has been processed.
+    /// </summary>
+    void parallel_for(std::size_t count, std::size_t grain,
+        const std::function<void(std::size_t, std::size_t)> &body);
+
+private:
+    using chunk = std::pair<std::size_t, std::size_t>;
+
+    struct work_queue
+    {
+        std::mutex mutex;
+        std::deque<chunk> chunks;
+    };
+
+    void run(std::size_t index);
+    void work(std::size_t index);
+    bool pop(std::size_t index, chunk &result);
+    bool steal(std::size_t thief, chunk &result);
+
+    std::vector<std::unique_ptr<work_queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::size_t generation_;
+    std::size_t active_;
+    bool stopping_;
+
+    const std::function<void(std::size_t, std::size_t)> *body_;
+    std::atomic<std::size_t> remaining_;
+    std::exception_ptr error_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -22,14 +22,21 @@
 // @author: see AUTHORS file
 #pragma once
 
-#include <list>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <detail/calculation_chain.hpp>
+#include <detail/copy_on_write.hpp>
+#include <detail/formula_engine.hpp>
+#include <detail/shared_string_table.hpp>
 #include <detail/stylesheet.hpp>
 #include <detail/worksheet_impl.hpp>
+#include <detail/worksheet_registry.hpp>
 #include <xlnt/packaging/manifest.hpp>
+#include <xlnt/workbook/calculation_properties.hpp>
+#include <xlnt/workbook/load_options.hpp>
 #include <xlnt/utils/datetime.hpp>
 #include <xlnt/workbook/theme.hpp>
 #include <xlnt/workbook/workbook_view.hpp>
@@ -46,8 +53,12 @@ struct workbook_impl
 {
 	workbook_impl()
 		: active_sheet_index_(0),
+		shared_strings_(std::make_shared<shared_string_table>()),
 		guess_types_(false),
 		data_only_(false),
+		lazy_loading_(false),
+		read_deferred_worksheet_(nullptr),
+		stylesheet_(std::make_shared<stylesheet>()),
 		has_theme_(false),
 		write_core_properties_(false),
 		created_(xlnt::datetime::now()),
@@ -79,10 +90,16 @@ struct workbook_impl
           shared_strings_(other.shared_strings_),
           guess_types_(other.guess_types_),
           data_only_(other.data_only_),
+          lazy_loading_(other.lazy_loading_),
+          read_deferred_worksheet_(other.read_deferred_worksheet_),
           stylesheet_(other.stylesheet_),
+          load_options_(other.load_options_),
+          unread_stylesheet_archive_(other.unread_stylesheet_archive_),
+          unread_stylesheet_part_(other.unread_stylesheet_part_),
           manifest_(other.manifest_),
 		  has_theme_(other.has_theme_),
 		  theme_(other.theme_),
+		  thumbnail_(other.thumbnail_),
 		  write_core_properties_(other.write_core_properties_),
 		  creator_(other.creator_),
 		  last_modified_by_(other.last_modified_by_),
@@ -103,7 +120,6 @@ struct workbook_impl
 		  shared_doc_(other.shared_doc_),
 		  hyperlinks_changed_(other.hyperlinks_changed_),
 		  app_version_(other.app_version_),
-		  sheet_title_rel_id_map_(other.sheet_title_rel_id_map_),
 		  x15_(other.x15_),
 		  has_properties_(other.has_properties_),
 		  has_absolute_path_(other.has_absolute_path_),
@@ -115,22 +131,30 @@ struct workbook_impl
 		  has_file_version_(other.has_file_version_),
 		  file_version_(other.file_version_),
 		  has_calculation_properties_(other.has_calculation_properties_),
+		  calculation_properties_(other.calculation_properties_),
 		  has_arch_id_(other.has_arch_id_),
-		  short_bools_(other.short_bools_)
+		  short_bools_(other.short_bools_),
+		  formulas_(other.formulas_),
+		  calculation_chain_(other.calculation_chain_)
     {
     }
 
     workbook_impl &operator=(const workbook_impl &other)
     {
         active_sheet_index_ = other.active_sheet_index_;
-        worksheets_.clear();
-        std::copy(other.worksheets_.begin(), other.worksheets_.end(), back_inserter(worksheets_));
-        shared_strings_.clear();
-        std::copy(other.shared_strings_.begin(), other.shared_strings_.end(), std::back_inserter(shared_strings_));
+        worksheets_ = other.worksheets_;
+        shared_strings_ = other.shared_strings_;
         guess_types_ = other.guess_types_;
         data_only_ = other.data_only_;
+        lazy_loading_ = other.lazy_loading_;
+        read_deferred_worksheet_ = other.read_deferred_worksheet_;
+        stylesheet_ = other.stylesheet_;
+        load_options_ = other.load_options_;
+        unread_stylesheet_archive_ = other.unread_stylesheet_archive_;
+        unread_stylesheet_part_ = other.unread_stylesheet_part_;
 		has_theme_ = other.has_theme_;
 		theme_ = other.theme_;
+		thumbnail_ = other.thumbnail_;
         manifest_ = other.manifest_;
 
 		write_core_properties_ = other.write_core_properties_;
@@ -155,8 +179,6 @@ struct workbook_impl
 		hyperlinks_changed_ = other.hyperlinks_changed_;
 		app_version_ = other.app_version_;
 
-		sheet_title_rel_id_map_ = other.sheet_title_rel_id_map_;
-
 		x15_ = other.x15_;
 		has_properties_ = other.has_properties_;
 		has_absolute_path_ = other.has_absolute_path_;
@@ -170,21 +192,54 @@ struct workbook_impl
 		file_version_ = other.file_version_;
 
 		has_calculation_properties_ = other.has_calculation_properties_;
+		calculation_properties_ = other.calculation_properties_;
 		has_arch_id_ = other.has_arch_id_;
 
 		short_bools_ = other.short_bools_;
 
+		formulas_ = other.formulas_;
+		calculation_chain_ = other.calculation_chain_;
+
         return *this;
     }
 
+    /// <summary>
+    /// Return the shared string table or the stylesheet for modification. Both are
+    /// shared with copies of the workbook, such as the snapshot written by
+    /// workbook::save_async, so they are copied first if a copy still uses them.
+    /// Formats and styles obtained before then still refer to the shared records.
+    /// </summary>
+    shared_string_table &mutable_shared_strings()
+    {
+        return copy_if_shared(shared_strings_);
+    }
+
+    stylesheet &mutable_stylesheet()
+    {
+        return copy_if_shared(stylesheet_);
+    }
+
     std::size_t active_sheet_index_;
-    std::list<worksheet_impl> worksheets_;
-    std::vector<text> shared_strings_;
+    worksheet_registry worksheets_;
+
+    // only read through these, see mutable_shared_strings and mutable_stylesheet
+    std::shared_ptr<shared_string_table> shared_strings_;
 
     bool guess_types_;
     bool data_only_;
+    bool lazy_loading_;
+
+    // Parses a lazily loaded worksheet. Set by the reader which deferred it so that
+    // neither worksheets nor the formula engine depend on the reader.
+    void (*read_deferred_worksheet_)(worksheet_impl &);
+
+    std::shared_ptr<stylesheet> stylesheet_;
 
-    stylesheet stylesheet_;
+    load_options load_options_;
+
+    // the still compressed stylesheet of a file loaded with load_options::skip_styles
+    std::shared_ptr<zip_file> unread_stylesheet_archive_;
+    path unread_stylesheet_part_;
     
     manifest manifest_;
 	bool has_theme_;
@@ -217,8 +272,6 @@ struct workbook_impl
 	bool hyperlinks_changed_;
 	std::string app_version_;
 
-	std::unordered_map<std::string, std::string> sheet_title_rel_id_map_;
-
 	bool x15_;
 	bool has_properties_;
 	bool has_absolute_path_;
@@ -238,9 +291,13 @@ struct workbook_impl
 	} file_version_;
 
 	bool has_calculation_properties_;
+	calculation_properties calculation_properties_;
 	bool has_arch_id_;
 
 	bool short_bools_;
+
+	formula_engine formulas_;
+	calculation_chain calculation_chain_;
 };
 
 } // namespace detail
@@ -22,10 +22,13 @@
 // @author: see AUTHORS file
 #pragma once
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <xlnt/packaging/zip_file.hpp>
+#include <xlnt/utils/path.hpp>
 #include <xlnt/workbook/named_range.hpp>
 #include <xlnt/worksheet/range.hpp>
 #include <xlnt/worksheet/range_reference.hpp>
@@ -33,7 +36,8 @@
 #include <xlnt/worksheet/column_properties.hpp>
 #include <xlnt/worksheet/row_properties.hpp>
 
-#include <detail/cell_impl.hpp>
+#include <detail/cell_store.hpp>
+#include <detail/merged_cell_index.hpp>
 
 namespace xlnt {
 
@@ -64,13 +68,6 @@ struct worksheet_impl
         column_properties_ = other.column_properties_;
         row_properties_ = other.row_properties_;
         cell_map_ = other.cell_map_;
-        for (auto &row : cell_map_)
-        {
-            for (auto &cell : row.second)
-            {
-                cell.second.parent_ = this;
-            }
-        }
         relationships_ = other.relationships_;
 		has_page_setup_ = other.has_page_setup_;
         page_setup_ = other.page_setup_;
@@ -88,21 +85,42 @@ struct worksheet_impl
 		x14ac_ = other.x14ac_;
 		has_dimension_ = other.has_dimension_;
 		has_format_properties_ = other.has_format_properties_;
+        deferred_archive_ = other.deferred_archive_;
+        deferred_part_ = other.deferred_part_;
     }
 
+    /// <summary>
+    /// Returns true if this worksheet was lazily loaded and its part hasn't been parsed yet.
+    /// </summary>
+    bool is_deferred() const
+    {
+        return deferred_archive_ != nullptr;
+    }
+
+    /// <summary>
+    /// Parse the part of a lazily loaded worksheet. Called before the cells, rows,
+    /// ranges or properties of the worksheet are accessed.
+    /// </summary>
+    void parse_deferred();
+
     workbook *parent_;
     std::size_t id_;
     std::string title_;
     std::unordered_map<column_t, column_properties> column_properties_;
     std::unordered_map<row_t, row_properties> row_properties_;
-    std::unordered_map<row_t, std::unordered_map<column_t, cell_impl>> cell_map_;
+
+    /// <summary>
+    /// Shared with the copies of this worksheet until either side modifies a block of rows.
+    /// </summary>
+    cell_store cell_map_;
+
     std::vector<relationship> relationships_;
 	bool has_page_setup_ = false;
     page_setup page_setup_;
     range_reference auto_filter_;
 	bool has_page_margins_ = false;
     page_margins page_margins_;
-    std::vector<range_reference> merged_cells_;
+    merged_cell_index merged_cells_;
     std::unordered_map<std::string, named_range> named_ranges_;
     std::size_t comment_count_;
     header_footer header_footer_;
@@ -114,6 +132,14 @@ struct worksheet_impl
 	bool x14ac_ = false;
 	bool has_dimension_ = false;
 	bool has_format_properties_ = false;
+
+    /// <summary>
+    /// The archive holding the still compressed part of a lazily loaded worksheet.
+    /// Shared with the other worksheets loaded from the same file and released
+    /// once the part has been parsed.
+    /// </summary>
+    std::shared_ptr<zip_file> deferred_archive_;
+    path deferred_part_;
 };
 
 } // namespace detail
@@ -0,0 +1,54 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#pragma once
+
+#include <cstddef>
+
+#include <xlnt/xlnt_config.hpp>
+
+namespace xlnt {
+
+class worksheet;
+
+namespace detail {
+
+/// <summary>
+/// Exposes the internal state of a worksheet to the tests.
+/// </summary>
+class XLNT_CLASS worksheet_inspector
+{
+public:
+    /// <summary>
+    /// Return the number of cells of ws whose memory is still shared with a copy of
+    /// the workbook, such as the snapshot written by workbook::save_async.
+    /// </summary>
+    static std::size_t shared_cells(const worksheet &ws);
+
+    /// <summary>
+    /// Return true if ws was lazily loaded and its part hasn't been parsed yet.
+    /// </summary>
+    static bool is_deferred(const worksheet &ws);
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,321 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+
+#include <detail/worksheet_impl.hpp>
+#include <detail/worksheet_registry.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+namespace xlnt {
+namespace detail {
+
+worksheet_registry::worksheet_registry()
+{
+}
+
+worksheet_registry::worksheet_registry(const worksheet_registry &other)
+{
+    *this = other;
+}
+
+worksheet_registry &worksheet_registry::operator=(const worksheet_registry &other)
+{
+    if (this == &other) return *this;
+
+    clear();
+    slots_.reserve(other.slots_.size());
+
+    for (const auto &entry : other.slots_)
+    {
+        slots_.push_back(slot{ std::unique_ptr<worksheet_impl>(new worksheet_impl(*entry.sheet)), entry.rel_id });
+        add_to_indices(slots_.size() - 1);
+    }
+
+    return *this;
+}
+
+worksheet_registry::~worksheet_registry()
+{
+}
+
+worksheet_registry::iterator worksheet_registry::begin()
+{
+    return iterator(slots_.data());
+}
+
+worksheet_registry::iterator worksheet_registry::end()
+{
+    return iterator(slots_.data() + slots_.size());
+}
+
+worksheet_registry::const_iterator worksheet_registry::begin() const
+{
+    return const_iterator(slots_.data());
+}
+
+worksheet_registry::const_iterator worksheet_registry::end() const
+{
+    return const_iterator(slots_.data() + slots_.size());
+}
+
+std::size_t worksheet_registry::size() const
+{
+    return slots_.size();
+}
+
+bool worksheet_registry::empty() const
+{
+    return slots_.empty();
+}
+
+worksheet_impl &worksheet_registry::at(std::size_t index)
+{
+    if (index >= slots_.size())
+    {
+        throw invalid_parameter();
+    }
+
+    return *slots_[index].sheet;
+}
+
+const worksheet_impl &worksheet_registry::at(std::size_t index) const
+{
+    if (index >= slots_.size())
+    {
+        throw invalid_parameter();
+    }
+
+    return *slots_[index].sheet;
+}
+
+worksheet_impl &worksheet_registry::back()
+{
+    return *slots_.back().sheet;
+}
+
+worksheet_impl &worksheet_registry::insert(std::size_t index, worksheet_impl &&sheet)
+{
+    if (index > slots_.size())
+    {
+        throw invalid_parameter();
+    }
+
+    auto stored = std::unique_ptr<worksheet_impl>(new worksheet_impl(std::move(sheet)));
+    slots_.insert(slots_.begin() + static_cast<std::ptrdiff_t>(index), slot{ std::move(stored), std::string() });
+    add_to_indices(index);
+    update_positions(index + 1, slots_.size());
+
+    return *slots_[index].sheet;
+}
+
+worksheet_impl &worksheet_registry::push_back(worksheet_impl &&sheet)
+{
+    return insert(slots_.size(), std::move(sheet));
+}
+
+void worksheet_registry::erase(std::size_t index)
+{
+    if (index >= slots_.size())
+    {
+        throw invalid_parameter();
+    }
+
+    remove_from_indices(slots_[index]);
+    slots_.erase(slots_.begin() + static_cast<std::ptrdiff_t>(index));
+    update_positions(index, slots_.size());
+}
+
+void worksheet_registry::move(std::size_t from, std::size_t to)
+{
+    if (from >= slots_.size() || to >= slots_.size())
+    {
+        throw invalid_parameter();
+    }
+
+    auto moved = std::move(slots_[from]);
+
+    if (from < to)
+    {
+        std::move(slots_.begin() + static_cast<std::ptrdiff_t>(from + 1),
+            slots_.begin() + static_cast<std::ptrdiff_t>(to + 1),
+            slots_.begin() + static_cast<std::ptrdiff_t>(from));
+        slots_[to] = std::move(moved);
+        update_positions(from, to + 1);
+    }
+    else if (to < from)
+    {
+        std::move_backward(slots_.begin() + static_cast<std::ptrdiff_t>(to),
+            slots_.begin() + static_cast<std::ptrdiff_t>(from),
+            slots_.begin() + static_cast<std::ptrdiff_t>(from + 1));
+        slots_[to] = std::move(moved);
+        update_positions(to, from + 1);
+    }
+    else
+    {
+        slots_[to] = std::move(moved);
+    }
+}
+
+void worksheet_registry::clear()
+{
+    slots_.clear();
+    titles_.clear();
+    ids_.clear();
+    rel_ids_.clear();
+    positions_.clear();
+}
+
+std::size_t worksheet_registry::index_of(const worksheet_impl &sheet) const
+{
+    auto match = positions_.find(&sheet);
+    return match == positions_.end() ? npos : match->second;
+}
+
+worksheet_impl *worksheet_registry::find_by_title(const std::string &title) const
+{
+    auto match = titles_.find(title);
+    return match == titles_.end() ? nullptr : match->second;
+}
+
+worksheet_impl *worksheet_registry::find_by_id(std::size_t id) const
+{
+    auto match = ids_.find(id);
+    return match == ids_.end() ? nullptr : match->second;
+}
+
+worksheet_impl *worksheet_registry::find_by_rel_id(const std::string &rel_id) const
+{
+    auto match = rel_ids_.find(rel_id);
+    return match == rel_ids_.end() ? nullptr : match->second;
+}
+
+void worksheet_registry::set_title(worksheet_impl &sheet, const std::string &title)
+{
+    auto match = titles_.find(sheet.title_);
+
+    if (match != titles_.end() && match->second == &sheet)
+    {
+        titles_.erase(match);
+    }
+
+    sheet.title_ = title;
+
+    if (index_of(sheet) != npos)
+    {
+        titles_[title] = &sheet;
+    }
+}
+
+void worksheet_registry::set_id(worksheet_impl &sheet, std::size_t id)
+{
+    auto match = ids_.find(sheet.id_);
+
+    if (match != ids_.end() && match->second == &sheet)
+    {
+        ids_.erase(match);
+    }
+
+    sheet.id_ = id;
+
+    if (index_of(sheet) != npos)
+    {
+        ids_[id] = &sheet;
+    }
+}
+
+const std::string &worksheet_registry::get_rel_id(const worksheet_impl &sheet) const
+{
+    return const_cast<worksheet_registry *>(this)->slot_of(sheet).rel_id;
+}
+
+void worksheet_registry::set_rel_id(worksheet_impl &sheet, const std::string &rel_id)
+{
+    auto &entry = slot_of(sheet);
+
+    if (!entry.rel_id.empty())
+    {
+        rel_ids_.erase(entry.rel_id);
+    }
+
+    entry.rel_id = rel_id;
+
+    if (!rel_id.empty())
+    {
+        rel_ids_[rel_id] = &sheet;
+    }
+}
+
+void worksheet_registry::add_to_indices(std::size_t position)
+{
+    auto &entry = slots_[position];
+    auto sheet = entry.sheet.get();
+
+    titles_[sheet->title_] = sheet;
+    ids_[sheet->id_] = sheet;
+    positions_[sheet] = position;
+
+    if (!entry.rel_id.empty())
+    {
+        rel_ids_[entry.rel_id] = sheet;
+    }
+}
+
+void worksheet_registry::remove_from_indices(const slot &entry)
+{
+    auto sheet = entry.sheet.get();
+
+    auto title_match = titles_.find(sheet->title_);
+    if (title_match != titles_.end() && title_match->second == sheet) titles_.erase(title_match);
+
+    auto id_match = ids_.find(sheet->id_);
+    if (id_match != ids_.end() && id_match->second == sheet) ids_.erase(id_match);
+
+    auto rel_id_match = rel_ids_.find(entry.rel_id);
+    if (rel_id_match != rel_ids_.end() && rel_id_match->second == sheet) rel_ids_.erase(rel_id_match);
+
+    positions_.erase(sheet);
+}
+
+void worksheet_registry::update_positions(std::size_t first, std::size_t last)
+{
+    for (auto position = first; position < last; ++position)
+    {
+        positions_[slots_[position].sheet.get()] = position;
+    }
+}
+
+worksheet_registry::slot &worksheet_registry::slot_of(const worksheet_impl &sheet)
+{
+    auto position = index_of(sheet);
+
+    if (position == npos)
+    {
+        throw invalid_parameter();
+    }
+
+    return slots_[position];
+}
+
+} // namespace detail
+} // namespace xlnt
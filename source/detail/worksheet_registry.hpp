@@ -0,0 +1,187 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace xlnt {
+namespace detail {
+
+struct worksheet_impl;
+
+/// <summary>
+/// The worksheets of a workbook in tab order. Each worksheet_impl is allocated
+/// separately so its address never changes while it's in the registry, even when
+/// sheets are inserted, removed, or reordered. Titles, sheet ids, relationship ids,
+/// and positions are indexed so that every lookup takes constant time.
+/// </summary>
+class worksheet_registry
+{
+private:
+    struct slot
+    {
+        std::unique_ptr<worksheet_impl> sheet;
+        std::string rel_id;
+    };
+
+    template <typename Slot, typename Value>
+    class basic_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value *;
+        using reference = Value &;
+
+        basic_iterator() = default;
+        explicit basic_iterator(Slot *position) : position_(position) {}
+
+        Value &operator*() const { return *position_->sheet; }
+        Value *operator->() const { return position_->sheet.get(); }
+
+        basic_iterator &operator++() { ++position_; return *this; }
+        basic_iterator operator++(int) { auto old = *this; ++position_; return old; }
+        basic_iterator &operator--() { --position_; return *this; }
+        basic_iterator operator--(int) { auto old = *this; --position_; return old; }
+        basic_iterator &operator+=(std::ptrdiff_t n) { position_ += n; return *this; }
+        basic_iterator operator+(std::ptrdiff_t n) const { return basic_iterator(position_ + n); }
+        std::ptrdiff_t operator-(const basic_iterator &other) const { return position_ - other.position_; }
+
+        bool operator==(const basic_iterator &other) const { return position_ == other.position_; }
+        bool operator!=(const basic_iterator &other) const { return position_ != other.position_; }
+
+    private:
+        Slot *position_ = nullptr;
+    };
+
+public:
+    using iterator = basic_iterator<slot, worksheet_impl>;
+    using const_iterator = basic_iterator<const slot, const worksheet_impl>;
+
+    worksheet_registry();
+
+    /// <summary>
+    /// Copies every worksheet. The indices refer to the new copies.
+    /// </summary>
+    worksheet_registry(const worksheet_registry &other);
+    worksheet_registry &operator=(const worksheet_registry &other);
+
+    ~worksheet_registry();
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    std::size_t size() const;
+    bool empty() const;
+
+    /// <summary>
+    /// Return the worksheet at the given position. Throws invalid_parameter if index is out of range.
+    /// </summary>
+    worksheet_impl &at(std::size_t index);
+    const worksheet_impl &at(std::size_t index) const;
+
+    worksheet_impl &back();
+
+    /// <summary>
+    /// Move sheet into the registry at position index and return the stored worksheet.
+    /// </summary>
+    worksheet_impl &insert(std::size_t index, worksheet_impl &&sheet);
+
+    /// <summary>
+    /// Move sheet into the registry after every other worksheet and return the stored worksheet.
+    /// </summary>
+    worksheet_impl &push_back(worksheet_impl &&sheet);
+
+    /// <summary>
+    /// Remove and destroy the worksheet at the given position.
+    /// </summary>
+    void erase(std::size_t index);
+
+    /// <summary>
+    /// Move the worksheet at position from so that it ends up at position to.
+    /// </summary>
+    void move(std::size_t from, std::size_t to);
+
+    void clear();
+
+    /// <summary>
+    /// Return the position of sheet or npos if it isn't in this registry.
+    /// </summary>
+    std::size_t index_of(const worksheet_impl &sheet) const;
+
+    /// <summary>
+    /// Return the worksheet with the given title, sheet id, or relationship id or
+    /// nullptr if there is none.
+    /// </summary>
+    worksheet_impl *find_by_title(const std::string &title) const;
+    worksheet_impl *find_by_id(std::size_t id) const;
+    worksheet_impl *find_by_rel_id(const std::string &rel_id) const;
+
+    /// <summary>
+    /// Change the title of sheet. Must be used instead of assigning worksheet_impl::title_
+    /// directly so that the title index stays current.
+    /// </summary>
+    void set_title(worksheet_impl &sheet, const std::string &title);
+
+    /// <summary>
+    /// Change the sheet id of sheet. Must be used instead of assigning worksheet_impl::id_
+    /// directly so that the id index stays current.
+    /// </summary>
+    void set_id(worksheet_impl &sheet, std::size_t id);
+
+    /// <summary>
+    /// Return the id of the workbook relationship targeting sheet or an empty string.
+    /// </summary>
+    const std::string &get_rel_id(const worksheet_impl &sheet) const;
+
+    /// <summary>
+    /// Set the id of the workbook relationship targeting sheet.
+    /// </summary>
+    void set_rel_id(worksheet_impl &sheet, const std::string &rel_id);
+
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+private:
+    void add_to_indices(std::size_t position);
+    void remove_from_indices(const slot &entry);
+    void update_positions(std::size_t first, std::size_t last);
+    slot &slot_of(const worksheet_impl &sheet);
+
+    std::vector<slot> slots_;
+    std::unordered_map<std::string, worksheet_impl *> titles_;
+    std::unordered_map<std::size_t, worksheet_impl *> ids_;
+    std::unordered_map<std::string, worksheet_impl *> rel_ids_;
+    std::unordered_map<const worksheet_impl *, std::size_t> positions_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -1,9 +1,14 @@
+#include <algorithm>
 #include <cctype>
+#include <limits>
+#include <thread>
 
 #include <detail/xlsx_consumer.hpp>
 
 #include <detail/constants.hpp>
 #include <detail/custom_value_traits.hpp>
+#include <detail/inflate_pipeline.hpp>
+#include <detail/sheet_data_scanner.hpp>
 #include <detail/workbook_impl.hpp>
 #include <xlnt/cell/cell.hpp>
 #include <xlnt/utils/path.hpp>
@@ -11,6 +16,7 @@
 #include <xlnt/packaging/zip_file.hpp>
 #include <xlnt/workbook/const_worksheet_iterator.hpp>
 #include <xlnt/workbook/workbook.hpp>
+#include <xlnt/workbook/worksheet_summary.hpp>
 #include <xlnt/worksheet/worksheet.hpp>
 
 namespace {
@@ -29,6 +35,35 @@ std::size_t string_to_size_t(const std::string &s)
 #endif
 }
 
+/// <summary>
+/// Returns true if s is an optionally negative integer with at most 18 digits,
+/// i.e. one that std::stoll can parse without overflowing.
+/// </summary>
+/// <summary>
+/// Parse the characters from first to last into result if they are an integer of
+/// at most 18 digits, which always fits in an int64. Returns false otherwise.
+/// </summary>
+bool parse_integer(const char *first, const char *last, std::int64_t &result)
+{
+    const auto negative = first != last && *first == '-';
+    if (negative) ++first;
+
+    const auto digits = last - first;
+    if (digits == 0 || digits > 18) return false;
+
+    result = 0;
+
+    for (; first != last; ++first)
+    {
+        if (*first < '0' || *first > '9') return false;
+        result = result * 10 + (*first - '0');
+    }
+
+    if (negative) result = -result;
+
+    return true;
+}
+
 xlnt::datetime w3cdtf_to_datetime(const std::string &string)
 {
 	xlnt::datetime result(1900, 1, 1);
@@ -57,6 +92,450 @@ struct EnumClassHash
 };
 */
 
+/// <summary>
+/// Read the character content of the element that was just started, if any,
+/// leaving the parser positioned before its end_element.
+/// </summary>
+std::string read_text(xml::parser &parser)
+{
+	auto text = std::string();
+
+	while (parser.peek() == xml::parser::event_type::characters)
+	{
+		parser.next_expect(xml::parser::event_type::characters);
+		text.append(parser.value());
+	}
+
+	return text;
+}
+
+/// <summary>
+/// Finds the dimension of a worksheet and whether it has any cells from the text
+/// of its part as it is decompressed, without parsing it as XML. Scanning is done
+/// as soon as both are known, which is right after the start of sheetData unless
+/// the part has no dimension element and every cell reference has to be read.
+/// </summary>
+class worksheet_head_scanner
+{
+public:
+    /// <summary>
+    /// Scan the next chunk of the part. Returns false once nothing more is needed.
+    /// </summary>
+    bool scan(const char *data, std::size_t size)
+    {
+        buffer_.append(data, size);
+
+        while (!done_)
+        {
+            auto start = buffer_.find('<', position_);
+
+            if (start == std::string::npos)
+            {
+                position_ = buffer_.size();
+                break;
+            }
+
+            auto end = buffer_.find('>', start);
+
+            if (end == std::string::npos)
+            {
+                // wait for the rest of the tag
+                position_ = start;
+                break;
+            }
+
+            read_tag(start + 1, end);
+            position_ = end + 1;
+        }
+
+        // keep the buffer small while every cell reference is scanned
+        if (position_ > 65536)
+        {
+            buffer_.erase(0, position_);
+            position_ = 0;
+        }
+
+        return !done_;
+    }
+
+    void fill(xlnt::worksheet_summary &summary) const
+    {
+        summary.empty = empty_;
+
+        if (has_dimension_)
+        {
+            summary.dimension = dimension_;
+        }
+        else if (!empty_)
+        {
+            summary.dimension = xlnt::range_reference(xlnt::column_t(min_column_), min_row_,
+                xlnt::column_t(max_column_), max_row_);
+        }
+
+        summary.row_count = empty_ ? 0 : static_cast<xlnt::row_t>(summary.dimension.get_height() + 1);
+    }
+
+private:
+    bool is_name(std::size_t begin, std::size_t end, const char *name) const
+    {
+        return buffer_.compare(begin, end - begin, name) == 0;
+    }
+
+    // The value of the attribute called name in the tag text between begin and end.
+    std::string attribute(std::size_t begin, std::size_t end, const std::string &name) const
+    {
+        auto position = begin;
+
+        while (true)
+        {
+            position = buffer_.find(name, position);
+
+            if (position == std::string::npos || position + name.size() + 2 > end)
+            {
+                return "";
+            }
+
+            auto quote = position + name.size() + 1;
+
+            if (std::isspace(static_cast<unsigned char>(buffer_[position - 1])) != 0
+                && buffer_[quote - 1] == '=' && (buffer_[quote] == '"' || buffer_[quote] == '\''))
+            {
+                auto value_end = buffer_.find(buffer_[quote], quote + 1);
+                return value_end < end ? buffer_.substr(quote + 1, value_end - quote - 1) : "";
+            }
+
+            position += name.size();
+        }
+    }
+
+    void read_tag(std::size_t begin, std::size_t end)
+    {
+        if (buffer_[begin] == '?' || buffer_[begin] == '!') return;
+
+        auto closing = buffer_[begin] == '/';
+        if (closing) ++begin;
+
+        auto name_end = begin;
+
+        while (name_end < end && buffer_[name_end] != '/'
+            && std::isspace(static_cast<unsigned char>(buffer_[name_end])) == 0)
+        {
+            ++name_end;
+        }
+
+        // ignore the namespace prefix
+        auto colon = buffer_.find(':', begin);
+        auto name_begin = colon < name_end ? colon + 1 : begin;
+
+        if (!in_sheet_data_)
+        {
+            if (closing) return;
+
+            if (is_name(name_begin, name_end, "dimension"))
+            {
+                auto ref = attribute(name_end, end, "ref");
+
+                if (!ref.empty())
+                {
+                    dimension_ = xlnt::range_reference(ref);
+                    has_dimension_ = true;
+                }
+            }
+            else if (is_name(name_begin, name_end, "sheetData"))
+            {
+                in_sheet_data_ = true;
+                done_ = buffer_[end - 1] == '/';
+            }
+
+            return;
+        }
+
+        if (closing)
+        {
+            done_ = is_name(name_begin, name_end, "sheetData");
+            return;
+        }
+
+        if (!is_name(name_begin, name_end, "c")) return;
+
+        empty_ = false;
+
+        if (has_dimension_)
+        {
+            done_ = true;
+            return;
+        }
+
+        auto r = attribute(name_end, end, "r");
+        if (r.empty()) return;
+
+        xlnt::cell_reference reference(r);
+        auto row = reference.get_row();
+        auto column = reference.get_column_index().index;
+
+        min_row_ = std::min(min_row_, row);
+        max_row_ = std::max(max_row_, row);
+        min_column_ = std::min(min_column_, column);
+        max_column_ = std::max(max_column_, column);
+    }
+
+    std::string buffer_;
+    std::size_t position_ = 0;
+    bool in_sheet_data_ = false;
+    bool done_ = false;
+    bool empty_ = true;
+    bool has_dimension_ = false;
+    xlnt::range_reference dimension_;
+    xlnt::row_t min_row_ = std::numeric_limits<xlnt::row_t>::max();
+    xlnt::row_t max_row_ = 0;
+    xlnt::column_t::index_t min_column_ = std::numeric_limits<xlnt::column_t::index_t>::max();
+    xlnt::column_t::index_t max_column_ = 0;
+};
+
+/// <summary>
+/// Returns the index of the column in a cell reference like "AB12" without
+/// validating the rest of it.
+/// </summary>
+std::size_t column_index_of(const char *first, const char *last)
+{
+    std::size_t column = 0;
+
+    for (; first != last && *first >= 'A' && *first <= 'Z'; ++first)
+    {
+        column = column * 26 + static_cast<std::size_t>(*first - 'A' + 1);
+    }
+
+    return column;
+}
+
+/// <summary>
+/// Find the start tag of the sheetData element in the text of a worksheet part,
+/// which may be incomplete. Returns false if the tag isn't there yet. Otherwise
+/// content_first is the position after it, or npos if the element is empty,
+/// and prefix is its namespace prefix.
+/// </summary>
+bool find_sheet_data_start(const std::string &xml, std::size_t &content_first, std::string &prefix)
+{
+    static const std::string name = "sheetData";
+
+    for (auto position = xml.find(name); position != std::string::npos; position = xml.find(name, position + 1))
+    {
+        const auto after_name = position + name.size() < xml.size() ? xml[position + name.size()] : '\0';
+
+        if (after_name != '>' && after_name != '/' && !std::isspace(static_cast<unsigned char>(after_name)))
+        {
+            continue;
+        }
+
+        // the element may have a namespace prefix
+        auto open = position;
+
+        while (open > 0 && xml[open - 1] != '<' && xml[open - 1] != '/' && !std::isspace(static_cast<unsigned char>(xml[open - 1])))
+        {
+            --open;
+        }
+
+        if (open == 0 || xml[open - 1] != '<') continue;
+
+        const auto start_tag_end = xml.find('>', position);
+
+        if (start_tag_end == std::string::npos)
+        {
+            return false;
+        }
+
+        prefix = xml.substr(open, position - open);
+        content_first = xml[start_tag_end - 1] == '/' ? std::string::npos : start_tag_end + 1;
+
+        return true;
+    }
+
+    return false;
+}
+
+/// <summary>
+/// Find the content of the sheetData element in the text of a worksheet part.
+/// Returns false if there is no sheetData element or it's empty.
+/// </summary>
+bool find_sheet_data(const std::string &xml, std::size_t &first, std::size_t &last)
+{
+    std::string prefix;
+
+    if (!find_sheet_data_start(xml, first, prefix) || first == std::string::npos)
+    {
+        return false;
+    }
+
+    last = xml.find("</" + prefix + "sheetData>", first);
+
+    if (last == std::string::npos)
+    {
+        throw xlnt::invalid_file("sheetData isn't closed");
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Worksheet parts at least this large are inflated on another thread while they're parsed.
+/// </summary>
+const std::size_t pipelined_part_size = 1 << 20;
+
+
+/// <summary>
+/// Returns true if the worksheet element called name belongs to one of the
+/// categories options asks to skip.
+/// </summary>
+bool is_skipped(const xml::qname &name, const xlnt::load_options &options)
+{
+    static const auto xmlns = xlnt::constants::get_namespace("worksheet");
+
+    if (name.namespace_() != xmlns)
+    {
+        return false;
+    }
+
+    const auto &element = name.name();
+
+    if (options.skip_row_column_properties && (element == "cols" || element == "sheetFormatPr"))
+    {
+        return true;
+    }
+
+    if (options.skip_merged_cells && element == "mergeCells")
+    {
+        return true;
+    }
+
+    return options.skip_views_and_page_setup && (element == "sheetPr" || element == "sheetViews"
+        || element == "pageMargins" || element == "pageSetup" || element == "printOptions"
+        || element == "headerFooter");
+}
+
+/// <summary>
+/// Consume everything up to and including the end tag of the element that was
+/// just started so that elements which aren't needed can be ignored.
+/// </summary>
+void skip_element(xml::parser &parser)
+{
+	parser.attribute_map();
+	parser.content(xml::parser::content_type::mixed);
+
+	std::size_t depth = 1;
+
+	while (depth > 0)
+	{
+		auto event = parser.next();
+
+		if (event == xml::parser::event_type::start_element)
+		{
+			parser.attribute_map();
+			parser.content(xml::parser::content_type::mixed);
+			++depth;
+		}
+		else if (event == xml::parser::event_type::end_element)
+		{
+			--depth;
+		}
+	}
+}
+
+/// <summary>
+/// Read the runs of the si or is element that was just started, leaving the
+/// parser positioned before its end_element.
+/// </summary>
+xlnt::text read_rich_text(xml::parser &parser)
+{
+    static const auto xmlns = xlnt::constants::get_namespace("worksheet");
+
+    parser.content(xml::parser::content_type::complex);
+
+    xlnt::text t;
+
+    while (true)
+    {
+        if (parser.peek() == xml::parser::event_type::end_element) break;
+
+        parser.next_expect(xml::parser::event_type::start_element);
+
+        if (parser.qname() == xml::qname(xmlns, "t"))
+        {
+            parser.attribute_map(); // xml:space
+            t.set_plain_string(read_text(parser));
+            parser.next_expect(xml::parser::event_type::end_element, xmlns, "t");
+        }
+        else if (parser.qname() == xml::qname(xmlns, "r")) // possible multiple text entities.
+        {
+            parser.content(xml::parser::content_type::complex);
+            xlnt::text_run run;
+
+            while (true)
+            {
+                if (parser.peek() == xml::parser::event_type::end_element) break;
+
+                parser.next_expect(xml::parser::event_type::start_element);
+
+                if (parser.qname() == xml::qname(xmlns, "t"))
+                {
+                    parser.attribute_map(); // xml:space
+                    run.set_string(read_text(parser));
+                    parser.next_expect(xml::parser::event_type::end_element, xmlns, "t");
+                }
+                else if (parser.qname() == xml::qname(xmlns, "rPr"))
+                {
+                    parser.content(xml::parser::content_type::complex);
+
+                    while (true)
+                    {
+                        if (parser.peek() == xml::parser::event_type::end_element) break;
+
+                        parser.next_expect(xml::parser::event_type::start_element);
+
+                        if (parser.qname() == xml::qname(xmlns, "sz"))
+                        {
+                            run.set_size(string_to_size_t(parser.attribute("val")));
+                        }
+                        else if (parser.qname() == xml::qname(xmlns, "rFont"))
+                        {
+                            run.set_font(parser.attribute("val"));
+                        }
+                        else if (parser.qname() == xml::qname(xmlns, "color"))
+                        {
+                            run.set_color(parser.attribute_present("rgb")
+                                ? parser.attribute("rgb") : parser.attribute("val"));
+                        }
+                        else if (parser.qname() == xml::qname(xmlns, "family"))
+                        {
+                            run.set_family(string_to_size_t(parser.attribute("val")));
+                        }
+                        else if (parser.qname() == xml::qname(xmlns, "scheme"))
+                        {
+                            run.set_scheme(parser.attribute("val"));
+                        }
+
+                        skip_element(parser);
+                    }
+
+                    parser.next_expect(xml::parser::event_type::end_element, xmlns, "rPr");
+                }
+                else
+                {
+                    skip_element(parser);
+                }
+            }
+
+            parser.next_expect(xml::parser::event_type::end_element, xmlns, "r");
+            t.add_run(run);
+        }
+        else // phonetic runs and properties
+        {
+            skip_element(parser);
+        }
+    }
+
+    return t;
+}
+
 xlnt::protection read_protection(xml::parser &parser)
 {
     parser.next_expect(xml::parser::event_type::start_element, "protection");
@@ -391,28 +870,57 @@ void check_document_type(const std::string &document_content_type)
 namespace xlnt {
 namespace detail {
 
-xlsx_consumer::xlsx_consumer(workbook &destination) : destination_(destination)
+xlsx_consumer::xlsx_consumer(workbook &destination)
+    : source_(std::make_shared<zip_file>()),
+      destination_(destination)
+{
+}
+
+std::vector<worksheet_summary> xlsx_consumer::probe(const path &source)
+{
+	source_->load(source);
+	return summarize_sheets();
+}
+
+std::vector<worksheet_summary> xlsx_consumer::probe(std::istream &source)
+{
+	source_->load(source);
+	return summarize_sheets();
+}
+
+std::vector<worksheet_summary> xlsx_consumer::probe(const std::vector<std::uint8_t> &source)
 {
+	source_->load(source);
+	return summarize_sheets();
+}
+
+std::vector<worksheet_summary> xlsx_consumer::probe(input_source &source)
+{
+	source_->load(source);
+	return summarize_sheets();
 }
 
 void xlsx_consumer::read(const path &source)
 {
-	destination_.clear();
-	source_.load(source);
+	source_->load(source);
 	populate_workbook();
 }
 
 void xlsx_consumer::read(std::istream &source)
 {
-	destination_.clear();
-	source_.load(source);
+	source_->load(source);
 	populate_workbook();
 }
 
 void xlsx_consumer::read(const std::vector<std::uint8_t> &source)
 {
-	destination_.clear();
-	source_.load(source);
+	source_->load(source);
+	populate_workbook();
+}
+
+void xlsx_consumer::read(input_source &source)
+{
+	source_->load(source);
 	populate_workbook();
 }
 
@@ -425,7 +933,7 @@ void xlsx_consumer::populate_workbook()
 
 	for (const auto &rel : manifest.get_relationships(path("/")))
 	{
-        std::istringstream parser_stream(source_.read(rel.get_target().get_path()));
+        std::istringstream parser_stream(source_->read(rel.get_target().get_path()));
         xml::parser parser(parser_stream, rel.get_target().get_path().string());
 
 		switch (rel.get_type())
@@ -473,10 +981,41 @@ void xlsx_consumer::populate_workbook()
 
     // First pass of workbook relationship parts which must be read before sheets (e.g. shared strings)
     
+	const auto &options = destination_.d_->load_options_;
+
 	for (const auto &rel : manifest.get_relationships(workbook_rel.get_target().get_path()))
 	{
 		path part_path(rel.get_source().get_path().parent().append(rel.get_target().get_path()));
-        std::istringstream parser_stream(source_.read(part_path));
+
+        // only inflate the parts that are going to be read
+        switch (rel.get_type())
+        {
+        case relationship::type::calculation_chain:
+            if (options.skip_formulas) continue;
+            break;
+        case relationship::type::styles:
+            if (options.skip_styles)
+            {
+                destination_.d_->unread_stylesheet_archive_ = source_;
+                destination_.d_->unread_stylesheet_part_ = part_path;
+
+                continue;
+            }
+            break;
+        case relationship::type::shared_string_table:
+            if (options.lazy_shared_strings)
+            {
+                destination_.d_->mutable_shared_strings().assign_xml(source_->read(part_path));
+                continue;
+            }
+            break;
+        case relationship::type::theme:
+            break;
+        default:
+            continue;
+        }
+
+        std::istringstream parser_stream(source_->read(part_path));
         auto using_namespaces = rel.get_type() == relationship::type::styles;
         auto receive = xml::parser::receive_default
             | (using_namespaces ? xml::parser::receive_namespace_decls : 0);
@@ -484,6 +1023,9 @@ void xlsx_consumer::populate_workbook()
 
 		switch (rel.get_type())
 		{
+        case relationship::type::calculation_chain:
+            read_calculation_chain(parser);
+            break;
         case relationship::type::shared_string_table:
             read_shared_string_table(parser);
             break;
@@ -500,33 +1042,112 @@ void xlsx_consumer::populate_workbook()
     
     // Second pass, read sheets themselves
 
-	for (const auto &rel : manifest.get_relationships(workbook_rel.get_target().get_path()))
-    {
+	for (const auto &rel : manifest.get_relationships(workbook_rel.get_target().get_path()))
+    {
+		path part_path(rel.get_source().get_path().parent().append(rel.get_target().get_path()));
+
+        switch (rel.get_type())
+        {
+        case relationship::type::chartsheet:
+        case relationship::type::dialogsheet:
+            break;
+        case relationship::type::worksheet:
+            if (!is_selected(rel.get_id()))
+            {
+                // the worksheet is left out of the workbook entirely
+                manifest.unregister_override_type(path("/").append(part_path));
+                manifest.unregister_relationship(workbook_rel.get_target(), rel.get_id());
+
+                continue;
+            }
+
+            if (options.lazy)
+            {
+                // leave the part compressed until the worksheet is first accessed
+                auto &sheet = read_worksheet_declaration(rel.get_id());
+                sheet.deferred_archive_ = source_;
+                sheet.deferred_part_ = part_path;
+                destination_.d_->read_deferred_worksheet_ = &xlsx_consumer::read_deferred_worksheet;
+
+                continue;
+            }
+            break;
+        default:
+            continue;
+        }
+
+        if (rel.get_type() == relationship::type::worksheet)
+        {
+            read_worksheet(read_worksheet_declaration(rel.get_id()), part_path);
+            continue;
+        }
+
+        std::istringstream parser_stream(source_->read(part_path));
+        auto receive = xml::parser::receive_default | xml::parser::receive_namespace_decls;
+        xml::parser parser(parser_stream, rel.get_target().get_path().string(), receive);
+
+		switch (rel.get_type())
+		{
+		case relationship::type::chartsheet:
+			read_chartsheet(rel.get_id(), parser);
+			break;
+		case relationship::type::dialogsheet:
+			read_dialogsheet(rel.get_id(), parser);
+			break;
+        default:
+            break;
+		}
+	}
+
+	// Unknown Parts
+
+	void read_unknown_parts();
+	void read_unknown_relationships();
+
+	// Loaded formulas come with their cached values so nothing needs to be
+	// recalculated until a cell is changed.
+	destination_.d_->formulas_.reset();
+}
+
+std::vector<worksheet_summary> xlsx_consumer::summarize_sheets()
+{
+	auto &manifest = destination_.get_manifest();
+	read_manifest();
+
+	const auto workbook_rel = manifest.get_relationship(path("/"), relationship::type::office_document);
+	const auto workbook_path = workbook_rel.get_target().get_path();
+
+	check_document_type(manifest.get_content_type(workbook_path));
+	std::istringstream workbook_stream(source_->read(workbook_path));
+	xml::parser workbook_parser(workbook_stream, workbook_path.string());
+	read_workbook(workbook_parser);
+
+	std::vector<worksheet_summary> summaries(sheet_declarations_.size());
+
+	for (const auto &declaration : sheet_declarations_)
+	{
+		auto &summary = summaries.at(declaration.second.index);
+		summary.title = declaration.second.title;
+
+		if (!manifest.has_relationship(workbook_path, declaration.first)) continue;
+
+		const auto rel = manifest.get_relationship(workbook_path, declaration.first);
+
+		// chartsheets and dialogsheets don't have cells
+		if (rel.get_type() != relationship::type::worksheet) continue;
+
 		path part_path(rel.get_source().get_path().parent().append(rel.get_target().get_path()));
-        std::istringstream parser_stream(source_.read(part_path));
-        auto receive = xml::parser::receive_default | xml::parser::receive_namespace_decls;
-        xml::parser parser(parser_stream, rel.get_target().get_path().string(), receive);
+		worksheet_head_scanner scanner;
 
-		switch (rel.get_type())
+		source_->read(part_path, [&scanner](const char *data, std::size_t size)
 		{
-		case relationship::type::chartsheet:
-			read_chartsheet(rel.get_id(), parser);
-			break;
-		case relationship::type::dialogsheet:
-			read_dialogsheet(rel.get_id(), parser);
-			break;
-		case relationship::type::worksheet:
-			read_worksheet(rel.get_id(), parser);
-			break;
-        default:
-            break;
-		}
-	}
+			return scanner.scan(data, size);
+		});
 
-	// Unknown Parts
+		scanner.fill(summary);
+	}
 
-	void read_unknown_parts();
-	void read_unknown_relationships();
+	return summaries;
 }
 
 // Package Parts
@@ -534,10 +1155,10 @@ void xlsx_consumer::populate_workbook()
 void xlsx_consumer::read_manifest()
 {
 	path package_rels_path("_rels/.rels");
-	if (!source_.has_file(package_rels_path)) throw invalid_file("missing package rels");
-	auto package_rels = read_relationships(package_rels_path, source_);
+	if (!source_->has_file(package_rels_path)) throw invalid_file("missing package rels");
+	auto package_rels = read_relationships(package_rels_path, *source_);
 
-    std::istringstream parser_stream(source_.read(path("[Content_Types].xml")));
+    std::istringstream parser_stream(source_->read(path("[Content_Types].xml")));
     xml::parser parser(parser_stream, "[Content_Types].xml");
     
 	auto &manifest = destination_.get_manifest();
@@ -578,7 +1199,7 @@ void xlsx_consumer::read_manifest()
 			package_rel.get_id());
 	}
 
-	for (const auto &relationship_source : source_.infolist())
+	for (const auto &relationship_source : source_->infolist())
 	{
 		if (relationship_source.filename == path("_rels/.rels") 
 			|| relationship_source.filename.extension() != "rels") continue;
@@ -589,7 +1210,7 @@ void xlsx_consumer::read_manifest()
 
 		path source_directory = part.parent();
 
-		auto part_rels = read_relationships(relationship_source.filename, source_);
+		auto part_rels = read_relationships(relationship_source.filename, *source_);
 
 		for (const auto part_rel : part_rels)
 		{
@@ -836,9 +1457,7 @@ void xlsx_consumer::read_workbook(xml::parser &parser)
                 std::string title(parser.attribute("name"));
                 auto id = string_to_size_t(parser.attribute("sheetId"));
 
-                sheet_title_id_map_[title] = id;
-                sheet_title_index_map_[title] = index++;
-                destination_.d_->sheet_title_rel_id_map_[title] = rel_id;
+                sheet_declarations_[rel_id] = sheet_declaration{ title, id, index++ };
                 
                 parser.next_expect(xml::parser::event_type::end_element, xmlns_s, "sheet");
             }
@@ -850,6 +1469,20 @@ void xlsx_consumer::read_workbook(xml::parser &parser)
             destination_.d_->has_calculation_properties_ = true;
             parser.attribute("calcId");
             parser.attribute("concurrentCalc");
+
+            auto &properties = destination_.d_->calculation_properties_;
+            properties.iterate = parser.attribute_present("iterate") && is_true(parser.attribute("iterate"));
+
+            if (parser.attribute_present("iterateCount"))
+            {
+                properties.iterate_count = string_to_size_t(parser.attribute("iterateCount"));
+            }
+
+            if (parser.attribute_present("iterateDelta"))
+            {
+                properties.iterate_delta = std::stod(parser.attribute("iterateDelta"));
+            }
+
             parser.next_expect(xml::parser::event_type::end_element, xmlns, "calcPr");
         }
         else if (qname == xml::qname(xmlns, "extLst"))
@@ -871,8 +1504,59 @@ void xlsx_consumer::read_workbook(xml::parser &parser)
 
 // Write Workbook Relationship Target Parts
 
-void xlsx_consumer::read_calculation_chain(xml::parser &/*parser*/)
+void xlsx_consumer::read_calculation_chain(xml::parser &parser)
 {
+    static const auto xmlns = constants::get_namespace("workbook");
+
+    auto &chain = destination_.d_->calculation_chain_;
+    chain.clear();
+
+    parser.next_expect(xml::parser::event_type::start_element, xmlns, "calcChain");
+    parser.content(xml::parser::content_type::complex);
+
+    // i is only written when it differs from the previous entry
+    std::size_t sheet_id = 1;
+
+    while (true)
+    {
+        if (parser.peek() == xml::parser::event_type::end_element) break;
+
+        parser.next_expect(xml::parser::event_type::start_element, xmlns, "c");
+
+        if (parser.attribute_present("i"))
+        {
+            sheet_id = string_to_size_t(parser.attribute("i"));
+        }
+
+        cell_reference ref(parser.attribute("r"));
+        std::uint8_t flags = 0;
+
+        if (parser.attribute_present("l") && is_true(parser.attribute("l")))
+        {
+            flags |= detail::calculation_chain::new_level;
+        }
+
+        if (parser.attribute_present("s") && is_true(parser.attribute("s")))
+        {
+            flags |= detail::calculation_chain::child_chain;
+        }
+
+        if (parser.attribute_present("a") && is_true(parser.attribute("a")))
+        {
+            flags |= detail::calculation_chain::array;
+        }
+
+        if (parser.attribute_present("t") && is_true(parser.attribute("t")))
+        {
+            flags |= detail::calculation_chain::new_thread;
+        }
+
+        chain.append(sheet_id, ref.get_row(), ref.get_column().index, flags);
+
+        parser.next_expect(xml::parser::event_type::end_element, xmlns, "c");
+    }
+
+    parser.next_expect(xml::parser::event_type::end_element, xmlns, "calcChain");
 }
 
 void xlsx_consumer::read_chartsheet(const std::string &/*title*/, xml::parser &/*parser*/)
@@ -909,82 +1593,31 @@ void xlsx_consumer::read_pivot_table(xml::parser &/*parser*/)
 
 void xlsx_consumer::read_shared_string_table(xml::parser &parser)
 {
-    static const auto xmlns = constants::get_namespace("shared-strings");
+    static const auto xmlns = constants::get_namespace("worksheet");
     
     parser.next_expect(xml::parser::event_type::start_element, xmlns, "sst");
+    parser.content(xml::parser::content_type::complex);
 	std::size_t unique_count = 0;
 
+	if (parser.attribute_present("count"))
+	{
+		parser.attribute("count");
+	}
+
 	if (parser.attribute_present("uniqueCount"))
 	{
 		unique_count = string_to_size_t(parser.attribute("uniqueCount"));
 	}
 
-	auto &strings = destination_.get_shared_strings();
+	auto &strings = destination_.d_->mutable_shared_strings();
 
     while (true)
     {
         if (parser.peek() == xml::parser::event_type::end_element) break;
         
         parser.next_expect(xml::parser::event_type::start_element, xmlns, "si");
-        parser.next_expect(xml::parser::event_type::start_element);
-        
-        text t;
-        
-		if (parser.name() == "t")
-		{
-			t.set_plain_string(parser.value());
-		}
-		else if (parser.name() == "r") // possible multiple text entities.
-		{
-            while (true)
-            {
-                if (parser.peek() == xml::parser::event_type::end_element) break;
-                
-                parser.next_expect(xml::parser::event_type::start_element, xmlns, "t");
-                
-                text_run run;
-                run.set_string(parser.value());
-
-                if (parser.peek() == xml::parser::event_type::start_element)
-                {
-                    parser.next_expect(xml::parser::event_type::start_element, xmlns, "rPr");
-
-                    while (true)
-                    {
-                        if (parser.peek() == xml::parser::event_type::end_element) break;
-                        
-                        parser.next_expect(xml::parser::event_type::start_element);
-
-                        if (parser.qname() == xml::qname(xmlns, "sz"))
-                        {
-                            run.set_size(string_to_size_t(parser.attribute("val")));
-                        }
-                        else if (parser.qname() == xml::qname(xmlns, "rFont"))
-                        {
-                            run.set_font(parser.attribute("val"));
-                        }
-                        else if (parser.qname() == xml::qname(xmlns, "color"))
-                        {
-                            run.set_color(parser.attribute("rgb"));
-                        }
-                        else if (parser.qname() == xml::qname(xmlns, "family"))
-                        {
-                            run.set_family(string_to_size_t(parser.attribute("val")));
-                        }
-                        else if (parser.qname() == xml::qname(xmlns, "scheme"))
-                        {
-                            run.set_scheme(parser.attribute("val"));
-                        }
-                        
-                        parser.next_expect(xml::parser::event_type::end_element, parser.qname());
-                    }
-                }
-
-                t.add_run(run);
-            }
-		}
-        
-        strings.push_back(t);
+        strings.add(read_rich_text(parser), true);
+        parser.next_expect(xml::parser::event_type::end_element, xmlns, "si");
 	}
 
 	if (unique_count != strings.size())
@@ -993,6 +1626,20 @@ void xlsx_consumer::read_shared_string_table(xml::parser &parser)
 	}
 }
 
+text xlsx_consumer::read_shared_string(const std::string &xml)
+{
+    static const auto xmlns = constants::get_namespace("worksheet");
+
+    std::istringstream stream(xml);
+    xml::parser parser(stream, "si");
+
+    parser.next_expect(xml::parser::event_type::start_element, xmlns, "si");
+    auto string = read_rich_text(parser);
+    parser.next_expect(xml::parser::event_type::end_element, xmlns, "si");
+
+    return string;
+}
+
 void xlsx_consumer::read_shared_workbook_revision_headers(xml::parser &/*parser*/)
 {
 }
@@ -1012,7 +1659,7 @@ void xlsx_consumer::read_stylesheet(xml::parser &parser)
     static const auto xmlns_x14 = constants::get_namespace("x14");
     static const auto xmlns_x14ac = constants::get_namespace("x14ac");
     
-	auto &stylesheet = destination_.impl().stylesheet_;
+	auto &stylesheet = destination_.d_->mutable_stylesheet();
 
     parser.next_expect(xml::parser::event_type::start_element, xmlns, "styleSheet");
     parser.content(xml::parser::content_type::complex);
@@ -1373,32 +2020,192 @@ void xlsx_consumer::read_volatile_dependencies(xml::parser &/*parser*/)
 {
 }
 
-void xlsx_consumer::read_worksheet(const std::string &rel_id, xml::parser &parser)
+bool xlsx_consumer::is_selected(const std::string &rel_id) const
 {
-    static const auto xmlns = constants::get_namespace("worksheet");
-    static const auto xmlns_mc = constants::get_namespace("mc");
-    static const auto xmlns_x14ac = constants::get_namespace("x14ac");
+	const auto &options = destination_.d_->load_options_;
+
+	if (options.sheet_titles.empty() && options.sheet_indices.empty())
+	{
+		return true;
+	}
+
+	auto declaration = sheet_declarations_.find(rel_id);
+
+	if (declaration == sheet_declarations_.end())
+	{
+		throw invalid_file("no sheet in workbook.xml for relationship " + rel_id);
+	}
+
+	const auto &titles = options.sheet_titles;
+	const auto &indices = options.sheet_indices;
+
+	return std::find(titles.begin(), titles.end(), declaration->second.title) != titles.end()
+		|| std::find(indices.begin(), indices.end(), declaration->second.index) != indices.end();
+}
+
+worksheet_impl &xlsx_consumer::read_worksheet_declaration(const std::string &rel_id)
+{
+	auto declaration = sheet_declarations_.find(rel_id);
+
+	if (declaration == sheet_declarations_.end())
+	{
+		throw invalid_file("no sheet in workbook.xml for relationship " + rel_id);
+	}
+
+	const auto &title = declaration->second.title;
+	auto id = declaration->second.id;
+	auto index = declaration->second.index;
+
+	auto position = std::lower_bound(read_sheet_indices_.begin(), read_sheet_indices_.end(), index);
+	auto insertion_index = static_cast<std::size_t>(position - read_sheet_indices_.begin());
+	read_sheet_indices_.insert(position, index);
+
+	auto &sheets = destination_.d_->worksheets_;
+	auto &sheet = sheets.insert(insertion_index, worksheet_impl(&destination_, id, title));
+	sheets.set_rel_id(sheet, rel_id);
+
+	return sheet;
+}
+
+void xlsx_consumer::read_deferred_worksheet(worksheet_impl &sheet)
+{
+	if (!sheet.is_deferred()) return;
+
+	// released first so that the worksheet handles created while parsing don't come back here
+	auto archive = std::move(sheet.deferred_archive_);
+	sheet.deferred_archive_.reset();
+
+	xlsx_consumer consumer(*sheet.parent_);
+	consumer.source_ = archive;
+	consumer.read_worksheet(sheet, sheet.deferred_part_);
+}
+
+void xlsx_consumer::read_worksheet(worksheet_impl &sheet, const path &part)
+{
+	if ((inflate_pipeline::forced || std::thread::hardware_concurrency() > 1)
+		&& source_->getinfo(part).file_size >= pipelined_part_size)
+	{
+		read_pipelined_worksheet(sheet, part);
+		return;
+	}
+
+	const auto xml = source_->read(part);
+
+	std::size_t sheet_data_first = 0;
+	std::size_t sheet_data_last = 0;
+	auto has_sheet_data = find_sheet_data(xml, sheet_data_first, sheet_data_last);
+
+	// everything but the content of sheetData goes through the XML parser
+	std::istringstream parser_stream(has_sheet_data
+		? xml.substr(0, sheet_data_first) + xml.substr(sheet_data_last) : xml);
+	auto receive = xml::parser::receive_default | xml::parser::receive_namespace_decls;
+	xml::parser parser(parser_stream, part.string(), receive);
+
+	read_worksheet(sheet, parser, xml.data() + sheet_data_first, xml.data() + sheet_data_last);
+}
+
+void xlsx_consumer::read_pipelined_worksheet(worksheet_impl &sheet, const path &part)
+{
+	enum class stage
+	{
+		before_sheet_data,
+		sheet_data,
+		after_sheet_data
+	};
+
+	// the part except for the content of sheetData, which is scanned as it arrives
+	std::string outer;
+	// content of sheetData that hasn't been scanned yet
+	std::string window;
+
+	auto current = stage::before_sheet_data;
+	std::string prefix;
+	row_t row_index = 0;
 
-	auto title = std::find_if(destination_.d_->sheet_title_rel_id_map_.begin(),
-		destination_.d_->sheet_title_rel_id_map_.end(),
-		[&](const std::pair<std::string, std::string> &p)
 	{
-		return p.second == rel_id;
-	})->first;
+		inflate_pipeline pipeline(*source_, part);
+		const char *data = nullptr;
+		std::size_t size = 0;
 
-	auto id = sheet_title_id_map_[title];
-	auto index = sheet_title_index_map_[title];
+		while (pipeline.next(data, size))
+		{
+			(current == stage::sheet_data ? window : outer).append(data, size);
+
+			if (current == stage::before_sheet_data)
+			{
+				std::size_t content_first = 0;
+
+				if (!find_sheet_data_start(outer, content_first, prefix)) continue;
+
+				if (content_first == std::string::npos)
+				{
+					current = stage::after_sheet_data;
+					continue;
+				}
+
+				window = outer.substr(content_first);
+				outer.resize(content_first);
+				current = stage::sheet_data;
+			}
+
+			if (current != stage::sheet_data) continue;
+
+			// only whole rows are scanned, the rest waits for the next buffer
+			const auto sheet_data_last = window.find("</" + prefix + "sheetData>");
+			auto scanned = sheet_data_last;
+
+			if (scanned == std::string::npos)
+			{
+				const auto row_end = "</" + prefix + "row>";
+				scanned = window.rfind(row_end);
+
+				if (scanned == std::string::npos) continue;
+
+				scanned += row_end.size();
+			}
+
+			if (!read_sheet_data(sheet, window.data(), window.data() + scanned, row_index))
+			{
+				// rows are in ascending order so nothing else in the part is needed
+				outer.append("</" + prefix + "sheetData></" + prefix + "worksheet>");
+				current = stage::after_sheet_data;
+				break;
+			}
+
+			if (sheet_data_last == std::string::npos)
+			{
+				window.erase(0, scanned);
+			}
+			else
+			{
+				outer.append(window, sheet_data_last, std::string::npos);
+				window.clear();
+				current = stage::after_sheet_data;
+			}
+		}
+	}
 
-	auto insertion_iter = destination_.d_->worksheets_.begin();
-	while (insertion_iter != destination_.d_->worksheets_.end()
-		&& sheet_title_index_map_[insertion_iter->title_] < index)
+	if (current == stage::sheet_data)
 	{
-		++insertion_iter;
+		throw invalid_file("sheetData isn't closed");
 	}
 
-	destination_.d_->worksheets_.emplace(insertion_iter, &destination_, id, title);
+	std::istringstream parser_stream(outer);
+	auto receive = xml::parser::receive_default | xml::parser::receive_namespace_decls;
+	xml::parser parser(parser_stream, part.string(), receive);
+
+	read_worksheet(sheet, parser, nullptr, nullptr);
+}
+
+void xlsx_consumer::read_worksheet(worksheet_impl &sheet, xml::parser &parser,
+	const char *sheet_data_first, const char *sheet_data_last)
+{
+    static const auto xmlns = constants::get_namespace("worksheet");
+    static const auto xmlns_mc = constants::get_namespace("mc");
+    static const auto xmlns_x14ac = constants::get_namespace("x14ac");
 
-	auto ws = destination_.get_sheet_by_id(id);
+	worksheet ws(&sheet);
+	const auto &options = destination_.d_->load_options_;
 
 	parser.next_expect(xml::parser::event_type::start_element, xmlns, "worksheet");
     parser.content(xml::parser::content_type::complex);
@@ -1418,8 +2225,6 @@ void xlsx_consumer::read_worksheet(const std::string &rel_id, xml::parser &parse
         parser.attribute(xml::qname(xmlns_mc, "Ignorable"));
     }
 
-	xlnt::range_reference full_range;
-
     while (true)
     {
         if (parser.peek() == xml::parser::event_type::end_element) break;
@@ -1427,9 +2232,13 @@ void xlsx_consumer::read_worksheet(const std::string &rel_id, xml::parser &parse
         parser.next_expect(xml::parser::event_type::start_element);
         parser.content(xml::parser::content_type::complex);
         
-        if (parser.qname() == xml::qname(xmlns, "dimension"))
+        if (is_skipped(parser.qname(), options))
+        {
+            skip_element(parser);
+        }
+        else if (parser.qname() == xml::qname(xmlns, "dimension"))
         {
-            full_range = xlnt::range_reference(parser.attribute("ref"));
+            parser.attribute("ref");
             ws.d_->has_dimension_ = true;
             parser.next_expect(xml::parser::event_type::end_element, xmlns, "dimension");
         }
@@ -1474,8 +2283,9 @@ void xlsx_consumer::read_worksheet(const std::string &rel_id, xml::parser &parse
                 if (parser.peek() == xml::parser::event_type::end_element) break;
 
                 parser.next_expect(xml::parser::event_type::start_element, xmlns, "mergeCell");
-                ws.merge_cells(range_reference(parser.attribute("ref")));
-                parser.next_expect(xml::parser::event_type::start_element, xmlns, "mergeCell");
+                // the cells have already been read with the values they should have
+                sheet.merged_cells_.add(range_reference(parser.attribute("ref")));
+                parser.next_expect(xml::parser::event_type::end_element, xmlns, "mergeCell");
 
                 count--;
             }
@@ -1489,125 +2299,15 @@ void xlsx_consumer::read_worksheet(const std::string &rel_id, xml::parser &parse
         }
         else if (parser.qname() == xml::qname(xmlns, "sheetData"))
         {
-            auto &shared_strings = destination_.get_shared_strings();
+            // the content was cut out of the part before it was parsed and is scanned separately
+            row_t row_index = 0;
 
-            while (true)
+            if (!read_sheet_data(sheet, sheet_data_first, sheet_data_last, row_index))
             {
-                if (parser.peek() == xml::parser::event_type::end_element) break;
-                
-                parser.next_expect(xml::parser::event_type::start_element, xmlns, "row");
-
-                auto row_index = static_cast<row_t>(std::stoull(parser.attribute("r")));
-
-                if (parser.attribute_present("ht"))
-                {
-                    ws.get_row_properties(row_index).height = std::stold(parser.attribute("ht"));
-                }
-
-                std::string span_string = parser.attribute("spans");
-                auto colon_index = span_string.find(':');
-
-                column_t min_column = 0;
-                column_t max_column = 0;
-
-                if (colon_index != std::string::npos)
-                {
-                    min_column = static_cast<column_t::index_t>(std::stoll(span_string.substr(0, colon_index)));
-                    max_column = static_cast<column_t::index_t>(std::stoll(span_string.substr(colon_index + 1)));
-                }
-                else
-                {
-                    min_column = full_range.get_top_left().get_column_index();
-                    max_column = full_range.get_bottom_right().get_column_index();
-                }
-
-                while (true)
-                {
-                    if (parser.peek() == xml::parser::event_type::end_element) break;
-
-                    parser.next_expect(xml::parser::event_type::start_element, xmlns, "c");
-                    auto cell = ws.get_cell(cell_reference(parser.attribute("r")));
-                    
-                    auto has_type = parser.attribute_present("t");
-                    auto type = has_type ? parser.attribute("t") : "";
-
-                    auto has_format = parser.attribute_present("s");
-                    auto format_id = static_cast<std::size_t>(has_format ? std::stoull(parser.attribute("s")) : 0LL);
-    
-                    auto has_value = false;
-                    auto value_string = std::string();
-                    
-                    auto has_formula = false;
-                    auto has_shared_formula = false;
-                    auto formula_value_string = std::string();
-    
-                    while (true)
-                    {
-                        if (parser.peek() == xml::parser::event_type::end_element) break;
-                        
-                        parser.next_expect(xml::parser::event_type::start_element);
-                        
-                        if (parser.qname() == xml::qname(xmlns, "v"))
-                        {
-                            has_value = true;
-                            value_string = parser.value();
-                        }
-                        else if (parser.qname() == xml::qname(xmlns, "f"))
-                        {
-                            has_formula = true;
-                            has_shared_formula = parser.attribute_present("t") && parser.attribute("t") == "shared";
-                            formula_value_string = parser.value();
-                        }
-                        else if (parser.qname() == xml::qname(xmlns, "is"))
-                        {
-                            parser.next_expect(xml::parser::event_type::start_element, xmlns, "t");
-                            value_string = parser.value();
-                            parser.next_expect(xml::parser::event_type::end_element, xmlns, "t");
-                        }
-                        
-                        parser.next_expect(xml::parser::event_type::end_element, parser.qname());
-                    }
-
-                    if (has_formula && !has_shared_formula && !ws.get_workbook().get_data_only())
-                    {
-                        cell.set_formula(formula_value_string);
-                    }
-
-                    if (has_type && (type == "inlineStr" || type =="str"))
-                    {
-                        cell.set_value(value_string);
-                    }
-                    else if (has_type && type == "s" && !has_formula)
-                    {
-                        auto shared_string_index = static_cast<std::size_t>(std::stoull(value_string));
-                        auto shared_string = shared_strings.at(shared_string_index);
-                        cell.set_value(shared_string);
-                    }
-                    else if (has_type && type == "b") // boolean
-                    {
-                        cell.set_value(value_string != "0");
-                    }
-                    else if (has_value && !value_string.empty())
-                    {
-                        if (!value_string.empty() && value_string[0] == '#')
-                        {
-                            cell.set_error(value_string);
-                        }
-                        else
-                        {
-                            cell.set_value(std::stold(value_string));
-                        }
-                    }
-
-                    if (has_format)
-                    {
-                        cell.set_format(destination_.get_format(format_id));
-                    }
-                    
-                    parser.next_expect(xml::parser::event_type::end_element, xmlns, "c");
-                }
+                // rows are in ascending order so nothing else in the part is needed
+                return;
             }
-            
+
             parser.next_expect(xml::parser::event_type::end_element, xmlns, "sheetData");
         }
         else if (parser.qname() == xml::qname(xmlns, "cols"))
@@ -1620,7 +2320,7 @@ void xlsx_consumer::read_worksheet(const std::string &rel_id, xml::parser &parse
 
                 auto min = static_cast<column_t::index_t>(std::stoull(parser.attribute("min")));
                 auto max = static_cast<column_t::index_t>(std::stoull(parser.attribute("max")));
-                auto width = std::stold(parser.attribute("width"));
+                auto width = std::stod(parser.attribute("width"));
                 bool custom = parser.attribute("customWidth") == std::string("1");
                 auto column_style = static_cast<std::size_t>(parser.attribute_present("style") ? std::stoull(parser.attribute("style")) : 0);
 
@@ -1661,11 +2361,154 @@ void xlsx_consumer::read_worksheet(const std::string &rel_id, xml::parser &parse
             
             parser.next_expect(xml::parser::event_type::end_element, xmlns, "pageMargins");
         }
+        else
+        {
+            skip_element(parser);
+        }
     }
     
     parser.next_expect(xml::parser::event_type::end_element, xmlns, "worksheet");
 }
 
+bool xlsx_consumer::read_sheet_data(worksheet_impl &sheet, const char *first, const char *last, row_t &row_index)
+{
+	const auto &options = destination_.d_->load_options_;
+	const auto &shared_strings = *destination_.d_->shared_strings_;
+	const auto read_formulas = !options.skip_formulas && !destination_.get_data_only();
+	worksheet ws(&sheet);
+
+	// columns[i] is true if cells in column i are loaded
+	std::vector<bool> columns;
+
+	for (const auto &column : options.columns)
+	{
+		columns.resize(std::max(columns.size(), static_cast<std::size_t>(column.index) + 1), false);
+		columns[column.index] = true;
+	}
+
+	sheet_data_scanner scanner(first, last);
+	sheet_data_scanner::row_record row;
+	sheet_data_scanner::cell_record record;
+
+	while (scanner.next_row(row))
+	{
+		// r is optional for rows and cells, which then follow the previous one
+		row_index = row.index != 0 ? row.index : row_index + 1;
+
+		if (row_index < options.first_row) continue;
+		if (row_index > options.last_row) return false;
+
+		if (!row.height.empty() && !options.skip_row_column_properties)
+		{
+			ws.get_row_properties(row_index).height = std::strtod(row.height.first, nullptr);
+		}
+
+		cell_store::row_map *row_cells = nullptr;
+		std::size_t column_index = 0;
+
+		while (scanner.next_cell(record))
+		{
+			column_index = record.reference.empty() ? column_index + 1
+				: column_index_of(record.reference.first, record.reference.last);
+
+			if (!columns.empty() && (column_index >= columns.size() || !columns[column_index]))
+			{
+				continue;
+			}
+
+			if (row_cells == nullptr)
+			{
+				row_cells = &sheet.cell_map_[row_index];
+			}
+
+			auto &impl = (*row_cells)[static_cast<column_t::index_t>(column_index)];
+
+			// rows start at 1 so a cell that was just added has none yet
+			if (impl.row_ == 0)
+			{
+				impl.column_ = static_cast<column_t::index_t>(column_index);
+				impl.row_ = row_index;
+			}
+
+			xlnt::cell cell(&impl, &sheet);
+			const auto &type = record.type;
+			const auto has_formula = record.has_formula && !options.skip_formulas;
+
+			if (has_formula && read_formulas && !record.formula_type.equals("shared"))
+			{
+				cell.set_formula(record.formula.to_string());
+			}
+
+			std::int64_t integer = 0;
+
+			if (type.equals("inlineStr") || type.equals("str")
+				|| (type.equals("s") && !has_formula && (!record.has_value || record.value.empty())))
+			{
+				// strings that aren't shared are kept in the cell, as formula results are, rather
+				// than added to the shared strings, which would look them up in the table first.
+				// Empty strings are written as shared strings without a value.
+				const auto characters = record.has_inline_string ? record.inline_string
+					: type.equals("s") ? std::string() : record.value.to_string();
+
+				if (characters.empty())
+				{
+					impl.clear_value_text();
+				}
+				else
+				{
+					sheet.cell_map_.extras(impl).value_text_.set_plain_string(characters);
+				}
+
+				impl.type_ = cell::type::string;
+				impl.value_string_index_ = cell_impl::no_string_index;
+			}
+			else if (type.equals("s") && !has_formula)
+			{
+				if (!parse_integer(record.value.first, record.value.last, integer)
+					|| integer < 0 || static_cast<std::size_t>(integer) >= shared_strings.size())
+				{
+					throw invalid_file("shared string index out of range");
+				}
+
+				// the string is already in the table so it's referenced rather than added again
+				impl.type_ = cell::type::string;
+				impl.value_string_index_ = static_cast<std::uint32_t>(integer);
+			}
+			else if (type.equals("b")) // boolean
+			{
+				cell.set_value(!record.value.equals("0"));
+			}
+			else if (record.has_value && !record.value.empty())
+			{
+				if (*record.value.first == '#')
+				{
+					cell.set_error(record.value.to_string());
+				}
+				else if (record.value.escaped)
+				{
+					cell.set_value(std::stod(record.value.to_string()));
+				}
+				else if (parse_integer(record.value.first, record.value.last, integer))
+				{
+					cell.set_value(integer);
+				}
+				else
+				{
+					// the value is followed by the end tag of v so strtod stops there
+					cell.set_value(std::strtod(record.value.first, nullptr));
+				}
+			}
+
+			if (!record.style.empty() && !options.skip_styles)
+			{
+				cell.set_format(destination_.get_format(std::strtoul(record.style.first, nullptr, 10)));
+			}
+		}
+	}
+
+	return true;
+}
+
 // Sheet Relationship Target Parts
 
 void xlsx_consumer::read_comments(xml::parser &/*parser*/)
@@ -25,21 +25,29 @@
 
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include <detail/include_libstudxml.hpp>
 #include <xlnt/xlnt_config.hpp>
+#include <xlnt/cell/index_types.hpp>
 #include <xlnt/packaging/zip_file.hpp>
 
 namespace xlnt {
 
+class input_source;
 class path;
 class relationship;
+class text;
 class workbook;
+class worksheet_summary;
 
 namespace detail {
 
+struct worksheet_impl;
+
 /// <summary>
 /// Handles writing a workbook into an XLSX file.
 /// </summary>
@@ -54,6 +62,31 @@ public:
 
 	void read(const std::vector<std::uint8_t> &source);
 
+	void read(input_source &source);
+
+	/// <summary>
+	/// Read only as much of the archive as is needed to summarize each of its
+	/// sheets. See workbook::probe.
+	/// </summary>
+	std::vector<worksheet_summary> probe(const path &source);
+
+	std::vector<worksheet_summary> probe(std::istream &source);
+
+	std::vector<worksheet_summary> probe(const std::vector<std::uint8_t> &source);
+
+	std::vector<worksheet_summary> probe(input_source &source);
+
+	/// <summary>
+	/// Parse the part of a worksheet which was skipped by a lazy load.
+	/// Does nothing if sheet has already been parsed.
+	/// </summary>
+	static void read_deferred_worksheet(worksheet_impl &sheet);
+
+	/// <summary>
+	/// Parse a single si element of a shared string table.
+	/// </summary>
+	static text read_shared_string(const std::string &xml);
+
 private:
 	/// <summary>
 	/// Read all the files needed from the XLSX archive and initialize all of
@@ -61,6 +94,11 @@ private:
 	/// </summary>
 	void populate_workbook();
 
+	/// <summary>
+	/// Read the manifest and workbook part and then summarize every sheet they declare.
+	/// </summary>
+	std::vector<worksheet_summary> summarize_sheets();
+
 	// Package Parts
 
 	void read_manifest();
@@ -92,7 +130,23 @@ private:
 
 	void read_chartsheet(const std::string &title, xml::parser &parser);
 	void read_dialogsheet(const std::string &title, xml::parser &parser);
-	void read_worksheet(const std::string &title, xml::parser &parser);
+	bool is_selected(const std::string &rel_id) const;
+	worksheet_impl &read_worksheet_declaration(const std::string &rel_id);
+	void read_worksheet(worksheet_impl &sheet, const path &part);
+	void read_worksheet(worksheet_impl &sheet, xml::parser &parser,
+		const char *sheet_data_first, const char *sheet_data_last);
+
+	/// <summary>
+	/// Read a large worksheet part while another thread is still inflating it.
+	/// </summary>
+	void read_pipelined_worksheet(worksheet_impl &sheet, const path &part);
+
+	/// <summary>
+	/// Read the rows of a worksheet from all or part of the content of its sheetData
+	/// element. row_index is the index of the row read before, or 0 at the start.
+	/// Returns false if reading stopped before the end because of load_options::last_row.
+	/// </summary>
+	bool read_sheet_data(worksheet_impl &sheet, const char *first, const char *last, row_t &row_index);
 
 	// Sheet Relationship Target Parts
 
@@ -106,12 +160,31 @@ private:
 
 	/// <summary>
 	/// A reference to the archive from which files representing the workbook
-    /// are read.
+    /// are read. Lazily loaded worksheets keep it alive after the load.
 	/// </summary>
-	zip_file source_;
+	std::shared_ptr<zip_file> source_;
 
-	std::unordered_map<std::string, std::size_t> sheet_title_id_map_;
-	std::unordered_map<std::string, std::size_t> sheet_title_index_map_;
+	/// <summary>
+	/// A worksheet declared in workbook.xml.
+	/// </summary>
+	struct sheet_declaration
+	{
+		std::string title;
+		std::size_t id;
+		std::size_t index;
+	};
+
+	/// <summary>
+	/// The worksheets declared in workbook.xml by the id of the relationship targeting them.
+	/// </summary>
+	std::unordered_map<std::string, sheet_declaration> sheet_declarations_;
+
+	/// <summary>
+	/// The tab positions of the worksheets read so far in ascending order.
+	/// Worksheet parts can be read in any order so this is used to insert each
+	/// one at the right position.
+	/// </summary>
+	std::vector<std::size_t> read_sheet_indices_;
 
 	/// <summary>
 	/// A reference to the workbook which is being read.
@@ -1,13 +1,22 @@
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <sstream>
 #include <string>
 
 #include <detail/custom_value_traits.hpp>
+#include <detail/shared_string_table.hpp>
+#include <detail/sheet_data_writer.hpp>
+#include <detail/static_part_cache.hpp>
 #include <detail/xlsx_producer.hpp>
 #include <detail/constants.hpp>
 #include <detail/workbook_impl.hpp>
+#include <detail/worksheet_impl.hpp>
 #include <xlnt/cell/cell.hpp>
 #include <xlnt/utils/path.hpp>
+#include <xlnt/packaging/deflate_cache.hpp>
 #include <xlnt/packaging/manifest.hpp>
+#include <xlnt/packaging/output_sink.hpp>
 #include <xlnt/packaging/zip_file.hpp>
 #include <xlnt/workbook/const_worksheet_iterator.hpp>
 #include <xlnt/workbook/workbook.hpp>
@@ -24,11 +33,12 @@ namespace {
 const bool skip_unknown_elements = true;
 
 /// <summary>
-/// Returns true if d is exactly equal to an integer.
+/// Returns true if d is exactly equal to an integer that fits in a long long.
 /// </summary>
-bool is_integral(long double d)
+bool is_integral(double d)
 {
-	return d == static_cast<long long int>(d);
+	return d >= -9223372036854775808.0 && d < 9223372036854775808.0
+		&& d == static_cast<double>(static_cast<long long int>(d));
 }
 
 std::string fill(const std::string &string, std::size_t length = 2)
@@ -51,40 +61,76 @@ std::string datetime_to_w3cdtf(const xlnt::datetime &dt)
         + fill(std::to_string(dt.second)) + "Z";
 }
 
+// Whether the cell is written as a reference to its shared string. Formula results
+// aren't, and other cells may still hold the index of a string they no longer show.
+bool is_shared_string(const xlnt::detail::cell_impl &cell)
+{
+	return cell.type_ == xlnt::cell_type::string && !cell.formula()
+		&& cell.value_string_index_ != xlnt::detail::cell_impl::no_string_index;
+}
+
 } // namespace
 
 namespace xlnt {
 namespace detail {
 
-xlsx_producer::xlsx_producer(const workbook &target) : source_(target)
+xlsx_producer::xlsx_producer(const workbook &target, const save_options &options)
+    : source_(target),
+      serializer_(nullptr),
+      part_stream_(nullptr),
+      options_(options),
+      manifest_(target.get_manifest()),
+      calculation_chain_(target.d_->calculation_chain_),
+      strings_(nullptr),
+      shared_string_count_(0)
+{
+}
+
+xlsx_producer::~xlsx_producer()
 {
 }
 
 void xlsx_producer::write(const path &destination)
 {
+	// each part is compressed into the file as soon as it's written instead of
+	// building the whole archive in memory and copying it out at the end
+	destination_.begin_write(destination);
 	populate_archive();
-	destination_.save(destination);
+	destination_.end_write();
 }
 
 void xlsx_producer::write(std::ostream &destination)
 {
-	populate_archive();
-	destination_.save(destination);
+	ostream_sink sink(destination);
+	write(sink);
 }
 
 void xlsx_producer::write(std::vector<std::uint8_t> &destination)
 {
+	destination.clear();
+	vector_sink sink(destination);
+	write(sink);
+}
+
+void xlsx_producer::write(output_sink &destination)
+{
+	destination_.begin_write(destination);
 	populate_archive();
-	destination_.save(destination);
+	destination_.end_write();
 }
 
 // Part Writing Methods
 
 void xlsx_producer::populate_archive()
 {
+	plan_calculation_chain();
+
+	// the shared string table is written before the worksheets that refer to it
+	plan_strings();
+
 	write_content_types();
     
-    const auto root_rels = source_.get_manifest().get_relationships(path("/"));
+    const auto root_rels = manifest_.get_relationships(path("/"));
     write_relationships(root_rels, path("/"));
 
 	for (auto &rel : root_rels)
@@ -92,6 +138,7 @@ void xlsx_producer::populate_archive()
         std::ostringstream serializer_stream;
         xml::serializer serializer(serializer_stream, rel.get_target().get_path().string());
         serializer_ = &serializer;
+        part_stream_ = &serializer_stream;
 
         bool write_document = true;
 
@@ -124,7 +171,7 @@ void xlsx_producer::populate_archive()
 
         if (write_document)
         {
-            destination_.write_string(serializer_stream.str(), rel.get_target().get_path());
+            write_part(serializer_stream.str(), rel.get_target().get_path());
         }
 	}
 
@@ -146,26 +193,26 @@ void xlsx_producer::write_content_types()
     content_types_serializer.start_element(xmlns, "Types");
     content_types_serializer.namespace_decl(xmlns, "");
 
-	for (const auto &extension : source_.get_manifest().get_extensions_with_default_types())
+	for (const auto &extension : manifest_.get_extensions_with_default_types())
 	{
         content_types_serializer.start_element(xmlns, "Default");
         content_types_serializer.attribute("Extension", extension);
 		content_types_serializer.attribute("ContentType",
-            source_.get_manifest().get_default_type(extension));
+            manifest_.get_default_type(extension));
         content_types_serializer.end_element(xmlns, "Default");
 	}
 
-	for (const auto &part : source_.get_manifest().get_parts_with_overriden_types())
+	for (const auto &part : manifest_.get_parts_with_overriden_types())
 	{
         content_types_serializer.start_element(xmlns, "Override");
         content_types_serializer.attribute("PartName", part.resolve(path("/")).string());
 		content_types_serializer.attribute("ContentType",
-            source_.get_manifest().get_override_type(part));
+            manifest_.get_override_type(part));
         content_types_serializer.end_element(xmlns, "Override");
 	}
     
     content_types_serializer.end_element(xmlns, "Types");
-    destination_.write_string(content_types_stream.str(), path("[Content_Types].xml"));
+    write_part(content_types_stream.str(), path("[Content_Types].xml"));
 }
 
 void xlsx_producer::write_extended_properties(const relationship &rel)
@@ -199,9 +246,9 @@ void xlsx_producer::write_extended_properties(const relationship &rel)
     serializer().attribute("size", source_.get_sheet_titles().size());
     serializer().attribute("baseType", "lpstr");
 
-	for (auto ws : source_)
+	for (const auto &title : source_.get_sheet_titles())
 	{
-        serializer().element(xmlns_vt, "lpstr", ws.get_title());
+        serializer().element(xmlns_vt, "lpstr", title);
 	}
 
     serializer().end_element(xmlns_vt, "vector");
@@ -278,8 +325,17 @@ void xlsx_producer::write_workbook(const relationship &rel)
 	std::size_t num_visible = 0;
 	bool any_defined_names = false;
 
-	for (auto ws : source_)
+	for (auto &sheet : source_.d_->worksheets_)
 	{
+		// worksheets that are still unparsed are written as they were loaded
+		if (sheet.is_deferred())
+		{
+			num_visible++;
+			continue;
+		}
+
+		worksheet ws(&sheet);
+
 		if (!ws.has_page_setup() || ws.get_page_setup().get_sheet_state() == sheet_state::visible)
 		{
 			num_visible++;
@@ -399,14 +455,23 @@ void xlsx_producer::write_workbook(const relationship &rel)
 		serializer().element(xmlns, "definedNames", "");
 	}
 
-	for (const auto ws : source_)
+	for (auto &sheet : source_.d_->worksheets_)
 	{
-		auto sheet_rel_id = source_.d_->sheet_title_rel_id_map_[ws.get_title()];
-		auto sheet_rel = source_.d_->manifest_.get_relationship(rel.get_source().get_path(), sheet_rel_id);
+		auto sheet_rel_id = source_.d_->worksheets_.get_rel_id(sheet);
 
 		serializer().start_element(xmlns, "sheet");
-		serializer().attribute("name", ws.get_title());
-		serializer().attribute("sheetId", ws.get_id());
+		serializer().attribute("name", sheet.title_);
+		serializer().attribute("sheetId", sheet.id_);
+
+		if (sheet.is_deferred())
+		{
+			serializer().attribute(xmlns_r, "id", sheet_rel_id);
+			serializer().end_element(xmlns, "sheet");
+
+			continue;
+		}
+
+		worksheet ws(&sheet);
 
 		if (ws.has_page_setup() && ws.get_sheet_state() == xlnt::sheet_state::hidden)
 		{
@@ -443,6 +508,15 @@ void xlsx_producer::write_workbook(const relationship &rel)
             serializer().attribute("calcMode", "auto");
             serializer().attribute("fullCalcOnLoad", "1");
         }
+
+        const auto &properties = source_.d_->calculation_properties_;
+
+        if (properties.iterate)
+        {
+            serializer().attribute("iterate", write_bool(true));
+            serializer().attribute("iterateCount", properties.iterate_count);
+            serializer().attribute("iterateDelta", properties.iterate_delta);
+        }
         
         serializer().attribute("concurrentCalc", "0");
         serializer().end_element(xmlns, "calcPr");
@@ -481,14 +555,45 @@ void xlsx_producer::write_workbook(const relationship &rel)
 
     serializer().end_element(xmlns, "workbook");
     
-    auto workbook_rels = source_.get_manifest().get_relationships(rel.get_target().get_path());
+    auto workbook_rels = manifest_.get_relationships(rel.get_target().get_path());
     write_relationships(workbook_rels, rel.get_target().get_path());
     
     for (const auto &child_rel : workbook_rels)
     {
+		path archive_path(child_rel.get_source().get_path().parent().append(child_rel.get_target().get_path()));
+
+        // copy the stylesheet of a file that was loaded without styles as it was
+        if (child_rel.get_type() == relationship::type::styles
+            && source_.d_->unread_stylesheet_archive_ != nullptr
+            && source_.d_->stylesheet_->formats.empty())
+        {
+            destination_.copy_file(*source_.d_->unread_stylesheet_archive_, source_.d_->unread_stylesheet_part_);
+            continue;
+        }
+
+        if (child_rel.get_type() == relationship::type::worksheet)
+        {
+            auto sheet = source_.d_->worksheets_.find_by_rel_id(child_rel.get_id());
+
+            // copy the still compressed part of a worksheet that was never accessed after a lazy load
+            if (sheet != nullptr && sheet->is_deferred())
+            {
+                destination_.copy_file(*sheet->deferred_archive_, sheet->deferred_part_);
+                continue;
+            }
+        }
+
+        // the theme is always the default one so it's compressed once per process
+        if (child_rel.get_type() == relationship::type::theme)
+        {
+            destination_.write_compressed(*static_part_cache::instance().get(theme_xml(child_rel)), archive_path);
+            continue;
+        }
+
         std::ostringstream child_stream;
         xml::serializer child_serializer(child_stream, child_rel.get_target().get_path().string());
         serializer_ = &child_serializer;
+        part_stream_ = &child_stream;
         
         switch (child_rel.get_type())
         {
@@ -536,10 +641,6 @@ void xlsx_producer::write_workbook(const relationship &rel)
 			write_styles(child_rel);
 			break;
             
-		case relationship::type::theme:
-			write_theme(child_rel);
-			break;
-            
 		case relationship::type::volatile_dependencies:
 			write_volatile_dependencies(child_rel);
 			break;
@@ -552,16 +653,192 @@ void xlsx_producer::write_workbook(const relationship &rel)
             break;
 		}
         
-		path archive_path(child_rel.get_source().get_path().parent().append(child_rel.get_target().get_path()));
-        destination_.write_string(child_stream.str(), archive_path);
+        write_part(child_stream.str(), archive_path);
     }
 }
 
+void xlsx_producer::write_part(const std::string &content, const path &archive_path)
+{
+	if (options_.compression_cache != nullptr)
+	{
+		destination_.write_compressed(*options_.compression_cache->get(content), archive_path);
+	}
+	else
+	{
+		destination_.write_string(content, archive_path);
+	}
+}
+
+void xlsx_producer::plan_calculation_chain()
+{
+	calculation_chain_.reconcile(source_.d_->worksheets_);
+
+	if (!manifest_.has_relationship(path("/"), relationship::type::office_document))
+	{
+		return;
+	}
+
+	auto wb_target = manifest_.get_relationship(path("/"), relationship::type::office_document).get_target();
+	auto has_chain_rel = manifest_.has_relationship(wb_target.get_path(), relationship::type::calculation_chain);
+	const auto chain_part = path("/").append(wb_target.get_path().parent()).append("calcChain.xml");
+
+	if (!calculation_chain_.empty() && !has_chain_rel)
+	{
+		manifest_.register_override_type(chain_part,
+			"application/vnd.openxmlformats-officedocument.spreadsheetml.calcChain+xml");
+		manifest_.register_relationship(wb_target, relationship::type::calculation_chain,
+			uri("calcChain.xml"), target_mode::internal);
+	}
+	else if (calculation_chain_.empty() && has_chain_rel)
+	{
+		auto chain_rel = manifest_.get_relationship(wb_target.get_path(), relationship::type::calculation_chain);
+		manifest_.unregister_override_type(path("/").append(wb_target.get_path().parent())
+			.append(chain_rel.get_target().get_path()));
+		manifest_.unregister_relationship(wb_target, chain_rel.get_id());
+	}
+}
+
+void xlsx_producer::plan_strings()
+{
+	const auto &table = *source_.d_->shared_strings_;
+	strings_ = &table;
+	rebuilt_strings_.reset();
+	string_indices_.clear();
+	inline_columns_.clear();
+
+	auto all_parsed = true;
+
+	for (const auto &sheet : source_.d_->worksheets_)
+	{
+		all_parsed = all_parsed && !sheet.is_deferred();
+	}
+
+	// cells of worksheets that haven't been parsed refer to the table as it is
+	const auto rebuild = options_.rebuild_shared_strings && all_parsed;
+	std::vector<bool> used(rebuild ? table.size() : 0, false);
+	std::size_t shared_count = 0;
+
+	for (const auto &sheet : source_.d_->worksheets_)
+	{
+		if (sheet.is_deferred()) continue;
+
+		auto &inline_columns = inline_columns_[&sheet];
+
+		if (options_.strings == save_options::string_storage::automatic)
+		{
+			// the distinct strings and the number of string cells in each column
+			std::unordered_map<column_t::index_t, std::pair<std::unordered_set<std::uint32_t>, std::size_t>> columns;
+
+			for (const auto &row : sheet.cell_map_)
+			{
+				for (const auto &cell : row.second)
+				{
+					if (!is_shared_string(cell.second)) continue;
+
+					auto &column = columns[cell.first.index];
+					column.first.insert(cell.second.value_string_index_);
+					++column.second;
+				}
+			}
+
+			for (const auto &column : columns)
+			{
+				// inline unless each string is used at least twice on average
+				if (column.second.first.size() * 2 > column.second.second)
+				{
+					inline_columns.insert(column.first);
+				}
+			}
+		}
+
+		for (const auto &row : sheet.cell_map_)
+		{
+			for (const auto &cell : row.second)
+			{
+				const auto index = cell.second.value_string_index_;
+
+				if (!is_shared_string(cell.second)
+					|| is_written_inline(inline_columns, cell.first.index, index)) continue;
+
+				++shared_count;
+
+				if (rebuild)
+				{
+					used[index] = true;
+				}
+			}
+		}
+	}
+
+	shared_string_count_ = all_parsed ? shared_count : std::numeric_limits<std::size_t>::max();
+
+	if (!rebuild) return;
+
+	// the strings that are still used keep their order
+	rebuilt_strings_.reset(new shared_string_table());
+	string_indices_.assign(table.size(), cell_impl::no_string_index);
+
+	for (std::size_t i = 0; i < table.size(); ++i)
+	{
+		if (!used[i]) continue;
+
+		string_indices_[i] = static_cast<std::uint32_t>(table.is_plain(i)
+			? rebuilt_strings_->add(table.get_plain_string(i))
+			: rebuilt_strings_->add(table.get(i), false));
+	}
+
+	strings_ = rebuilt_strings_.get();
+}
+
+bool xlsx_producer::is_written_inline(const std::unordered_set<column_t::index_t> &inline_columns,
+	column_t::index_t column, std::uint32_t index) const
+{
+	switch (options_.strings)
+	{
+	case save_options::string_storage::inline_:
+		break;
+	case save_options::string_storage::automatic:
+		if (inline_columns.find(column) == inline_columns.end()) return false;
+		break;
+	default:
+		return false;
+	}
+
+	// formatted strings can only be written inline as runs, which is left to the table
+	return source_.d_->shared_strings_->is_plain(index);
+}
+
 // Write Workbook Relationship Target Parts
 
-void xlsx_producer::write_calculation_chain(const relationship &rel)
+void xlsx_producer::write_calculation_chain(const relationship &/*rel*/)
 {
-	serializer().start_element("calcChain");
+    static const auto xmlns = constants::get_namespace("workbook");
+
+    serializer().start_element(xmlns, "calcChain");
+    serializer().namespace_decl(xmlns, "");
+
+    std::size_t previous_sheet_id = 0;
+
+    for (const auto &entry : calculation_chain_.entries())
+    {
+        serializer().start_element(xmlns, "c");
+        serializer().attribute("r", cell_reference(entry.column, entry.row).to_string());
+
+        if (entry.sheet_id != previous_sheet_id)
+        {
+            serializer().attribute("i", entry.sheet_id);
+            previous_sheet_id = entry.sheet_id;
+        }
+
+        if (entry.flags & detail::calculation_chain::new_level) serializer().attribute("l", "1");
+        if (entry.flags & detail::calculation_chain::child_chain) serializer().attribute("s", "1");
+        if (entry.flags & detail::calculation_chain::array) serializer().attribute("a", "1");
+        if (entry.flags & detail::calculation_chain::new_thread) serializer().attribute("t", "1");
+
+        serializer().end_element(xmlns, "c");
+    }
+
+    serializer().end_element(xmlns, "calcChain");
 }
 
 void xlsx_producer::write_chartsheet(const relationship &rel)
@@ -606,32 +883,21 @@ void xlsx_producer::write_shared_string_table(const relationship &rel)
 	serializer().start_element(xmlns, "sst");
     serializer().namespace_decl(xmlns, "");
 
-    // todo: is there a more elegant way to get this number?
-    std::size_t string_count = 0;
-
-    for (const auto ws : source_)
+    // count is optional and can't be known without parsing every worksheet
+    if (shared_string_count_ != std::numeric_limits<std::size_t>::max())
     {
-        for (const auto row : ws.rows())
-        {
-            for (const auto cell : row)
-            {
-                if (cell.get_data_type() == cell::type::string)
-                {
-                    ++string_count;
-                }
-            }
-        }
+        serializer().attribute("count", shared_string_count_);
     }
 
-	serializer().attribute("count", string_count);
-	serializer().attribute("uniqueCount", source_.get_shared_strings().size());
+    const auto &strings = *strings_;
+	serializer().attribute("uniqueCount", strings.size());
 
-	for (const auto &string : source_.get_shared_strings())
+	for (std::size_t i = 0; i < strings.size(); ++i)
 	{
-		if (string.get_runs().size() == 1 && !string.get_runs().at(0).has_formatting())
+		if (strings.is_plain(i))
 		{
             serializer().start_element(xmlns, "si");
-            serializer().element(xmlns, "t", string.get_plain_string());
+            serializer().element(xmlns, "t", strings.get_plain_string(i));
             serializer().end_element(xmlns, "si");
             
             continue;
@@ -639,7 +905,7 @@ void xlsx_producer::write_shared_string_table(const relationship &rel)
 
         serializer().start_element(xmlns, "si");
 
-        for (const auto &run : string.get_runs())
+        for (const auto &run : strings.get(i).get_runs())
         {
             serializer().start_element(xmlns, "r");
 
@@ -727,7 +993,7 @@ void xlsx_producer::write_styles(const relationship &rel)
         serializer().attribute(xmlns_mc, "Ignorable", "x14ac");
 	}
 
-	const auto &stylesheet = source_.impl().stylesheet_;
+	const auto &stylesheet = *source_.d_->stylesheet_;
 
 	// Number Formats
 
@@ -1673,6 +1939,23 @@ void xlsx_producer::write_theme(const relationship &rel)
     serializer().end_element(xmlns_a, "theme");
 }
 
+const std::string &xlsx_producer::theme_xml(const relationship &rel)
+{
+    static const std::string xml = [this, &rel]()
+    {
+        std::ostringstream theme_stream;
+        xml::serializer theme_serializer(theme_stream, rel.get_target().get_path().string());
+        auto previous_serializer = serializer_;
+        serializer_ = &theme_serializer;
+        write_theme(rel);
+        serializer_ = previous_serializer;
+
+        return theme_stream.str();
+    }();
+
+    return xml;
+}
+
 void xlsx_producer::write_volatile_dependencies(const relationship &rel)
 {
 	serializer().start_element("volTypes");
@@ -1680,14 +1963,14 @@ void xlsx_producer::write_volatile_dependencies(const relationship &rel)
 
 void xlsx_producer::write_worksheet(const relationship &rel)
 {
-	auto title = std::find_if(source_.d_->sheet_title_rel_id_map_.begin(),
-		source_.d_->sheet_title_rel_id_map_.end(),
-		[&](const std::pair<std::string, std::string> &p)
+	auto sheet = source_.d_->worksheets_.find_by_rel_id(rel.get_id());
+
+	if (sheet == nullptr)
 	{
-		return p.second == rel.get_id();
-	})->first;
+		throw key_not_found();
+	}
 
-	auto ws = source_.get_sheet_by_title(title);
+	worksheet ws(sheet);
 
     static const auto xmlns = constants::get_namespace("worksheet");
     static const auto xmlns_r = constants::get_namespace("r");
@@ -1826,7 +2109,11 @@ void xlsx_producer::write_worksheet(const relationship &rel)
 
 	bool has_column_properties = false;
 
-	for (auto column = ws.get_lowest_column(); column <= ws.get_highest_column(); column++)
+	// both of these look at every cell so they're only called once
+	const auto lowest_column = ws.get_lowest_column();
+	const auto highest_column = ws.get_highest_column();
+
+	for (auto column = lowest_column; column <= highest_column; column++)
 	{
 		if (ws.has_column_properties(column))
 		{
@@ -1839,7 +2126,7 @@ void xlsx_producer::write_worksheet(const relationship &rel)
 	{
 		serializer().start_element(xmlns, "cols");
 
-		for (auto column = ws.get_lowest_column(); column <= ws.get_highest_column(); column++)
+		for (auto column = lowest_column; column <= highest_column; column++)
 		{
 			if (!ws.has_column_properties(column)) continue;
 
@@ -1860,166 +2147,9 @@ void xlsx_producer::write_worksheet(const relationship &rel)
 	std::unordered_map<std::string, std::string> hyperlink_references;
 
 	serializer().start_element(xmlns, "sheetData");
-	const auto &shared_strings = ws.get_workbook().get_shared_strings();
-
-	for (auto row : ws.rows())
-	{
-		auto min = static_cast<xlnt::row_t>(row.num_cells());
-		xlnt::row_t max = 0;
-		bool any_non_null = false;
-
-		for (auto cell : row)
-		{
-			min = std::min(min, cell.get_column().index);
-			max = std::max(max, cell.get_column().index);
-
-			if (!cell.garbage_collectible())
-			{
-				any_non_null = true;
-			}
-		}
-
-		if (!any_non_null)
-		{
-			continue;
-		}
-
-		serializer().start_element(xmlns, "row");
-
-		serializer().attribute("r", row.front().get_row());
-		serializer().attribute("spans", std::to_string(min) + ":" + std::to_string(max));
-
-		if (ws.has_row_properties(row.front().get_row()))
-		{
-			serializer().attribute("customHeight", "1");
-			auto height = ws.get_row_properties(row.front().get_row()).height;
-
-			if (height == std::floor(height))
-			{
-				serializer().attribute("ht", std::to_string(static_cast<long long int>(height)) + ".0");
-			}
-			else
-			{
-				serializer().attribute("ht", height);
-			}
-		}
-
-        if (!skip_unknown_elements)
-        {
-            serializer().attribute(xmlns_x14ac, "dyDescent", 0.25);
-        }
-
-		for (auto cell : row)
-		{
-			if (!cell.garbage_collectible())
-			{
-				serializer().start_element(xmlns, "c");
-				serializer().attribute("r", cell.get_reference().to_string());
-            
-				if (cell.has_format())
-				{
-					serializer().attribute("s", cell.get_format().id());
-				}
-
-				if (cell.get_data_type() == cell::type::string)
-				{
-					if (cell.has_formula())
-					{
-						serializer().attribute("t", "str");
-						serializer().element(xmlns, "f", cell.get_formula());
-						serializer().element(xmlns, "v", cell.to_string());
-                        serializer().end_element(xmlns, "c");
-
-						continue;
-					}
-
-					int match_index = -1;
-
-					for (std::size_t i = 0; i < shared_strings.size(); i++)
-					{
-						if (shared_strings[i] == cell.get_value<text>())
-						{
-							match_index = static_cast<int>(i);
-							break;
-						}
-					}
-
-					if (match_index == -1)
-					{
-						if (cell.get_value<std::string>().empty())
-						{
-							serializer().attribute("t", "s");
-						}
-						else
-						{
-							serializer().attribute("t", "inlineStr");
-							serializer().start_element(xmlns, "is");
-							serializer().element(xmlns, "t", cell.get_value<std::string>());
-							serializer().end_element(xmlns, "is");
-						}
-					}
-					else
-					{
-						serializer().attribute("t", "s");
-						serializer().element(xmlns, "v", match_index);
-					}
-				}
-				else
-				{
-					if (cell.get_data_type() != cell::type::null)
-					{
-						if (cell.get_data_type() == cell::type::boolean)
-						{
-							serializer().attribute("t", "b");
-							serializer().element(xmlns, "v", write_bool(cell.get_value<bool>()));
-						}
-						else if (cell.get_data_type() == cell::type::numeric)
-						{
-							if (cell.has_formula())
-							{
-								serializer().element(xmlns, "f", cell.get_formula());
-								serializer().element(xmlns, "v", cell.to_string());
-                                serializer().end_element(xmlns, "c");
-
-								continue;
-							}
-
-							serializer().attribute("t", "n");
-							serializer().start_element(xmlns, "v");
-
-							if (is_integral(cell.get_value<long double>()))
-							{
-                                serializer().characters(cell.get_value<long long>());
-							}
-							else
-							{
-								std::stringstream ss;
-								ss.precision(20);
-								ss << cell.get_value<long double>();
-								ss.str();
-                                serializer().characters(ss.str());
-							}
-                            
-                            serializer().end_element(xmlns, "v");
-						}
-					}
-					else if (cell.has_formula())
-					{
-						serializer().element(xmlns, "f", cell.get_formula());
-						serializer().element(xmlns, "v", "");
-                        serializer().end_element(xmlns, "c");
-
-						continue;
-					}
-				}
-                
-                serializer().end_element(xmlns, "c");
-			}
-		}
-        
-        serializer().end_element(xmlns, "row");
-	}
-
+	// characters writes out the start tag so that the rows can follow it in the stream
+	serializer().characters("");
+	write_sheet_data(ws);
     serializer().end_element(xmlns, "sheetData");
 
 	if (ws.has_auto_filter())
@@ -2044,7 +2174,7 @@ void xlsx_producer::write_worksheet(const relationship &rel)
 		serializer().end_element(xmlns, "mergeCells");
 	}
 
-	const auto sheet_rels = source_.get_manifest().get_relationships(rel.get_target().get_path());
+	const auto sheet_rels = manifest_.get_relationships(rel.get_target().get_path());
 
 	if (!sheet_rels.empty())
 	{
@@ -2181,7 +2311,208 @@ void xlsx_producer::write_thumbnail(const relationship &rel)
 {
     const auto &thumbnail = source_.get_thumbnail();
     std::string thumbnail_string(thumbnail.begin(), thumbnail.end());
-    destination_.write_string(thumbnail_string, rel.get_target().get_path());
+    destination_.write_compressed(*static_part_cache::instance().get(thumbnail_string), rel.get_target().get_path());
+}
+
+void xlsx_producer::write_sheet_data(const worksheet &ws)
+{
+	const auto &cell_map = ws.d_->cell_map_;
+
+	std::vector<row_t> row_indices;
+	row_indices.reserve(cell_map.size());
+
+	for (const auto &row : cell_map)
+	{
+		row_indices.push_back(row.first);
+	}
+
+	std::sort(row_indices.begin(), row_indices.end());
+
+	std::vector<std::pair<column_t::index_t, cell_impl *>> row_cells;
+	sheet_data_writer writer(*part_stream_);
+
+	const auto &source_strings = *source_.d_->shared_strings_;
+	const auto &inline_columns = inline_columns_[ws.d_];
+
+	for (auto row_index : row_indices)
+	{
+		row_cells.clear();
+
+		for (const auto &entry : cell_map.at(row_index))
+		{
+			auto impl = const_cast<cell_impl *>(&entry.second);
+
+			if (!cell(impl, ws.d_).garbage_collectible())
+			{
+				row_cells.push_back({ entry.first.index, impl });
+			}
+		}
+
+		if (row_cells.empty()) continue;
+
+		std::sort(row_cells.begin(), row_cells.end(),
+			[](const std::pair<column_t::index_t, cell_impl *> &a, const std::pair<column_t::index_t, cell_impl *> &b)
+		{
+			return a.first < b.first;
+		});
+
+		writer.append("<row r=\"");
+		writer.append_unsigned(row_index);
+		writer.append("\" spans=\"");
+		writer.append_unsigned(row_cells.front().first);
+		writer.append(":");
+		writer.append_unsigned(row_cells.back().first);
+		writer.append("\"");
+
+		if (ws.has_row_properties(row_index))
+		{
+			writer.append(" customHeight=\"1\" ht=\"");
+			auto height = ws.get_row_properties(row_index).height;
+
+			if (height == std::floor(height))
+			{
+				writer.append_integer(static_cast<long long int>(height));
+				writer.append(".0");
+			}
+			else
+			{
+				std::ostringstream height_stream;
+				height_stream << height;
+				writer.append(height_stream.str().c_str());
+			}
+
+			writer.append("\"");
+		}
+
+		if (!skip_unknown_elements && ws.x14ac_enabled())
+		{
+			writer.append(" x14ac:dyDescent=\"0.25\"");
+		}
+
+		writer.append(">");
+
+		for (const auto &entry : row_cells)
+		{
+			const auto &impl = *entry.second;
+			cell current(entry.second, ws.d_);
+
+			writer.append("<c r=\"");
+			writer.append_reference(entry.first, row_index);
+			writer.append("\"");
+
+			if (impl.format_id_)
+			{
+				writer.append(" s=\"");
+				writer.append_unsigned(impl.format_id_.get());
+				writer.append("\"");
+			}
+
+			if (impl.formula())
+			{
+				// the cell holds the result of the last calculation, if any, which is
+				// written as the cached value of the formula
+				switch (impl.type_)
+				{
+				case cell::type::string:
+					writer.append(" t=\"str\"");
+					break;
+				case cell::type::boolean:
+					writer.append(" t=\"b\"");
+					break;
+				case cell::type::error:
+					writer.append(" t=\"e\"");
+					break;
+				default:
+					break;
+				}
+
+				writer.append("><f>");
+				writer.append_escaped(impl.formula().get());
+				writer.append("</f>");
+			}
+			else
+			{
+				switch (impl.type_)
+				{
+				case cell::type::string:
+					if (impl.value_string_index_ != cell_impl::no_string_index
+						&& is_written_inline(inline_columns, entry.first, impl.value_string_index_))
+					{
+						writer.append(" t=\"inlineStr\"><is><t>");
+						writer.append_escaped(source_strings.get_plain_string(impl.value_string_index_));
+						writer.append("</t></is></c>");
+					}
+					else if (impl.value_string_index_ != cell_impl::no_string_index)
+					{
+						writer.append(" t=\"s\"><v>");
+						writer.append_unsigned(rebuilt_strings_
+							? string_indices_[impl.value_string_index_] : impl.value_string_index_);
+						writer.append("</v></c>");
+					}
+					else if (impl.get_string(*ws.d_).empty())
+					{
+						writer.append(" t=\"s\"/>");
+					}
+					else
+					{
+						writer.append(" t=\"inlineStr\"><is><t>");
+						writer.append_escaped(impl.get_string(*ws.d_));
+						writer.append("</t></is></c>");
+					}
+					continue;
+				case cell::type::boolean:
+					writer.append(" t=\"b\">");
+					break;
+				case cell::type::error:
+					writer.append(" t=\"e\">");
+					break;
+				case cell::type::numeric:
+					writer.append(" t=\"n\">");
+					break;
+				default:
+					writer.append("/>");
+					continue;
+				}
+			}
+
+			switch (impl.type_)
+			{
+			case cell::type::string:
+			case cell::type::error:
+				writer.append("<v>");
+				writer.append_escaped(impl.get_string(*ws.d_));
+				writer.append("</v>");
+				break;
+			case cell::type::boolean:
+				writer.append("<v>");
+				writer.append(write_bool(current.get_value<bool>()).c_str());
+				writer.append("</v>");
+				break;
+			case cell::type::numeric:
+				writer.append("<v>");
+
+				if (is_integral(impl.value_numeric_))
+				{
+					writer.append_integer(current.get_value<long long>());
+				}
+				else
+				{
+					writer.append_double(impl.value_numeric_);
+				}
+
+				writer.append("</v>");
+				break;
+			default:
+				break;
+			}
+
+			writer.append("</c>");
+		}
+
+		writer.append("</row>");
+	}
+
+	writer.flush();
 }
 
 xml::serializer &xlsx_producer::serializer()
@@ -2199,6 +2530,23 @@ std::string xlsx_producer::write_bool(bool boolean) const
 	return boolean ? "true" : "false";
 }
 
+void xlsx_producer::write_numeric_value(const cell &c)
+{
+	auto value = c.get_value<double>();
+
+	if (is_integral(value))
+	{
+		serializer().characters(c.get_value<long long>());
+	}
+	else
+	{
+		std::stringstream ss;
+		ss.precision(std::numeric_limits<double>::max_digits10);
+		ss << value;
+		serializer().characters(ss.str());
+	}
+}
+
 
 void xlsx_producer::write_relationships(const std::vector<xlnt::relationship> &relationships, const path &part)
 {
@@ -2235,7 +2583,7 @@ void xlsx_producer::write_relationships(const std::vector<xlnt::relationship> &r
 	}
     
     rels_serializer.end_element(xmlns, "Relationships");
-    destination_.write_string(rels_stream.str(), rels_path);
+    write_part(rels_stream.str(), rels_path);
 }
 
 
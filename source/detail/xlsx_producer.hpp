@@ -25,11 +25,18 @@
 
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <detail/include_libstudxml.hpp>
 #include <xlnt/xlnt_config.hpp>
+#include <xlnt/cell/index_types.hpp>
+#include <xlnt/packaging/manifest.hpp>
 #include <xlnt/packaging/zip_file.hpp>
+#include <xlnt/workbook/save_options.hpp>
+#include <detail/calculation_chain.hpp>
 
 namespace xml {
 class serializer;
@@ -37,20 +44,28 @@ class serializer;
 
 namespace xlnt {
 
+class cell;
 class color;
+class output_sink;
 class path;
 class relationship;
 class workbook;
+class worksheet;
 
 namespace detail {
 
+class shared_string_table;
+struct worksheet_impl;
+
 /// <summary>
 /// Handles writing a workbook into an XLSX file.
 /// </summary>
 class XLNT_CLASS xlsx_producer
 {
 public:
-	xlsx_producer(const workbook &target);
+	xlsx_producer(const workbook &target, const save_options &options = save_options());
+
+	~xlsx_producer();
 
 	void write(const path &destination);
 
@@ -58,6 +73,8 @@ public:
 
 	void write(std::vector<std::uint8_t> &destination);
 
+	void write(output_sink &destination);
+
 private:
 	/// <summary>
 	/// Write all files needed to create a valid XLSX file which represents all
@@ -65,6 +82,31 @@ private:
 	/// </summary>
 	void populate_archive();
 
+	/// <summary>
+	/// Add a serialized part to the archive, going through options_.compression_cache if there is one.
+	/// </summary>
+	void write_part(const std::string &content, const path &archive_path);
+
+	/// <summary>
+	/// Bring copies of the workbook's calculation chain and manifest up to date with
+	/// its formulas, so that the manifest only references xl/calcChain.xml when there
+	/// is a chain to write. The workbook itself isn't changed by saving it.
+	/// </summary>
+	void plan_calculation_chain();
+
+	/// <summary>
+	/// Decide which string cells are written inline and which refer to the shared
+	/// string table according to options_, and rebuild the table if requested.
+	/// </summary>
+	void plan_strings();
+
+	/// <summary>
+	/// Return true if the string cell in column of a worksheet with the given inline
+	/// columns that refers to shared string index is written inline.
+	/// </summary>
+	bool is_written_inline(const std::unordered_set<column_t::index_t> &inline_columns,
+		column_t::index_t column, std::uint32_t index) const;
+
 	// Package Parts
 
 	void write_content_types();
@@ -91,12 +133,23 @@ private:
 	void write_shared_workbook_user_data(const relationship &rel);
 	void write_styles(const relationship &rel);
 	void write_theme(const relationship &rel);
+
+	/// <summary>
+	/// The theme part as written by write_theme. Workbooks only have the default
+	/// Office theme so it's serialized once per process.
+	/// </summary>
+	const std::string &theme_xml(const relationship &rel);
 	void write_volatile_dependencies(const relationship &rel);
 
 	void write_chartsheet(const relationship &rel);
 	void write_dialogsheet(const relationship &rel);
 	void write_worksheet(const relationship &rel);
 
+	/// <summary>
+	/// Write the rows of ws straight into part_stream_ after the start tag of sheetData.
+	/// </summary>
+	void write_sheet_data(const worksheet &ws);
+
 	// Sheet Relationship Target Parts
 
 	void write_comments(const relationship &rel);
@@ -116,6 +169,12 @@ private:
 	/// we're trying to match.
 	/// </summary>
 	std::string write_bool(bool boolean) const;
+
+	/// <summary>
+	/// Write the numeric value of cell as the characters of the current element.
+	/// Integers are written without a decimal point.
+	/// </summary>
+	void write_numeric_value(const cell &c);
     
     void write_relationships(const std::vector<xlnt::relationship> &relationships, const path &part);
     void write_color(const xlnt::color &color);
@@ -145,6 +204,43 @@ private:
     /// store pointer in this field and access it in methods with xlsx_producer::serializer().
     /// </summary>
     xml::serializer *serializer_;
+
+    /// <summary>
+    /// The stream serializer_ writes the current part into. The content of sheetData
+    /// is written to it directly.
+    /// </summary>
+    std::ostream *part_stream_;
+
+	save_options options_;
+
+	/// <summary>
+	/// The manifest and calculation chain that are written, see plan_calculation_chain.
+	/// </summary>
+	manifest manifest_;
+	calculation_chain calculation_chain_;
+
+	/// <summary>
+	/// The shared string table that is written, either the workbook's or rebuilt_strings_.
+	/// </summary>
+	const shared_string_table *strings_;
+	std::unique_ptr<shared_string_table> rebuilt_strings_;
+
+	/// <summary>
+	/// If the table was rebuilt, the index in it of each string of the workbook's table.
+	/// </summary>
+	std::vector<std::uint32_t> string_indices_;
+
+	/// <summary>
+	/// The columns of each worksheet whose strings are written inline when
+	/// options_ asks for automatic string storage.
+	/// </summary>
+	std::unordered_map<const worksheet_impl *, std::unordered_set<column_t::index_t>> inline_columns_;
+
+	/// <summary>
+	/// The number of cells that refer to the shared string table or npos if
+	/// it can't be known because some worksheets haven't been parsed.
+	/// </summary>
+	std::size_t shared_string_count_;
 };
 
 } // namespace detail
@@ -0,0 +1,436 @@
+#pragma once
+
+#include <iostream>
+#include <cxxtest/TestSuite.h>
+
+#include <xlnt/xlnt.hpp>
+
+class test_formula : public CxxTest::TestSuite
+{
+public:
+    void test_arithmetic()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        ws.get_cell("A1").set_value("=1+2*3");
+        ws.get_cell("A2").set_value("=(1+2)*3");
+        ws.get_cell("A3").set_value("=2^3^2");
+        ws.get_cell("A4").set_value("=-2^2");
+        ws.get_cell("A5").set_value("=50%");
+        ws.get_cell("A6").set_value("=1/0");
+        ws.get_cell("A7").set_value("=\"a\"&1.5&TRUE");
+
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_data_type(), xlnt::cell::type::formula);
+
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_data_type(), xlnt::cell::type::numeric);
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_value<int>(), 7);
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_value<int>(), 9);
+        TS_ASSERT_EQUALS(ws.get_cell("A3").get_value<int>(), 64);
+        TS_ASSERT_EQUALS(ws.get_cell("A4").get_value<int>(), 4);
+        TS_ASSERT_EQUALS(ws.get_cell("A5").get_value<double>(), 0.5);
+        TS_ASSERT_EQUALS(ws.get_cell("A6").get_data_type(), xlnt::cell::type::error);
+        TS_ASSERT_EQUALS(ws.get_cell("A6").get_value<std::string>(), "#DIV/0!");
+        TS_ASSERT_EQUALS(ws.get_cell("A7").get_value<std::string>(), "a1.5TRUE");
+        TS_ASSERT_EQUALS(ws.get_cell("A7").get_formula(), "\"a\"&1.5&TRUE");
+    }
+
+    void test_comparison()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        ws.get_cell("A1").set_value(3);
+        ws.get_cell("B1").set_value("=A1>2");
+        ws.get_cell("B2").set_value("=A1<>3");
+        ws.get_cell("B3").set_value("=\"abc\"=\"ABC\"");
+        ws.get_cell("B4").set_value("=\"a\">5");
+        ws.get_cell("B5").set_value("=Z99=0");
+
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_data_type(), xlnt::cell::type::boolean);
+        TS_ASSERT(ws.get_cell("B1").get_value<bool>());
+        TS_ASSERT(!ws.get_cell("B2").get_value<bool>());
+        TS_ASSERT(ws.get_cell("B3").get_value<bool>());
+        TS_ASSERT(ws.get_cell("B4").get_value<bool>());
+        TS_ASSERT(ws.get_cell("B5").get_value<bool>());
+    }
+
+    void test_aggregates()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        ws.get_cell("A1").set_value(1);
+        ws.get_cell("A2").set_value(2);
+        ws.get_cell("A3").set_value("text");
+        ws.get_cell("A4").set_value(6);
+
+        ws.get_cell("B1").set_value("=SUM(A1:A4)");
+        ws.get_cell("B2").set_value("=AVERAGE(A1:A4)");
+        ws.get_cell("B3").set_value("=MIN(A1:A4, 0.5)");
+        ws.get_cell("B4").set_value("=MAX(A1:A4)");
+        ws.get_cell("B5").set_value("=COUNT(A1:A4, 1, \"x\")");
+        ws.get_cell("B6").set_value("=AVERAGE(C1:C5)");
+        ws.get_cell("B7").set_value("=SUM(A1:A2; \"3\")");
+
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 9);
+        TS_ASSERT_EQUALS(ws.get_cell("B2").get_value<int>(), 3);
+        TS_ASSERT_EQUALS(ws.get_cell("B3").get_value<double>(), 0.5);
+        TS_ASSERT_EQUALS(ws.get_cell("B4").get_value<int>(), 6);
+        TS_ASSERT_EQUALS(ws.get_cell("B5").get_value<int>(), 4);
+        TS_ASSERT_EQUALS(ws.get_cell("B6").get_value<std::string>(), "#DIV/0!");
+        TS_ASSERT_EQUALS(ws.get_cell("B7").get_value<int>(), 6);
+    }
+
+    void test_if()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        ws.get_cell("A1").set_value(5);
+        ws.get_cell("B1").set_value("=IF(A1<4;-1;1)");
+        ws.get_cell("B2").set_value("=IF(A1>4,\"big\")");
+        ws.get_cell("B3").set_value("=IF(A1>9,\"big\")");
+        ws.get_cell("B4").set_value("=IF(TRUE,1,1/0)");
+
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 1);
+        TS_ASSERT_EQUALS(ws.get_cell("B2").get_value<std::string>(), "big");
+        TS_ASSERT_EQUALS(ws.get_cell("B3").get_data_type(), xlnt::cell::type::boolean);
+        TS_ASSERT(!ws.get_cell("B3").get_value<bool>());
+        TS_ASSERT_EQUALS(ws.get_cell("B4").get_value<int>(), 1);
+    }
+
+    void test_lookup()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        ws.get_cell("A1").set_value(10);
+        ws.get_cell("A2").set_value(20);
+        ws.get_cell("A3").set_value(30);
+        ws.get_cell("B1").set_value("ten");
+        ws.get_cell("B2").set_value("twenty");
+        ws.get_cell("B3").set_value("thirty");
+
+        ws.get_cell("D1").set_value("=VLOOKUP(20,A1:B3,2,FALSE)");
+        ws.get_cell("D2").set_value("=VLOOKUP(25,A1:B3,2)");
+        ws.get_cell("D3").set_value("=VLOOKUP(25,A1:B3,2,FALSE)");
+        ws.get_cell("D4").set_value("=VLOOKUP(20,A1:B3,3,FALSE)");
+        ws.get_cell("D5").set_value("=INDEX(A1:B3,3,2)");
+        ws.get_cell("D6").set_value("=SUM(INDEX(A1:B3,0,1))");
+        ws.get_cell("D7").set_value("=MATCH(\"TWENTY\",B1:B3,0)");
+        ws.get_cell("D8").set_value("=MATCH(25,A1:A3)");
+        ws.get_cell("D9").set_value("=INDEX(B1:B3,MATCH(30,A1:A3,0))");
+
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("D1").get_value<std::string>(), "twenty");
+        TS_ASSERT_EQUALS(ws.get_cell("D2").get_value<std::string>(), "twenty");
+        TS_ASSERT_EQUALS(ws.get_cell("D3").get_value<std::string>(), "#N/A");
+        TS_ASSERT_EQUALS(ws.get_cell("D4").get_value<std::string>(), "#REF!");
+        TS_ASSERT_EQUALS(ws.get_cell("D5").get_value<std::string>(), "thirty");
+        TS_ASSERT_EQUALS(ws.get_cell("D6").get_value<int>(), 60);
+        TS_ASSERT_EQUALS(ws.get_cell("D7").get_value<int>(), 2);
+        TS_ASSERT_EQUALS(ws.get_cell("D8").get_value<int>(), 2);
+        TS_ASSERT_EQUALS(ws.get_cell("D9").get_value<std::string>(), "thirty");
+    }
+
+    void test_cross_sheet_and_named_range()
+    {
+        xlnt::workbook wb;
+        auto ws1 = wb.get_active_sheet();
+        auto ws2 = wb.create_sheet();
+        ws2.set_title("Data Sheet");
+
+        ws2.get_cell("A1").set_value(4);
+        ws2.get_cell("A2").set_value(5);
+        wb.create_named_range("values", ws2, "A1:A2");
+
+        ws1.get_cell("A1").set_value("='Data Sheet'!A1*2");
+        ws1.get_cell("A2").set_value("=SUM(values)");
+        ws1.get_cell("A3").set_value("=Missing!A1");
+        ws1.get_cell("A4").set_value("=undefined_name");
+
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws1.get_cell("A1").get_value<int>(), 8);
+        TS_ASSERT_EQUALS(ws1.get_cell("A2").get_value<int>(), 9);
+        TS_ASSERT_EQUALS(ws1.get_cell("A3").get_value<std::string>(), "#REF!");
+        TS_ASSERT_EQUALS(ws1.get_cell("A4").get_value<std::string>(), "#NAME?");
+
+        ws2.get_cell("A2").set_value(10);
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws1.get_cell("A2").get_value<int>(), 14);
+    }
+
+    void test_incremental_recalculation()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        ws.get_cell("A1").set_value(1);
+        ws.get_cell("A2").set_value("=A1+1");
+        ws.get_cell("A3").set_value("=A2*10");
+        ws.get_cell("B1").set_value("=SUM(A1:A3)");
+        ws.get_cell("C1").set_value("=5");
+
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("A3").get_value<int>(), 20);
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 23);
+
+        // Overwrite the cached result of a formula that doesn't depend on A1.
+        // A full recalculation would restore it, an incremental one leaves it alone.
+        ws.get_cell("C1").set_value(99);
+        ws.get_cell("A1").set_value(2);
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_value<int>(), 3);
+        TS_ASSERT_EQUALS(ws.get_cell("A3").get_value<int>(), 30);
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 35);
+        TS_ASSERT_EQUALS(ws.get_cell("C1").get_value<int>(), 99);
+
+        ws.get_cell("A2").set_formula("=A1*100");
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("A3").get_value<int>(), 2000);
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 2202);
+
+        ws.get_cell("A2").clear_value();
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("A3").get_value<int>(), 0);
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 2);
+    }
+
+    void test_circular_reference()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        ws.get_cell("A1").set_value("=B1+1");
+        ws.get_cell("B1").set_value("=A1+1");
+        ws.get_cell("C1").set_value("=C1");
+        ws.get_cell("D1").set_value("=7");
+
+        // cells that only depend on a cycle aren't part of it
+        ws.get_cell("E1").set_value("=C1*2+5");
+        ws.get_cell("F1").set_value("=E1+A1");
+
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_value<int>(), 0);
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 0);
+        TS_ASSERT_EQUALS(ws.get_cell("C1").get_value<int>(), 0);
+        TS_ASSERT_EQUALS(ws.get_cell("D1").get_value<int>(), 7);
+        TS_ASSERT_EQUALS(ws.get_cell("E1").get_value<int>(), 5);
+        TS_ASSERT_EQUALS(ws.get_cell("F1").get_value<int>(), 5);
+    }
+
+    void test_iterative_circular_reference()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        xlnt::calculation_properties properties;
+        properties.iterate = true;
+        properties.iterate_count = 1000;
+        properties.iterate_delta = 0.0001;
+        wb.set_calculation_properties(properties);
+
+        // converges to x = 10 + x / 2 = 20
+        ws.get_cell("A1").set_value("=10+A1/2");
+        ws.get_cell("C1").set_value("=A1*2");
+        wb.calculate();
+
+        TS_ASSERT_DELTA(ws.get_cell("A1").get_value<double>(), 20.0, 0.001);
+        TS_ASSERT_DELTA(ws.get_cell("C1").get_value<double>(), 40.0, 0.002);
+
+        properties.iterate_count = 3;
+        wb.set_calculation_properties(properties);
+        ws.get_cell("B1").set_value("=B1+1");
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 3);
+    }
+
+    void test_parallel_calculation()
+    {
+        const int rows = 20;
+        const int columns = 300;
+        std::vector<int> expected;
+
+        // workbooks don't start threads unless asked to
+        TS_ASSERT_EQUALS(xlnt::calculation_properties().thread_count, 1);
+
+        for (std::size_t threads : { 1, 4 })
+        {
+            xlnt::workbook wb;
+            auto ws = wb.get_active_sheet();
+
+            xlnt::calculation_properties properties;
+            properties.thread_count = threads;
+            wb.set_calculation_properties(properties);
+
+            for (int column = 1; column <= columns; ++column)
+            {
+                ws.get_cell(xlnt::cell_reference(column, 1)).set_value(column);
+            }
+
+            for (int row = 2; row <= rows; ++row)
+            {
+                for (int column = 1; column <= columns; ++column)
+                {
+                    auto left = xlnt::cell_reference(std::max(column - 1, 1), row - 1).to_string();
+                    auto above = xlnt::cell_reference(column, row - 1).to_string();
+                    ws.get_cell(xlnt::cell_reference(column, row)).set_formula(left + "+" + above + "-" + std::to_string(row));
+                }
+            }
+
+            wb.calculate();
+
+            std::vector<int> results;
+
+            for (int column = 1; column <= columns; ++column)
+            {
+                results.push_back(ws.get_cell(xlnt::cell_reference(column, rows)).get_value<int>());
+            }
+
+            if (expected.empty())
+            {
+                expected = results;
+            }
+            else
+            {
+                TS_ASSERT(results == expected);
+            }
+
+            ws.get_cell("A1").set_value(100);
+            wb.calculate();
+
+            TS_ASSERT_EQUALS(ws.get_cell(xlnt::cell_reference(1, 2)).get_value<int>(), 198);
+        }
+    }
+
+    void test_unsupported_function()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        ws.get_cell("A1").set_value("=NOW()");
+        ws.get_cell("A2").set_value("=1+");
+
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_data_type(), xlnt::cell::type::formula);
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_formula(), "NOW()");
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_formula(), "1+");
+    }
+
+    void test_sheet_changes()
+    {
+        xlnt::workbook wb;
+        auto ws1 = wb.get_active_sheet();
+
+        ws1.get_cell("A1").set_value("=Other!A1+1");
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws1.get_cell("A1").get_value<std::string>(), "#REF!");
+
+        auto ws2 = wb.create_sheet();
+        ws2.set_title("Other");
+        ws2.get_cell("A1").set_value(41);
+        wb.calculate();
+
+        TS_ASSERT_EQUALS(ws1.get_cell("A1").get_value<int>(), 42);
+    }
+
+    void test_save_writes_cached_values()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        ws.get_cell("A1").set_value(2);
+        ws.get_cell("A2").set_value("=A1*21");
+
+        // saving doesn't change the workbook, calculating is up to the caller
+        const auto uncalculated = ws.get_cell("A2").get_data_type();
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_data_type(), uncalculated);
+        TS_ASSERT_DIFFERS(uncalculated, xlnt::cell::type::numeric);
+
+        wb.calculate();
+        wb.save(data);
+
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_value<int>(), 42);
+
+        xlnt::workbook loaded;
+        loaded.load(data);
+        auto cell = loaded.get_active_sheet().get_cell("A2");
+
+        TS_ASSERT(cell.has_formula());
+        TS_ASSERT_EQUALS(cell.get_formula(), "A1*21");
+        TS_ASSERT_EQUALS(cell.get_data_type(), xlnt::cell::type::numeric);
+        TS_ASSERT_EQUALS(cell.get_value<int>(), 42);
+    }
+
+    void test_calculation_chain_round_trip()
+    {
+        xlnt::workbook wb;
+        auto ws1 = wb.get_active_sheet();
+        auto ws2 = wb.create_sheet();
+
+        ws1.get_cell("A1").set_value(1);
+        ws1.get_cell("B2").set_value("=A1+1");
+        ws1.get_cell("A2").set_value("=B2*2");
+        ws2.get_cell("C3").set_value("=SUM(" + ws1.get_title() + "!A1:B2)");
+        wb.calculate();
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+
+        xlnt::zip_file archive(data);
+        auto chain_xml = archive.read(xlnt::path("xl/calcChain.xml"));
+        TS_ASSERT_DIFFERS(chain_xml.find("r=\"A2\""), std::string::npos);
+        TS_ASSERT_DIFFERS(chain_xml.find("r=\"B2\""), std::string::npos);
+        TS_ASSERT_DIFFERS(chain_xml.find("r=\"C3\" i=\"2\""), std::string::npos);
+
+        xlnt::workbook loaded;
+        loaded.load(data);
+
+        auto workbook_part = loaded.get_manifest().get_relationship(xlnt::path("/"),
+            xlnt::relationship::type::office_document).get_target().get_path();
+        TS_ASSERT(loaded.get_manifest().has_relationship(workbook_part,
+            xlnt::relationship::type::calculation_chain));
+        TS_ASSERT_EQUALS(loaded.get_sheet_by_index(1).get_cell("C3").get_value<int>(), 7);
+
+        // removing a formula drops it from the chain, removing all of them drops the part
+        loaded.get_active_sheet().get_cell("A2").clear_formula();
+        loaded.save(data);
+        TS_ASSERT_EQUALS(xlnt::zip_file(data).read(xlnt::path("xl/calcChain.xml")).find("r=\"A2\""),
+            std::string::npos);
+
+        loaded.get_active_sheet().get_cell("B2").clear_formula();
+        loaded.get_sheet_by_index(1).get_cell("C3").clear_formula();
+        loaded.save(data);
+        TS_ASSERT(!xlnt::zip_file(data).has_file(xlnt::path("xl/calcChain.xml")));
+
+        // the saved manifest drops the part while the workbook's own is left as it was
+        TS_ASSERT(loaded.get_manifest().has_relationship(workbook_part,
+            xlnt::relationship::type::calculation_chain));
+        xlnt::workbook reloaded;
+        reloaded.load(data);
+        TS_ASSERT(!reloaded.get_manifest().has_relationship(workbook_part,
+            xlnt::relationship::type::calculation_chain));
+    }
+};
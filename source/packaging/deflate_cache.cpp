@@ -0,0 +1,197 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <miniz.h>
+#include <xlnt/packaging/deflate_cache.hpp>
+#include <xlnt/packaging/zip_file.hpp>
+#include <detail/sha256.hpp>
+
+namespace xlnt {
+namespace detail {
+
+struct deflate_cache_impl
+{
+	// identifies the uncompressed content of a part without keeping it
+	struct key
+	{
+		std::array<std::uint8_t, 32> digest;
+		std::size_t size;
+		std::uint32_t crc;
+
+		bool operator==(const key &other) const
+		{
+			return size == other.size && crc == other.crc && digest == other.digest;
+		}
+	};
+
+	struct key_hash
+	{
+		std::size_t operator()(const key &k) const
+		{
+			// the digest is already uniformly distributed
+			std::size_t hash = 0;
+			std::memcpy(&hash, k.digest.data(), sizeof(hash));
+
+			return hash;
+		}
+	};
+
+	struct entry
+	{
+		key hash;
+		std::shared_ptr<const compressed_file> compressed;
+
+		std::size_t size() const
+		{
+			return compressed->bytes.size();
+		}
+	};
+
+	deflate_cache_impl(std::size_t capacity)
+		: capacity(capacity), bytes(0), hits(0), misses(0)
+	{
+	}
+
+	void evict()
+	{
+		while (bytes > capacity && !entries.empty())
+		{
+			erase(std::prev(entries.end()));
+		}
+	}
+
+	void erase(std::list<entry>::iterator position)
+	{
+		bytes -= position->size();
+		index.erase(position->hash);
+		entries.erase(position);
+	}
+
+	mutable std::mutex mutex;
+	std::size_t capacity;
+	std::size_t bytes;
+	std::size_t hits;
+	std::size_t misses;
+
+	// most recently used first
+	std::list<entry> entries;
+	std::unordered_map<key, std::list<entry>::iterator, key_hash> index;
+};
+
+} // namespace detail
+
+deflate_cache::deflate_cache(std::size_t capacity)
+	: d_(new detail::deflate_cache_impl(capacity))
+{
+}
+
+deflate_cache::~deflate_cache()
+{
+}
+
+std::shared_ptr<const compressed_file> deflate_cache::get(const std::string &content)
+{
+	const detail::deflate_cache_impl::key key{ detail::sha256(content.data(), content.size()), content.size(),
+		static_cast<std::uint32_t>(mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const mz_uint8 *>(content.data()), content.size())) };
+
+	{
+		std::lock_guard<std::mutex> lock(d_->mutex);
+		auto match = d_->index.find(key);
+
+		if (match != d_->index.end())
+		{
+			d_->entries.splice(d_->entries.begin(), d_->entries, match->second);
+			++d_->hits;
+
+			return match->second->compressed;
+		}
+
+		++d_->misses;
+	}
+
+	// compress without holding the lock so that saves on other threads aren't held up
+	auto compressed = std::make_shared<const compressed_file>(zip_file::precompress(content));
+
+	std::lock_guard<std::mutex> lock(d_->mutex);
+
+	// a part that doesn't fit would only empty the cache, and another thread
+	// may have compressed the same part in the meantime
+	if (compressed->bytes.size() > d_->capacity || d_->index.count(key) != 0)
+	{
+		return compressed;
+	}
+
+	d_->entries.push_front(detail::deflate_cache_impl::entry{ key, compressed });
+	d_->index[key] = d_->entries.begin();
+	d_->bytes += d_->entries.front().size();
+	d_->evict();
+
+	return compressed;
+}
+
+std::size_t deflate_cache::hits() const
+{
+	std::lock_guard<std::mutex> lock(d_->mutex);
+	return d_->hits;
+}
+
+std::size_t deflate_cache::misses() const
+{
+	std::lock_guard<std::mutex> lock(d_->mutex);
+	return d_->misses;
+}
+
+std::size_t deflate_cache::size() const
+{
+	std::lock_guard<std::mutex> lock(d_->mutex);
+	return d_->entries.size();
+}
+
+std::size_t deflate_cache::size_in_bytes() const
+{
+	std::lock_guard<std::mutex> lock(d_->mutex);
+	return d_->bytes;
+}
+
+std::size_t deflate_cache::capacity() const
+{
+	return d_->capacity;
+}
+
+void deflate_cache::clear()
+{
+	std::lock_guard<std::mutex> lock(d_->mutex);
+	d_->entries.clear();
+	d_->index.clear();
+	d_->bytes = 0;
+}
+
+} // namespace xlnt
@@ -0,0 +1,95 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#include <algorithm>
+#include <cstring>
+
+#include <xlnt/packaging/input_source.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+namespace xlnt {
+
+input_source::~input_source()
+{
+}
+
+const std::uint8_t *input_source::data() const
+{
+	return nullptr;
+}
+
+memory_source::memory_source(const std::uint8_t *data, std::size_t size) : data_(data), size_(size)
+{
+}
+
+memory_source::memory_source(const std::vector<std::uint8_t> &bytes) : memory_source(bytes.data(), bytes.size())
+{
+}
+
+std::uint64_t memory_source::size() const
+{
+	return size_;
+}
+
+std::size_t memory_source::read_at(std::uint64_t offset, std::uint8_t *data, std::size_t size)
+{
+	if (offset >= size_) return 0;
+
+	auto count = std::min(size, static_cast<std::size_t>(size_ - offset));
+	std::memcpy(data, data_ + offset, count);
+
+	return count;
+}
+
+const std::uint8_t *memory_source::data() const
+{
+	return data_;
+}
+
+istream_source::istream_source(std::istream &stream) : stream_(stream), size_(0)
+{
+	stream_.seekg(0, std::ios::end);
+	auto end = stream_.tellg();
+
+	if (!stream_.good() || end < 0)
+	{
+		throw invalid_file("((std::istream)) - not seekable");
+	}
+
+	size_ = static_cast<std::uint64_t>(end);
+}
+
+std::uint64_t istream_source::size() const
+{
+	return size_;
+}
+
+std::size_t istream_source::read_at(std::uint64_t offset, std::uint8_t *data, std::size_t size)
+{
+	stream_.clear();
+	stream_.seekg(static_cast<std::streamoff>(offset));
+	stream_.read(reinterpret_cast<char *>(data), static_cast<std::streamsize>(size));
+
+	return static_cast<std::size_t>(stream_.gcount());
+}
+
+} // namespace xlnt
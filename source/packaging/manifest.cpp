@@ -49,6 +49,14 @@ bool manifest::has_relationship(const path &part, relationship::type type) const
     return false;
 }
 
+bool manifest::has_relationship(const path &part, const std::string &rel_id) const
+{
+    auto part_match = relationships_.find(part);
+
+    return part_match != relationships_.end()
+        && part_match->second.find(rel_id) != part_match->second.end();
+}
+
 relationship manifest::get_relationship(const path &part, relationship::type type) const
 {
     if (relationships_.find(part) == relationships_.end()) throw key_not_found();
@@ -98,6 +106,11 @@ void manifest::register_override_type(const path &part, const std::string &conte
     override_content_types_[part] = content_type;
 }
 
+void manifest::unregister_override_type(const path &part)
+{
+    override_content_types_.erase(part);
+}
+
 std::vector<path> manifest::get_parts_with_overriden_types() const
 {
 	std::vector<path> overriden;
@@ -176,6 +189,16 @@ std::string manifest::register_relationship(const uri &source, relationship::typ
 	return rel_id;
 }
 
+void manifest::unregister_relationship(const uri &source, const std::string &rel_id)
+{
+    auto source_match = relationships_.find(source.get_path());
+
+    if (source_match != relationships_.end())
+    {
+        source_match->second.erase(rel_id);
+    }
+}
+
 bool manifest::has_default_type(const std::string &extension) const
 {
 	return default_content_types_.find(extension) != default_content_types_.end();
@@ -0,0 +1,124 @@
+// Copyright (c) 2014-2016 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <xlnt/packaging/output_sink.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+namespace xlnt {
+
+output_sink::~output_sink()
+{
+}
+
+void output_sink::reserve(std::size_t /*size*/)
+{
+}
+
+void output_sink::flush()
+{
+}
+
+ostream_sink::ostream_sink(std::ostream &stream) : stream_(stream)
+{
+}
+
+void ostream_sink::write(const std::uint8_t *data, std::size_t size)
+{
+	stream_.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+
+	if (!stream_.good())
+	{
+		throw exception("failed to write to stream");
+	}
+}
+
+void ostream_sink::flush()
+{
+	stream_.flush();
+}
+
+vector_sink::vector_sink(std::vector<std::uint8_t> &bytes) : bytes_(bytes)
+{
+}
+
+void vector_sink::reserve(std::size_t size)
+{
+	// grow geometrically so that many small parts don't each reallocate
+	if (bytes_.capacity() - bytes_.size() < size)
+	{
+		bytes_.reserve(std::max(bytes_.size() + size, bytes_.capacity() * 2));
+	}
+}
+
+void vector_sink::write(const std::uint8_t *data, std::size_t size)
+{
+	bytes_.insert(bytes_.end(), data, data + size);
+}
+
+file_descriptor_sink::file_descriptor_sink(int descriptor) : descriptor_(descriptor)
+{
+}
+
+void file_descriptor_sink::write(const std::uint8_t *data, std::size_t size)
+{
+	while (size > 0)
+	{
+#ifdef _MSC_VER
+		auto written = _write(descriptor_, data, static_cast<unsigned int>(std::min<std::size_t>(size, 1 << 30)));
+#else
+		auto written = ::write(descriptor_, data, size);
+#endif
+
+		if (written < 0)
+		{
+			if (errno == EINTR) continue;
+			throw exception("failed to write to file descriptor");
+		}
+
+		data += written;
+		size -= static_cast<std::size_t>(written);
+	}
+}
+
+callback_sink::callback_sink(const callback &write) : write_(write)
+{
+}
+
+void callback_sink::write(const std::uint8_t *data, std::size_t size)
+{
+	write_(data, size);
+}
+
+} // namespace xlnt
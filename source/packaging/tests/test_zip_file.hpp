@@ -204,6 +204,141 @@ public:
         TS_ASSERT(f2.read(f2.getinfo(xlnt::path("b.txt"))) == "b\nb");
     }
 
+    void test_write_streamed()
+    {
+		temporary_file temp_file;
+        std::string large(300000, 'x');
+
+        for (std::size_t i = 0; i < large.size(); i += 7)
+        {
+            large[i] = static_cast<char>('a' + i % 26);
+        }
+
+        xlnt::zip_file source(existing_file);
+        xlnt::zip_file f;
+        f.begin_write(temp_file.get_path());
+        f.write_string("a\na", xlnt::path("a.txt"));
+        f.write_string(large, xlnt::path("large.txt"));
+        f.copy_file(source, xlnt::path("text.txt"));
+        TS_ASSERT_THROWS(f.copy_file(source, xlnt::path("missing.txt")), xlnt::invalid_file);
+        f.comment = "comment";
+        f.end_write();
+
+        xlnt::zip_file f2(temp_file.get_path());
+        TS_ASSERT(!f2.check_crc());
+        TS_ASSERT(f2.read(xlnt::path("a.txt")) == "a\na");
+        TS_ASSERT(f2.read(xlnt::path("large.txt")) == large);
+        TS_ASSERT(f2.read(xlnt::path("text.txt")) == expected_string);
+        TS_ASSERT(f2.comment == "comment");
+
+        TS_ASSERT_THROWS(f.end_write(), xlnt::invalid_parameter);
+    }
+
+    void test_write_abandoned()
+    {
+        temporary_file temp_file;
+
+        {
+            xlnt::zip_file f(existing_file);
+            f.save(temp_file.get_path());
+        }
+
+        {
+            // a write that never reaches end_write leaves the existing file alone
+            xlnt::zip_file f;
+            f.begin_write(temp_file.get_path());
+            f.write_string("a\na", xlnt::path("a.txt"));
+        }
+
+        TS_ASSERT(files_equal(existing_file, temp_file.get_path()));
+        TS_ASSERT(!xlnt::path(temp_file.get_path().string() + ".tmp").exists());
+
+        xlnt::zip_file f;
+        f.begin_write(temp_file.get_path());
+        f.write_string("a\na", xlnt::path("a.txt"));
+        f.end_write();
+
+        TS_ASSERT(!xlnt::path(temp_file.get_path().string() + ".tmp").exists());
+        xlnt::zip_file f2(temp_file.get_path());
+        TS_ASSERT(f2.read(xlnt::path("a.txt")) == "a\na");
+    }
+
+    void test_write_to_sink()
+    {
+        std::vector<std::uint8_t> bytes;
+        std::size_t chunks = 0;
+        xlnt::callback_sink sink([&](const std::uint8_t *data, std::size_t size)
+        {
+            bytes.insert(bytes.end(), data, data + size);
+            ++chunks;
+        });
+
+        xlnt::zip_file f;
+        f.begin_write(sink);
+        f.write_string("a\na", xlnt::path("a.txt"));
+        f.write_string("b\nb", xlnt::path("b.txt"));
+        TS_ASSERT_EQUALS(chunks, 2);
+        f.comment = "comment";
+        f.end_write();
+
+        xlnt::zip_file f2(bytes);
+        TS_ASSERT(f2.read(xlnt::path("a.txt")) == "a\na");
+        TS_ASSERT(f2.read(xlnt::path("b.txt")) == "b\nb");
+        TS_ASSERT(f2.comment == "comment");
+    }
+
+    void test_load_source()
+    {
+        xlnt::zip_file original;
+        original.write_string("a\na", xlnt::path("a.txt"));
+        original.comment = "comment";
+        std::vector<std::uint8_t> bytes;
+        original.save(bytes);
+
+        xlnt::memory_source memory(bytes);
+        xlnt::zip_file f(memory);
+        TS_ASSERT(f.read(xlnt::path("a.txt")) == "a\na");
+        TS_ASSERT(f.comment == "comment");
+
+        std::istringstream stream(std::string(bytes.begin(), bytes.end()));
+        xlnt::istream_source stream_source(stream);
+        xlnt::zip_file f2;
+        f2.load(stream_source);
+        TS_ASSERT(f2.has_file(xlnt::path("a.txt")));
+        TS_ASSERT(f2.read(xlnt::path("a.txt")) == "a\na");
+        TS_ASSERT(f2.comment == "comment");
+
+        // writing copies the archive out of the source first
+        f2.write_string("b\nb", xlnt::path("b.txt"));
+        std::vector<std::uint8_t> result;
+        f2.save(result);
+        xlnt::zip_file f3(result);
+        TS_ASSERT(f3.read(xlnt::path("a.txt")) == "a\na");
+        TS_ASSERT(f3.read(xlnt::path("b.txt")) == "b\nb");
+        TS_ASSERT(f3.comment == "comment");
+    }
+
+    void test_write_compressed()
+    {
+        std::string content(5000, 'z');
+        content += "tail";
+        auto compressed = xlnt::zip_file::precompress(content);
+        TS_ASSERT(compressed.bytes.size() < content.size());
+        TS_ASSERT_EQUALS(compressed.uncompressed_size, content.size());
+
+        xlnt::zip_file f;
+        f.write_compressed(compressed, xlnt::path("a.txt"));
+        f.write_compressed(compressed, xlnt::path("b.txt"));
+        std::vector<std::uint8_t> bytes;
+        f.save(bytes);
+
+        xlnt::zip_file f2(bytes);
+        TS_ASSERT(!f2.check_crc());
+        TS_ASSERT(f2.read(xlnt::path("a.txt")) == content);
+        TS_ASSERT(f2.read(xlnt::path("b.txt")) == content);
+        TS_ASSERT_EQUALS(f2.getinfo(xlnt::path("a.txt")).compress_size, compressed.bytes.size());
+    }
+
     void test_comment()
     {
         xlnt::zip_file f;
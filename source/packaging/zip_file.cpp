@@ -24,11 +24,15 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <iterator>
+#include <limits>
 #include <miniz.h>
 
+#include <xlnt/packaging/input_source.hpp>
+#include <xlnt/packaging/output_sink.hpp>
 #include <xlnt/packaging/zip_file.hpp>
 #include <xlnt/utils/path.hpp>
 #include <xlnt/utils/exceptions.hpp>
@@ -113,10 +117,74 @@ std::size_t write_callback(void *opaque, mz_uint64 file_ofs, const void *pBuf, s
     return n;
 }
 
+std::size_t read_callback(void *opaque, mz_uint64 file_ofs, void *pBuf, std::size_t n)
+{
+    // exceptions can't be thrown through miniz so a failed read is a short one
+    try
+    {
+        return static_cast<xlnt::input_source *>(opaque)->read_at(file_ofs, static_cast<std::uint8_t *>(pBuf), n);
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
 } // namespace
 
 namespace xlnt {
 
+/// <summary>
+/// Where an archive started with zip_file::begin_write goes. miniz writes
+/// sequentially except when it goes back to fill in a local header once the
+/// size and crc of its file are known, so the bytes of the file being added
+/// are held in pending and only passed on to sink once it's complete.
+/// </summary>
+struct zip_file::destination
+{
+    destination(output_sink &sink) : sink(&sink), flushed(0)
+    {
+    }
+
+    static std::size_t write(void *opaque, mz_uint64 file_ofs, const void *pBuf, std::size_t n)
+    {
+        auto target = static_cast<destination *>(opaque);
+
+        if (file_ofs < target->flushed) return 0;
+
+        auto offset = static_cast<std::size_t>(file_ofs - target->flushed);
+
+        if (offset + n > target->pending.size())
+        {
+            target->pending.resize(offset + n);
+        }
+
+        std::copy(static_cast<const std::uint8_t *>(pBuf), static_cast<const std::uint8_t *>(pBuf) + n,
+            target->pending.begin() + static_cast<std::ptrdiff_t>(offset));
+
+        return n;
+    }
+
+    void flush()
+    {
+        if (pending.empty()) return;
+
+        sink->reserve(pending.size());
+        sink->write(pending.data(), pending.size());
+        flushed += pending.size();
+        pending.clear();
+    }
+
+    output_sink *sink;
+    std::unique_ptr<std::ofstream> file;
+    std::unique_ptr<output_sink> file_sink;
+    std::vector<std::uint8_t> pending;
+    mz_uint64 flushed;
+
+    // the file written by begin_write(const path &) until it's renamed to the target
+    std::string temporary;
+};
+
 zip_info::zip_info()
     : create_system(0),
       create_version(0),
@@ -138,7 +206,7 @@ zip_info::zip_info()
     date_time.seconds = 0;
 }
 
-zip_file::zip_file() : archive_(new mz_zip_archive())
+zip_file::zip_file() : archive_(new mz_zip_archive()), source_(nullptr)
 {
     reset();
 }
@@ -158,11 +226,131 @@ zip_file::zip_file(const std::vector<unsigned char> &bytes) : zip_file()
     load(bytes);
 }
 
+zip_file::zip_file(input_source &source) : zip_file()
+{
+    load(source);
+}
+
 zip_file::~zip_file()
 {
     reset();
 }
 
+void zip_file::begin_write(const path &filename)
+{
+    // the archive goes to a file next to the target which replaces it once the
+    // archive is complete, so a failed write leaves the existing file untouched
+    const auto temporary = filename.string() + ".tmp";
+    std::unique_ptr<std::ofstream> file(new std::ofstream(temporary, std::ios::binary));
+
+    if (!file->good())
+    {
+        throw invalid_file(filename.string());
+    }
+
+    std::unique_ptr<output_sink> file_sink(new ostream_sink(*file));
+
+    try
+    {
+        begin_write(*file_sink);
+    }
+    catch (...)
+    {
+        file.reset();
+        std::remove(temporary.c_str());
+        throw;
+    }
+
+    filename_ = filename;
+    destination_->file = std::move(file);
+    destination_->file_sink = std::move(file_sink);
+    destination_->temporary = temporary;
+}
+
+void zip_file::begin_write(output_sink &sink)
+{
+    reset();
+
+    destination_.reset(new destination(sink));
+    archive_->m_pWrite = &destination::write;
+    archive_->m_pIO_opaque = destination_.get();
+
+    if (!mz_zip_writer_init(archive_.get(), 0))
+    {
+        destination_.reset();
+        throw std::runtime_error("bad zip");
+    }
+}
+
+void zip_file::end_write()
+{
+    if (!destination_)
+    {
+        throw invalid_parameter();
+    }
+
+    if (!mz_zip_writer_finalize_archive(archive_.get()))
+    {
+        reset();
+        throw exception("failed to finish archive");
+    }
+
+    mz_zip_writer_end(archive_.get());
+
+    auto &pending = destination_->pending;
+
+    if (!comment.empty())
+    {
+        auto comment_length = std::min(static_cast<uint16_t>(comment.length()), std::numeric_limits<uint16_t>::max());
+        pending[pending.size() - 2] = static_cast<std::uint8_t>(comment_length);
+        pending[pending.size() - 1] = static_cast<std::uint8_t>(comment_length >> 8);
+        pending.insert(pending.end(), comment.begin(), comment.begin() + comment_length);
+    }
+
+    try
+    {
+        destination_->flush();
+        destination_->sink->flush();
+
+        if (destination_->file)
+        {
+            destination_->file->close();
+
+            if (destination_->file->fail())
+            {
+                throw exception("failed to write " + filename_.string());
+            }
+
+            const auto target = filename_.string();
+
+            // renaming over an existing file fails on some platforms
+            if (std::rename(destination_->temporary.c_str(), target.c_str()) != 0
+                && (std::remove(target.c_str()) != 0
+                    || std::rename(destination_->temporary.c_str(), target.c_str()) != 0))
+            {
+                throw exception("failed to write " + filename_.string());
+            }
+
+            destination_->temporary.clear();
+        }
+    }
+    catch (...)
+    {
+        reset();
+        throw;
+    }
+
+    reset();
+}
+
+void zip_file::flush_destination()
+{
+    if (destination_)
+    {
+        destination_->flush();
+    }
+}
+
 void zip_file::load(std::istream &stream)
 {
 	if (!stream.good())
@@ -217,6 +405,82 @@ void zip_file::load(const std::vector<unsigned char> &bytes)
     start_read();
 }
 
+void zip_file::load(input_source &source)
+{
+    auto size = source.size();
+
+    if (size == 0)
+    {
+        throw invalid_file("((source)) - empty file");
+    }
+
+    reset();
+
+    // the archive comment isn't exposed by miniz so it's found in the end of
+    // central directory record, which is within the last 64 KiB of the source
+    std::vector<std::uint8_t> tail(static_cast<std::size_t>(std::min<std::uint64_t>(size, 22 + 0xFFFF)));
+    auto tail_offset = size - tail.size();
+
+    if (source.read_at(tail_offset, tail.data(), tail.size()) != tail.size())
+    {
+        throw invalid_file("((source))");
+    }
+
+    for (auto position = static_cast<std::ptrdiff_t>(tail.size()) - 22; position >= 0; --position)
+    {
+        if (tail[position] == 'P' && tail[position + 1] == 'K' && tail[position + 2] == '\x05' && tail[position + 3] == '\x06')
+        {
+            auto length = static_cast<std::size_t>(tail[position + 20] | (tail[position + 21] << 8));
+            auto first = tail.begin() + position + 22;
+            comment.assign(first, first + static_cast<std::ptrdiff_t>(std::min(length, static_cast<std::size_t>(tail.end() - first))));
+            break;
+        }
+    }
+
+    mz_bool initialized = MZ_FALSE;
+
+    if (source.data() != nullptr)
+    {
+        initialized = mz_zip_reader_init_mem(archive_.get(), source.data(), static_cast<std::size_t>(size), 0);
+    }
+    else
+    {
+        archive_->m_pRead = &read_callback;
+        archive_->m_pIO_opaque = &source;
+        initialized = mz_zip_reader_init(archive_.get(), size, 0);
+    }
+
+    if (!initialized)
+    {
+        throw invalid_file("((source))");
+    }
+
+    source_ = &source;
+}
+
+void zip_file::read_source_into_buffer()
+{
+    if (source_ == nullptr) return;
+
+    auto source = source_;
+    source_ = nullptr;
+
+    buffer_.resize(static_cast<std::size_t>(source->size()));
+
+    if (archive_->m_zip_mode == MZ_ZIP_MODE_READING)
+    {
+        mz_zip_reader_end(archive_.get());
+    }
+
+    if (source->read_at(0, reinterpret_cast<std::uint8_t *>(buffer_.data()), buffer_.size()) != buffer_.size())
+    {
+        throw invalid_file("((source))");
+    }
+
+    remove_comment();
+    start_read();
+}
+
 void zip_file::save(const path &filename)
 {
     filename_ = filename;
@@ -226,6 +490,8 @@ void zip_file::save(const path &filename)
 
 void zip_file::save(std::ostream &stream)
 {
+    read_source_into_buffer();
+
     if (archive_->m_zip_mode == MZ_ZIP_MODE_WRITING)
     {
         mz_zip_writer_finalize_archive(archive_.get());
@@ -247,6 +513,8 @@ void zip_file::save(std::ostream &stream)
 
 void zip_file::save(std::vector<unsigned char> &bytes)
 {
+    read_source_into_buffer();
+
     if (archive_->m_zip_mode == MZ_ZIP_MODE_WRITING)
     {
         mz_zip_writer_finalize_archive(archive_.get());
@@ -319,13 +587,26 @@ void zip_file::reset()
         mz_zip_reader_end(archive_.get());
         break;
     case MZ_ZIP_MODE_WRITING:
-        mz_zip_writer_finalize_archive(archive_.get());
+        // an archive left unfinished after begin_write isn't completed, which would
+        // pass a valid looking archive that is missing files to its sink
+        if (!destination_)
+        {
+            mz_zip_writer_finalize_archive(archive_.get());
+        }
         mz_zip_writer_end(archive_.get());
         break;
     default:
         break;
     }
 
+    if (destination_ && !destination_->temporary.empty())
+    {
+        destination_->file.reset();
+        std::remove(destination_->temporary.c_str());
+    }
+
+    destination_.reset();
+    source_ = nullptr;
     buffer_.clear();
     comment.clear();
 
@@ -341,7 +622,9 @@ zip_info zip_file::getinfo(const path &name)
         start_read();
     }
 
+    std::unique_lock<std::mutex> lock(read_mutex_);
     int index = mz_zip_reader_locate_file(archive_.get(), name.string().c_str(), nullptr, 0);
+    lock.unlock();
 
     if (index == -1)
     {
@@ -359,7 +642,9 @@ zip_info zip_file::getinfo(int index)
     }
 
     mz_zip_archive_file_stat stat;
+    std::unique_lock<std::mutex> lock(read_mutex_);
     mz_zip_reader_file_stat(archive_.get(), static_cast<mz_uint>(index), &stat);
+    lock.unlock();
 
     zip_info result;
 
@@ -411,6 +696,9 @@ void zip_file::start_write()
 {
     if (archive_->m_zip_mode == MZ_ZIP_MODE_WRITING) return;
 
+    // an archive read in place from a source has to be copied before it can change
+    read_source_into_buffer();
+
     switch (archive_->m_zip_mode)
     {
     case MZ_ZIP_MODE_READING:
@@ -495,6 +783,7 @@ void zip_file::write_string(const std::string &bytes, const path &arcname)
 
     mz_zip_writer_add_mem(archive_.get(), arcname.string().c_str(),
 		bytes.data(), bytes.size(), MZ_BEST_COMPRESSION);
+    flush_destination();
 }
 
 void zip_file::write_string(const std::string &bytes, const zip_info &info)
@@ -514,13 +803,79 @@ void zip_file::write_string(const std::string &bytes, const zip_info &info)
     mz_zip_writer_add_mem_ex(archive_.get(), info.filename.string().c_str(), bytes.data(), bytes.size(),
         info.comment.c_str(), static_cast<mz_uint16>(info.comment.size()),
         MZ_BEST_COMPRESSION, 0, crc);
+    flush_destination();
+}
+
+compressed_file zip_file::precompress(const std::string &bytes)
+{
+    compressed_file result;
+    result.crc = static_cast<uint32_t>(mz_crc32(MZ_CRC32_INIT,
+        reinterpret_cast<const mz_uint8 *>(bytes.data()), bytes.size()));
+    result.uncompressed_size = bytes.size();
+
+    std::size_t compressed_size = 0;
+    auto compressed = tdefl_compress_mem_to_heap(bytes.data(), bytes.size(), &compressed_size,
+        static_cast<int>(tdefl_create_comp_flags_from_zip_params(MZ_BEST_COMPRESSION, -15, MZ_DEFAULT_STRATEGY)));
+
+    if (compressed == nullptr)
+    {
+        throw exception("failed to compress");
+    }
+
+    result.bytes.assign(static_cast<const char *>(compressed), compressed_size);
+    mz_free(compressed);
+
+    return result;
+}
+
+void zip_file::write_compressed(const compressed_file &file, const path &archive_path)
+{
+    if (archive_->m_zip_mode != MZ_ZIP_MODE_WRITING)
+    {
+        start_write();
+    }
+
+    if (!mz_zip_writer_add_mem_ex(archive_.get(), archive_path.string().c_str(), file.bytes.data(), file.bytes.size(),
+        nullptr, 0, MZ_BEST_COMPRESSION | MZ_ZIP_FLAG_COMPRESSED_DATA, file.uncompressed_size, file.crc))
+    {
+        throw exception("failed to add " + archive_path.string());
+    }
+
+    flush_destination();
+}
+
+void zip_file::copy_file(zip_file &source, const path &name)
+{
+    if (archive_->m_zip_mode != MZ_ZIP_MODE_WRITING)
+    {
+        start_write();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(source.read_mutex_);
+        auto index = mz_zip_reader_locate_file(source.archive_.get(), name.string().c_str(), nullptr, 0);
+
+        if (index == -1)
+        {
+            throw invalid_file(name.string() + " - not in source archive");
+        }
+
+        if (!mz_zip_writer_add_from_zip_reader(archive_.get(), source.archive_.get(), static_cast<mz_uint>(index)))
+        {
+            throw invalid_file(name.string() + " - couldn't be copied");
+        }
+    }
+
+    flush_destination();
 }
 
 std::string zip_file::read(const zip_info &info)
 {
     std::size_t size;
+    std::unique_lock<std::mutex> lock(read_mutex_);
 	void *data_raw = mz_zip_reader_extract_file_to_heap(archive_.get(), 
 		info.filename.string().c_str(), &size, 0);
+    lock.unlock();
 
     if (data_raw == nullptr)
     {
@@ -539,6 +894,44 @@ std::string zip_file::read(const path &name)
     return read(getinfo(name));
 }
 
+bool zip_file::read(const path &name, const std::function<bool(const char *, std::size_t)> &callback)
+{
+    if (!has_file(name))
+    {
+        throw std::runtime_error("file not found");
+    }
+
+    struct read_state
+    {
+        const std::function<bool(const char *, std::size_t)> *callback;
+        bool stopped;
+    } state { &callback, false };
+
+    auto write = [](void *opaque, mz_uint64, const void *data, std::size_t size) -> std::size_t
+    {
+        auto &state = *static_cast<read_state *>(opaque);
+
+        if (!(*state.callback)(static_cast<const char *>(data), size))
+        {
+            // miniz stops extracting when fewer bytes than it passed are accepted
+            state.stopped = true;
+            return 0;
+        }
+
+        return size;
+    };
+
+    std::lock_guard<std::mutex> lock(read_mutex_);
+
+    if (!mz_zip_reader_extract_file_to_callback(archive_.get(), name.string().c_str(), write, &state, 0)
+        && !state.stopped)
+    {
+        throw std::runtime_error("file couldn't be read");
+    }
+
+    return !state.stopped;
+}
+
 bool zip_file::has_file(const path &name)
 {
     if (archive_->m_zip_mode != MZ_ZIP_MODE_READING)
@@ -546,6 +939,7 @@ bool zip_file::has_file(const path &name)
         start_read();
     }
 
+    std::lock_guard<std::mutex> lock(read_mutex_);
     int index = mz_zip_reader_locate_file(archive_.get(), name.string().c_str(), nullptr, 0);
 
     return index != -1;
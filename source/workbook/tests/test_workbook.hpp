@@ -1,10 +1,16 @@
 #pragma once
 
 #include <algorithm>
+#include <clocale>
+#include <future>
 #include <iostream>
+#include <sstream>
 #include <cxxtest/TestSuite.h>
 
 #include <xlnt/xlnt.hpp>
+#include <detail/inflate_pipeline.hpp>
+#include <detail/static_part_cache.hpp>
+#include <detail/worksheet_inspector.hpp>
 #include "helpers/temporary_file.hpp"
 
 //checked with 52f25d6
@@ -131,6 +137,1022 @@ public:
         TS_ASSERT_EQUALS(sheet_index, 2);
     }
 
+    void test_sheet_lookup_after_reordering()
+    {
+        xlnt::workbook wb;
+        auto first = wb.get_active_sheet();
+        auto second = wb.create_sheet();
+        second.set_title("second");
+        auto inserted = wb.create_sheet(0);
+        inserted.set_title("inserted");
+        wb.copy_sheet(second, 1);
+
+        TS_ASSERT_EQUALS(wb.get_sheet_count(), 4);
+        TS_ASSERT_EQUALS(wb.get_index(inserted), 0);
+        TS_ASSERT_EQUALS(wb.get_index(first), 2);
+        TS_ASSERT_EQUALS(wb.get_index(second), 3);
+        TS_ASSERT_EQUALS(wb.get_sheet_by_index(0), inserted);
+        TS_ASSERT_EQUALS(wb.get_sheet_by_title("second"), second);
+        TS_ASSERT_EQUALS(wb.get_sheet_by_id(second.get_id()), second);
+
+        // worksheets stay valid while others are added and removed around them
+        wb.remove_sheet(inserted);
+        TS_ASSERT(!wb.contains("inserted"));
+        TS_ASSERT_EQUALS(wb.get_index(first), 1);
+        TS_ASSERT_EQUALS(wb.get_sheet_by_index(2), second);
+
+        second.set_title("renamed");
+        TS_ASSERT(!wb.contains("second"));
+        TS_ASSERT_EQUALS(wb.get_sheet_by_title("renamed"), second);
+
+        // ids stay unique after removing a sheet
+        auto created = wb.create_sheet();
+        std::vector<std::size_t> ids;
+        for (auto ws : wb) ids.push_back(ws.get_id());
+        std::sort(ids.begin(), ids.end());
+        TS_ASSERT(std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+        TS_ASSERT_EQUALS(wb.get_sheet_by_id(created.get_id()), created);
+
+        auto old_id = created.get_id();
+        created.set_id(old_id + 100);
+        TS_ASSERT_EQUALS(wb.get_sheet_by_id(old_id + 100), created);
+        TS_ASSERT_THROWS(wb.get_sheet_by_id(old_id), xlnt::key_not_found);
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+
+        xlnt::workbook loaded;
+        loaded.load(data);
+        TS_ASSERT_EQUALS(loaded.get_sheet_titles(), wb.get_sheet_titles());
+    }
+
+    void test_lazy_loading()
+    {
+        xlnt::workbook wb;
+        wb.get_active_sheet().set_title("first");
+        wb.get_active_sheet().get_cell("A1").set_value("untouched");
+        wb.get_active_sheet().get_cell("B1").set_value(2);
+        wb.get_active_sheet().get_cell("C1").set_formula("B1*2");
+        auto second = wb.create_sheet();
+        second.set_title("second");
+        second.get_cell("A1").set_value(1);
+        auto third = wb.create_sheet();
+        third.set_title("third");
+        third.get_cell("B1").set_value(5);
+        wb.calculate();
+
+        std::vector<std::uint8_t> written;
+        wb.save(written);
+
+        // a part xlnt wouldn't write the same way shows whether it was parsed and written again
+        const xlnt::path untouched_part("xl/worksheets/sheet1.xml");
+        xlnt::zip_file written_archive(written);
+        auto untouched_xml = written_archive.read(untouched_part);
+        untouched_xml.insert(0, "<!-- written by hand -->");
+
+        xlnt::zip_file original_archive;
+
+        for (const auto &name : written_archive.namelist())
+        {
+            original_archive.write_string(name == untouched_part ? untouched_xml : written_archive.read(name), name);
+        }
+
+        std::vector<std::uint8_t> original;
+        original_archive.save(original);
+
+        xlnt::workbook lazy;
+        lazy.set_lazy_loading(true);
+        lazy.load(original);
+        TS_ASSERT(lazy.get_lazy_loading());
+        TS_ASSERT_EQUALS(lazy.get_sheet_titles(), wb.get_sheet_titles());
+
+        auto ws = lazy.get_sheet_by_title("second");
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_value<int>(), 1);
+        ws.get_cell("A2").set_value("added");
+
+        // only the worksheets formulas refer to are parsed to calculate them
+        ws.get_cell("A3").set_formula("third!B1*3");
+        lazy.calculate();
+
+        std::vector<std::uint8_t> saved;
+        lazy.save(saved);
+
+        // the worksheet that was never accessed is copied without being parsed
+        xlnt::zip_file saved_archive(saved);
+        TS_ASSERT_EQUALS(saved_archive.read(untouched_part), untouched_xml);
+
+        xlnt::workbook loaded;
+        loaded.load(saved);
+        TS_ASSERT_EQUALS(loaded.get_sheet_by_title("first").get_cell("A1").get_value<std::string>(), "untouched");
+        TS_ASSERT_EQUALS(loaded.get_sheet_by_title("first").get_cell("C1").get_value<int>(), 4);
+        TS_ASSERT_EQUALS(loaded.get_sheet_by_title("second").get_cell("A2").get_value<std::string>(), "added");
+        TS_ASSERT_EQUALS(loaded.get_sheet_by_title("second").get_cell("A3").get_value<int>(), 15);
+    }
+
+    void test_lazy_worksheet_handles()
+    {
+        xlnt::workbook wb;
+        auto first = wb.get_active_sheet();
+        first.set_title("first");
+        first.get_cell("A1").set_value(2);
+        first.get_cell("A2").set_formula("A1*2");
+        auto second = wb.create_sheet();
+        second.set_title("second");
+        second.get_cell("A1").set_value(3);
+        second.get_cell("A2").set_formula("A1+first!A2");
+        wb.create_sheet().set_title("third");
+        wb.calculate();
+
+        std::vector<std::uint8_t> written;
+        wb.save(written);
+
+        xlnt::workbook lazy;
+        lazy.set_lazy_loading(true);
+        lazy.load(written);
+
+        // getting a handle to a worksheet doesn't parse it
+        for (auto ws : lazy)
+        {
+            TS_ASSERT(!ws.get_title().empty());
+        }
+
+        lazy.get_sheet_by_title("third");
+        lazy.get_sheet_by_index(1);
+
+        for (auto ws : lazy)
+        {
+            TS_ASSERT(xlnt::detail::worksheet_inspector::is_deferred(ws));
+        }
+
+        // calculating builds the formulas of the first worksheet into the graph
+        lazy.get_sheet_by_title("first").get_cell("A1").set_value(5);
+        lazy.calculate();
+        TS_ASSERT(!xlnt::detail::worksheet_inspector::is_deferred(lazy.get_sheet_by_title("first")));
+        TS_ASSERT(xlnt::detail::worksheet_inspector::is_deferred(lazy.get_sheet_by_title("second")));
+        TS_ASSERT(xlnt::detail::worksheet_inspector::is_deferred(lazy.get_sheet_by_title("third")));
+
+        // the formulas of a worksheet parsed afterwards are added to the same graph,
+        // recalculated since they may depend on the changed cells
+        auto parsed = lazy.get_sheet_by_title("second");
+        TS_ASSERT_EQUALS(parsed.get_cell("A2").get_value<int>(), 7);
+        TS_ASSERT(xlnt::detail::worksheet_inspector::is_deferred(lazy.get_sheet_by_title("third")));
+        lazy.calculate();
+        TS_ASSERT_EQUALS(parsed.get_cell("A2").get_value<int>(), 13);
+
+        lazy.get_sheet_by_title("first").get_cell("A1").set_value(1);
+        lazy.calculate();
+        TS_ASSERT_EQUALS(parsed.get_cell("A2").get_value<int>(), 5);
+
+        parsed.get_cell("A1").set_value(10);
+        lazy.calculate();
+        TS_ASSERT_EQUALS(parsed.get_cell("A2").get_value<int>(), 12);
+    }
+
+    void test_load_options()
+    {
+        xlnt::workbook wb;
+        auto first = wb.get_active_sheet();
+        first.set_title("first");
+        first.get_cell("A1").set_value(1);
+        auto second = wb.create_sheet();
+        second.set_title("second");
+        second.get_cell("A1").set_value(2);
+        second.get_cell("A2").set_formula("A1*3");
+        second.get_cell("B1").set_number_format(xlnt::number_format::percentage());
+        second.get_cell("B1").set_value(0.5);
+        second.get_row_properties(1).height = 30;
+        second.merge_cells("C1:D2");
+        auto third = wb.create_sheet();
+        third.set_title("third");
+        wb.calculate();
+
+        std::vector<std::uint8_t> original;
+        wb.save(original);
+
+        auto options = xlnt::load_options::values_only();
+        options.sheet_titles.push_back("second");
+        options.sheet_indices.push_back(2);
+
+        xlnt::workbook loaded;
+        loaded.load(original, options);
+
+        const std::vector<std::string> expected_titles = { "second", "third" };
+        TS_ASSERT_EQUALS(loaded.get_sheet_titles(), expected_titles);
+
+        auto ws = loaded.get_sheet_by_title("second");
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_value<int>(), 2);
+        TS_ASSERT(!ws.get_cell("A2").has_formula());
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_value<int>(), 6);
+        TS_ASSERT(!ws.get_cell("B1").has_format());
+        TS_ASSERT_DELTA(ws.get_cell("B1").get_value<double>(), 0.5, 1e-9);
+        TS_ASSERT(!ws.has_row_properties(1));
+        TS_ASSERT(ws.get_merged_ranges().empty());
+
+        // sheets that weren't loaded are gone and the skipped stylesheet is kept as it was
+        std::vector<std::uint8_t> saved;
+        loaded.save(saved);
+
+        xlnt::zip_file original_archive(original);
+        xlnt::zip_file saved_archive(saved);
+        TS_ASSERT_EQUALS(saved_archive.read(xlnt::path("xl/styles.xml")),
+            original_archive.read(xlnt::path("xl/styles.xml")));
+
+        xlnt::workbook reloaded;
+        reloaded.load(saved, xlnt::load_options::values_only());
+        TS_ASSERT_EQUALS(reloaded.get_sheet_titles(), expected_titles);
+        TS_ASSERT_EQUALS(reloaded.get_sheet_by_title("second").get_cell("A2").get_value<int>(), 6);
+    }
+
+    void test_read_filter()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 20; ++row)
+        {
+            for (xlnt::column_t::index_t column = 1; column <= 10; ++column)
+            {
+                ws.get_cell(xlnt::cell_reference(column, row)).set_value(static_cast<int>(row * 100 + column));
+            }
+        }
+
+        ws.merge_cells("A20:B20");
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+
+        xlnt::load_options options;
+        options.columns = { xlnt::column_t("B"), xlnt::column_t("J") };
+        options.first_row = 5;
+        options.last_row = 7;
+
+        xlnt::workbook loaded;
+        loaded.load(data, options);
+        auto loaded_ws = loaded.get_active_sheet();
+
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("B5").get_value<int>(), 502);
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("J7").get_value<int>(), 710);
+        TS_ASSERT(!loaded_ws.has_cell("A5"));
+        TS_ASSERT(!loaded_ws.has_cell("B4"));
+        TS_ASSERT(!loaded_ws.has_cell("B8"));
+        TS_ASSERT_EQUALS(loaded_ws.calculate_dimension(), xlnt::range_reference("B5:J7"));
+
+        // parsing stops after the last row so the merged cells that follow aren't read
+        TS_ASSERT(loaded_ws.get_merged_ranges().empty());
+    }
+
+    void test_lazy_shared_strings()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+        ws.get_cell("A1").set_value("plain");
+        ws.get_cell("A2").set_value("fish & <chips>");
+
+        xlnt::text_run run;
+        run.set_string("bold");
+        run.set_size(14);
+        run.set_font("Calibri");
+        xlnt::text rich;
+        rich.add_run(run);
+        ws.get_cell("A3").set_value(rich);
+
+        wb.add_shared_string(xlnt::text(), true);
+        xlnt::text unused;
+        unused.set_plain_string("unused");
+        wb.add_shared_string(unused);
+
+        std::vector<std::uint8_t> original;
+        wb.save(original);
+
+        xlnt::load_options options;
+        options.lazy_shared_strings = true;
+        xlnt::workbook loaded;
+        loaded.load(original, options);
+
+        TS_ASSERT_EQUALS(loaded.get_shared_string_count(), wb.get_shared_string_count());
+
+        auto loaded_ws = loaded.get_active_sheet();
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("A1").get_value<std::string>(), "plain");
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("A2").get_value<std::string>(), "fish & <chips>");
+        TS_ASSERT(loaded_ws.get_cell("A3").get_value<xlnt::text>() == rich);
+        TS_ASSERT_EQUALS(loaded.get_shared_string(wb.get_shared_string_count() - 1).get_plain_string(), "unused");
+
+        // strings that were never decoded are written back unchanged
+        std::vector<std::uint8_t> saved;
+        loaded.save(saved);
+
+        xlnt::workbook reloaded;
+        reloaded.load(saved);
+        TS_ASSERT(reloaded.get_shared_strings() == wb.get_shared_strings());
+        TS_ASSERT(reloaded.get_active_sheet().get_cell("A3").get_value<xlnt::text>() == rich);
+    }
+
+    void test_lazy_shared_strings_parallel_calculation()
+    {
+        const int columns = 1000;
+
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        // formatted strings are the ones left undecoded until they're read
+        for (int column = 1; column <= columns; ++column)
+        {
+            xlnt::text_run run;
+            run.set_string("s" + std::to_string(column));
+            run.set_size(14);
+            xlnt::text rich;
+            rich.add_run(run);
+            ws.get_cell(xlnt::cell_reference(column, 1)).set_value(rich);
+        }
+
+        std::vector<std::uint8_t> original;
+        wb.save(original);
+
+        xlnt::load_options options;
+        options.lazy_shared_strings = true;
+        xlnt::workbook loaded;
+        loaded.load(original, options);
+
+        xlnt::calculation_properties properties;
+        properties.thread_count = 4;
+        loaded.set_calculation_properties(properties);
+
+        // the strings are decoded by whichever evaluating thread reads them first
+        auto loaded_ws = loaded.get_active_sheet();
+
+        for (int column = 1; column <= columns; ++column)
+        {
+            auto above = xlnt::cell_reference(column, 1).to_string();
+            loaded_ws.get_cell(xlnt::cell_reference(column, 2)).set_formula(above + "&\"!\"");
+        }
+
+        loaded.calculate();
+
+        for (int column = 1; column <= columns; ++column)
+        {
+            TS_ASSERT_EQUALS(loaded_ws.get_cell(xlnt::cell_reference(column, 2)).get_value<std::string>(),
+                "s" + std::to_string(column) + "!");
+        }
+    }
+
+    void test_read_sheet_data()
+    {
+        xlnt::workbook wb;
+        wb.get_active_sheet().get_cell("A1").set_value(1);
+        std::vector<std::uint8_t> original;
+        wb.save(original);
+
+        // elements may have a prefix, r attributes may be left out and values can be escaped
+        const std::string sheet_xml = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+            "<x:worksheet xmlns:x=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+            "<x:dimension ref=\"A1:D5\"/><x:sheetData>\n"
+            "<!-- <x:c r=\"Z9\"><x:v>1</x:v></x:c> -->\n"
+            "<x:row r=\"1\"><x:c r=\"A1\" s=\"0\"><x:v>42</x:v></x:c><x:c><x:v>-1.5E3</x:v></x:c>"
+            "<x:c t=\"str\"><x:f>\"a\"&amp;\"b\"</x:f><x:v>a&amp;b</x:v></x:c></x:row>\n"
+            "<x:row><x:c r=\"B2\" t=\"inlineStr\"><x:is><x:r><x:t>one </x:t></x:r>"
+            "<x:r><x:rPr><x:b/></x:rPr><x:t>two</x:t></x:r></x:is></x:c>"
+            "<x:c r=\"C2\" t=\"b\"><x:v>1</x:v></x:c><x:c r=\"D2\" t=\"e\"><x:v>#N/A</x:v></x:c>"
+            "<x:extLst><x:ext><x:c r=\"E2\"/></x:ext></x:extLst></x:row>\n"
+            "<x:row r=\"5\" spans=\"1:1\"/>"
+            "<x:row r=\"6\"><x:c r=\"A6\" t=\"str\"><x:v><![CDATA[<tag>]]></x:v></x:c></x:row>\n"
+            "</x:sheetData></x:worksheet>";
+
+        xlnt::zip_file original_archive(original);
+        xlnt::zip_file modified_archive;
+
+        for (const auto &name : original_archive.namelist())
+        {
+            auto is_sheet = name.string().find("sheet1.xml") != std::string::npos
+                && name.string().find(".rels") == std::string::npos;
+            modified_archive.write_string(is_sheet ? sheet_xml : original_archive.read(name), name);
+        }
+
+        std::vector<std::uint8_t> modified;
+        modified_archive.save(modified);
+
+        xlnt::workbook loaded;
+        loaded.load(modified);
+        auto ws = loaded.get_active_sheet();
+
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_value<int>(), 42);
+        TS_ASSERT_DELTA(ws.get_cell("B1").get_value<double>(), -1500, 1e-9);
+        TS_ASSERT(ws.get_cell("C1").has_formula());
+        TS_ASSERT_EQUALS(ws.get_cell("C1").get_formula(), "\"a\"&\"b\"");
+        TS_ASSERT_EQUALS(ws.get_cell("C1").get_value<std::string>(), "a&b");
+        TS_ASSERT_EQUALS(ws.get_cell("B2").get_value<std::string>(), "one two");
+        TS_ASSERT_EQUALS(ws.get_cell("C2").get_value<bool>(), true);
+        TS_ASSERT(ws.get_cell("D2").get_data_type() == xlnt::cell::type::error);
+        TS_ASSERT(!ws.has_cell("E2"));
+        TS_ASSERT(!ws.has_cell("Z9"));
+        TS_ASSERT_EQUALS(ws.get_cell("A6").get_value<std::string>(), "<tag>");
+
+        // strings that aren't shared are kept in their cells
+        TS_ASSERT_EQUALS(loaded.get_shared_string_count(), 0);
+    }
+
+    void test_lazy_shared_strings_add()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+        ws.get_cell("A1").set_value("first");
+        ws.get_cell("A2").set_value("second");
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+
+        xlnt::load_options options;
+        options.lazy_shared_strings = true;
+        xlnt::workbook loaded;
+        loaded.load(data, options);
+        auto loaded_ws = loaded.get_active_sheet();
+
+        // a string that has been read is found again instead of being added twice
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("A2").get_value<std::string>(), "second");
+        loaded_ws.get_cell("B1").set_value("second");
+        loaded_ws.get_cell("B2").set_value("third");
+        TS_ASSERT_EQUALS(loaded.get_shared_string_count(), 3);
+
+        loaded.save(data);
+        xlnt::workbook reloaded;
+        reloaded.load(data);
+        auto reloaded_ws = reloaded.get_active_sheet();
+        TS_ASSERT_EQUALS(reloaded_ws.get_cell("A1").get_value<std::string>(), "first");
+        TS_ASSERT_EQUALS(reloaded_ws.get_cell("B1").get_value<std::string>(), "second");
+        TS_ASSERT_EQUALS(reloaded_ws.get_cell("B2").get_value<std::string>(), "third");
+    }
+
+    void test_read_large_sheet_data()
+    {
+        xlnt::workbook wb;
+        wb.get_active_sheet().get_cell("A1").set_value(1);
+        std::vector<std::uint8_t> original;
+        wb.save(original);
+
+        // big enough to be inflated on another thread while the rows are read,
+        // with rows numbered by their position so they're counted across buffers
+        const xlnt::row_t row_count = 50000;
+        std::string sheet_xml = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+            "<x:worksheet xmlns:x=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+            "<x:sheetData>";
+
+        for (xlnt::row_t row = 1; row <= row_count; ++row)
+        {
+            sheet_xml.append("<x:row><x:c><x:v>" + std::to_string(row) + "</x:v></x:c>"
+                "<x:c t=\"inlineStr\"><x:is><x:t>row &amp; " + std::to_string(row) + "</x:t></x:is></x:c></x:row>");
+        }
+
+        sheet_xml.append("</x:sheetData></x:worksheet>");
+        TS_ASSERT_LESS_THAN(1 << 20, sheet_xml.size());
+
+        xlnt::zip_file original_archive(original);
+        xlnt::zip_file modified_archive;
+
+        for (const auto &name : original_archive.namelist())
+        {
+            auto is_sheet = name.string().find("sheet1.xml") != std::string::npos
+                && name.string().find(".rels") == std::string::npos;
+            modified_archive.write_string(is_sheet ? sheet_xml : original_archive.read(name), name);
+        }
+
+        std::vector<std::uint8_t> modified;
+        modified_archive.save(modified);
+
+        // the pipeline is otherwise skipped on a single core
+        struct force_pipeline
+        {
+            force_pipeline() { xlnt::detail::inflate_pipeline::forced = true; }
+            ~force_pipeline() { xlnt::detail::inflate_pipeline::forced = false; }
+        } forced;
+
+        xlnt::workbook loaded;
+        loaded.load(modified);
+        auto ws = loaded.get_active_sheet();
+
+        TS_ASSERT_EQUALS(ws.get_highest_row(), row_count);
+
+        for (xlnt::row_t row = 1; row <= row_count; row += 997)
+        {
+            TS_ASSERT_EQUALS(ws.get_cell(xlnt::cell_reference(1, row)).get_value<int>(), static_cast<int>(row));
+            TS_ASSERT_EQUALS(ws.get_cell(xlnt::cell_reference(2, row)).get_value<std::string>(), "row & " + std::to_string(row));
+        }
+
+        TS_ASSERT_EQUALS(ws.get_cell(xlnt::cell_reference(2, row_count)).get_value<std::string>(), "row & 50000");
+
+        xlnt::load_options options;
+        options.last_row = 30000;
+        xlnt::workbook partial;
+        partial.load(modified, options);
+
+        TS_ASSERT_EQUALS(partial.get_active_sheet().get_highest_row(), 30000);
+        TS_ASSERT_EQUALS(partial.get_active_sheet().get_cell("A30000").get_value<int>(), 30000);
+    }
+
+    void test_write_sheet_data()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+        ws.get_cell("A1").set_value("<tag> & \"quotes\"");
+        ws.get_cell("B1").set_value(9007199254740993LL);
+        ws.get_cell("C1").set_value(0.1);
+        ws.get_cell("D1").set_value(-2.5e-300);
+        ws.get_cell("A2").set_value(true);
+        ws.get_cell("B2").set_error("#DIV/0!");
+        ws.get_cell("C2").set_value("");
+        ws.get_cell("D2").set_formula("IF(A2,\"<yes>\",\"no\")");
+        ws.get_row_properties(2).height = 20.5;
+        ws.get_cell("AB300").set_value(-7);
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+
+        xlnt::workbook loaded;
+        loaded.load(data);
+        auto loaded_ws = loaded.get_active_sheet();
+
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("A1").get_value<std::string>(), "<tag> & \"quotes\"");
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("B1").get_value<long long>(), 9007199254740993LL);
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("C1").get_value<double>(), 0.1);
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("D1").get_value<double>(), -2.5e-300);
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("A2").get_value<bool>(), true);
+        TS_ASSERT(loaded_ws.get_cell("B2").get_data_type() == xlnt::cell::type::error);
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("B2").get_value<std::string>(), "#DIV/0!");
+        TS_ASSERT(loaded_ws.get_cell("C2").get_data_type() == xlnt::cell::type::string);
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("D2").get_formula(), "IF(A2,\"<yes>\",\"no\")");
+        TS_ASSERT_DELTA(loaded_ws.get_row_properties(2).height, 20.5, 1e-9);
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("AB300").get_value<int>(), -7);
+    }
+
+    void test_write_sheet_data_decimal_comma_locale()
+    {
+        xlnt::workbook wb;
+        wb.get_active_sheet().get_cell("A1").set_value(1.5);
+
+        // the locale may not be installed, in which case this only checks the C locale
+        const std::string previous = std::setlocale(LC_NUMERIC, nullptr);
+
+        for (auto name : { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "German" })
+        {
+            if (std::setlocale(LC_NUMERIC, name) != nullptr) break;
+        }
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+        std::setlocale(LC_NUMERIC, previous.c_str());
+
+        xlnt::zip_file archive(data);
+        auto sheet_xml = archive.read(xlnt::path("xl/worksheets/sheet1.xml"));
+        TS_ASSERT_DIFFERS(sheet_xml.find("<v>1.5</v>"), std::string::npos);
+    }
+
+    void test_load_from_source()
+    {
+        xlnt::workbook wb;
+        wb.get_active_sheet().get_cell("A1").set_value("in place");
+        wb.create_sheet().get_cell("B2").set_value(7);
+
+        std::vector<std::uint8_t> original;
+        wb.save(original);
+
+        xlnt::memory_source memory(original);
+        xlnt::workbook loaded;
+        loaded.load(memory);
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("A1").get_value<std::string>(), "in place");
+        TS_ASSERT_EQUALS(xlnt::workbook::probe(memory).size(), 2);
+
+        // unread sheets are copied from the source when a lazily loaded workbook is saved
+        std::istringstream stream(std::string(original.begin(), original.end()));
+        xlnt::istream_source stream_source(stream);
+        xlnt::workbook lazy;
+        lazy.set_lazy_loading(true);
+        lazy.load(stream_source);
+        lazy.get_sheet_by_index(0).get_cell("A2").set_value("added");
+
+        std::vector<std::uint8_t> saved;
+        lazy.save(saved);
+        xlnt::workbook reloaded;
+        reloaded.load(saved);
+        TS_ASSERT_EQUALS(reloaded.get_sheet_by_index(0).get_cell("A2").get_value<std::string>(), "added");
+        TS_ASSERT_EQUALS(reloaded.get_sheet_by_index(1).get_cell("B2").get_value<int>(), 7);
+    }
+
+    void test_static_part_cache_eviction()
+    {
+        xlnt::detail::static_part_cache cache;
+        auto part = [](std::size_t i) { return "custom thumbnail " + std::to_string(i); };
+        auto first = cache.get(part(0));
+        auto second = cache.get(part(1));
+
+        for (std::size_t i = 2; i < xlnt::detail::static_part_cache::max_entries; ++i)
+        {
+            cache.get(part(i));
+        }
+
+        // using the first part again makes the second one the least recently used
+        TS_ASSERT_EQUALS(cache.get(part(0)), first);
+
+        // a new part still gets cached and takes the place of the second one
+        auto added = cache.get("another thumbnail");
+        TS_ASSERT_EQUALS(cache.get("another thumbnail"), added);
+        TS_ASSERT_EQUALS(cache.get(part(0)), first);
+        TS_ASSERT_DIFFERS(cache.get(part(1)), second);
+    }
+
+    void test_save_static_parts()
+    {
+        xlnt::workbook wb;
+        std::vector<std::uint8_t> first;
+        wb.save(first);
+        std::vector<std::uint8_t> second;
+        wb.save(second);
+
+        xlnt::zip_file first_archive(first);
+        xlnt::zip_file second_archive(second);
+        const xlnt::path theme_part("xl/theme/theme1.xml");
+        const xlnt::path thumbnail_part("docProps/thumbnail.jpeg");
+        TS_ASSERT_DIFFERS(first_archive.read(theme_part).find("Office Theme"), std::string::npos);
+        TS_ASSERT_EQUALS(second_archive.read(theme_part), first_archive.read(theme_part));
+        const auto &thumbnail = wb.get_thumbnail();
+        TS_ASSERT_EQUALS(second_archive.read(thumbnail_part), std::string(thumbnail.begin(), thumbnail.end()));
+
+        // a different thumbnail is found by its content and not mistaken for the default one
+        std::vector<std::uint8_t> custom_thumbnail(thumbnail.begin(), thumbnail.end());
+        custom_thumbnail.back() ^= 0x5a;
+        wb.set_thumbnail(custom_thumbnail, "jpeg", "image/jpeg");
+        std::vector<std::uint8_t> custom;
+        wb.save(custom);
+        xlnt::zip_file custom_archive(custom);
+        TS_ASSERT(!custom_archive.check_crc());
+        TS_ASSERT_EQUALS(custom_archive.read(thumbnail_part), std::string(custom_thumbnail.begin(), custom_thumbnail.end()));
+    }
+
+    void test_save_compression_cache()
+    {
+        xlnt::workbook wb;
+        wb.get_active_sheet().get_cell("A1").set_value("unchanged");
+        auto second = wb.create_sheet();
+        second.get_cell("A1").set_value(1);
+
+        xlnt::deflate_cache cache;
+        xlnt::save_options options;
+        options.compression_cache = &cache;
+
+        std::vector<std::uint8_t> first;
+        wb.save(first, options);
+        TS_ASSERT_EQUALS(cache.hits(), 0);
+        const auto parts = cache.misses();
+        TS_ASSERT(parts > 5);
+        TS_ASSERT_EQUALS(cache.size(), parts);
+
+        // only the edited sheet is compressed again
+        second.get_cell("A1").set_value(2);
+        std::vector<std::uint8_t> edited;
+        wb.save(edited, options);
+        TS_ASSERT_EQUALS(cache.misses(), parts + 1);
+        TS_ASSERT_EQUALS(cache.hits(), parts - 1);
+
+        xlnt::workbook loaded;
+        loaded.load(edited);
+        TS_ASSERT_EQUALS(loaded.get_sheet_by_index(0).get_cell("A1").get_value<std::string>(), "unchanged");
+        TS_ASSERT_EQUALS(loaded.get_sheet_by_index(1).get_cell("A1").get_value<int>(), 2);
+
+        // the least recently used parts are dropped to stay within the capacity
+        xlnt::deflate_cache small(cache.size_in_bytes() / 2);
+        options.compression_cache = &small;
+        wb.save(edited, options);
+        TS_ASSERT(small.size_in_bytes() <= small.capacity());
+        TS_ASSERT(small.size() < parts);
+        small.clear();
+        TS_ASSERT_EQUALS(small.size(), 0);
+        TS_ASSERT_EQUALS(small.size_in_bytes(), 0);
+
+        // only the compressed bytes of a part are kept
+        const std::string compressible(100000, 'a');
+        small.get(compressible);
+        TS_ASSERT(small.size_in_bytes() < 1000);
+        TS_ASSERT_EQUALS(small.get(compressible)->uncompressed_size, compressible.size());
+        TS_ASSERT_EQUALS(small.get(compressible + "b")->uncompressed_size, compressible.size() + 1);
+        TS_ASSERT_EQUALS(small.size(), 2);
+    }
+
+    void test_save_async()
+    {
+        std::vector<std::uint8_t> data;
+        std::future<void> saved;
+
+        {
+            xlnt::workbook wb;
+            auto ws = wb.get_active_sheet();
+            ws.get_cell("A1").set_value("before");
+            ws.get_cell("A2").set_formula("1+2");
+            ws.get_cell("A3").set_value(1);
+            ws.get_cell("A3").set_font(xlnt::font().bold(true));
+            wb.calculate();
+
+            // the snapshot is a copy which keeps the stylesheet
+            xlnt::workbook copy(wb);
+            TS_ASSERT(copy.get_active_sheet().get_cell("A3").get_font().bold());
+
+            saved = wb.save_async(data);
+
+            // the save writes the snapshot taken above, not these changes
+            ws.get_cell("A1").set_value("after");
+            wb.create_sheet().set_title("later");
+        }
+
+        saved.get();
+
+        xlnt::workbook loaded;
+        loaded.load(data);
+        auto ws = loaded.get_active_sheet();
+        TS_ASSERT_EQUALS(loaded.get_sheet_titles().size(), 1);
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_value<std::string>(), "before");
+        TS_ASSERT_EQUALS(ws.get_cell("A2").get_value<int>(), 3);
+
+        xlnt::workbook failing;
+        auto missing = failing.save_async(xlnt::path("/nonexistent/directory/file.xlsx"));
+        TS_ASSERT_THROWS_ANYTHING(missing.get());
+    }
+
+    void test_save_async_copies_changed_cells()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 2000; ++row)
+        {
+            ws.get_cell(xlnt::cell_reference(1, row)).set_value(static_cast<int>(row));
+        }
+
+        ws.get_cell("B1").set_formula("A5*2");
+        ws.get_cell("B1500").set_formula("A1500+1");
+        wb.calculate();
+
+        // the sink holds the save, and with it the snapshot, until the checks are done
+        std::promise<void> release;
+        auto released = release.get_future().share();
+        std::vector<std::uint8_t> data;
+        xlnt::callback_sink sink([&](const std::uint8_t *bytes, std::size_t size) {
+            released.wait();
+            data.insert(data.end(), bytes, bytes + size);
+        });
+        auto saved = wb.save_async(sink);
+
+        const std::size_t cells = 2002;
+        TS_ASSERT_EQUALS(xlnt::detail::worksheet_inspector::shared_cells(ws), cells);
+
+        // only the block of rows holding the edited cell and the formula depending
+        // on it is copied, not the block of the formula that wasn't recalculated
+        ws.get_cell("A5").set_value(100);
+        wb.calculate();
+        // A1:A255 and B1 make up the first block
+        TS_ASSERT_EQUALS(xlnt::detail::worksheet_inspector::shared_cells(ws), cells - 256);
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 200);
+
+        release.set_value();
+        saved.get();
+        TS_ASSERT_EQUALS(xlnt::detail::worksheet_inspector::shared_cells(ws), 0);
+
+        xlnt::workbook loaded;
+        loaded.load(data);
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("A5").get_value<int>(), 5);
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("B1").get_value<int>(), 10);
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("B1500").get_value<int>(), 1501);
+    }
+
+    void test_copy_on_write()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+        auto a1 = ws.get_cell("A1");
+        a1.set_value(1);
+        ws.get_cell("B1").set_formula("A1*2");
+        ws.get_cell("A1000").set_value("far");
+        wb.calculate();
+
+        // copies share their cells until one side changes them
+        xlnt::workbook copy(wb);
+        auto copy_ws = copy.get_active_sheet();
+        TS_ASSERT_EQUALS(copy_ws.get_cell("A1").get_value<int>(), 1);
+
+        copy_ws.get_cell("A1000").set_value("changed");
+        TS_ASSERT_EQUALS(ws.get_cell("A1000").get_value<std::string>(), "far");
+
+        // a cell obtained before copying still refers to the original after its block was copied
+        ws.get_cell("C1").set_value(3);
+        a1.set_value(5);
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_value<int>(), 5);
+        TS_ASSERT_EQUALS(a1.get_value<int>(), 5);
+        TS_ASSERT_EQUALS(copy_ws.get_cell("A1").get_value<int>(), 1);
+        TS_ASSERT(!copy_ws.has_cell("C1"));
+
+        wb.calculate();
+        TS_ASSERT_EQUALS(ws.get_cell("B1").get_value<int>(), 10);
+        copy.calculate();
+        TS_ASSERT_EQUALS(copy_ws.get_cell("B1").get_value<int>(), 2);
+
+        // the copy outlives the workbook it was made from
+        auto second_copy = std::unique_ptr<xlnt::workbook>(new xlnt::workbook(copy));
+        copy_ws.get_cell("A1").set_value(7);
+        copy = xlnt::workbook();
+        TS_ASSERT_EQUALS(second_copy->get_active_sheet().get_cell("A1").get_value<int>(), 1);
+        TS_ASSERT_EQUALS(second_copy->get_active_sheet().get_cell("A1000").get_value<std::string>(), "changed");
+    }
+
+    void test_copy_on_write_extra_values()
+    {
+        auto copy = std::unique_ptr<xlnt::workbook>(new xlnt::workbook());
+
+        {
+            xlnt::workbook wb;
+            auto ws = wb.get_active_sheet();
+            ws.get_cell("A1").set_error("#N/A");
+            ws.get_cell("A2").set_hyperlink("http://example.com");
+            ws.get_cell("A3").set_formula("\"a\"&\"b\"");
+            ws.get_cell("A4").set_style(wb.create_style("extra"));
+            wb.calculate();
+
+            // formulas, errors, hyperlinks and style names are copied with their block
+            *copy = wb;
+            ws.get_cell("A1").set_error("#REF!");
+            ws.get_cell("A3").set_formula("\"c\"");
+            wb.calculate();
+            TS_ASSERT_EQUALS(ws.get_cell("A3").get_value<std::string>(), "c");
+
+            // assigning a cell copies its contents but not its position
+            ws.get_cell("B3") = ws.get_cell("A3");
+            TS_ASSERT_EQUALS(ws.get_cell("B3").get_reference().to_string(), "B3");
+            TS_ASSERT_EQUALS(ws.get_cell("B3").get_formula(), "\"c\"");
+
+            ws.get_cell("A4").clear_style();
+            ws.garbage_collect();
+            TS_ASSERT(!ws.has_cell("A4"));
+        }
+
+        // the copy outlives the workbook it was made from
+        auto copy_ws = copy->get_active_sheet();
+        TS_ASSERT_EQUALS(copy_ws.get_cell("A1").get_value<std::string>(), "#N/A");
+        TS_ASSERT_EQUALS(copy_ws.get_cell("A2").get_hyperlink(), "http://example.com");
+        TS_ASSERT_EQUALS(copy_ws.get_cell("A3").get_formula(), "\"a\"&\"b\"");
+        TS_ASSERT_EQUALS(copy_ws.get_cell("A3").get_value<std::string>(), "ab");
+        TS_ASSERT_EQUALS(copy_ws.get_cell("A4").get_style().name(), "extra");
+    }
+
+    void test_copy_on_write_strings_and_styles()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+        ws.get_cell("A1").set_value("shared");
+        ws.get_cell("A2").set_font(xlnt::font().bold(true));
+
+        // the copy reads the same shared strings and stylesheet until one side changes them
+        xlnt::workbook copy(wb);
+        const auto &const_wb = wb;
+        const auto &const_copy = copy;
+        TS_ASSERT_EQUALS(&const_wb.get_format(0), &const_copy.get_format(0));
+
+        auto copy_ws = copy.get_active_sheet();
+        copy_ws.get_cell("B1").set_value("only in the copy");
+        copy_ws.get_cell("B2").set_font(xlnt::font().italic(true));
+        TS_ASSERT_DIFFERS(&const_wb.get_format(0), &const_copy.get_format(0));
+
+        TS_ASSERT_EQUALS(wb.get_shared_string_count(), 1);
+        TS_ASSERT_EQUALS(copy.get_shared_string_count(), 2);
+        TS_ASSERT_EQUALS(copy_ws.get_cell("A1").get_value<std::string>(), "shared");
+        TS_ASSERT(copy_ws.get_cell("A2").get_font().bold());
+        TS_ASSERT(copy_ws.get_cell("B2").get_font().italic());
+        TS_ASSERT(!ws.get_cell("A2").get_font().italic());
+        TS_ASSERT_THROWS(const_wb.get_format(2), std::out_of_range);
+    }
+
+    void test_save_to_sink()
+    {
+        xlnt::workbook wb;
+        wb.get_active_sheet().get_cell("B2").set_value("sink");
+        wb.create_sheet().get_cell("A1").set_value(3);
+
+        std::vector<std::uint8_t> expected;
+        wb.save(expected);
+
+        std::vector<std::uint8_t> bytes(1, 0xff);
+        xlnt::vector_sink sink(bytes);
+        wb.save(sink);
+        TS_ASSERT_EQUALS(bytes.front(), 0xff);
+        TS_ASSERT_EQUALS(bytes.size(), expected.size() + 1);
+
+        std::ostringstream stream;
+        wb.save(stream);
+        TS_ASSERT_EQUALS(stream.str().size(), expected.size());
+
+        xlnt::workbook loaded;
+        loaded.load(std::vector<std::uint8_t>(bytes.begin() + 1, bytes.end()));
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("B2").get_value<std::string>(), "sink");
+        TS_ASSERT_EQUALS(loaded.get_sheet_by_index(1).get_cell("A1").get_value<int>(), 3);
+    }
+
+    void test_save_string_storage()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+        ws.get_cell("C1").set_value("unused");
+        ws.get_cell("C1").set_value("id 0");
+
+        for (xlnt::row_t row = 1; row <= 100; ++row)
+        {
+            ws.get_cell(xlnt::cell_reference(1, row)).set_value("id " + std::to_string(row));
+            ws.get_cell(xlnt::cell_reference(2, row)).set_value(row % 3 == 0 ? "yes" : "no");
+        }
+
+        auto save_and_read = [&wb](const xlnt::save_options &options, std::string &sheet_xml, std::string &strings_xml)
+        {
+            std::vector<std::uint8_t> data;
+            wb.save(data, options);
+            xlnt::zip_file archive(data);
+            sheet_xml = archive.read(xlnt::path("xl/worksheets/sheet1.xml"));
+            strings_xml = archive.read(xlnt::path("xl/sharedStrings.xml"));
+
+            xlnt::workbook loaded;
+            loaded.load(data);
+            auto loaded_ws = loaded.get_active_sheet();
+            TS_ASSERT_EQUALS(loaded_ws.get_cell("A42").get_value<std::string>(), "id 42");
+            TS_ASSERT_EQUALS(loaded_ws.get_cell("B42").get_value<std::string>(), "yes");
+            TS_ASSERT_EQUALS(loaded_ws.get_cell("C1").get_value<std::string>(), "id 0");
+        };
+
+        std::string sheet_xml;
+        std::string strings_xml;
+
+        xlnt::save_options options;
+        save_and_read(options, sheet_xml, strings_xml);
+        TS_ASSERT_EQUALS(sheet_xml.find("inlineStr"), std::string::npos);
+        TS_ASSERT_DIFFERS(strings_xml.find(">unused<"), std::string::npos);
+
+        options.strings = xlnt::save_options::string_storage::inline_;
+        save_and_read(options, sheet_xml, strings_xml);
+        TS_ASSERT_EQUALS(sheet_xml.find("t=\"s\""), std::string::npos);
+
+        // the identifiers are all different so only the yes and no column is shared
+        options.strings = xlnt::save_options::string_storage::automatic;
+        options.rebuild_shared_strings = true;
+        save_and_read(options, sheet_xml, strings_xml);
+        TS_ASSERT_DIFFERS(sheet_xml.find("<is><t>id 42</t></is>"), std::string::npos);
+        TS_ASSERT_DIFFERS(strings_xml.find("uniqueCount=\"2\""), std::string::npos);
+        TS_ASSERT_DIFFERS(strings_xml.find("count=\"100\""), std::string::npos);
+        TS_ASSERT_EQUALS(strings_xml.find(">unused<"), std::string::npos);
+    }
+
+    void test_save_string_overwritten_by_number()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+        ws.get_cell("A1").set_value("kept");
+        ws.get_cell("B1").set_value("replaced");
+        ws.get_cell("B1").set_value(3);
+        ws.get_cell("C1").set_value("also replaced");
+        ws.get_cell("C1").set_value(true);
+
+        xlnt::save_options options;
+        std::vector<std::uint8_t> data;
+        wb.save(data, options);
+        auto strings_xml = xlnt::zip_file(data).read(xlnt::path("xl/sharedStrings.xml"));
+        TS_ASSERT_DIFFERS(strings_xml.find(" count=\"1\""), std::string::npos);
+
+        // the strings that were replaced aren't used anymore
+        options.rebuild_shared_strings = true;
+        wb.save(data, options);
+        strings_xml = xlnt::zip_file(data).read(xlnt::path("xl/sharedStrings.xml"));
+        TS_ASSERT_DIFFERS(strings_xml.find("uniqueCount=\"1\""), std::string::npos);
+        TS_ASSERT_EQUALS(strings_xml.find("replaced"), std::string::npos);
+
+        xlnt::workbook loaded;
+        loaded.load(data);
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("A1").get_value<std::string>(), "kept");
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("B1").get_value<int>(), 3);
+        TS_ASSERT_EQUALS(loaded.get_active_sheet().get_cell("C1").get_value<bool>(), true);
+    }
+
+    void test_probe()
+    {
+        xlnt::workbook wb;
+        auto first = wb.get_active_sheet();
+        first.set_title("first");
+        first.get_cell("B2").set_value(1);
+        first.get_cell("D40").set_value("x");
+        wb.create_sheet().set_title("empty");
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+
+        auto summaries = xlnt::workbook::probe(data);
+
+        TS_ASSERT_EQUALS(summaries.size(), 2);
+        TS_ASSERT_EQUALS(summaries[0].title, "first");
+        TS_ASSERT(!summaries[0].empty);
+        TS_ASSERT_EQUALS(summaries[0].dimension, xlnt::range_reference("B2:D40"));
+        TS_ASSERT_EQUALS(summaries[0].row_count, 39);
+        TS_ASSERT_EQUALS(summaries[1].title, "empty");
+        TS_ASSERT(summaries[1].empty);
+        TS_ASSERT_EQUALS(summaries[1].row_count, 0);
+    }
+
     void test_get_sheet_names()
     {
         xlnt::workbook wb;
@@ -29,6 +29,7 @@
 #include <sstream>
 #include <iterator>
 
+#include <detail/calculation_chain.hpp>
 #include <detail/cell_impl.hpp>
 #include <detail/constants.hpp>
 #include <detail/excel_thumbnail.hpp>
@@ -37,7 +38,9 @@
 #include <detail/workbook_impl.hpp>
 #include <detail/worksheet_impl.hpp>
 #include <xlnt/cell/cell.hpp>
+#include <xlnt/packaging/input_source.hpp>
 #include <xlnt/packaging/manifest.hpp>
+#include <xlnt/packaging/output_sink.hpp>
 #include <xlnt/packaging/relationship.hpp>
 #include <xlnt/packaging/zip_file.hpp>
 #include <xlnt/styles/alignment.hpp>
@@ -50,15 +53,61 @@
 #include <xlnt/styles/protection.hpp>
 #include <xlnt/utils/exceptions.hpp>
 #include <xlnt/utils/path.hpp>
+#include <xlnt/workbook/calculation_properties.hpp>
 #include <xlnt/workbook/const_worksheet_iterator.hpp>
+#include <xlnt/workbook/load_options.hpp>
 #include <xlnt/workbook/named_range.hpp>
+#include <xlnt/workbook/save_options.hpp>
 #include <xlnt/workbook/theme.hpp>
 #include <xlnt/workbook/workbook.hpp>
 #include <xlnt/workbook/workbook_view.hpp>
 #include <xlnt/workbook/worksheet_iterator.hpp>
+#include <xlnt/workbook/worksheet_summary.hpp>
 #include <xlnt/worksheet/range.hpp>
 #include <xlnt/worksheet/worksheet.hpp>
 
+namespace {
+
+// Options equivalent to the settings of wb for the overloads of load that don't take any.
+xlnt::load_options default_load_options(const xlnt::detail::workbook_impl &wb)
+{
+    xlnt::load_options options;
+    options.lazy = wb.lazy_loading_;
+
+    return options;
+}
+
+// Return wb to the state of a new workbook but keep the settings that control
+// how the file about to be loaded into it is read.
+void reset_for_load(xlnt::detail::workbook_impl &wb, const xlnt::load_options &options)
+{
+    auto data_only = wb.data_only_;
+    auto lazy_loading = wb.lazy_loading_;
+
+    wb = xlnt::detail::workbook_impl();
+    wb.mutable_stylesheet().clear();
+
+    wb.data_only_ = data_only;
+    wb.lazy_loading_ = lazy_loading;
+    wb.load_options_ = options;
+}
+
+// The lowest sheet id above the number of sheets that isn't in use. Sheet ids
+// have to be unique but may have gaps after sheets were removed.
+std::size_t next_sheet_id(const xlnt::detail::workbook_impl &wb)
+{
+    auto id = wb.worksheets_.size() + 1;
+
+    while (wb.worksheets_.find_by_id(id) != nullptr)
+    {
+        ++id;
+    }
+
+    return id;
+}
+
+} // namespace
+
 namespace xlnt {
 
 workbook workbook::minimal()
@@ -75,13 +124,13 @@ workbook workbook::minimal()
 		uri("workbook.xml"), target_mode::internal);
 
 	std::string title("1");
-	wb.d_->worksheets_.push_back(detail::worksheet_impl(&wb, 1, title));
+	auto &sheet = wb.d_->worksheets_.push_back(detail::worksheet_impl(&wb, 1, title));
 
 	wb.d_->manifest_.register_override_type(path("/sheet1.xml"),
 		"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml");
 	auto ws_rel = wb.d_->manifest_.register_relationship(uri("workbook.xml"),
 		relationship::type::worksheet, uri("sheet1.xml"), target_mode::internal);
-	wb.d_->sheet_title_rel_id_map_[title] = ws_rel;
+	wb.d_->worksheets_.set_rel_id(sheet, ws_rel);
 
 	return wb;
 }
@@ -147,18 +196,18 @@ workbook workbook::empty_excel()
 	ws.d_->has_format_properties_ = true;
 	ws.d_->has_view_ = true;
 
-	wb.d_->stylesheet_.fills.push_back(pattern_fill().type(pattern_fill_type::none));
-	wb.d_->stylesheet_.fills.push_back(pattern_fill().type(pattern_fill_type::gray125));
+	wb.d_->mutable_stylesheet().fills.push_back(pattern_fill().type(pattern_fill_type::none));
+	wb.d_->mutable_stylesheet().fills.push_back(pattern_fill().type(pattern_fill_type::gray125));
 
 	auto default_font = font().name("Calibri").size(12).scheme("minor").family(2).color(theme_color(1));
-	wb.d_->stylesheet_.fonts.push_back(default_font);
+	wb.d_->mutable_stylesheet().fonts.push_back(default_font);
 
 	auto default_border = border().side(border_side::bottom, border::border_property())
 		.side(border_side::top, border::border_property())
 		.side(border_side::start, border::border_property())
 		.side(border_side::end, border::border_property())
 		.side(border_side::diagonal, border::border_property());
-	wb.d_->stylesheet_.borders.push_back(default_border);
+	wb.d_->mutable_stylesheet().borders.push_back(default_border);
 
 	auto &normal_style = wb.create_style("Normal").builtin_id(0);
 	normal_style.font(default_font, false);
@@ -200,13 +249,13 @@ workbook workbook::empty_libre_office()
 		"application/vnd.openxmlformats-package.relationships+xml");
 
 	std::string title("Sheet1");
-	wb.d_->worksheets_.push_back(detail::worksheet_impl(&wb, 1, title));
+	auto &sheet = wb.d_->worksheets_.push_back(detail::worksheet_impl(&wb, 1, title));
 
 	wb.d_->manifest_.register_override_type(path("xl/worksheets/sheet1.xml"),
 		"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml");
 	auto ws_rel = wb.d_->manifest_.register_relationship(uri("xl/workbook.xml"),
 		relationship::type::worksheet, uri("worksheets/sheet1.xml"), target_mode::internal);
-	wb.d_->sheet_title_rel_id_map_[title] = ws_rel;
+	wb.d_->worksheets_.set_rel_id(sheet, ws_rel);
 
 	auto ws = wb.get_sheet_by_index(0);
 	ws.d_->has_format_properties_ = true;
@@ -232,7 +281,7 @@ workbook workbook::empty_libre_office()
 		.wrap(false)
 		.indent(0)
 		.shrink(false);
-	wb.d_->stylesheet_.alignments.push_back(default_alignment);
+	wb.d_->mutable_stylesheet().alignments.push_back(default_alignment);
 
 	auto default_border = border().side(border_side::bottom, border::border_property())
 		.side(border_side::top, border::border_property())
@@ -240,29 +289,29 @@ workbook workbook::empty_libre_office()
 		.side(border_side::end, border::border_property())
 		.side(border_side::diagonal, border::border_property())
 		.diagonal(diagonal_direction::neither);
-	wb.d_->stylesheet_.borders.push_back(default_border);
+	wb.d_->mutable_stylesheet().borders.push_back(default_border);
 
 	auto default_fill = xlnt::fill(xlnt::pattern_fill().type(pattern_fill_type::none));
-	wb.d_->stylesheet_.fills.push_back(default_fill);
+	wb.d_->mutable_stylesheet().fills.push_back(default_fill);
 
 	auto gray125_fill = xlnt::fill(xlnt::pattern_fill().type(pattern_fill_type::gray125));
-	wb.d_->stylesheet_.fills.push_back(gray125_fill);
+	wb.d_->mutable_stylesheet().fills.push_back(gray125_fill);
 
 	auto default_font = font().name("Arial").size(10).family(2);
-	wb.d_->stylesheet_.fonts.push_back(default_font);
+	wb.d_->mutable_stylesheet().fonts.push_back(default_font);
 
 	auto second_font = font().name("Arial").size(10).family(0);
-	wb.d_->stylesheet_.fonts.push_back(second_font);
+	wb.d_->mutable_stylesheet().fonts.push_back(second_font);
 
 	auto default_number_format = xlnt::number_format();
 	default_number_format.set_format_string("General");
 	default_number_format.set_id(164);
-	wb.d_->stylesheet_.number_formats.push_back(default_number_format);
+	wb.d_->mutable_stylesheet().number_formats.push_back(default_number_format);
 
 	auto default_protection = xlnt::protection()
 		.locked(true)
 		.hidden(false);
-	wb.d_->stylesheet_.protections.push_back(default_protection);
+	wb.d_->mutable_stylesheet().protections.push_back(default_protection);
 
 	auto &normal_style = wb.create_style("Normal").builtin_id(0).custom(false);
 	normal_style.alignment(default_alignment, false);
@@ -414,76 +463,60 @@ void workbook::register_theme_in_manifest()
 
 const worksheet workbook::get_sheet_by_title(const std::string &title) const
 {
-    for (auto &impl : d_->worksheets_)
+    auto match = d_->worksheets_.find_by_title(title);
+
+    if (match == nullptr)
     {
-        if (impl.title_ == title)
-        {
-            return worksheet(&impl);
-        }
+        throw key_not_found();
     }
 
-    throw key_not_found();
+    return worksheet(match);
 }
 
 worksheet workbook::get_sheet_by_title(const std::string &title)
 {
-    for (auto &impl : d_->worksheets_)
+    auto match = d_->worksheets_.find_by_title(title);
+
+    if (match == nullptr)
     {
-        if (impl.title_ == title)
-        {
-            return worksheet(&impl);
-        }
+        throw key_not_found();
     }
 
-    throw key_not_found();
+    return worksheet(match);
 }
 
 worksheet workbook::get_sheet_by_index(std::size_t index)
 {
-    auto iter = std::next(d_->worksheets_.begin(), index);
-
-    if (iter == d_->worksheets_.end())
-    {
-        throw invalid_parameter();
-    }
-	return worksheet(&*iter);
+	return worksheet(&d_->worksheets_.at(index));
 }
 
 const worksheet workbook::get_sheet_by_index(std::size_t index) const
 {
-    auto iter = std::next(d_->worksheets_.begin(), index);
-
-    if (iter == d_->worksheets_.end())
-    {
-        throw invalid_parameter();
-    }
-    return worksheet(&*iter);
+    return worksheet(&d_->worksheets_.at(index));
 }
 
 worksheet workbook::get_sheet_by_id(std::size_t id)
 {
-	for (auto &impl : d_->worksheets_)
+	auto match = d_->worksheets_.find_by_id(id);
+
+	if (match == nullptr)
 	{
-		if (impl.id_ == id)
-		{
-			return worksheet(&impl);
-		}
+		throw key_not_found();
 	}
 
-	throw key_not_found();
+	return worksheet(match);
 }
 
 const worksheet workbook::get_sheet_by_id(std::size_t id) const
 {
-	for (auto &impl : d_->worksheets_)
+	auto match = d_->worksheets_.find_by_id(id);
+
+	if (match == nullptr)
 	{
-		if (impl.id_ == id)
-		{
-			return worksheet(&impl);
-		}
+		throw key_not_found();
 	}
 
-	throw key_not_found();
+	return worksheet(match);
 }
 
 worksheet workbook::get_active_sheet()
@@ -513,10 +546,11 @@ worksheet workbook::create_sheet()
         title = "Sheet" + std::to_string(++index);
     }
 
-    auto sheet_id = d_->worksheets_.size() + 1;
+    auto sheet_id = next_sheet_id(*d_);
     std::string sheet_filename = "sheet" + std::to_string(sheet_id) + ".xml";
 
-    d_->worksheets_.push_back(detail::worksheet_impl(this, sheet_id, title));
+    auto &sheet = d_->worksheets_.push_back(detail::worksheet_impl(this, sheet_id, title));
+    d_->formulas_.invalidate();
 
 	auto workbook_rel = d_->manifest_.get_relationship(path("/"), relationship::type::office_document);
     uri relative_sheet_uri(path("worksheets").append(sheet_filename).string());
@@ -525,9 +559,9 @@ worksheet workbook::create_sheet()
 		"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml");
 	auto ws_rel = d_->manifest_.register_relationship(workbook_rel.get_target(),
 		relationship::type::worksheet, relative_sheet_uri, target_mode::internal);
-	d_->sheet_title_rel_id_map_[title] = ws_rel;
+	d_->worksheets_.set_rel_id(sheet, ws_rel);
 
-    return worksheet(&d_->worksheets_.back());
+    return worksheet(&sheet);
 }
 
 void workbook::copy_sheet(worksheet to_copy)
@@ -536,8 +570,10 @@ void workbook::copy_sheet(worksheet to_copy)
 
     detail::worksheet_impl impl(*to_copy.d_);
     auto new_sheet = create_sheet();
+    impl.id_ = new_sheet.d_->id_;
     impl.title_ = new_sheet.get_title();
     *new_sheet.d_ = impl;
+    d_->formulas_.invalidate();
 }
 
 void workbook::copy_sheet(worksheet to_copy, std::size_t index)
@@ -546,27 +582,21 @@ void workbook::copy_sheet(worksheet to_copy, std::size_t index)
 
     if (index != d_->worksheets_.size() - 1)
     {
-		auto iter = d_->worksheets_.begin();
-
-		for (std::size_t i = 0; i < index; ++i, ++iter)
-		{
-		}
-
-		d_->worksheets_.insert(iter, d_->worksheets_.back());
-		d_->worksheets_.pop_back();
+		d_->worksheets_.move(d_->worksheets_.size() - 1, index);
+		d_->formulas_.invalidate();
     }
 }
 
 std::size_t workbook::get_index(worksheet ws)
 {
-    auto match = std::find(begin(), end(), ws);
+    auto index = d_->worksheets_.index_of(*ws.d_);
 
-    if (match == end())
+    if (index == detail::worksheet_registry::npos)
     {
 		throw invalid_parameter();
     }
 
-    return std::distance(begin(), match);
+    return index;
 }
 
 void workbook::create_named_range(const std::string &name, worksheet range_owner, const std::string &reference_string)
@@ -608,16 +638,17 @@ range workbook::get_named_range(const std::string &name)
 
 void workbook::load(std::istream &stream)
 {
-	clear();
-    detail::xlsx_consumer consumer(*this);
-	consumer.read(stream);
+	load(stream, default_load_options(*d_));
 }
 
 void workbook::load(const std::vector<unsigned char> &data)
 {
-	clear();
-	detail::xlsx_consumer consumer(*this);
-	consumer.read(data);
+	load(data, default_load_options(*d_));
+}
+
+void workbook::load(input_source &source)
+{
+	load(source, default_load_options(*d_));
 }
 
 void workbook::load(const std::string &filename)
@@ -627,15 +658,78 @@ void workbook::load(const std::string &filename)
 
 void workbook::load(const path &filename)
 {
-	clear();
+	load(filename, default_load_options(*d_));
+}
+
+void workbook::load(std::istream &stream, const load_options &options)
+{
+	reset_for_load(*d_, options);
+    detail::xlsx_consumer consumer(*this);
+	consumer.read(stream);
+}
+
+void workbook::load(const std::vector<unsigned char> &data, const load_options &options)
+{
+	reset_for_load(*d_, options);
+	detail::xlsx_consumer consumer(*this);
+	consumer.read(data);
+}
+
+void workbook::load(const std::string &filename, const load_options &options)
+{
+	return load(path(filename), options);
+}
+
+void workbook::load(const path &filename, const load_options &options)
+{
+	reset_for_load(*d_, options);
 	detail::xlsx_consumer consumer(*this);
 	consumer.read(filename);
 }
 
+void workbook::load(input_source &source, const load_options &options)
+{
+	reset_for_load(*d_, options);
+	detail::xlsx_consumer consumer(*this);
+	consumer.read(source);
+}
+
+std::vector<worksheet_summary> workbook::probe(const std::vector<std::uint8_t> &data)
+{
+	workbook wb(new detail::workbook_impl());
+	detail::xlsx_consumer consumer(wb);
+	return consumer.probe(data);
+}
+
+std::vector<worksheet_summary> workbook::probe(const std::string &filename)
+{
+	return probe(path(filename));
+}
+
+std::vector<worksheet_summary> workbook::probe(const path &filename)
+{
+	workbook wb(new detail::workbook_impl());
+	detail::xlsx_consumer consumer(wb);
+	return consumer.probe(filename);
+}
+
+std::vector<worksheet_summary> workbook::probe(std::istream &stream)
+{
+	workbook wb(new detail::workbook_impl());
+	detail::xlsx_consumer consumer(wb);
+	return consumer.probe(stream);
+}
+
+std::vector<worksheet_summary> workbook::probe(input_source &source)
+{
+	workbook wb(new detail::workbook_impl());
+	detail::xlsx_consumer consumer(wb);
+	return consumer.probe(source);
+}
+
 void workbook::save(std::vector<unsigned char> &data) const
 {
-	detail::xlsx_producer producer(*this);
-	producer.write(data);
+	save(data, save_options());
 }
 
 void workbook::save(const std::string &filename) const
@@ -645,16 +739,114 @@ void workbook::save(const std::string &filename) const
 
 void workbook::save(const path &filename) const
 {
-	detail::xlsx_producer producer(*this);
-	producer.write(filename);
+	save(filename, save_options());
 }
 
 void workbook::save(std::ostream &stream) const
 {
-	detail::xlsx_producer producer(*this);
+	save(stream, save_options());
+}
+
+void workbook::save(output_sink &sink) const
+{
+	save(sink, save_options());
+}
+
+void workbook::save(std::vector<unsigned char> &data, const save_options &options) const
+{
+	detail::xlsx_producer producer(*this, options);
+	producer.write(data);
+}
+
+void workbook::save(const std::string &filename, const save_options &options) const
+{
+	return save(path(filename), options);
+}
+
+void workbook::save(const path &filename, const save_options &options) const
+{
+	detail::xlsx_producer producer(*this, options);
+	producer.write(filename);
+}
+
+void workbook::save(std::ostream &stream, const save_options &options) const
+{
+	detail::xlsx_producer producer(*this, options);
 	producer.write(stream);
 }
 
+void workbook::save(output_sink &sink, const save_options &options) const
+{
+	detail::xlsx_producer producer(*this, options);
+	producer.write(sink);
+}
+
+std::future<void> workbook::save_async(const std::string &filename) const
+{
+	return save_async(path(filename), save_options());
+}
+
+std::future<void> workbook::save_async(const path &filename) const
+{
+	return save_async(filename, save_options());
+}
+
+std::future<void> workbook::save_async(std::vector<std::uint8_t> &data) const
+{
+	return save_async(data, save_options());
+}
+
+std::future<void> workbook::save_async(output_sink &sink) const
+{
+	return save_async(sink, save_options());
+}
+
+std::future<void> workbook::save_async(const std::string &filename, const save_options &options) const
+{
+	return save_async(path(filename), options);
+}
+
+// Each overload copies the workbook here and then writes the copy with a producer on
+// another thread.
+
+std::future<void> workbook::save_async(const path &filename, const save_options &options) const
+{
+	auto snapshot = std::make_shared<const workbook>(*this);
+
+	return std::async(std::launch::async, [snapshot, filename, options]()
+	{
+		detail::xlsx_producer producer(*snapshot, options);
+		producer.write(filename);
+	});
+}
+
+std::future<void> workbook::save_async(std::vector<std::uint8_t> &data, const save_options &options) const
+{
+	auto snapshot = std::make_shared<const workbook>(*this);
+
+	return std::async(std::launch::async, [snapshot, &data, options]()
+	{
+		detail::xlsx_producer producer(*snapshot, options);
+		producer.write(data);
+	});
+}
+
+std::future<void> workbook::save_async(output_sink &sink, const save_options &options) const
+{
+	auto snapshot = std::make_shared<const workbook>(*this);
+
+	return std::async(std::launch::async, [snapshot, &sink, options]()
+	{
+		detail::xlsx_producer producer(*snapshot, options);
+		producer.write(sink);
+	});
+}
+
+void workbook::calculate()
+{
+	d_->formulas_.calculate(*d_);
+}
+
 void workbook::set_guess_types(bool guess)
 {
     d_->guess_types_ = guess;
@@ -667,17 +859,27 @@ bool workbook::get_guess_types() const
 
 void workbook::remove_sheet(worksheet ws)
 {
-    auto match_iter = std::find_if(d_->worksheets_.begin(), d_->worksheets_.end(),
-		[=](detail::worksheet_impl &comp) { return worksheet(&comp) == ws; });
+    auto index = d_->worksheets_.index_of(*ws.d_);
 
-    if (match_iter == d_->worksheets_.end())
+    if (index == detail::worksheet_registry::npos)
     {
 		throw invalid_parameter();
     }
 
-    auto sheet_filename = path("worksheets/sheet" + std::to_string(d_->worksheets_.size()) + ".xml");
+    // drop the sheet's part from the package so that it isn't written anymore
+    auto rel_id = d_->worksheets_.get_rel_id(*ws.d_);
+    auto workbook_rel = d_->manifest_.get_relationship(path("/"), relationship::type::office_document);
 
-    d_->worksheets_.erase(match_iter);
+    if (!rel_id.empty() && d_->manifest_.has_relationship(workbook_rel.get_target().get_path(), rel_id))
+    {
+        auto sheet_rel = d_->manifest_.get_relationship(workbook_rel.get_target().get_path(), rel_id);
+        d_->manifest_.unregister_override_type(path("/").append(workbook_rel.get_target().get_path().parent())
+            .append(sheet_rel.get_target().get_path()));
+        d_->manifest_.unregister_relationship(workbook_rel.get_target(), rel_id);
+    }
+
+    d_->worksheets_.erase(index);
+    d_->formulas_.invalidate();
 }
 
 worksheet workbook::create_sheet(std::size_t index)
@@ -686,14 +888,8 @@ worksheet workbook::create_sheet(std::size_t index)
 
     if (index != d_->worksheets_.size() - 1)
     {
-		auto iter = d_->worksheets_.begin();
-
-		for (std::size_t i = 0; i < index; ++i, ++iter)
-		{
-		}
-
-		d_->worksheets_.insert(iter, d_->worksheets_.back());
-		d_->worksheets_.pop_back();
+		d_->worksheets_.move(d_->worksheets_.size() - 1, index);
+		d_->formulas_.invalidate();
     }
 
 	return get_sheet_by_index(index);
@@ -701,10 +897,11 @@ worksheet workbook::create_sheet(std::size_t index)
 
 worksheet workbook::create_sheet_with_rel(const std::string &title, const relationship &rel)
 {
-    auto sheet_id = d_->worksheets_.size() + 1;
-    d_->worksheets_.push_back(detail::worksheet_impl(this, sheet_id, title));
+    auto &sheet = d_->worksheets_.push_back(detail::worksheet_impl(this, next_sheet_id(*d_), title));
+    d_->worksheets_.set_rel_id(sheet, rel.get_id());
+    d_->formulas_.invalidate();
 
-    return worksheet(&d_->worksheets_.back());
+    return worksheet(&sheet);
 }
 
 workbook::iterator workbook::begin()
@@ -741,9 +938,9 @@ std::vector<std::string> workbook::get_sheet_titles() const
 {
     std::vector<std::string> names;
 
-    for (auto ws : *this)
+    for (const auto &sheet : d_->worksheets_)
     {
-        names.push_back(ws.get_title());
+        names.push_back(sheet.title_);
     }
 
     return names;
@@ -767,7 +964,7 @@ worksheet workbook::operator[](std::size_t index)
 void workbook::clear()
 {
 	*d_ = detail::workbook_impl();
-    d_->stylesheet_.clear();
+    d_->mutable_stylesheet().clear();
 }
 
 bool workbook::operator==(const workbook &rhs) const
@@ -787,17 +984,17 @@ void swap(workbook &left, workbook &right)
 
 	if (left.d_ != nullptr)
 	{
-		for (auto ws : left)
+		for (auto &sheet : left.d_->worksheets_)
 		{
-			ws.set_parent(left);
+			sheet.parent_ = &left;
 		}
 	}
 
 	if (right.d_ != nullptr)
 	{
-		for (auto ws : right)
+		for (auto &sheet : right.d_->worksheets_)
 		{
-			ws.set_parent(right);
+			sheet.parent_ = &right;
 		}
 	}
 }
@@ -817,9 +1014,9 @@ workbook::workbook(const workbook &other) : workbook()
 {
     *d_.get() = *other.d_.get();
 
-    for (auto ws : *this)
+    for (auto &sheet : d_->worksheets_)
     {
-        ws.set_parent(*this);
+        sheet.parent_ = this;
     }
 }
 
@@ -837,6 +1034,16 @@ void workbook::set_data_only(bool data_only)
     d_->data_only_ = data_only;
 }
 
+bool workbook::get_lazy_loading() const
+{
+    return d_->lazy_loading_;
+}
+
+void workbook::set_lazy_loading(bool lazy)
+{
+    d_->lazy_loading_ = lazy;
+}
+
 bool workbook::has_theme() const
 {
 	return d_->has_theme_;
@@ -858,9 +1065,9 @@ std::vector<named_range> workbook::get_named_ranges() const
 {
     std::vector<named_range> named_ranges;
 
-    for (auto ws : *this)
+    for (const auto &sheet : d_->worksheets_)
     {
-        for (auto &ws_named_range : ws.d_->named_ranges_)
+        for (auto &ws_named_range : sheet.named_ranges_)
         {
             named_ranges.push_back(ws_named_range.second);
         }
@@ -872,23 +1079,23 @@ std::vector<named_range> workbook::get_named_ranges() const
 format &workbook::create_format()
 {
 	register_stylesheet_in_manifest();
-    return d_->stylesheet_.create_format();
+    return d_->mutable_stylesheet().create_format();
 }
 
 bool workbook::has_style(const std::string &name) const
 {
-	return d_->stylesheet_.has_style(name);
+	return d_->stylesheet_->has_style(name);
 }
 
 void workbook::clear_styles()
 {
-    d_->stylesheet_.styles.clear();
+    d_->mutable_stylesheet().styles.clear();
     apply_to_cells([](cell c) { c.clear_style(); });
 }
 
 void workbook::clear_formats()
 {
-    d_->stylesheet_.formats.clear();
+    d_->mutable_stylesheet().formats.clear();
     apply_to_cells([](cell c) { c.clear_format(); });
 }
 
@@ -908,12 +1115,12 @@ void workbook::apply_to_cells(std::function<void(cell)> f)
 
 format &workbook::get_format(std::size_t format_index)
 {
-	return d_->stylesheet_.get_format(format_index);
+	return d_->mutable_stylesheet().get_format(format_index);
 }
 
 const format &workbook::get_format(std::size_t format_index) const
 {
-	return d_->stylesheet_.get_format(format_index);
+	return d_->stylesheet_->get_format(format_index);
 }
 
 manifest &workbook::get_manifest()
@@ -926,40 +1133,38 @@ const manifest &workbook::get_manifest() const
     return d_->manifest_;
 }
 
-std::vector<text> &workbook::get_shared_strings()
+std::vector<text> workbook::get_shared_strings() const
 {
-    return d_->shared_strings_;
+    std::vector<text> strings;
+    strings.reserve(d_->shared_strings_->size());
+
+    for (std::size_t i = 0; i < d_->shared_strings_->size(); ++i)
+    {
+        strings.push_back(d_->shared_strings_->get(i));
+    }
+
+    return strings;
 }
 
-const std::vector<text> &workbook::get_shared_strings() const
+std::size_t workbook::get_shared_string_count() const
 {
-    return d_->shared_strings_;
+    return d_->shared_strings_->size();
+}
+
+text workbook::get_shared_string(std::size_t index) const
+{
+    return d_->shared_strings_->get(index);
 }
 
 void workbook::add_shared_string(const text &shared, bool allow_duplicates)
 {
 	register_shared_string_table_in_manifest();
-
-	if (!allow_duplicates)
-	{
-		//TODO: inefficient, use a set or something?
-		for (auto &s : d_->shared_strings_)
-		{
-			if (s == shared) return;
-		}
-	}
-    
-    d_->shared_strings_.push_back(shared);
+    d_->mutable_shared_strings().add(shared, allow_duplicates);
 }
 
 bool workbook::contains(const std::string &sheet_title) const
 {
-    for(auto ws : *this)
-    {
-        if(ws.get_title() == sheet_title) return true;
-    }
-    
-    return false;
+    return d_->worksheets_.find_by_title(sheet_title) != nullptr;
 }
 
 void workbook::set_thumbnail(const std::vector<std::uint8_t> &thumbnail,
@@ -982,17 +1187,17 @@ const std::vector<std::uint8_t> &workbook::get_thumbnail() const
 
 style &workbook::create_style(const std::string &name)
 {
-	return d_->stylesheet_.create_style().name(name);
+	return d_->mutable_stylesheet().create_style().name(name);
 }
 
 style &workbook::get_style(const std::string &name)
 {
-	return d_->stylesheet_.get_style(name);
+	return d_->mutable_stylesheet().get_style(name);
 }
 
 const style &workbook::get_style(const std::string &name) const
 {
-	return d_->stylesheet_.get_style(name);
+	return d_->stylesheet_->get_style(name);
 }
 
 std::string workbook::get_application() const
@@ -1260,6 +1465,17 @@ bool workbook::has_calculation_properties() const
 	return d_->has_calculation_properties_;
 }
 
+calculation_properties workbook::get_calculation_properties() const
+{
+	return d_->calculation_properties_;
+}
+
+void workbook::set_calculation_properties(const calculation_properties &properties)
+{
+	d_->has_calculation_properties_ = true;
+	d_->calculation_properties_ = properties;
+}
+
 bool workbook::has_arch_id() const
 {
 	return d_->has_arch_id_;
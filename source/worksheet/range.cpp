@@ -26,6 +26,30 @@
 #include <xlnt/worksheet/range_iterator.hpp>
 #include <xlnt/worksheet/range_reference.hpp>
 #include <xlnt/worksheet/worksheet.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+#include <detail/numeric_kernels.hpp>
+#include <detail/worksheet_impl.hpp>
+
+namespace {
+
+xlnt::detail::numeric_bounds get_bounds(const xlnt::range_reference &reference)
+{
+    return { reference.get_top_left().get_row(), reference.get_bottom_right().get_row(),
+        reference.get_top_left().get_column_index().index, reference.get_bottom_right().get_column_index().index };
+}
+
+xlnt::detail::numeric_summary summarize(const xlnt::detail::worksheet_impl &sheet, const xlnt::range_reference &reference)
+{
+    xlnt::detail::numeric_summary summary;
+
+    xlnt::detail::gather_numeric_blocks(sheet, get_bounds(reference),
+        [&summary](const xlnt::detail::numeric_block &block) { summary.merge(xlnt::detail::summarize(block)); });
+
+    return summary;
+}
+
+} // namespace
 
 namespace xlnt {
 
@@ -202,4 +226,50 @@ range::const_reverse_iterator range::rend() const
     return crend();
 }
 
+double range::sum() const
+{
+    return summarize(*ws_.d_, ref_).sum;
+}
+
+double range::minimum() const
+{
+    auto summary = summarize(*ws_.d_, ref_);
+
+    return summary.count == 0 ? 0 : summary.min;
+}
+
+double range::maximum() const
+{
+    auto summary = summarize(*ws_.d_, ref_);
+
+    return summary.count == 0 ? 0 : summary.max;
+}
+
+std::size_t range::count() const
+{
+    return summarize(*ws_.d_, ref_).count;
+}
+
+double range::mean() const
+{
+    auto summary = summarize(*ws_.d_, ref_);
+
+    if (summary.count == 0)
+    {
+        throw invalid_data_type();
+    }
+
+    return summary.sum / static_cast<double>(summary.count);
+}
+
+std::size_t range::count_if(comparison_operator op, double operand) const
+{
+    std::size_t count = 0;
+
+    detail::gather_numeric_blocks(*ws_.d_, get_bounds(ref_),
+        [&](const detail::numeric_block &block) { count += detail::count_matching(block, op, operand); });
+
+    return count;
+}
+
 } // namespace xlnt
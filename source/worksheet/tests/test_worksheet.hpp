@@ -516,6 +516,89 @@ public:
         TS_ASSERT_EQUALS(ws.get_merged_ranges().size(), 0);
     }
 
+    void test_merged_range_lookup()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+        ws.get_cell("C1").set_value("cleared");
+        ws.get_cell("A1").set_value("kept");
+
+        // merging doesn't create the cells of the range
+        ws.merge_cells("A1:XFD1048576");
+        TS_ASSERT_EQUALS(ws.get_cell("A1").get_value<std::string>(), "kept");
+        TS_ASSERT_EQUALS(ws.get_cell("C1").get_value<std::string>(), "");
+        TS_ASSERT(ws.has_merged_range("ZZ99999"));
+        TS_ASSERT(!ws.has_cell("ZZ99999"));
+        ws.unmerge_cells("A1:XFD1048576");
+        TS_ASSERT(!ws.has_merged_range("ZZ99999"));
+
+        for (xlnt::row_t row = 1; row <= 2000; ++row)
+        {
+            ws.merge_cells(xlnt::range_reference(1, row * 2, 3, row * 2 + 1));
+        }
+
+        TS_ASSERT(ws.get_cell("B1001").is_merged());
+        TS_ASSERT(!ws.get_cell("D1001").is_merged());
+        TS_ASSERT(!ws.has_merged_range("A1"));
+        TS_ASSERT_EQUALS(ws.get_merged_range("C4001"), xlnt::range_reference("A4000:C4001"));
+        TS_ASSERT_THROWS(ws.get_merged_range("D4001"), xlnt::key_not_found);
+
+        ws.unmerge_cells("A1000:C1001");
+        TS_ASSERT(!ws.has_merged_range("B1001"));
+        TS_ASSERT(ws.has_merged_range("B1002"));
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+        xlnt::workbook loaded;
+        loaded.load(data);
+        auto loaded_ws = loaded.get_active_sheet();
+
+        TS_ASSERT_EQUALS(loaded_ws.get_merged_ranges(), ws.get_merged_ranges());
+        TS_ASSERT(loaded_ws.has_merged_range("C3999"));
+        TS_ASSERT_EQUALS(loaded_ws.get_cell("A1").get_value<std::string>(), "kept");
+    }
+
+    void test_unmerge_many()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 1000; ++row)
+        {
+            ws.merge_cells(xlnt::range_reference(1, row, 2, row));
+        }
+
+        TS_ASSERT(ws.has_merged_range("B700"));
+
+        // removed ranges are dropped in bulk once they are half of them, lookups in between skip them
+        for (xlnt::row_t row = 1; row <= 1000; row += 2)
+        {
+            ws.unmerge_cells(xlnt::range_reference(1, row, 2, row));
+            TS_ASSERT(!ws.has_merged_range(xlnt::cell_reference(2, row)));
+            TS_ASSERT(ws.has_merged_range(xlnt::cell_reference(2, row + 1)));
+        }
+
+        TS_ASSERT_THROWS(ws.unmerge_cells("A1:B1"), xlnt::invalid_parameter);
+        ws.unmerge_cells("A2:B2");
+
+        auto ranges = ws.get_merged_ranges();
+        TS_ASSERT_EQUALS(ranges.size(), 499);
+        TS_ASSERT_EQUALS(ranges.front(), xlnt::range_reference("A4:B4"));
+        TS_ASSERT_EQUALS(ranges.back(), xlnt::range_reference("A1000:B1000"));
+        TS_ASSERT(ws.has_merged_range("A998"));
+        TS_ASSERT(!ws.has_merged_range("A999"));
+
+        // a cell merged on its own is a range of one cell
+        auto cell = ws.get_cell("D5");
+        cell.set_merged(true);
+        TS_ASSERT(cell.is_merged());
+        TS_ASSERT_EQUALS(ws.get_merged_range("D5"), xlnt::range_reference("D5:D5"));
+        cell.set_merged(false);
+        TS_ASSERT(!cell.is_merged());
+        ws.get_cell("A4").set_merged(false);
+        TS_ASSERT(ws.get_cell("A4").is_merged());
+    }
+
     void test_print_titles_old()
     {
         xlnt::workbook wb;
@@ -966,6 +1049,43 @@ public:
         TS_ASSERT_EQUALS(dimensions, xlnt::range_reference("B2", "B2"));
     }
 
+    void test_garbage_collect_compacts()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 200; row++)
+        {
+            for (xlnt::column_t::index_t column = 1; column <= 100; column++)
+            {
+                ws.get_cell(xlnt::cell_reference(column, row)).set_value(static_cast<int>(row));
+            }
+        }
+
+        auto kept = ws.get_cell("C5");
+        kept.set_hyperlink("http://example.com");
+        auto formula = ws.get_cell("D7");
+        formula.set_formula("=A1+B1");
+
+        for (xlnt::row_t row = 1; row <= 200; row++)
+        {
+            for (xlnt::column_t::index_t column = 1; column <= 100; column++)
+            {
+                if ((row != 5 || column != 3) && (row != 7 || column != 4))
+                {
+                    ws.get_cell(xlnt::cell_reference(column, row)).clear_value();
+                }
+            }
+        }
+
+        ws.garbage_collect();
+
+        TS_ASSERT_EQUALS(ws.calculate_dimension(), xlnt::range_reference("C5", "D7"));
+        TS_ASSERT_EQUALS(kept.get_value<int>(), 5);
+        TS_ASSERT_EQUALS(kept.get_hyperlink(), "http://example.com");
+        TS_ASSERT_EQUALS(formula.get_formula(), "A1+B1");
+    }
+
     void test_has_cell()
     {
         xlnt::workbook wb;
@@ -1124,4 +1244,57 @@ public:
 		TS_ASSERT_THROWS_NOTHING(ws.create_named_range("XFE1048576", "A2"));
 		TS_ASSERT_THROWS_NOTHING(ws.create_named_range("XFD1048577", "A2"));
 	}
+
+    void test_range_aggregates()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.get_active_sheet();
+
+        // enough cells to fill several blocks, with gaps and non-numeric cells
+        for (xlnt::row_t row = 1; row <= 3000; ++row)
+        {
+            if (row % 7 == 0) continue;
+
+            if (row % 100 == 0)
+            {
+                ws.get_cell(xlnt::cell_reference(1, row)).set_value("text");
+            }
+            else
+            {
+                ws.get_cell(xlnt::cell_reference(1, row)).set_value(static_cast<int>(row) - 1000);
+            }
+        }
+
+        double expected_sum = 0;
+        std::size_t expected_count = 0;
+        std::size_t expected_positive = 0;
+
+        for (int row = 1; row <= 3000; ++row)
+        {
+            if (row % 7 == 0 || row % 100 == 0) continue;
+
+            expected_sum += row - 1000;
+            ++expected_count;
+            if (row - 1000 > 0) ++expected_positive;
+        }
+
+        auto column = ws.get_range("A1:A3000");
+
+        TS_ASSERT_EQUALS(column.sum(), expected_sum);
+        TS_ASSERT_EQUALS(column.count(), expected_count);
+        TS_ASSERT_EQUALS(column.minimum(), -999);
+        TS_ASSERT_EQUALS(column.maximum(), 1999);
+        TS_ASSERT_DELTA(column.mean(), expected_sum / expected_count, 1e-9);
+        TS_ASSERT_EQUALS(column.count_if(xlnt::comparison_operator::greater, 0), expected_positive);
+        TS_ASSERT_EQUALS(column.count_if(xlnt::comparison_operator::equal, 5), 1);
+
+        auto part = ws.get_range("A10:A12");
+        TS_ASSERT_EQUALS(part.sum(), -990 - 989 - 988);
+
+        auto empty = ws.get_range("B1:C10");
+        TS_ASSERT_EQUALS(empty.sum(), 0);
+        TS_ASSERT_EQUALS(empty.count(), 0);
+        TS_ASSERT_EQUALS(empty.minimum(), 0);
+        TS_ASSERT_THROWS(empty.mean(), xlnt::invalid_data_type);
+    }
 };
@@ -47,6 +47,7 @@
 #include <detail/constants.hpp>
 #include <detail/workbook_impl.hpp>
 #include <detail/worksheet_impl.hpp>
+#include <detail/worksheet_inspector.hpp>
 
 namespace xlnt {
 
@@ -110,6 +111,7 @@ void worksheet::create_named_range(const std::string &name, const range_referenc
     targets.push_back({ *this, reference }); 
 
     d_->named_ranges_[name] = named_range(name, targets);
+    get_workbook().impl().formulas_.invalidate();
 }
 
 range worksheet::operator()(const xlnt::cell_reference &top_left, const xlnt::cell_reference &bottom_right)
@@ -124,26 +126,32 @@ cell worksheet::operator[](const cell_reference &ref)
 
 std::vector<range_reference> worksheet::get_merged_ranges() const
 {
-    return d_->merged_cells_;
+    d_->parse_deferred();
+    return d_->merged_cells_.ranges();
 }
 
 bool worksheet::has_page_margins() const
 {
+	d_->parse_deferred();
 	return d_->has_page_margins_;
 }
 
 bool worksheet::has_page_setup() const
 {
+	d_->parse_deferred();
 	return d_->has_page_setup_;
 }
 
 page_margins worksheet::get_page_margins() const
 {
+    d_->parse_deferred();
     return d_->page_margins_;
 }
 
 void worksheet::set_page_margins(const page_margins &margins)
 {
+	d_->parse_deferred();
+
 	d_->page_margins_ = margins;
 	d_->has_page_margins_ = true;
 }
@@ -155,6 +163,7 @@ void worksheet::auto_filter(const std::string &reference_string)
 
 void worksheet::auto_filter(const range_reference &reference)
 {
+    d_->parse_deferred();
     d_->auto_filter_ = reference;
 }
 
@@ -165,27 +174,34 @@ void worksheet::auto_filter(const xlnt::range &range)
 
 range_reference worksheet::get_auto_filter() const
 {
+    d_->parse_deferred();
     return d_->auto_filter_;
 }
 
 bool worksheet::has_auto_filter() const
 {
+    d_->parse_deferred();
     return d_->auto_filter_.get_width() > 0;
 }
 
 void worksheet::unset_auto_filter()
 {
+    d_->parse_deferred();
     d_->auto_filter_ = range_reference(1, 1, 1, 1);
 }
 
 void worksheet::set_page_setup(const page_setup &setup)
 {
+	d_->parse_deferred();
+
 	d_->has_page_setup_ = true;
 	d_->page_setup_ = setup;
 }
 
 page_setup worksheet::get_page_setup() const
 {
+	d_->parse_deferred();
+
 	if (!d_->has_page_setup_)
 	{
 		throw invalid_attribute();
@@ -211,38 +227,46 @@ const workbook &worksheet::get_workbook() const
 
 void worksheet::garbage_collect()
 {
-    auto cell_map_iter = d_->cell_map_.begin();
+    d_->parse_deferred();
 
-    while (cell_map_iter != d_->cell_map_.end())
+    std::vector<row_t> empty_rows;
+
+    for (auto &row : d_->cell_map_.mutable_rows())
     {
-        auto cell_iter = cell_map_iter->second.begin();
+        auto cell_iter = row.second.begin();
 
-        while (cell_iter != cell_map_iter->second.end())
+        while (cell_iter != row.second.end())
         {
-            cell current_cell(&cell_iter->second);
+            cell current_cell(&cell_iter->second, d_);
 
             if (current_cell.garbage_collectible())
             {
-                cell_iter = cell_map_iter->second.erase(cell_iter);
+                cell_iter = detail::cell_store::erase(row.second, cell_iter);
                 continue;
             }
 
             cell_iter++;
         }
 
-        if (cell_map_iter->second.empty())
+        if (row.second.empty())
         {
-            cell_map_iter = d_->cell_map_.erase(cell_map_iter);
-            continue;
+            empty_rows.push_back(row.first);
         }
+    }
 
-        cell_map_iter++;
+    // rows are erased afterwards since erasing the last row of a block removes the block
+    for (auto row : empty_rows)
+    {
+        d_->cell_map_.erase(row);
     }
+
+    // the memory of erased cells is only given back by moving the rest to a new arena
+    d_->cell_map_.compact();
 }
 
 void worksheet::set_id(std::size_t id)
 {
-    d_->id_ = id;
+    get_workbook().impl().worksheets_.set_id(*d_, id);
 }
 
 std::size_t worksheet::get_id() const
@@ -267,19 +291,21 @@ void worksheet::set_title(const std::string &title)
 		throw invalid_sheet_title(title);
 	}
 
-	auto same_title = std::find_if(get_workbook().begin(), get_workbook().end(), 
-		[&](worksheet ws) { return ws.get_title() == title; });
+	auto &sheets = get_workbook().impl().worksheets_;
+	auto same_title = sheets.find_by_title(title);
 
-	if (same_title != get_workbook().end() && *same_title != *this)
+	if (same_title != nullptr && same_title != d_)
 	{
 		throw invalid_sheet_title(title);
 	}
 
-	d_->title_ = title;
+	sheets.set_title(*d_, title);
+	get_workbook().impl().formulas_.invalidate();
 }
 
 cell_reference worksheet::get_frozen_panes() const
 {
+    d_->parse_deferred();
     return d_->view_.get_pane().top_left_cell;
 }
 
@@ -290,6 +316,8 @@ void worksheet::freeze_panes(xlnt::cell top_left_cell)
 
 void worksheet::freeze_panes(const std::string &top_left_coordinate)
 {
+    d_->parse_deferred();
+
     auto ref = cell_reference(top_left_coordinate);
     d_->view_.get_pane().top_left_cell = ref;
     d_->view_.get_pane().state = pane_state::frozen;
@@ -331,37 +359,39 @@ void worksheet::freeze_panes(const std::string &top_left_coordinate)
 
 void worksheet::unfreeze_panes()
 {
+    d_->parse_deferred();
+
     d_->view_.get_pane().top_left_cell = cell_reference("A1");
     d_->view_.get_pane().state = pane_state::normal;
 }
 
 cell worksheet::get_cell(const cell_reference &reference)
 {
-    if (d_->cell_map_.find(reference.get_row()) == d_->cell_map_.end())
-    {
-        d_->cell_map_[reference.get_row()] = std::unordered_map<column_t, detail::cell_impl>();
-    }
+    d_->parse_deferred();
 
-    auto &row = d_->cell_map_[reference.get_row()];
+    // an existing cell isn't modified yet so the block holding it stays shared with any copies
+    auto existing = d_->cell_map_.find_cell(reference.get_row(), reference.get_column_index());
 
-    if (row.find(reference.get_column_index()) == row.end())
+    if (existing != nullptr)
     {
-        auto &impl = row[reference.get_column_index()] = detail::cell_impl();
-		impl.parent_ = d_;
-		impl.column_ = reference.get_column_index();
-		impl.row_ = reference.get_row();
+        return cell(const_cast<detail::cell_impl *>(existing), d_);
     }
 
-    return cell(&row[reference.get_column_index()]);
+    return cell(&d_->cell_map_.get_cell(reference.get_row(), reference.get_column_index()), d_);
 }
 
 const cell worksheet::get_cell(const cell_reference &reference) const
 {
-    return cell(&d_->cell_map_.at(reference.get_row()).at(reference.get_column_index()));
+    d_->parse_deferred();
+
+    auto &impl = d_->cell_map_.at(reference.get_row()).at(reference.get_column_index());
+    return cell(const_cast<detail::cell_impl *>(&impl), d_);
 }
 
 bool worksheet::has_cell(const cell_reference &reference) const
 {
+    d_->parse_deferred();
+
     const auto row = d_->cell_map_.find(reference.get_row());
     if(row == d_->cell_map_.cend())
         return false;
@@ -375,6 +405,7 @@ bool worksheet::has_cell(const cell_reference &reference) const
 
 bool worksheet::has_row_properties(row_t row) const
 {
+    d_->parse_deferred();
     return d_->row_properties_.find(row) != d_->row_properties_.end();
 }
 
@@ -395,6 +426,8 @@ range worksheet::get_named_range(const std::string &name)
 
 column_t worksheet::get_lowest_column() const
 {
+    d_->parse_deferred();
+
     if (d_->cell_map_.empty())
     {
         return constants::min_column();
@@ -415,6 +448,8 @@ column_t worksheet::get_lowest_column() const
 
 row_t worksheet::get_lowest_row() const
 {
+    d_->parse_deferred();
+
     if (d_->cell_map_.empty())
     {
         return constants::min_row();
@@ -432,6 +467,8 @@ row_t worksheet::get_lowest_row() const
 
 row_t worksheet::get_highest_row() const
 {
+    d_->parse_deferred();
+
     row_t highest = constants::min_row();
 
     for (auto &row : d_->cell_map_)
@@ -444,6 +481,8 @@ row_t worksheet::get_highest_row() const
 
 column_t worksheet::get_highest_column() const
 {
+    d_->parse_deferred();
+
     column_t highest = constants::min_column();
 
     for (auto &row : d_->cell_map_)
@@ -459,11 +498,13 @@ column_t worksheet::get_highest_column() const
 
 bool worksheet::has_dimension() const
 {
+	d_->parse_deferred();
 	return d_->has_dimension_;
 }
 
 bool worksheet::has_format_properties() const
 {
+	d_->parse_deferred();
 	return d_->has_format_properties_;
 }
 
@@ -498,6 +539,26 @@ const range worksheet::get_range(const range_reference &reference) const
     return range(*this, reference);
 }
 
+bool worksheet::has_merged_range(const cell_reference &reference) const
+{
+    d_->parse_deferred();
+    return d_->merged_cells_.find(reference) != nullptr;
+}
+
+range_reference worksheet::get_merged_range(const cell_reference &reference) const
+{
+    d_->parse_deferred();
+
+    auto match = d_->merged_cells_.find(reference);
+
+    if (match == nullptr)
+    {
+        throw key_not_found();
+    }
+
+    return *match;
+}
+
 void worksheet::merge_cells(const std::string &reference_string)
 {
     merge_cells(range_reference(reference_string));
@@ -510,28 +571,61 @@ void worksheet::unmerge_cells(const std::string &reference_string)
 
 void worksheet::merge_cells(const range_reference &reference)
 {
-    d_->merged_cells_.push_back(reference);
-    bool first = true;
+    d_->parse_deferred();
+
+    d_->merged_cells_.add(reference);
 
-    for (auto row : get_range(reference))
+    // only cells that already exist are touched so that merging a large range stays cheap
+    const auto top_left = reference.get_top_left();
+    const auto bottom_right = reference.get_bottom_right();
+    const auto first_row = std::min(top_left.get_row(), bottom_right.get_row());
+    const auto last_row = std::max(top_left.get_row(), bottom_right.get_row());
+    const auto first_column = std::min(top_left.get_column(), bottom_right.get_column());
+    const auto last_column = std::max(top_left.get_column(), bottom_right.get_column());
+
+    auto clear_row = [&](row_t row_index, detail::cell_store::row_map &row)
     {
-        for (auto cell : row)
+        for (auto &entry : row)
         {
-            cell.set_merged(true);
+            if (entry.first < first_column || entry.first > last_column) continue;
+            if (row_index == first_row && entry.first == first_column) continue;
+
+            cell merged(&entry.second, d_);
 
-            if (!first)
+            if (merged.get_data_type() == cell::type::string)
             {
-                if (cell.get_data_type() == cell::type::string)
-                {
-                    cell.set_value("");
-                }
-                else
-                {
-                    cell.clear_value();
-                }
+                merged.set_value("");
             }
+            else
+            {
+                merged.clear_value();
+            }
+        }
+    };
 
-            first = false;
+    if (static_cast<std::size_t>(last_row - first_row) < d_->cell_map_.size())
+    {
+        // the loop condition is checked at the end since last_row may be the largest row_t
+        for (auto row_index = first_row; ; ++row_index)
+        {
+            auto match = d_->cell_map_.find(row_index);
+
+            if (match != d_->cell_map_.end())
+            {
+                clear_row(row_index, d_->cell_map_[row_index]);
+            }
+
+            if (row_index == last_row) break;
+        }
+    }
+    else
+    {
+        for (auto &row : d_->cell_map_.mutable_rows())
+        {
+            if (row.first >= first_row && row.first <= last_row)
+            {
+                clear_row(row.first, row.second);
+            }
         }
     }
 }
@@ -543,22 +637,12 @@ void worksheet::merge_cells(column_t start_column, row_t start_row, column_t end
 
 void worksheet::unmerge_cells(const range_reference &reference)
 {
-    auto match = std::find(d_->merged_cells_.begin(), d_->merged_cells_.end(), reference);
+    d_->parse_deferred();
 
-    if (match == d_->merged_cells_.end())
+    if (!d_->merged_cells_.remove(reference))
     {
 		throw invalid_parameter();
     }
-
-    d_->merged_cells_.erase(match);
-
-    for (auto row : get_range(reference))
-    {
-        for (auto cell : row)
-        {
-            cell.set_merged(false);
-        }
-    }
 }
 
 void worksheet::unmerge_cells(column_t start_column, row_t start_row, column_t end_column, row_t end_row)
@@ -584,6 +668,8 @@ void worksheet::append(const std::vector<std::string> &cells)
 
 row_t worksheet::get_next_row() const
 {
+    d_->parse_deferred();
+
     auto row = get_highest_row() + 1;
 
     if (row == 2 && d_->cell_map_.size() == 0)
@@ -676,6 +762,9 @@ bool worksheet::compare(const worksheet &other, bool reference) const
     }
     
     if(d_->parent_ != other.d_->parent_) return false;
+
+    d_->parse_deferred();
+    other.d_->parse_deferred();
     
     for(auto &row : d_->cell_map_)
     {
@@ -686,20 +775,22 @@ bool worksheet::compare(const worksheet &other, bool reference) const
         
         for(auto &cell : row.second)
         {
-            if(other.d_->cell_map_[row.first].find(cell.first) == other.d_->cell_map_[row.first].end())
+            auto other_impl = other.d_->cell_map_.find_cell(row.first, cell.first);
+
+            if(other_impl == nullptr)
             {
                 return false;
             }
             
-            xlnt::cell this_cell(&cell.second);
-			xlnt::cell other_cell(&other.d_->cell_map_[row.first][cell.first]);
+            const xlnt::cell this_cell(const_cast<detail::cell_impl *>(&cell.second), d_);
+			const xlnt::cell other_cell(const_cast<detail::cell_impl *>(other_impl), other.d_);
 
             if (this_cell.get_data_type() != other_cell.get_data_type())
             {
                 return false;
             }
 
-            if (this_cell.get_data_type() == xlnt::cell::type::numeric && this_cell.get_value<long double>() != other_cell.get_value<long double>())
+            if (this_cell.get_data_type() == xlnt::cell::type::numeric && this_cell.get_value<double>() != other_cell.get_value<double>())
             {
                 return false;
             }
@@ -772,35 +863,42 @@ void worksheet::remove_named_range(const std::string &name)
     }
 
     d_->named_ranges_.erase(name);
+    get_workbook().impl().formulas_.invalidate();
 }
 
 void worksheet::reserve(std::size_t n)
 {
+    d_->parse_deferred();
     d_->cell_map_.reserve(n);
 }
 
 void worksheet::increment_comments()
 {
+    d_->parse_deferred();
     d_->comment_count_++;
 }
 
 void worksheet::decrement_comments()
 {
+    d_->parse_deferred();
     d_->comment_count_--;
 }
 
 std::size_t worksheet::get_comment_count() const
 {
+    d_->parse_deferred();
     return d_->comment_count_;
 }
 
 header_footer &worksheet::get_header_footer()
 {
+    d_->parse_deferred();
     return d_->header_footer_;
 }
 
 const header_footer &worksheet::get_header_footer() const
 {
+    d_->parse_deferred();
     return d_->header_footer_;
 }
 
@@ -901,31 +999,37 @@ sheet_state worksheet::get_sheet_state() const
 
 void worksheet::add_column_properties(column_t column, const xlnt::column_properties &props)
 {
+    d_->parse_deferred();
     d_->column_properties_[column] = props;
 }
 
 bool worksheet::has_column_properties(column_t column) const
 {
+    d_->parse_deferred();
     return d_->column_properties_.find(column) != d_->column_properties_.end();
 }
 
 column_properties &worksheet::get_column_properties(column_t column)
 {
+    d_->parse_deferred();
     return d_->column_properties_[column];
 }
 
 const column_properties &worksheet::get_column_properties(column_t column) const
 {
+    d_->parse_deferred();
     return d_->column_properties_.at(column);
 }
 
 row_properties &worksheet::get_row_properties(row_t row)
 {
+    d_->parse_deferred();
     return d_->row_properties_[row];
 }
 
 const row_properties &worksheet::get_row_properties(row_t row) const
 {
+    d_->parse_deferred();
     return d_->row_properties_.at(row);
 }
 
@@ -1001,16 +1105,20 @@ void worksheet::add_print_title(int i, const std::string &rows_or_cols)
 
 void worksheet::set_print_title_rows(const std::string &rows)
 {
+    d_->parse_deferred();
     d_->print_title_rows_ = rows;
 }
 
 void worksheet::set_print_title_cols(const std::string &cols)
 {
+    d_->parse_deferred();
     d_->print_title_cols_ = cols;
 }
 
 std::string worksheet::get_print_titles() const
 {
+    d_->parse_deferred();
+
     if (!d_->print_title_rows_.empty() && !d_->print_title_cols_.empty())
     {
         return d_->title_ + "!" + d_->print_title_rows_ + "," + d_->title_ + "!" + d_->print_title_cols_;
@@ -1027,37 +1135,67 @@ std::string worksheet::get_print_titles() const
 
 void worksheet::set_print_area(const std::string &print_area)
 {
+    d_->parse_deferred();
     d_->print_area_ = range_reference::make_absolute(range_reference(print_area));
 }
 
 range_reference worksheet::get_print_area() const
 {
+    d_->parse_deferred();
     return d_->print_area_;
 }
 
 bool worksheet::has_view() const
 {
+	d_->parse_deferred();
 	return d_->has_view_;
 }
 
 sheet_view worksheet::get_view() const
 {
+    d_->parse_deferred();
     return d_->view_;
 }
 
 bool worksheet::x14ac_enabled() const
 {
+	d_->parse_deferred();
 	return d_->x14ac_;
 }
 
 void worksheet::enable_x14ac()
 {
+	d_->parse_deferred();
 	d_->x14ac_ = true;
 }
 
 void worksheet::disable_x14ac()
 {
+	d_->parse_deferred();
 	d_->x14ac_ = false;
 }
 
+namespace detail {
+
+void worksheet_impl::parse_deferred()
+{
+    if (!is_deferred()) return;
+
+    auto &workbook = parent_->impl();
+    workbook.formulas_.parse_deferred(workbook, *this);
+}
+
+bool worksheet_inspector::is_deferred(const worksheet &ws)
+{
+    return ws.d_->is_deferred();
+}
+
+std::size_t worksheet_inspector::shared_cells(const worksheet &ws)
+{
+    ws.d_->parse_deferred();
+    return ws.d_->cell_map_.shared_cells();
+}
+
+} // namespace detail
+
 } // namespace xlnt